@@ -23,6 +23,7 @@
  */
 
 #include <crypto/hash.h>
+#include <crypto/authenc.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/gfp.h>
@@ -33,6 +34,8 @@
 #include <linux/jiffies.h>
 #include <linux/timex.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
+#include <linux/rtnetlink.h>
 #include "tcrypt.h"
 #include "internal.h"
 
@@ -719,6 +722,230 @@ out:
 	crypto_free_ahash(tfm);
 }
 
+/*
+ * Throughput of a parallelized AEAD such as pcrypt, with many requests in
+ * flight.  Each block size runs a second time while a kernel thread keeps
+ * one of the CPUs busy, which is what stalls the in-order completion of
+ * padata when its work stealing is off.
+ */
+#define AEAD_SPEED_INFLIGHT	128
+#define AEAD_SPEED_AUTHSIZE	12
+
+struct aead_speed {
+	atomic_t		inflight;
+	atomic_long_t		ops;
+	atomic_long_t		dropped;
+	unsigned long		end;
+	int			err;
+	struct completion	done;
+};
+
+struct aead_speed_req {
+	struct aead_request	*req;
+	struct aead_speed	*speed;
+	struct scatterlist	asg;
+	u8			assoc[8];
+	u8			iv[16];
+};
+
+static void aead_speed_submit(struct aead_speed_req *sreq);
+
+static void aead_speed_complete(struct crypto_async_request *areq, int err)
+{
+	struct aead_speed_req *sreq = areq->data;
+
+	if (err)
+		sreq->speed->err = err;
+	else
+		atomic_long_inc(&sreq->speed->ops);
+
+	aead_speed_submit(sreq);
+}
+
+/* Keeps resubmitting one request from its own completion until time is up */
+static void aead_speed_submit(struct aead_speed_req *sreq)
+{
+	struct aead_speed *speed = sreq->speed;
+	int ret;
+
+	while (!speed->err && time_before(jiffies, speed->end)) {
+		ret = crypto_aead_encrypt(sreq->req);
+		if (ret == -EINPROGRESS)
+			return;
+		/* pcrypt has no backlog, and we may not sleep here */
+		if (ret == -EBUSY) {
+			atomic_long_inc(&speed->dropped);
+			break;
+		}
+		if (ret) {
+			speed->err = ret;
+			break;
+		}
+		atomic_long_inc(&speed->ops);
+	}
+
+	if (atomic_dec_and_test(&speed->inflight))
+		complete(&speed->done);
+}
+
+static int aead_speed_run(struct aead_speed_req *sreqs, struct scatterlist *sg,
+			  unsigned int blen, unsigned int sec)
+{
+	struct aead_speed speed;
+	unsigned long start, elapsed, ops;
+	int i;
+
+	atomic_set(&speed.inflight, AEAD_SPEED_INFLIGHT);
+	atomic_long_set(&speed.ops, 0);
+	atomic_long_set(&speed.dropped, 0);
+	speed.err = 0;
+	init_completion(&speed.done);
+
+	for (i = 0; i < AEAD_SPEED_INFLIGHT; i++) {
+		sreqs[i].speed = &speed;
+		aead_request_set_crypt(sreqs[i].req, sg, sg, blen, sreqs[i].iv);
+	}
+
+	start = jiffies;
+	speed.end = start + sec * HZ;
+	for (i = 0; i < AEAD_SPEED_INFLIGHT; i++)
+		aead_speed_submit(&sreqs[i]);
+
+	wait_for_completion(&speed.done);
+	elapsed = jiffies - start;
+
+	if (speed.err)
+		return speed.err;
+
+	ops = atomic_long_read(&speed.ops);
+	pr_cont("%8lu opers/sec, %10lu bytes/sec",
+		ops * HZ / elapsed, ops * blen / elapsed * HZ);
+	if (atomic_long_read(&speed.dropped))
+		pr_cont(", %lu requests dropped on -EBUSY",
+			atomic_long_read(&speed.dropped));
+	pr_cont("\n");
+
+	return 0;
+}
+
+static int aead_speed_hog(void *unused)
+{
+	set_user_nice(current, -20);
+	while (!kthread_should_stop())
+		cond_resched();
+
+	return 0;
+}
+
+/* authenc keys carry the length of the cipher key in front of them */
+static int aead_speed_setkey(struct crypto_aead *tfm)
+{
+	struct crypto_authenc_key_param *param;
+	u8 key[RTA_SPACE(sizeof(*param)) + 20 + 16];
+	struct rtattr *rta = (void *)key;
+
+	memset(key, 0x5a, sizeof(key));
+	rta->rta_type = CRYPTO_AUTHENC_KEYA_PARAM;
+	rta->rta_len = RTA_LENGTH(sizeof(*param));
+	param = RTA_DATA(rta);
+	param->enckeylen = cpu_to_be32(16);
+
+	return crypto_aead_setkey(tfm, key, sizeof(key));
+}
+
+static void test_aead_speed(const char *algo, unsigned int sec,
+			    unsigned int *blens)
+{
+	struct aead_speed_req *sreqs;
+	struct scatterlist sg[TVMEMSIZE];
+	struct task_struct *hog;
+	struct crypto_aead *tfm;
+	int i, ret, cpu, hog_cpu = -1;
+
+	printk(KERN_INFO "\ntesting speed of parallel %s\n", algo);
+
+	tfm = crypto_alloc_aead(algo, 0, 0);
+	if (IS_ERR(tfm)) {
+		pr_err("failed to load transform for %s: %ld\n",
+		       algo, PTR_ERR(tfm));
+		return;
+	}
+
+	ret = aead_speed_setkey(tfm);
+	if (!ret)
+		ret = crypto_aead_setauthsize(tfm, AEAD_SPEED_AUTHSIZE);
+	if (ret) {
+		pr_err("setkey() failed flags=%x\n", crypto_aead_get_flags(tfm));
+		goto out;
+	}
+
+	sreqs = kcalloc(AEAD_SPEED_INFLIGHT, sizeof(*sreqs), GFP_KERNEL);
+	if (!sreqs)
+		goto out;
+
+	for (i = 0; i < AEAD_SPEED_INFLIGHT; i++) {
+		sreqs[i].req = aead_request_alloc(tfm, GFP_KERNEL);
+		if (!sreqs[i].req) {
+			pr_err("aead request allocation failure\n");
+			goto out_free_reqs;
+		}
+		sg_init_one(&sreqs[i].asg, sreqs[i].assoc,
+			    sizeof(sreqs[i].assoc));
+		aead_request_set_assoc(sreqs[i].req, &sreqs[i].asg,
+				       sizeof(sreqs[i].assoc));
+		aead_request_set_callback(sreqs[i].req, 0,
+					  aead_speed_complete, &sreqs[i]);
+	}
+
+	test_hash_sg_init(sg);
+
+	/* the time based runs need whole seconds */
+	if (!sec)
+		sec = 1;
+
+	if (num_online_cpus() > 1)
+		for_each_online_cpu(cpu)
+			hog_cpu = cpu;
+
+	for (i = 0; blens[i] != 0; i++) {
+		if (blens[i] + AEAD_SPEED_AUTHSIZE > TVMEMSIZE * PAGE_SIZE) {
+			pr_err("template (%u) too big for tvmem (%lu)\n",
+			       blens[i], TVMEMSIZE * PAGE_SIZE);
+			break;
+		}
+
+		printk(KERN_INFO "test %u (%d byte blocks): ", i, blens[i]);
+		ret = aead_speed_run(sreqs, sg, blens[i], sec);
+		if (ret || hog_cpu < 0)
+			goto check;
+
+		hog = kthread_create(aead_speed_hog, NULL, "tcrypt_hog");
+		if (IS_ERR(hog)) {
+			ret = PTR_ERR(hog);
+			goto check;
+		}
+		kthread_bind(hog, hog_cpu);
+		wake_up_process(hog);
+
+		printk(KERN_INFO "test %u (%d byte blocks, cpu %d busy): ",
+		       i, blens[i], hog_cpu);
+		ret = aead_speed_run(sreqs, sg, blens[i], sec);
+		kthread_stop(hog);
+check:
+		if (ret) {
+			pr_err("encryption failed ret=%d\n", ret);
+			break;
+		}
+	}
+
+out_free_reqs:
+	for (i = 0; i < AEAD_SPEED_INFLIGHT; i++)
+		aead_request_free(sreqs[i].req);
+	kfree(sreqs);
+out:
+	crypto_free_aead(tfm);
+}
+
 static void test_available(void)
 {
 	char **name = check;
@@ -1231,6 +1458,19 @@ static int do_test(int m)
 	case 499:
 		break;
 
+	case 500:
+		test_aead_speed("pcrypt(authenc(hmac(sha1),cbc(aes)))", sec,
+				aead_speed_template);
+		if (mode > 500 && mode < 600) break;
+
+	case 501:
+		test_aead_speed("pcrypt(authenc(hmac(sha256),cbc(aes)))", sec,
+				aead_speed_template);
+		if (mode > 500 && mode < 600) break;
+
+	case 599:
+		break;
+
 	case 1000:
 		test_available();
 		break;
@@ -53,6 +53,11 @@ static u8 speed_template_16_24_32[] = {16, 24, 32, 0};
 static u8 speed_template_32_40_48[] = {32, 40, 48, 0};
 static u8 speed_template_32_48_64[] = {32, 48, 64, 0};
 
+/*
+ * AEAD speed tests, block sizes in bytes
+ */
+static unsigned int aead_speed_template[] = {64, 256, 1024, 4096, 0};
+
 /*
  * Digest speed tests
  */
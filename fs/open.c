@@ -100,6 +100,7 @@ static long do_sys_truncate(const char __user *pathname, loff_t length)
 	error = get_write_access(inode);
 	if (error)
 		goto mnt_drop_write_and_out;
+	filemap_huge_write_access(inode->i_mapping);
 
 	/*
 	 * Make sure that there are no leases.  get_write_access() protects
@@ -664,8 +665,10 @@ static struct file *__dentry_open(struct dentry *dentry, struct vfsmount *mnt,
 		error = __get_file_write_access(inode, mnt);
 		if (error)
 			goto cleanup_file;
-		if (!special_file(inode->i_mode))
+		if (!special_file(inode->i_mode)) {
 			file_take_write(f);
+			filemap_huge_write_access(inode->i_mapping);
+		}
 	}
 
 	f->f_mapping = inode->i_mapping;
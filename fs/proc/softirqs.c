@@ -2,23 +2,54 @@
 #include <linux/kernel_stat.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/time.h>
+#include <asm/div64.h>
+
+static void show_softirqs_header(struct seq_file *p, const char *title)
+{
+	int i;
+
+	seq_printf(p, "%-20s", title);
+	for_each_possible_cpu(i)
+		seq_printf(p, "CPU%-8d", i);
+	seq_putc(p, '\n');
+}
 
 /*
- * /proc/softirqs  ... display the number of softirqs
+ * /proc/softirqs  ... display the number of softirqs, the time spent
+ * in each vector and how often a vector was left to ksoftirqd
  */
 static int show_softirqs(struct seq_file *p, void *v)
 {
 	int i, j;
 
-	seq_puts(p, "                    ");
-	for_each_possible_cpu(i)
-		seq_printf(p, "CPU%-8d", i);
+	show_softirqs_header(p, "");
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j)
+			seq_printf(p, " %10u", kstat_softirqs_cpu(i, j));
+		seq_putc(p, '\n');
+	}
+
 	seq_putc(p, '\n');
+	show_softirqs_header(p, "TIME(us)");
+	for (i = 0; i < NR_SOFTIRQS; i++) {
+		seq_printf(p, "%12s:", softirq_to_name[i]);
+		for_each_possible_cpu(j) {
+			u64 t = kstat_softirq_time_cpu(i, j);
 
+			do_div(t, NSEC_PER_USEC);
+			seq_printf(p, " %10llu", (unsigned long long)t);
+		}
+		seq_putc(p, '\n');
+	}
+
+	seq_putc(p, '\n');
+	show_softirqs_header(p, "DEFERRED");
 	for (i = 0; i < NR_SOFTIRQS; i++) {
 		seq_printf(p, "%12s:", softirq_to_name[i]);
 		for_each_possible_cpu(j)
-			seq_printf(p, " %10u", kstat_softirqs_cpu(i, j));
+			seq_printf(p, " %10u", kstat_softirqs_deferred_cpu(i, j));
 		seq_putc(p, '\n');
 	}
 	return 0;
@@ -341,6 +341,17 @@ extern struct page *alloc_pages_vma(gfp_t gfp_mask, int order,
 #define alloc_page_vma_node(gfp_mask, vma, addr, node)		\
 	alloc_pages_vma(gfp_mask, 0, vma, addr, node)
 
+extern unsigned long alloc_pages_bulk_node(int nid, gfp_t gfp_mask,
+					   unsigned long nr_pages,
+					   struct list_head *list);
+
+static inline unsigned long alloc_pages_bulk(gfp_t gfp_mask,
+					     unsigned long nr_pages,
+					     struct list_head *list)
+{
+	return alloc_pages_bulk_node(-1, gfp_mask, nr_pages, list);
+}
+
 extern unsigned long __get_free_pages(gfp_t gfp_mask, unsigned int order);
 extern unsigned long get_zeroed_page(gfp_t gfp_mask);
 
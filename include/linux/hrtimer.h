@@ -36,6 +36,8 @@ enum hrtimer_mode {
 	HRTIMER_MODE_PINNED = 0x02,	/* Timer is bound to CPU */
 	HRTIMER_MODE_ABS_PINNED = 0x02,
 	HRTIMER_MODE_REL_PINNED = 0x03,
+	HRTIMER_MODE_DEFERRABLE = 0x04,	/* Timer does not wake an idle CPU,
+					   only valid for hrtimer_init() */
 };
 
 /*
@@ -96,6 +98,10 @@ enum hrtimer_restart {
  * @function:	timer expiry callback function
  * @base:	pointer to the timer base (per cpu and per clock)
  * @state:	state information (See bit values above)
+ * @deferrable:	set by hrtimer_init() with HRTIMER_MODE_DEFERRABLE. An idle
+ *		CPU is not woken up for this timer; it runs at the first
+ *		hrtimer interrupt after its soft expiry or when the CPU
+ *		leaves idle, whichever comes first.
  * @start_site:	timer statistics field to store the site where the timer
  *		was started
  * @start_comm: timer statistics field to store the name of the process which
@@ -111,6 +117,7 @@ struct hrtimer {
 	enum hrtimer_restart		(*function)(struct hrtimer *);
 	struct hrtimer_clock_base	*base;
 	unsigned long			state;
+	int				deferrable;
 #ifdef CONFIG_TIMER_STATS
 	int				start_pid;
 	void				*start_site;
@@ -165,27 +172,42 @@ enum  hrtimer_base_type {
  * @lock:		lock protecting the base and associated clock bases
  *			and timers
  * @active_bases:	Bitfield to mark bases with active timers
+ * @nr_deferrable:	Number of enqueued deferrable timers
  * @expires_next:	absolute time of the next event which was scheduled
  *			via clock_set_next_event()
  * @hres_active:	State of high resolution mode
  * @hang_detected:	The last hrtimer interrupt detected a hang
+ * @idle:		The tick is stopped, deferrable timers do not
+ *			program the event device
  * @nr_events:		Total number of hrtimer interrupt events
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
+ * @nr_reprograms:	Total number of event device reprograms
+ * @nr_coalesced:	Timers expired ahead of their hard expiry, by an
+ *			event programmed for another timer
+ * @nr_reprogram_skips:	Reprograms avoided because the next timer's range
+ *			covers the already programmed event
+ * @nr_deferred:	Deferrable timers passed over while idle
  * @clock_base:		array of clock bases for this cpu
  */
 struct hrtimer_cpu_base {
 	raw_spinlock_t			lock;
 	unsigned long			active_bases;
+	unsigned int			nr_deferrable;
 #ifdef CONFIG_HIGH_RES_TIMERS
 	ktime_t				expires_next;
 	int				hres_active;
 	int				hang_detected;
+	int				idle;
 	unsigned long			nr_events;
 	unsigned long			nr_retries;
 	unsigned long			nr_hangs;
 	ktime_t				max_hang_time;
+	unsigned long			nr_reprograms;
+	unsigned long			nr_coalesced;
+	unsigned long			nr_reprogram_skips;
+	unsigned long			nr_deferred;
 #endif
 	struct hrtimer_clock_base	clock_base[HRTIMER_MAX_CLOCK_BASES];
 };
@@ -274,6 +296,8 @@ static inline int hrtimer_is_hres_active(struct hrtimer *timer)
 }
 
 extern void hrtimer_peek_ahead_timers(void);
+extern void hrtimer_idle_enter(void);
+extern void hrtimer_idle_exit(void);
 
 /*
  * The resolution of the clocks. The resolution value is returned in
@@ -292,6 +316,8 @@ extern void hrtimer_peek_ahead_timers(void);
 # define KTIME_MONOTONIC_RES	KTIME_LOW_RES
 
 static inline void hrtimer_peek_ahead_timers(void) { }
+static inline void hrtimer_idle_enter(void) { }
+static inline void hrtimer_idle_exit(void) { }
 
 /*
  * In non high resolution mode the time reference is taken from
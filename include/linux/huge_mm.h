@@ -5,6 +5,10 @@ extern int do_huge_pmd_anonymous_page(struct mm_struct *mm,
 				      struct vm_area_struct *vma,
 				      unsigned long address, pmd_t *pmd,
 				      unsigned int flags);
+extern int do_huge_pmd_file_page(struct mm_struct *mm,
+				 struct vm_area_struct *vma,
+				 unsigned long address, pmd_t *pmd,
+				 unsigned int flags);
 extern int copy_huge_pmd(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 			 pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr,
 			 struct vm_area_struct *vma);
@@ -31,6 +35,8 @@ enum transparent_hugepage_flag {
 	TRANSPARENT_HUGEPAGE_DEFRAG_FLAG,
 	TRANSPARENT_HUGEPAGE_DEFRAG_REQ_MADV_FLAG,
 	TRANSPARENT_HUGEPAGE_DEFRAG_KHUGEPAGED_FLAG,
+	TRANSPARENT_HUGEPAGE_FILE_FLAG,
+	TRANSPARENT_HUGEPAGE_FILE_REQ_MADV_FLAG,
 #ifdef CONFIG_DEBUG_VM
 	TRANSPARENT_HUGEPAGE_DEBUG_COW_FLAG,
 #endif
@@ -65,6 +71,25 @@ extern pmd_t *page_check_address_pmd(struct page *page,
 	 (transparent_hugepage_flags &					\
 	  (1<<TRANSPARENT_HUGEPAGE_DEFRAG_REQ_MADV_FLAG) &&		\
 	  (__vma)->vm_flags & VM_HUGEPAGE))
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+struct vm_fault;
+extern int filemap_fault(struct vm_area_struct *, struct vm_fault *);
+/* mappings whose page cache is managed by the generic filemap code */
+#define filemap_huge_vma(__vma)						\
+	((__vma)->vm_ops && (__vma)->vm_ops->fault == filemap_fault)
+#define transparent_hugepage_file_enabled(__vma)			\
+	((transparent_hugepage_flags &					\
+	  (1<<TRANSPARENT_HUGEPAGE_FILE_FLAG) ||			\
+	  (transparent_hugepage_flags &					\
+	   (1<<TRANSPARENT_HUGEPAGE_FILE_REQ_MADV_FLAG) &&		\
+	   ((__vma)->vm_flags & VM_HUGEPAGE))) &&			\
+	 !((__vma)->vm_flags & (VM_NOHUGEPAGE | VM_WRITE |		\
+				VM_SHARED | VM_NONLINEAR)) &&		\
+	 filemap_huge_vma(__vma))
+#else /* CONFIG_TRANSPARENT_HUGEPAGE_FILE */
+#define filemap_huge_vma(__vma) 0
+#define transparent_hugepage_file_enabled(__vma) 0
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE_FILE */
 #ifdef CONFIG_DEBUG_VM
 #define transparent_hugepage_debug_cow()				\
 	(transparent_hugepage_flags &					\
@@ -113,7 +138,7 @@ static inline void vma_adjust_trans_huge(struct vm_area_struct *vma,
 					 unsigned long end,
 					 long adjust_next)
 {
-	if (!vma->anon_vma || vma->vm_ops)
+	if ((!vma->anon_vma || vma->vm_ops) && !filemap_huge_vma(vma))
 		return;
 	__vma_adjust_trans_huge(vma, start, end, adjust_next);
 }
@@ -148,6 +173,7 @@ static inline struct page *compound_trans_head(struct page *page)
 #define hpage_nr_pages(x) 1
 
 #define transparent_hugepage_enabled(__vma) 0
+#define transparent_hugepage_file_enabled(__vma) 0
 
 #define transparent_hugepage_flags 0UL
 static inline int split_huge_page(struct page *page)
@@ -102,6 +102,7 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
  * @thread:	thread pointer for threaded interrupts
  * @thread_flags:	flags related to @thread
  * @thread_mask:	bitmask for keeping track of @thread activity
+ * @wake_stamp:	time the hard interrupt last woke @thread
  */
 struct irqaction {
 	irq_handler_t handler;
@@ -115,6 +116,9 @@ struct irqaction {
 	unsigned long thread_mask;
 	const char *name;
 	struct proc_dir_entry *dir;
+#ifdef CONFIG_IRQ_LATENCY_STATS
+	u64 wake_stamp;
+#endif
 } ____cacheline_internodealigned_in_smp;
 
 extern irqreturn_t no_action(int cpl, void *dev_id);
@@ -137,6 +141,15 @@ request_any_context_irq(unsigned int irq, irq_handler_t handler,
 			unsigned long flags, const char *name, void *dev_id);
 
 extern void exit_irq_thread(void);
+
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+struct ctl_table;
+
+extern int sysctl_irq_thread_balance;
+extern int sysctl_irq_thread_balance_rate;
+extern int irq_thread_balance_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp, loff_t *ppos);
+#endif
 #else
 
 extern int __must_check
@@ -424,6 +437,10 @@ enum
  */
 extern char *softirq_to_name[NR_SOFTIRQS];
 
+/* softirq time budget and deferral policy, see kernel/softirq.c */
+extern unsigned int sysctl_softirq_budget_us;
+extern unsigned int sysctl_softirq_defer_mask;
+
 /* softirq mask and active fields moved to irq_cpustat_t in
  * asm/hardirq.h to get better cache usage.  KAO
  */
@@ -787,6 +787,310 @@ __kfifo_uint_must_check_helper( \
 }) \
 )
 
+/*
+ * Multi producer / multi consumer fifos
+ *
+ * The kfifo_mp_* macros may be used by any number of concurrent writers
+ * and readers, in process as well as in interrupt context, without an
+ * external lock.  A writer claims space by advancing a reservation index
+ * with cmpxchg, copies its data in and then publishes it by advancing
+ * fifo->in, in the order the space was claimed; readers work the same
+ * way on fifo->out.  Interrupts are disabled from claim to publish, so
+ * a writer never waits for another one that it interrupted.  Don't use
+ * them from NMI context.
+ *
+ * A fifo declared with one of the *_KFIFO_MP macros must only be written
+ * and read with the kfifo_mp_* macros.  The plain kfifo_len(),
+ * kfifo_is_empty(), kfifo_size(), kfifo_esize(), kfifo_recsize() and
+ * kfifo_peek_len() may be used on it, with the usual caveat that the
+ * answer may be outdated by the time it is looked at.
+ */
+struct __kfifo_mp {
+	struct __kfifo	kfifo;
+	unsigned int	head;	/* space claimed by writers */
+	unsigned int	tail;	/* data claimed by readers */
+};
+
+#define __STRUCT_KFIFO_MP_COMMON(datatype, recsize, ptrtype) \
+	union { \
+		struct __kfifo	kfifo; \
+		struct __kfifo_mp mp; \
+		datatype	*type; \
+		char		(*rectype)[recsize]; \
+		ptrtype		*ptr; \
+		const ptrtype	*ptr_const; \
+	}
+
+#define __STRUCT_KFIFO_MP(type, size, recsize, ptrtype) \
+{ \
+	__STRUCT_KFIFO_MP_COMMON(type, recsize, ptrtype); \
+	type		buf[((size < 2) || (size & (size - 1))) ? -1 : size]; \
+}
+
+#define STRUCT_KFIFO_MP(type, size) \
+	struct __STRUCT_KFIFO_MP(type, size, 0, type)
+
+#define __STRUCT_KFIFO_MP_PTR(type, recsize, ptrtype) \
+{ \
+	__STRUCT_KFIFO_MP_COMMON(type, recsize, ptrtype); \
+	type		buf[0]; \
+}
+
+#define STRUCT_KFIFO_MP_PTR(type) \
+	struct __STRUCT_KFIFO_MP_PTR(type, 0, type)
+
+/*
+ * define "struct kfifo_mp" for dynamic allocated byte fifos
+ */
+struct kfifo_mp __STRUCT_KFIFO_MP_PTR(unsigned char, 0, void);
+
+#define STRUCT_KFIFO_MP_REC_1(size) \
+	struct __STRUCT_KFIFO_MP(unsigned char, size, 1, void)
+
+#define STRUCT_KFIFO_MP_REC_2(size) \
+	struct __STRUCT_KFIFO_MP(unsigned char, size, 2, void)
+
+/*
+ * define kfifo_mp_rec types
+ */
+struct kfifo_mp_rec_ptr_1 __STRUCT_KFIFO_MP_PTR(unsigned char, 1, void);
+struct kfifo_mp_rec_ptr_2 __STRUCT_KFIFO_MP_PTR(unsigned char, 2, void);
+
+#define	__is_kfifo_mp_ptr(fifo)	(sizeof(*fifo) == sizeof(struct __kfifo_mp))
+
+/**
+ * DECLARE_KFIFO_MP_PTR - macro to declare a multi producer fifo pointer object
+ * @fifo: name of the declared fifo
+ * @type: type of the fifo elements
+ */
+#define DECLARE_KFIFO_MP_PTR(fifo, type)	STRUCT_KFIFO_MP_PTR(type) fifo
+
+/**
+ * DECLARE_KFIFO_MP - macro to declare a multi producer fifo object
+ * @fifo: name of the declared fifo
+ * @type: type of the fifo elements
+ * @size: the number of elements in the fifo, this must be a power of 2
+ */
+#define DECLARE_KFIFO_MP(fifo, type, size)	STRUCT_KFIFO_MP(type, size) fifo
+
+/**
+ * INIT_KFIFO_MP - Initialize a fifo declared by DECLARE_KFIFO_MP
+ * @fifo: name of the declared fifo datatype
+ */
+#define INIT_KFIFO_MP(fifo) \
+(void)({ \
+	typeof(&(fifo)) __tmp = &(fifo); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	__mp->kfifo.in = 0; \
+	__mp->kfifo.out = 0; \
+	__mp->kfifo.mask = __is_kfifo_mp_ptr(__tmp) ? \
+			   0 : ARRAY_SIZE(__tmp->buf) - 1; \
+	__mp->kfifo.esize = sizeof(*__tmp->buf); \
+	__mp->kfifo.data = __is_kfifo_mp_ptr(__tmp) ?  NULL : __tmp->buf; \
+	__mp->head = 0; \
+	__mp->tail = 0; \
+})
+
+/**
+ * DEFINE_KFIFO_MP - macro to define and initialize a multi producer fifo
+ * @fifo: name of the declared fifo datatype
+ * @type: type of the fifo elements
+ * @size: the number of elements in the fifo, this must be a power of 2
+ *
+ * Note: the macro can be used for global and local fifo data type variables.
+ */
+#define DEFINE_KFIFO_MP(fifo, type, size) \
+	DECLARE_KFIFO_MP(fifo, type, size) = \
+	(typeof(fifo)) { \
+		{ \
+			.mp = { \
+				.kfifo = { \
+				.in	= 0, \
+				.out	= 0, \
+				.mask	= ARRAY_SIZE((fifo).buf) - 1, \
+				.esize	= sizeof(*(fifo).buf), \
+				.data	= (fifo).buf, \
+				}, \
+				.head	= 0, \
+				.tail	= 0, \
+			} \
+		} \
+	}
+
+/**
+ * kfifo_mp_reset - removes the entire fifo content
+ * @fifo: address of the fifo to be used
+ *
+ * Note: like kfifo_reset(), this may only be called when it is secured
+ * that no other thread is accessing the fifo.
+ */
+#define kfifo_mp_reset(fifo) \
+(void)({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	__tmp->mp.kfifo.in = __tmp->mp.kfifo.out = 0; \
+	__tmp->mp.head = __tmp->mp.tail = 0; \
+})
+
+/**
+ * kfifo_mp_alloc - dynamically allocates a new multi producer fifo buffer
+ * @fifo: pointer to the fifo
+ * @size: the number of elements in the fifo, this must be a power of 2
+ * @gfp_mask: get_free_pages mask, passed to kmalloc()
+ *
+ * This macro dynamically allocates a new fifo buffer.
+ *
+ * The numer of elements will be rounded-up to a power of 2.
+ * The fifo will be release with kfifo_mp_free().
+ * Return 0 if no error, otherwise an error code.
+ */
+#define kfifo_mp_alloc(fifo, size, gfp_mask) \
+__kfifo_int_must_check_helper( \
+({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	__mp->head = __mp->tail = 0; \
+	__is_kfifo_mp_ptr(__tmp) ? \
+	__kfifo_alloc(&__mp->kfifo, size, sizeof(*__tmp->type), gfp_mask) : \
+	-EINVAL; \
+}) \
+)
+
+/**
+ * kfifo_mp_free - frees the multi producer fifo
+ * @fifo: the fifo to be freed
+ */
+#define kfifo_mp_free(fifo) \
+({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	if (__is_kfifo_mp_ptr(__tmp)) { \
+		__kfifo_free(&__mp->kfifo); \
+		__mp->head = __mp->tail = 0; \
+	} \
+})
+
+/**
+ * kfifo_mp_init - initialize a multi producer fifo using a preallocated buffer
+ * @fifo: the fifo to assign the buffer
+ * @buffer: the preallocated buffer to be used
+ * @size: the size of the internal buffer, this have to be a power of 2
+ *
+ * This macro initialize a fifo using a preallocated buffer.
+ *
+ * The numer of elements will be rounded-up to a power of 2.
+ * Return 0 if no error, otherwise an error code.
+ */
+#define kfifo_mp_init(fifo, buffer, size) \
+({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	__mp->head = __mp->tail = 0; \
+	__is_kfifo_mp_ptr(__tmp) ? \
+	__kfifo_init(&__mp->kfifo, buffer, size, sizeof(*__tmp->type)) : \
+	-EINVAL; \
+})
+
+/**
+ * kfifo_mp_in - put data into a multi producer fifo
+ * @fifo: address of the fifo to be used
+ * @buf: the data to be added
+ * @n: number of elements to be added
+ *
+ * This macro copies the given buffer into the fifo and returns the
+ * number of copied elements.  For a record fifo the record is added
+ * completely or not at all.
+ *
+ * Any number of writers may use this macro concurrently.
+ */
+#define	kfifo_mp_in(fifo, buf, n) \
+({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	typeof((buf) + 1) __buf = (buf); \
+	unsigned long __n = (n); \
+	const size_t __recsize = sizeof(*__tmp->rectype); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	if (0) { \
+		typeof(__tmp->ptr_const) __dummy __attribute__ ((unused)); \
+		__dummy = (typeof(__buf))NULL; \
+	} \
+	(__recsize) ?\
+	__kfifo_mp_in_r(__mp, __buf, __n, __recsize) : \
+	__kfifo_mp_in(__mp, __buf, __n); \
+})
+
+/**
+ * kfifo_mp_put - put a single element into a multi producer fifo
+ * @fifo: address of the fifo to be used
+ * @val: the data to be added
+ *
+ * This macro copies the given value into the fifo.
+ * It returns 0 if the fifo was full. Otherwise it returns the number
+ * processed elements.
+ *
+ * Any number of writers may use this macro concurrently.
+ */
+#define	kfifo_mp_put(fifo, val) \
+({ \
+	typeof((fifo) + 1) __tmpp = (fifo); \
+	typeof((val) + 1) __val = (val); \
+	const size_t __recsizep = sizeof(*__tmpp->rectype); \
+	(__recsizep) ? \
+	kfifo_mp_in(__tmpp, __val, sizeof(*__val)) : \
+	kfifo_mp_in(__tmpp, __val, 1); \
+})
+
+/**
+ * kfifo_mp_out - get data from a multi producer fifo
+ * @fifo: address of the fifo to be used
+ * @buf: pointer to the storage buffer
+ * @n: max. number of elements to get
+ *
+ * This macro get some data from the fifo and return the numbers of elements
+ * copied.
+ *
+ * Any number of readers may use this macro concurrently.
+ */
+#define	kfifo_mp_out(fifo, buf, n) \
+__kfifo_uint_must_check_helper( \
+({ \
+	typeof((fifo) + 1) __tmp = (fifo); \
+	typeof((buf) + 1) __buf = (buf); \
+	unsigned long __n = (n); \
+	const size_t __recsize = sizeof(*__tmp->rectype); \
+	struct __kfifo_mp *__mp = &__tmp->mp; \
+	if (0) { \
+		typeof(__tmp->ptr) __dummy = NULL; \
+		__buf = __dummy; \
+	} \
+	(__recsize) ?\
+	__kfifo_mp_out_r(__mp, __buf, __n, __recsize) : \
+	__kfifo_mp_out(__mp, __buf, __n); \
+}) \
+)
+
+/**
+ * kfifo_mp_get - get a single element from a multi producer fifo
+ * @fifo: address of the fifo to be used
+ * @val: the var where to store the data to be added
+ *
+ * This macro reads the data from the fifo.
+ * It returns 0 if the fifo was empty. Otherwise it returns the number
+ * processed elements.
+ *
+ * Any number of readers may use this macro concurrently.
+ */
+#define	kfifo_mp_get(fifo, val) \
+__kfifo_uint_must_check_helper( \
+({ \
+	typeof((fifo) + 1) __tmpg = (fifo); \
+	typeof((val) + 1) __val = (val); \
+	const size_t __recsizeg = sizeof(*__tmpg->rectype); \
+	(__recsizeg) ? \
+	kfifo_mp_out(__tmpg, __val, sizeof(*__val)) : \
+	kfifo_mp_out(__tmpg, __val, 1); \
+}) \
+)
+
 extern int __kfifo_alloc(struct __kfifo *fifo, unsigned int size,
 	size_t esize, gfp_t gfp_mask);
 
@@ -849,4 +1153,16 @@ extern unsigned int __kfifo_out_peek_r(struct __kfifo *fifo,
 
 extern unsigned int __kfifo_max_r(unsigned int len, size_t recsize);
 
+extern unsigned int __kfifo_mp_in(struct __kfifo_mp *mp,
+	const void *buf, unsigned int len);
+
+extern unsigned int __kfifo_mp_out(struct __kfifo_mp *mp,
+	void *buf, unsigned int len);
+
+extern unsigned int __kfifo_mp_in_r(struct __kfifo_mp *mp,
+	const void *buf, unsigned int len, size_t recsize);
+
+extern unsigned int __kfifo_mp_out_r(struct __kfifo_mp *mp,
+	void *buf, unsigned int len, size_t recsize);
+
 #endif
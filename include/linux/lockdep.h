@@ -394,6 +394,34 @@ struct lock_class_key { };
 
 #endif /* !LOCKDEP */
 
+/*
+ * Contention statistics without lockdep, see kernel/lock_contention.c.
+ * Only the slowpath pays: the clock is read after the trylock failed.
+ */
+enum {
+	LOCK_CONTENTION_SPIN,
+	LOCK_CONTENTION_RWLOCK,
+	LOCK_CONTENTION_MUTEX,
+	LOCK_CONTENTION_RWSEM,
+	LOCK_CONTENTION_NR,
+};
+
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+extern u64 lock_contention_begin(void);
+extern void lock_contention_end(void *lock, unsigned long ip, int type,
+				u64 start);
+#else
+static inline u64 lock_contention_begin(void)
+{
+	return 0;
+}
+
+static inline void lock_contention_end(void *lock, unsigned long ip,
+				       int type, u64 start)
+{
+}
+#endif
+
 #ifdef CONFIG_LOCK_STAT
 
 extern void lock_contended(struct lockdep_map *lock, unsigned long ip);
@@ -413,9 +441,35 @@ do {								\
 #define lock_contended(lockdep_map, ip) do {} while (0)
 #define lock_acquired(lockdep_map, ip) do {} while (0)
 
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+
+#define lock_contention_type(_lock)					\
+	__builtin_choose_expr(						\
+		__builtin_types_compatible_p(typeof(*(_lock)),		\
+					     struct rw_semaphore),	\
+		LOCK_CONTENTION_RWSEM,					\
+	__builtin_choose_expr(						\
+		__builtin_types_compatible_p(typeof(*(_lock)), rwlock_t), \
+		LOCK_CONTENTION_RWLOCK, LOCK_CONTENTION_SPIN))
+
+#define LOCK_CONTENDED(_lock, try, lock)				\
+do {									\
+	if (!try(_lock)) {						\
+		u64 __lc_start = lock_contention_begin();		\
+									\
+		lock(_lock);						\
+		lock_contention_end((_lock), _RET_IP_,			\
+				    lock_contention_type(_lock),	\
+				    __lc_start);			\
+	}								\
+} while (0)
+
+#else /* CONFIG_LOCK_CONTENTION_STAT */
+
 #define LOCK_CONTENDED(_lock, try, lock) \
 	lock(_lock)
 
+#endif /* CONFIG_LOCK_CONTENTION_STAT */
 #endif /* CONFIG_LOCK_STAT */
 
 #ifdef CONFIG_LOCKDEP
@@ -428,6 +482,20 @@ do {								\
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
 	LOCK_CONTENDED((_lock), (try), (lock))
 
+#elif defined(CONFIG_LOCK_CONTENTION_STAT)
+
+#define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags)		\
+do {									\
+	if (!try(_lock)) {						\
+		u64 __lc_start = lock_contention_begin();		\
+									\
+		lockfl((_lock), (flags));				\
+		lock_contention_end((_lock), _RET_IP_,			\
+				    lock_contention_type(_lock),	\
+				    __lc_start);			\
+	}								\
+} while (0)
+
 #else /* CONFIG_LOCKDEP */
 
 #define LOCK_CONTENDED_FLAGS(_lock, try, lock, lockfl, flags) \
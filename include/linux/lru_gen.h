@@ -0,0 +1,34 @@
+#ifndef _LINUX_LRU_GEN_H
+#define _LINUX_LRU_GEN_H
+
+#include <linux/mm_types.h>
+
+#ifdef CONFIG_LRU_GEN
+extern void lru_gen_add_mm(struct mm_struct *mm);
+extern void __lru_gen_del_mm(struct mm_struct *mm);
+
+static inline void lru_gen_init_mm(struct mm_struct *mm)
+{
+	INIT_LIST_HEAD(&mm->lru_gen_list);
+}
+
+static inline void lru_gen_del_mm(struct mm_struct *mm)
+{
+	if (!list_empty(&mm->lru_gen_list))
+		__lru_gen_del_mm(mm);
+}
+#else
+static inline void lru_gen_init_mm(struct mm_struct *mm)
+{
+}
+
+static inline void lru_gen_add_mm(struct mm_struct *mm)
+{
+}
+
+static inline void lru_gen_del_mm(struct mm_struct *mm)
+{
+}
+#endif
+
+#endif /* _LINUX_LRU_GEN_H */
@@ -21,6 +21,55 @@ static inline int page_is_file_cache(struct page *page)
 	return !PageSwapBacked(page);
 }
 
+/**
+ * lru_add_head - where a page on LRU list @l is added
+ * @zone: the page's zone
+ * @l: the LRU list the page is accounted to
+ *
+ * With the multi-generational LRU an evictable page goes to a generation
+ * list instead: an active page to the youngest generation, any other page
+ * to the second oldest one, so it is not the first thing to be evicted.
+ */
+static inline struct list_head *lru_add_head(struct zone *zone, enum lru_list l)
+{
+#ifdef CONFIG_LRU_GEN
+	if (lru_gen_enabled() && !is_unevictable_lru(l)) {
+		struct lru_gen *lrugen = &zone->lrugen;
+		int file = is_file_lru(l);
+		unsigned long seq;
+
+		if (is_active_lru(l))
+			seq = lrugen->max_seq;
+		else
+			seq = min(lrugen->min_seq[file] + 1, lrugen->max_seq);
+		return &lrugen->lists[lru_gen_from_seq(seq)][file];
+	}
+#endif
+	return &zone->lru[l].list;
+}
+
+/**
+ * lru_reclaim_head - where a page on LRU list @l is rotated to for reclaim
+ * @zone: the page's zone
+ * @l: the LRU list the page is accounted to
+ *
+ * Pages moved to the tail of the returned list are reclaimed next: the
+ * inactive list, or the oldest generation with the multi-generational LRU.
+ */
+static inline struct list_head *
+lru_reclaim_head(struct zone *zone, enum lru_list l)
+{
+#ifdef CONFIG_LRU_GEN
+	if (lru_gen_enabled() && !is_unevictable_lru(l)) {
+		struct lru_gen *lrugen = &zone->lrugen;
+		int file = is_file_lru(l);
+
+		return &lrugen->lists[lru_gen_from_seq(lrugen->min_seq[file])][file];
+	}
+#endif
+	return &zone->lru[l].list;
+}
+
 static inline void
 __add_page_to_lru_list(struct zone *zone, struct page *page, enum lru_list l,
 		       struct list_head *head)
@@ -33,7 +82,7 @@ __add_page_to_lru_list(struct zone *zone, struct page *page, enum lru_list l,
 static inline void
 add_page_to_lru_list(struct zone *zone, struct page *page, enum lru_list l)
 {
-	__add_page_to_lru_list(zone, page, l, &zone->lru[l].list);
+	__add_page_to_lru_list(zone, page, l, lru_add_head(zone, l));
 }
 
 static inline void
@@ -115,6 +115,14 @@ enum zone_stat_item {
 	NUMA_OTHER,		/* allocation from other node */
 #endif
 	NR_ANON_TRANSPARENT_HUGEPAGES,
+	NR_FILE_TRANSPARENT_HUGEPAGES,	/* huge pages in the page cache */
+#ifdef CONFIG_COMPACTION
+	NR_COMPACT_STALL,	/* direct compaction runs on this zone */
+	NR_COMPACT_SUCCESS,	/* direct compaction led to an allocation */
+	NR_COMPACT_FAIL,	/* direct compaction did not */
+	NR_KCOMPACTD_SUCCESS,	/* kcompactd runs that met the watermark */
+	NR_KCOMPACTD_FAIL,	/* kcompactd runs that did not */
+#endif
 	NR_VM_ZONE_STAT_ITEMS };
 
 /*
@@ -158,6 +166,44 @@ static inline int is_unevictable_lru(enum lru_list l)
 	return (l == LRU_UNEVICTABLE);
 }
 
+#ifdef CONFIG_LRU_GEN
+/*
+ * The multi-generational LRU (see mm/lru_gen.c) keeps the evictable pages
+ * of a zone on per generation lists instead of zone->lru[].  Generations
+ * are numbered by an ever increasing sequence number; max_seq is the
+ * youngest generation and min_seq[] the oldest one of each type, anon and
+ * file.  There are always between MIN_NR_GENS and MAX_NR_GENS of them.
+ */
+#define MIN_NR_GENS	2
+#define MAX_NR_GENS	4
+
+struct lru_gen {
+	unsigned long		max_seq;
+	unsigned long		min_seq[2];
+	/* jiffies at which each generation was created */
+	unsigned long		timestamps[MAX_NR_GENS];
+	/* pages are added at the head and evicted from the tail */
+	struct list_head	lists[MAX_NR_GENS][2];
+};
+
+extern bool lru_gen_active;
+
+static inline bool lru_gen_enabled(void)
+{
+	return lru_gen_active;
+}
+
+static inline int lru_gen_from_seq(unsigned long seq)
+{
+	return seq % MAX_NR_GENS;
+}
+#else
+static inline bool lru_gen_enabled(void)
+{
+	return false;
+}
+#endif
+
 /* Mask used at gathering information at once (see memcontrol.c) */
 #define LRU_ALL_FILE (BIT(LRU_INACTIVE_FILE) | BIT(LRU_ACTIVE_FILE))
 #define LRU_ALL_ANON (BIT(LRU_INACTIVE_ANON) | BIT(LRU_ACTIVE_ANON))
@@ -175,15 +221,28 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+/*
+ * Orders up to PAGE_ALLOC_COSTLY_ORDER are cached on the pcp-lists too,
+ * so small multi-page allocations such as skbs and kmalloc slabs do not
+ * take zone->lock each time.
+ */
+#define NR_PCP_ORDERS		(PAGE_ALLOC_COSTLY_ORDER + 1)
+#define NR_PCP_LISTS		(MIGRATE_PCPTYPES * NR_PCP_ORDERS)
+
 struct per_cpu_pages {
-	int count;		/* number of pages in the list */
+	int count;		/* number of base pages in the lists */
 	int high;		/* high watermark, emptying needed */
 	int batch;		/* chunk size for buddy add/remove */
 
-	/* Lists of pages, one per migrate type stored on the pcp-lists */
-	struct list_head lists[MIGRATE_PCPTYPES];
+	/* Lists of pages, one per migrate type and order on the pcp-lists */
+	struct list_head lists[NR_PCP_LISTS];
 };
 
+static inline int pcp_list_index(int migratetype, unsigned int order)
+{
+	return order * MIGRATE_PCPTYPES + migratetype;
+}
+
 struct per_cpu_pageset {
 	struct per_cpu_pages pcp;
 #ifdef CONFIG_NUMA
@@ -349,6 +408,9 @@ struct zone {
 	struct zone_lru {
 		struct list_head list;
 	} lru[NR_LRU_LISTS];
+#ifdef CONFIG_LRU_GEN
+	struct lru_gen		lrugen;
+#endif
 
 	struct zone_reclaim_stat reclaim_stat;
 
@@ -642,6 +704,12 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+#ifdef CONFIG_COMPACTION
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;
+	int kcompactd_max_order;
+	enum zone_type kcompactd_classzone_idx;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
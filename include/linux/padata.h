@@ -38,6 +38,8 @@
  * @pd: Pointer to the internal control structure.
  * @cb_cpu: Callback cpu for serializatioon.
  * @seq_nr: Sequence number of the parallelized data object.
+ * @cpu: Cpu the object was hashed to, owns its reorder queue slot.
+ * @stamp: Time the object entered the reorder queue.
  * @info: Used to pass information from the parallel to the serial function.
  * @parallel: Parallel execution function.
  * @serial: Serial complete function.
@@ -47,6 +49,8 @@ struct padata_priv {
 	struct parallel_data	*pd;
 	int			cb_cpu;
 	int			seq_nr;
+	int			cpu;
+	u64			stamp;
 	int			info;
 	void                    (*parallel)(struct padata_priv *padata);
 	void                    (*serial)(struct padata_priv *padata);
@@ -151,6 +155,11 @@ struct parallel_data {
  *            or both cpumasks change.
  * @kobj: padata instance kernel object.
  * @lock: padata instance lock.
+ * @work_stealing: Idle parallel workers take objects off other queues.
+ * @steals: Number of objects processed by a cpu they were not hashed to.
+ * @serialized: Number of objects that passed the reorder queues.
+ * @reorder_wait: Total time objects spent in the reorder queues, in ns.
+ * @reorder_wait_max: Longest time an object spent there, in ns.
  * @flags: padata flags.
  */
 struct padata_instance {
@@ -161,6 +170,11 @@ struct padata_instance {
 	struct blocking_notifier_head	 cpumask_change_notifier;
 	struct kobject                   kobj;
 	struct mutex			 lock;
+	int				 work_stealing;
+	atomic_long_t			 steals;
+	atomic_long_t			 serialized;
+	atomic64_t			 reorder_wait;
+	u64				 reorder_wait_max;
 	u8				 flags;
 #define	PADATA_INIT	1
 #define	PADATA_RESET	2
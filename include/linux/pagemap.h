@@ -24,6 +24,7 @@ enum mapping_flags {
 	AS_ENOSPC	= __GFP_BITS_SHIFT + 1,	/* ENOSPC on async write */
 	AS_MM_ALL_LOCKS	= __GFP_BITS_SHIFT + 2,	/* under mm_take_all_locks() */
 	AS_UNEVICTABLE	= __GFP_BITS_SHIFT + 3,	/* e.g., ramdisk, SHM_LOCK */
+	AS_HUGE		= __GFP_BITS_SHIFT + 4,	/* may hold transparent hugepages */
 };
 
 static inline void mapping_set_error(struct address_space *mapping, int error)
@@ -85,6 +86,34 @@ static inline void mapping_set_gfp_mask(struct address_space *m, gfp_t mask)
 #define page_cache_release(page)	put_page(page)
 void release_pages(struct page **pages, int nr, int cold);
 
+/*
+ * Transparent hugepages in the page cache of files nobody writes to: all
+ * the subpages of a compound page are in the radix-tree, each at its own
+ * index, see mm/filemap_huge.c.
+ */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+extern int PageFileHuge(struct page *page);
+extern int page_cache_get_speculative_tail(struct page *page);
+extern struct page *filemap_huge_get_page(struct file *file, pgoff_t index,
+					  gfp_t gfp_mask);
+extern int filemap_huge_invalidate(struct address_space *mapping,
+				   struct page *page, int sync);
+extern void filemap_huge_write_access(struct address_space *mapping);
+#else
+static inline int PageFileHuge(struct page *page)
+{
+	return 0;
+}
+static inline int filemap_huge_invalidate(struct address_space *mapping,
+					  struct page *page, int sync)
+{
+	return 0;
+}
+static inline void filemap_huge_write_access(struct address_space *mapping)
+{
+}
+#endif
+
 /*
  * speculatively take a reference to a page.
  * If the page is free (_count == 0), then _count is untouched, and 0
@@ -133,6 +162,11 @@ static inline int page_cache_get_speculative(struct page *page)
 {
 	VM_BUG_ON(in_interrupt());
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+	if (unlikely(PageTail(page)))
+		return page_cache_get_speculative_tail(page);
+#endif
+
 #if !defined(CONFIG_SMP) && defined(CONFIG_TREE_RCU)
 # ifdef CONFIG_PREEMPT_COUNT
 	VM_BUG_ON(!in_atomic());
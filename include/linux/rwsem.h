@@ -27,6 +27,9 @@ struct rw_semaphore {
 	long			count;
 	spinlock_t		wait_lock;
 	struct list_head	wait_list;
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	struct task_struct	*owner;
+#endif
 #ifdef CONFIG_DEBUG_LOCK_ALLOC
 	struct lockdep_map	dep_map;
 #endif
@@ -66,6 +69,8 @@ static inline int rwsem_is_locked(struct rw_semaphore *sem)
 extern void __init_rwsem(struct rw_semaphore *sem, const char *name,
 			 struct lock_class_key *key);
 
+extern int sysctl_rwsem_reader_batch;
+
 #define init_rwsem(sem)						\
 do {								\
 	static struct lock_class_key __key;			\
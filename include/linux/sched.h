@@ -140,6 +140,9 @@ extern unsigned long nr_running(void);
 extern unsigned long nr_uninterruptible(void);
 extern unsigned long nr_iowait(void);
 extern unsigned long nr_iowait_cpu(int cpu);
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+extern unsigned long sched_rt_task_ticks(int cpu);
+#endif
 extern unsigned long this_cpu_load(void);
 
 
@@ -360,6 +363,8 @@ extern signed long schedule_timeout_killable(signed long timeout);
 extern signed long schedule_timeout_uninterruptible(signed long timeout);
 asmlinkage void schedule(void);
 extern int mutex_spin_on_owner(struct mutex *lock, struct task_struct *owner);
+extern int rwsem_spin_on_owner(struct rw_semaphore *sem,
+			       struct task_struct *owner);
 
 struct nsproxy;
 struct user_namespace;
@@ -1427,6 +1432,10 @@ struct task_struct {
 	/* Deadlock detection and priority inheritance handling */
 	struct rt_mutex_waiter *pi_blocked_on;
 #endif
+#ifdef CONFIG_FUTEX_BOOST
+	/* Boosting futex waiters blocked on this task */
+	struct plist_head boost_waiters;
+#endif
 
 #ifdef CONFIG_DEBUG_MUTEXES
 	/* mutex deadlock detection */
@@ -104,6 +104,17 @@ struct kmem_cache *kmem_cache_create(const char *, size_t, size_t,
 void kmem_cache_destroy(struct kmem_cache *);
 int kmem_cache_shrink(struct kmem_cache *);
 void kmem_cache_free(struct kmem_cache *, void *);
+
+/*
+ * Bulk allocation and freeing. The allocators move a whole array of
+ * objects through their per cpu caches in one go instead of taking the
+ * fast path once per object.
+ *
+ * kmem_cache_alloc_bulk() either fills all @size entries and returns @size,
+ * or allocates nothing and returns 0.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *, size_t, void **);
+int kmem_cache_alloc_bulk(struct kmem_cache *, gfp_t, size_t, void **);
 unsigned int kmem_cache_size(struct kmem_cache *);
 
 /*
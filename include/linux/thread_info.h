@@ -26,6 +26,7 @@ struct restart_block {
 			u32 bitset;
 			u64 time;
 			u32 __user *uaddr2;
+			u32 boost_tid;
 		} futex;
 		/* For nanosleep */
 		struct {
@@ -232,6 +232,13 @@ extern unsigned long get_next_timer_interrupt(unsigned long now);
 /*
  * Timer-statistics info:
  */
+enum timer_wheel_stat {
+	TIMER_WHEEL_FIRED,		/* timer functions called */
+	TIMER_WHEEL_CASCADED,		/* timers requeued by the wheel */
+	TIMER_WHEEL_COALESCED,		/* timers moved to a coarser slot */
+	TIMER_WHEEL_NR_STATS,
+};
+
 #ifdef CONFIG_TIMER_STATS
 
 extern int timer_stats_active;
@@ -258,6 +265,15 @@ static inline void timer_stats_timer_clear_start_info(struct timer_list *timer)
 {
 	timer->start_site = NULL;
 }
+
+extern void __timer_stats_wheel_event(int cpu, enum timer_wheel_stat stat);
+
+static inline void timer_stats_wheel_event(int cpu, enum timer_wheel_stat stat)
+{
+	if (likely(!timer_stats_active))
+		return;
+	__timer_stats_wheel_event(cpu, stat);
+}
 #else
 static inline void init_timer_stats(void)
 {
@@ -270,6 +286,10 @@ static inline void timer_stats_timer_set_start_info(struct timer_list *timer)
 static inline void timer_stats_timer_clear_start_info(struct timer_list *timer)
 {
 }
+
+static inline void timer_stats_wheel_event(int cpu, enum timer_wheel_stat stat)
+{
+}
 #endif
 
 extern void add_timer(struct timer_list *timer);
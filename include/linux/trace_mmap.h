@@ -0,0 +1,18 @@
+#ifndef _LINUX_TRACE_MMAP_H
+#define _LINUX_TRACE_MMAP_H
+
+#include <linux/ioctl.h>
+
+/*
+ * per_cpu/cpuN/trace_pipe_raw can be mmap()ed read-only, one page at
+ * offset 0. The mapping shows the reader page of that CPU's ring buffer,
+ * laid out as described by events/header_page.
+ *
+ * TRACE_MMAP_IOCTL_GET_READER hands the current page back to the ring
+ * buffer and maps the next one in its place. It returns 0 when a new page
+ * was mapped and -EAGAIN when the buffer had nothing to read, in which
+ * case the mapped page is left as it was.
+ */
+#define TRACE_MMAP_IOCTL_GET_READER	_IO('R', 0x20)
+
+#endif /* _LINUX_TRACE_MMAP_H */
@@ -0,0 +1,56 @@
+#ifndef __LINUX_VMPRESSURE_H
+#define __LINUX_VMPRESSURE_H
+
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/list.h>
+#include <linux/workqueue.h>
+#include <linux/gfp.h>
+#include <linux/types.h>
+
+struct mem_cgroup;
+struct eventfd_ctx;
+
+struct vmpressure {
+	/* pages scanned and reclaimed in the current window */
+	unsigned long scanned;
+	unsigned long reclaimed;
+	/* protects scanned and reclaimed */
+	spinlock_t sr_lock;
+
+	/* the registered listeners, protected by events_lock */
+	struct list_head events;
+	struct mutex events_lock;
+
+	struct work_struct work;
+};
+
+#ifdef CONFIG_CGROUP_MEM_RES_CTLR
+extern void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
+		       unsigned long scanned, unsigned long reclaimed);
+extern void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio);
+
+extern void vmpressure_init(struct vmpressure *vmpr);
+extern void vmpressure_cleanup(struct vmpressure *vmpr);
+extern int vmpressure_register_event(struct vmpressure *vmpr,
+				     struct eventfd_ctx *eventfd,
+				     const char *args);
+extern void vmpressure_unregister_event(struct vmpressure *vmpr,
+					struct eventfd_ctx *eventfd);
+
+/* provided by memcontrol.c */
+extern struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *memcg);
+extern struct vmpressure *vmpressure_parent(struct vmpressure *vmpr);
+#else
+static inline void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
+			      unsigned long scanned, unsigned long reclaimed)
+{
+}
+
+static inline void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg,
+				   int prio)
+{
+}
+#endif /* CONFIG_CGROUP_MEM_RES_CTLR */
+
+#endif /* __LINUX_VMPRESSURE_H */
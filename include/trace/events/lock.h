@@ -80,6 +80,35 @@ DEFINE_EVENT(lock, lock_acquired,
 #endif
 #endif
 
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+
+TRACE_EVENT(lock_contention,
+
+	TP_PROTO(void *lock, unsigned long ip, int type, u64 wait_ns),
+
+	TP_ARGS(lock, ip, type, wait_ns),
+
+	TP_STRUCT__entry(
+		__field(	void *,		lock_addr	)
+		__field(	unsigned long,	ip		)
+		__field(	int,		type		)
+		__field(	u64,		wait_ns		)
+	),
+
+	TP_fast_assign(
+		__entry->lock_addr	= lock;
+		__entry->ip		= ip;
+		__entry->type		= type;
+		__entry->wait_ns	= wait_ns;
+	),
+
+	TP_printk("%p %pS type=%d wait_ns=%llu", __entry->lock_addr,
+		  (void *)__entry->ip, __entry->type,
+		  (unsigned long long)__entry->wait_ns)
+);
+
+#endif
+
 #endif /* _TRACE_LOCK_H */
 
 /* This part must be outside protection */
@@ -59,6 +59,8 @@
 #include <linux/magic.h>
 #include <linux/pid.h>
 #include <linux/nsproxy.h>
+#include <linux/bootmem.h>
+#include <linux/log2.h>
 
 #include <asm/futex.h>
 
@@ -66,7 +68,6 @@
 
 int __read_mostly futex_cmpxchg_enabled;
 
-#define FUTEX_HASHBITS (CONFIG_BASE_SMALL ? 4 : 8)
 
 /*
  * Futex flags used to encode options to functions and preserve them across
@@ -141,13 +142,43 @@ static const struct futex_q futex_q_init = {
  * Hash buckets are shared by all the futex_keys that hash to the same
  * location.  Each key may have multiple futex_q structures, one for each task
  * waiting on a futex.
+ *
+ * @waiters counts the tasks queued on the bucket plus those on their way
+ * to be queued (between queue_lock() and queue_me()/queue_unlock()), so
+ * that futex_wake() can skip taking the lock of an empty bucket.  The
+ * waiter increments it before reading the futex value, the waker reads
+ * it after writing the futex value, and both sides order the two with a
+ * full barrier; either the waiter sees the new value or the waker sees
+ * the waiter.
  */
 struct futex_hash_bucket {
+	atomic_t waiters;
 	spinlock_t lock;
 	struct plist_head chain;
-};
+} ____cacheline_aligned_in_smp;
 
-static struct futex_hash_bucket futex_queues[1<<FUTEX_HASHBITS];
+static unsigned long __read_mostly futex_hashsize;
+
+static struct futex_hash_bucket *futex_queues;
+
+static inline void hb_waiters_inc(struct futex_hash_bucket *hb)
+{
+	atomic_inc(&hb->waiters);
+	/* pairs with the barrier in hb_waiters_pending() */
+	smp_mb__after_atomic_inc();
+}
+
+static inline void hb_waiters_dec(struct futex_hash_bucket *hb)
+{
+	atomic_dec(&hb->waiters);
+}
+
+static inline int hb_waiters_pending(struct futex_hash_bucket *hb)
+{
+	/* order the caller's futex value update before the waiters read */
+	smp_mb();
+	return atomic_read(&hb->waiters);
+}
 
 /*
  * We hash on the keys returned from get_futex_key (see below).
@@ -157,7 +188,7 @@ static struct futex_hash_bucket *hash_futex(union futex_key *key)
 	u32 hash = jhash2((u32*)&key->both.word,
 			  (sizeof(key->both.word)+sizeof(key->both.ptr))/4,
 			  key->both.offset);
-	return &futex_queues[hash & ((1 << FUTEX_HASHBITS)-1)];
+	return &futex_queues[hash & (futex_hashsize - 1)];
 }
 
 /*
@@ -351,6 +382,9 @@ again:
 		key->both.offset |= FUT_OFF_INODE; /* inode-based key */
 		key->shared.inode = page_head->mapping->host;
 		key->shared.pgoff = page_head->index;
+		/* the subpages of a page cache hugepage have their own index */
+		if (PageFileHuge(page_head))
+			key->shared.pgoff += page - page_head;
 	}
 
 	get_futex_key_refs(key);
@@ -817,6 +851,7 @@ static void __unqueue_futex(struct futex_q *q)
 
 	hb = container_of(q->lock_ptr, struct futex_hash_bucket, lock);
 	plist_del(&q->list, &hb->chain);
+	hb_waiters_dec(hb);
 }
 
 /*
@@ -974,6 +1009,11 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 		goto out;
 
 	hb = hash_futex(&key);
+
+	/* Make sure we really have tasks to wake up */
+	if (!hb_waiters_pending(hb))
+		goto out_put_key;
+
 	spin_lock(&hb->lock);
 	head = &hb->chain;
 
@@ -995,6 +1035,7 @@ futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	}
 
 	spin_unlock(&hb->lock);
+out_put_key:
 	put_futex_key(&key);
 out:
 	return ret;
@@ -1109,6 +1150,8 @@ void requeue_futex(struct futex_q *q, struct futex_hash_bucket *hb1,
 	 */
 	if (likely(&hb1->chain != &hb2->chain)) {
 		plist_del(&q->list, &hb1->chain);
+		hb_waiters_dec(hb1);
+		hb_waiters_inc(hb2);
 		plist_add(&q->list, &hb2->chain);
 		q->lock_ptr = &hb2->lock;
 	}
@@ -1450,6 +1493,14 @@ static inline struct futex_hash_bucket *queue_lock(struct futex_q *q)
 	struct futex_hash_bucket *hb;
 
 	hb = hash_futex(&q->key);
+
+	/*
+	 * Account for the waiter before the futex value is read under the
+	 * lock, so that a concurrent futex_wake() either finds us or we
+	 * see its value update.
+	 */
+	hb_waiters_inc(hb);
+
 	q->lock_ptr = &hb->lock;
 
 	spin_lock(&hb->lock);
@@ -1461,6 +1512,7 @@ queue_unlock(struct futex_q *q, struct futex_hash_bucket *hb)
 	__releases(&hb->lock)
 {
 	spin_unlock(&hb->lock);
+	hb_waiters_dec(hb);
 }
 
 /**
@@ -1854,19 +1906,58 @@ out:
 	return ret;
 }
 
+#ifdef CONFIG_FUTEX_BOOST
+/*
+ * Look up the lock holder named by a FUTEX_WAIT_BOOST waiter.  Only
+ * tasks of the waiter's own thread group can be boosted, unless the
+ * waiter could change their priority anyway; any other tid fails the
+ * wait with -ESRCH, so that the caller knows nobody was boosted.
+ */
+static struct task_struct *futex_boost_get_owner(pid_t tid)
+{
+	struct task_struct *p;
+
+	p = futex_find_get_task(tid);
+	if (!p)
+		return ERR_PTR(-ESRCH);
+
+	if (p == current) {
+		put_task_struct(p);
+		return ERR_PTR(-EINVAL);
+	}
+	if (!same_thread_group(p, current) && !capable(CAP_SYS_NICE)) {
+		put_task_struct(p);
+		return ERR_PTR(-ESRCH);
+	}
+	return p;
+}
+#endif
+
 static int futex_wait(u32 __user *uaddr, unsigned int flags, u32 val,
-		      ktime_t *abs_time, u32 bitset)
+		      ktime_t *abs_time, u32 bitset, u32 boost_tid)
 {
 	struct hrtimer_sleeper timeout, *to = NULL;
 	struct restart_block *restart;
 	struct futex_hash_bucket *hb;
 	struct futex_q q = futex_q_init;
+#ifdef CONFIG_FUTEX_BOOST
+	struct task_struct *owner = NULL;
+	struct rt_mutex_boost boost;
+#endif
 	int ret;
 
 	if (!bitset)
 		return -EINVAL;
 	q.bitset = bitset;
 
+#ifdef CONFIG_FUTEX_BOOST
+	if (boost_tid) {
+		owner = futex_boost_get_owner(boost_tid);
+		if (IS_ERR(owner))
+			return PTR_ERR(owner);
+	}
+#endif
+
 	if (abs_time) {
 		to = &timeout;
 
@@ -1887,9 +1978,24 @@ retry:
 	if (ret)
 		goto out;
 
+#ifdef CONFIG_FUTEX_BOOST
+	/*
+	 * Boost the lock holder while we still hold the hb lock: it
+	 * cannot wake us before we are queued, so the boost is in place
+	 * for the whole time we block.
+	 */
+	if (owner)
+		rt_mutex_boost_owner(&boost, owner);
+#endif
+
 	/* queue_me and wait for wakeup, timeout, or a signal. */
 	futex_wait_queue_me(hb, &q, to);
 
+#ifdef CONFIG_FUTEX_BOOST
+	if (owner)
+		rt_mutex_unboost_owner(&boost);
+#endif
+
 	/* If we were woken (and unqueued), we succeeded, whatever. */
 	ret = 0;
 	/* unqueue_me() drops q.key ref */
@@ -1917,6 +2023,7 @@ retry:
 	restart->futex.time = abs_time->tv64;
 	restart->futex.bitset = bitset;
 	restart->futex.flags = flags | FLAGS_HAS_TIMEOUT;
+	restart->futex.boost_tid = boost_tid;
 
 	ret = -ERESTART_RESTARTBLOCK;
 
@@ -1925,6 +2032,10 @@ out:
 		hrtimer_cancel(&to->timer);
 		destroy_hrtimer_on_stack(&to->timer);
 	}
+#ifdef CONFIG_FUTEX_BOOST
+	if (owner)
+		put_task_struct(owner);
+#endif
 	return ret;
 }
 
@@ -1941,7 +2052,8 @@ static long futex_wait_restart(struct restart_block *restart)
 	restart->fn = do_no_restart_syscall;
 
 	return (long)futex_wait(uaddr, restart->futex.flags,
-				restart->futex.val, tp, restart->futex.bitset);
+				restart->futex.val, tp, restart->futex.bitset,
+				restart->futex.boost_tid);
 }
 
 
@@ -2195,6 +2307,7 @@ int handle_early_requeue_pi_wakeup(struct futex_hash_bucket *hb,
 		 * Unqueue the futex_q and determine which it was.
 		 */
 		plist_del(&q->list, &hb->chain);
+		hb_waiters_dec(hb);
 
 		/* Handle spurious wakeups gracefully */
 		ret = -EWOULDBLOCK;
@@ -2632,8 +2745,17 @@ long do_futex(u32 __user *uaddr, int op, u32 val, ktime_t *timeout,
 	case FUTEX_WAIT:
 		val3 = FUTEX_BITSET_MATCH_ANY;
 	case FUTEX_WAIT_BITSET:
-		ret = futex_wait(uaddr, flags, val, timeout, val3);
+		ret = futex_wait(uaddr, flags, val, timeout, val3, 0);
 		break;
+#ifdef CONFIG_FUTEX_BOOST
+	case FUTEX_WAIT_BOOST:
+		/* val3 is the TID of the lock holder to boost */
+		if (!val3)
+			return -ESRCH;
+		ret = futex_wait(uaddr, flags, val, timeout,
+				 FUTEX_BITSET_MATCH_ANY, val3);
+		break;
+#endif
 	case FUTEX_WAKE:
 		val3 = FUTEX_BITSET_MATCH_ANY;
 	case FUTEX_WAKE_BITSET:
@@ -2686,14 +2808,15 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 
 	if (utime && (cmd == FUTEX_WAIT || cmd == FUTEX_LOCK_PI ||
 		      cmd == FUTEX_WAIT_BITSET ||
-		      cmd == FUTEX_WAIT_REQUEUE_PI)) {
+		      cmd == FUTEX_WAIT_REQUEUE_PI ||
+		      cmd == FUTEX_WAIT_BOOST)) {
 		if (copy_from_user(&ts, utime, sizeof(ts)) != 0)
 			return -EFAULT;
 		if (!timespec_valid(&ts))
 			return -EINVAL;
 
 		t = timespec_to_ktime(ts);
-		if (cmd == FUTEX_WAIT)
+		if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_BOOST)
 			t = ktime_add_safe(ktime_get(), t);
 		tp = &t;
 	}
@@ -2711,7 +2834,22 @@ SYSCALL_DEFINE6(futex, u32 __user *, uaddr, int, op, u32, val,
 static int __init futex_init(void)
 {
 	u32 curval;
-	int i;
+	unsigned long i;
+	unsigned int futex_shift;
+
+#if CONFIG_BASE_SMALL
+	futex_hashsize = 16;
+#else
+	/* scale with the number of CPUs that can contend on the buckets */
+	futex_hashsize = roundup_pow_of_two(256 * num_possible_cpus());
+#endif
+
+	futex_queues = alloc_large_system_hash("futex",
+					       sizeof(*futex_queues),
+					       futex_hashsize, 0, 0,
+					       &futex_shift, NULL,
+					       futex_hashsize);
+	futex_hashsize = 1UL << futex_shift;
 
 	/*
 	 * This will fail and we want it. Some arch implementations do
@@ -2726,7 +2864,8 @@ static int __init futex_init(void)
 	if (cmpxchg_futex_value_locked(&curval, NULL, 0, 0) == -EFAULT)
 		futex_cmpxchg_enabled = 1;
 
-	for (i = 0; i < ARRAY_SIZE(futex_queues); i++) {
+	for (i = 0; i < futex_hashsize; i++) {
+		atomic_set(&futex_queues[i].waiters, 0);
 		plist_head_init(&futex_queues[i].chain);
 		spin_lock_init(&futex_queues[i].lock);
 	}
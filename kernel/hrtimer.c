@@ -482,6 +482,26 @@ static inline void debug_deactivate(struct hrtimer *timer)
 	trace_hrtimer_cancel(timer);
 }
 
+/*
+ * The first timer, starting at @node, which may wake up the cpu. With
+ * @skip_deferrable set, deferrable timers are passed over; there are
+ * only a few of them, so the walk is short.
+ */
+static inline struct hrtimer *
+hrtimer_next_waking(struct hrtimer_cpu_base *cpu_base,
+		    struct timerqueue_node *node, int skip_deferrable)
+{
+	struct hrtimer *timer;
+
+	for (; node; node = timerqueue_iterate_next(node)) {
+		timer = container_of(node, struct hrtimer, node);
+		if (!skip_deferrable || !cpu_base->nr_deferrable ||
+		    !timer->deferrable)
+			return timer;
+	}
+	return NULL;
+}
+
 /* High resolution timer related functions */
 #ifdef CONFIG_HIGH_RES_TIMERS
 
@@ -526,11 +546,16 @@ static inline int hrtimer_hres_active(void)
  * Reprogram the event source with checking both queues for the
  * next event
  * Called with interrupts disabled and base->lock held
+ *
+ * With skip_equal set the programmed event is also left alone when it
+ * is not later than any hard expiry and falls into the range of one
+ * of the first timers: that timer is expired by it, and the event for
+ * the next hard expiry is programmed from the interrupt anyway.
  */
 static void
 hrtimer_force_reprogram(struct hrtimer_cpu_base *cpu_base, int skip_equal)
 {
-	int i;
+	int i, covered = 0;
 	struct hrtimer_clock_base *base = cpu_base->clock_base;
 	ktime_t expires, expires_next;
 
@@ -541,9 +566,11 @@ hrtimer_force_reprogram(struct hrtimer_cpu_base *cpu_base, int skip_equal)
 		struct timerqueue_node *next;
 
 		next = timerqueue_getnext(&base->active);
-		if (!next)
+		timer = hrtimer_next_waking(cpu_base, next, cpu_base->idle);
+		if (!timer)
 			continue;
-		timer = container_of(next, struct hrtimer, node);
+		if (&timer->node != next)
+			cpu_base->nr_deferred++;
 
 		expires = ktime_sub(hrtimer_get_expires(timer), base->offset);
 		/*
@@ -555,15 +582,29 @@ hrtimer_force_reprogram(struct hrtimer_cpu_base *cpu_base, int skip_equal)
 			expires.tv64 = 0;
 		if (expires.tv64 < expires_next.tv64)
 			expires_next = expires;
+
+		expires = ktime_sub(hrtimer_get_softexpires(timer),
+				    base->offset);
+		if (&timer->node == next &&
+		    expires.tv64 <= cpu_base->expires_next.tv64)
+			covered = 1;
 	}
 
 	if (skip_equal && expires_next.tv64 == cpu_base->expires_next.tv64)
 		return;
 
+	if (skip_equal && covered &&
+	    cpu_base->expires_next.tv64 < expires_next.tv64) {
+		cpu_base->nr_reprogram_skips++;
+		return;
+	}
+
 	cpu_base->expires_next.tv64 = expires_next.tv64;
 
-	if (cpu_base->expires_next.tv64 != KTIME_MAX)
+	if (cpu_base->expires_next.tv64 != KTIME_MAX) {
+		cpu_base->nr_reprograms++;
 		tick_program_event(cpu_base->expires_next, 1);
+	}
 }
 
 /*
@@ -606,6 +647,12 @@ static int hrtimer_reprogram(struct hrtimer *timer,
 	if (expires.tv64 >= cpu_base->expires_next.tv64)
 		return 0;
 
+	/* An idle cpu is not woken up for a deferrable timer */
+	if (cpu_base->idle && timer->deferrable) {
+		cpu_base->nr_deferred++;
+		return 0;
+	}
+
 	/*
 	 * If a hang was detected in the last timer interrupt then we
 	 * do not schedule a timer which is earlier than the expiry
@@ -618,6 +665,7 @@ static int hrtimer_reprogram(struct hrtimer *timer,
 	/*
 	 * Clockevents returns -ETIME, when the event was in the past.
 	 */
+	cpu_base->nr_reprograms++;
 	res = tick_program_event(expires, 0);
 	if (!IS_ERR_VALUE(res))
 		cpu_base->expires_next = expires;
@@ -631,6 +679,45 @@ static inline void hrtimer_init_hres(struct hrtimer_cpu_base *base)
 {
 	base->expires_next.tv64 = KTIME_MAX;
 	base->hres_active = 0;
+	base->idle = 0;
+}
+
+/*
+ * Called by the nohz code with interrupts disabled when it stops the
+ * tick of an idle cpu. From now on deferrable timers do not program the
+ * event device.
+ */
+void hrtimer_idle_enter(void)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+
+	if (!hrtimer_hres_active())
+		return;
+
+	raw_spin_lock(&cpu_base->lock);
+	cpu_base->idle = 1;
+	/* the programmed event might be for a deferrable timer */
+	if (cpu_base->nr_deferrable)
+		hrtimer_force_reprogram(cpu_base, 1);
+	raw_spin_unlock(&cpu_base->lock);
+}
+
+/*
+ * Called by the nohz code with interrupts disabled when the tick is
+ * restarted. Deferrable timers which expired meanwhile run right away.
+ */
+void hrtimer_idle_exit(void)
+{
+	struct hrtimer_cpu_base *cpu_base = &__get_cpu_var(hrtimer_bases);
+
+	if (!hrtimer_hres_active())
+		return;
+
+	raw_spin_lock(&cpu_base->lock);
+	cpu_base->idle = 0;
+	if (cpu_base->nr_deferrable)
+		hrtimer_force_reprogram(cpu_base, 1);
+	raw_spin_unlock(&cpu_base->lock);
 }
 
 /*
@@ -861,6 +948,8 @@ static int enqueue_hrtimer(struct hrtimer *timer,
 
 	timerqueue_add(&base->active, &timer->node);
 	base->cpu_base->active_bases |= 1 << base->index;
+	if (timer->deferrable)
+		base->cpu_base->nr_deferrable++;
 
 	/*
 	 * HRTIMER_STATE_ENQUEUED is or'ed to the current state to preserve the
@@ -885,10 +974,21 @@ static void __remove_hrtimer(struct hrtimer *timer,
 			     struct hrtimer_clock_base *base,
 			     unsigned long newstate, int reprogram)
 {
+	struct timerqueue_node *next_timer;
+
 	if (!(timer->state & HRTIMER_STATE_ENQUEUED))
 		goto out;
 
-	if (&timer->node == timerqueue_getnext(&base->active)) {
+	if (timer->deferrable)
+		base->cpu_base->nr_deferrable--;
+
+	/*
+	 * Dequeue first, the reprogramming below must not find the timer
+	 * which is removed.
+	 */
+	next_timer = timerqueue_getnext(&base->active);
+	timerqueue_del(&base->active, &timer->node);
+	if (&timer->node == next_timer) {
 #ifdef CONFIG_HIGH_RES_TIMERS
 		/* Reprogram the clock event device. if enabled */
 		if (reprogram && hrtimer_hres_active()) {
@@ -901,7 +1001,6 @@ static void __remove_hrtimer(struct hrtimer *timer,
 		}
 #endif
 	}
-	timerqueue_del(&base->active, &timer->node);
 	if (!timerqueue_getnext(&base->active))
 		base->cpu_base->active_bases &= ~(1 << base->index);
 out:
@@ -1114,11 +1213,12 @@ ktime_t hrtimer_get_next_event(void)
 			struct hrtimer *timer;
 			struct timerqueue_node *next;
 
+			/* only used to stop the tick, so skip deferrables */
 			next = timerqueue_getnext(&base->active);
-			if (!next)
+			timer = hrtimer_next_waking(cpu_base, next, 1);
+			if (!timer)
 				continue;
 
-			timer = container_of(next, struct hrtimer, node);
 			delta.tv64 = hrtimer_get_expires_tv64(timer);
 			delta = ktime_sub(delta, base->get_time());
 			if (delta.tv64 < mindelta.tv64)
@@ -1144,6 +1244,11 @@ static void __hrtimer_init(struct hrtimer *timer, clockid_t clock_id,
 
 	cpu_base = &__raw_get_cpu_var(hrtimer_bases);
 
+	if (mode & HRTIMER_MODE_DEFERRABLE) {
+		timer->deferrable = 1;
+		mode &= ~HRTIMER_MODE_DEFERRABLE;
+	}
+
 	if (clock_id == CLOCK_REALTIME && mode != HRTIMER_MODE_ABS)
 		clock_id = CLOCK_MONOTONIC;
 
@@ -1292,15 +1397,27 @@ retry:
 			 */
 
 			if (basenow.tv64 < hrtimer_get_softexpires_tv64(timer)) {
+				struct hrtimer *next;
 				ktime_t expires;
 
-				expires = ktime_sub(hrtimer_get_expires(timer),
+				next = hrtimer_next_waking(cpu_base, node,
+							   cpu_base->idle);
+				if (!next)
+					break;
+				if (next != timer)
+					cpu_base->nr_deferred++;
+
+				expires = ktime_sub(hrtimer_get_expires(next),
 						    base->offset);
 				if (expires.tv64 < expires_next.tv64)
 					expires_next = expires;
 				break;
 			}
 
+			/* expired early, in the event of another timer */
+			if (basenow.tv64 < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_coalesced++;
+
 			__run_hrtimer(timer, &basenow);
 		}
 	}
@@ -1313,11 +1430,11 @@ retry:
 	raw_spin_unlock(&cpu_base->lock);
 
 	/* Reprogramming necessary ? */
-	if (expires_next.tv64 == KTIME_MAX ||
-	    !tick_program_event(expires_next, 0)) {
-		cpu_base->hang_detected = 0;
-		return;
-	}
+	if (expires_next.tv64 == KTIME_MAX)
+		goto out;
+	cpu_base->nr_reprograms++;
+	if (!tick_program_event(expires_next, 0))
+		goto out;
 
 	/*
 	 * The next timer was already expired due to:
@@ -1352,9 +1469,13 @@ retry:
 		expires_next = ktime_add_ns(now, 100 * NSEC_PER_MSEC);
 	else
 		expires_next = ktime_add(now, delta);
+	cpu_base->nr_reprograms++;
 	tick_program_event(expires_next, 1);
 	printk_once(KERN_WARNING "hrtimer: interrupt took %llu ns\n",
 		    ktime_to_ns(delta));
+	return;
+out:
+	cpu_base->hang_detected = 0;
 }
 
 /*
@@ -64,6 +64,8 @@ static void irq_wake_thread(struct irq_desc *desc, struct irqaction *action)
 	    test_and_set_bit(IRQTF_RUNTHREAD, &action->thread_flags))
 		return;
 
+	irq_lat_thread_wake(desc, action);
+
 	/*
 	 * It's safe to OR the mask lockless here. We have only two
 	 * places which write to threads_oneshot: This code and the
@@ -121,10 +123,12 @@ handle_irq_event_percpu(struct irq_desc *desc, struct irqaction *action)
 
 	do {
 		irqreturn_t res;
+		u64 start = irq_lat_stamp(desc);
 
 		trace_irq_handler_entry(irq, action);
 		res = action->handler(irq, action->dev_id);
 		trace_irq_handler_exit(irq, action, res);
+		irq_lat_add(desc, IRQ_LAT_HANDLER, start);
 
 		if (WARN_ONCE(!irqs_disabled(),"irq %u handler %pF enabled interrupts\n",
 			      irq, action->handler))
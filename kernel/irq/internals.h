@@ -6,6 +6,7 @@
  * of this file for your non core code.
  */
 #include <linux/irqdesc.h>
+#include <linux/sched.h>
 
 #ifdef CONFIG_SPARSE_IRQ
 # define IRQ_BITMAP_BITS	(NR_IRQS + 8196)
@@ -99,6 +100,86 @@ static inline void unregister_handler_proc(unsigned int irq,
 
 extern int irq_select_affinity_usr(unsigned int irq, struct cpumask *mask);
 
+#ifdef CONFIG_IRQ_LATENCY_STATS
+enum irq_lat_type {
+	IRQ_LAT_HANDLER,	/* primary handler run time */
+	IRQ_LAT_WAKEUP,		/* hard irq wakeup to thread running */
+	IRQ_LAT_THREAD,		/* threaded handler run time */
+	IRQ_LAT_NR,
+};
+
+/* bucket n counts latencies in [2^(n-1), 2^n) ns, the last one the rest */
+#define IRQ_LAT_BUCKETS		32
+
+struct irq_lat_hist {
+	atomic_long_t		count[IRQ_LAT_BUCKETS];
+	atomic64_t		sum;
+	u64			max;
+};
+
+struct irq_latency {
+	struct irq_lat_hist	hist[IRQ_LAT_NR];
+	atomic_long_t		thread_wakeups;
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	unsigned long		last_wakeups;
+	unsigned long		rate;
+	bool			steered;
+	cpumask_var_t		steer_mask;
+#endif
+};
+
+extern const struct file_operations irq_latency_proc_fops;
+
+extern void irq_latency_alloc(struct irq_desc *desc);
+extern void irq_latency_free_one(struct irq_latency *lat);
+extern void irq_lat_add(struct irq_desc *desc, enum irq_lat_type type,
+			u64 start);
+
+/* 0 means no statistics, irq_lat_add() ignores it */
+static inline u64 irq_lat_stamp(struct irq_desc *desc)
+{
+	return unlikely(desc->latency) ? local_clock() : 0;
+}
+
+static inline void
+irq_lat_thread_wake(struct irq_desc *desc, struct irqaction *action)
+{
+	action->wake_stamp = irq_lat_stamp(desc);
+	if (desc->latency)
+		atomic_long_inc(&desc->latency->thread_wakeups);
+}
+
+static inline void
+irq_lat_thread_woken(struct irq_desc *desc, struct irqaction *action)
+{
+	irq_lat_add(desc, IRQ_LAT_WAKEUP, action->wake_stamp);
+	action->wake_stamp = 0;
+}
+#else
+enum irq_lat_type {
+	IRQ_LAT_HANDLER,
+	IRQ_LAT_WAKEUP,
+	IRQ_LAT_THREAD,
+};
+
+static inline void irq_latency_alloc(struct irq_desc *desc) { }
+static inline u64 irq_lat_stamp(struct irq_desc *desc) { return 0; }
+static inline void irq_lat_add(struct irq_desc *desc, enum irq_lat_type type,
+			       u64 start) { }
+static inline void
+irq_lat_thread_wake(struct irq_desc *desc, struct irqaction *action) { }
+static inline void
+irq_lat_thread_woken(struct irq_desc *desc, struct irqaction *action) { }
+#endif
+
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+extern void irq_thread_balance_mask(struct irq_desc *desc,
+				    struct cpumask *mask);
+#else
+static inline void
+irq_thread_balance_mask(struct irq_desc *desc, struct cpumask *mask) { }
+#endif
+
 extern void irq_set_thread_affinity(struct irq_desc *desc);
 
 /* Inline functions for support of irq chips on slow busses */
@@ -172,6 +172,9 @@ static void free_desc(unsigned int irq)
 
 	free_masks(desc);
 	free_percpu(desc->kstat_irqs);
+#ifdef CONFIG_IRQ_LATENCY_STATS
+	irq_latency_free_one(desc->latency);
+#endif
 	kfree(desc);
 }
 
@@ -0,0 +1,345 @@
+/*
+ * linux/kernel/irq/latency.c
+ *
+ * Per interrupt latency statistics and the interrupt thread balancer.
+ *
+ * Three log2 histograms are kept for every interrupt that has a handler
+ * installed: the run time of the primary handlers, the delay from the
+ * hard interrupt waking an interrupt thread until that thread runs, and
+ * the run time of the threaded handlers.  They live in
+ * /proc/irq/<N>/latency.
+ *
+ * With CONFIG_IRQ_THREAD_BALANCE a work item looks at the thread wakeup
+ * rates once per second and keeps the threads of busy interrupts off the
+ * CPUs that have been running real-time tasks.
+ */
+
+#include <linux/irq.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/seq_file.h>
+#include <linux/proc_fs.h>
+#include <linux/interrupt.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+static const char * const irq_lat_names[IRQ_LAT_NR] = {
+	[IRQ_LAT_HANDLER]	= "handler",
+	[IRQ_LAT_WAKEUP]	= "wakeup",
+	[IRQ_LAT_THREAD]	= "thread",
+};
+
+void irq_lat_add(struct irq_desc *desc, enum irq_lat_type type, u64 start)
+{
+	struct irq_latency *lat = desc->latency;
+	struct irq_lat_hist *hist;
+	unsigned int bucket;
+	s64 delta;
+
+	if (!start || !lat)
+		return;
+
+	/* the thread may run on another CPU than the one that woke it */
+	delta = local_clock() - start;
+	if (delta < 0)
+		delta = 0;
+
+	hist = &lat->hist[type];
+	bucket = min_t(unsigned int, fls64(delta), IRQ_LAT_BUCKETS - 1);
+	atomic_long_inc(&hist->count[bucket]);
+	atomic64_add(delta, &hist->sum);
+	/* racy against a concurrent update, good enough for a maximum */
+	if (delta > hist->max)
+		hist->max = delta;
+}
+
+static void irq_lat_reset(struct irq_latency *lat)
+{
+	int i, j;
+
+	for (i = 0; i < IRQ_LAT_NR; i++) {
+		for (j = 0; j < IRQ_LAT_BUCKETS; j++)
+			atomic_long_set(&lat->hist[i].count[j], 0);
+		atomic64_set(&lat->hist[i].sum, 0);
+		lat->hist[i].max = 0;
+	}
+}
+
+/*
+ * Called from __setup_irq().  The statistics stay around once allocated;
+ * a failed allocation only means there are none for this interrupt.
+ */
+void irq_latency_alloc(struct irq_desc *desc)
+{
+	struct irq_latency *lat;
+
+	if (desc->latency)
+		return;
+
+	lat = kzalloc(sizeof(*lat), GFP_KERNEL);
+	if (!lat)
+		return;
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	if (!zalloc_cpumask_var(&lat->steer_mask, GFP_KERNEL)) {
+		kfree(lat);
+		return;
+	}
+#endif
+	if (cmpxchg(&desc->latency, NULL, lat))
+		irq_latency_free_one(lat);
+}
+
+void irq_latency_free_one(struct irq_latency *lat)
+{
+	if (!lat)
+		return;
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	free_cpumask_var(lat->steer_mask);
+#endif
+	kfree(lat);
+}
+
+static void irq_lat_show_hist(struct seq_file *m, struct irq_latency *lat)
+{
+	unsigned long count[IRQ_LAT_NR];
+	int first = IRQ_LAT_BUCKETS, last = -1;
+	int i, b;
+
+	for (b = 0; b < IRQ_LAT_BUCKETS; b++) {
+		for (i = 0; i < IRQ_LAT_NR; i++) {
+			if (atomic_long_read(&lat->hist[i].count[b])) {
+				first = min(first, b);
+				last = b;
+			}
+		}
+	}
+
+	if (last < 0)
+		return;
+
+	seq_printf(m, "\n%-24s", "ns");
+	for (i = 0; i < IRQ_LAT_NR; i++)
+		seq_printf(m, " %12s", irq_lat_names[i]);
+	seq_putc(m, '\n');
+
+	for (b = first; b <= last; b++) {
+		for (i = 0; i < IRQ_LAT_NR; i++)
+			count[i] = atomic_long_read(&lat->hist[i].count[b]);
+
+		seq_printf(m, "%10llu -> %10llu:",
+			   b ? 1ULL << (b - 1) : 0ULL, (1ULL << b) - 1);
+		for (i = 0; i < IRQ_LAT_NR; i++)
+			seq_printf(m, " %12lu", count[i]);
+		seq_putc(m, '\n');
+	}
+}
+
+static int irq_latency_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irq_latency *lat = desc->latency;
+	unsigned long nr[IRQ_LAT_NR];
+	int i, b;
+
+	if (!lat)
+		return 0;
+
+	for (i = 0; i < IRQ_LAT_NR; i++) {
+		nr[i] = 0;
+		for (b = 0; b < IRQ_LAT_BUCKETS; b++)
+			nr[i] += atomic_long_read(&lat->hist[i].count[b]);
+	}
+
+	seq_printf(m, "%-24s", "");
+	for (i = 0; i < IRQ_LAT_NR; i++)
+		seq_printf(m, " %12s", irq_lat_names[i]);
+	seq_printf(m, "\n%-24s", "count");
+	for (i = 0; i < IRQ_LAT_NR; i++)
+		seq_printf(m, " %12lu", nr[i]);
+	seq_printf(m, "\n%-24s", "avg_ns");
+	for (i = 0; i < IRQ_LAT_NR; i++)
+		seq_printf(m, " %12llu", nr[i] ?
+			   div64_u64(atomic64_read(&lat->hist[i].sum), nr[i]) : 0);
+	seq_printf(m, "\n%-24s", "max_ns");
+	for (i = 0; i < IRQ_LAT_NR; i++)
+		seq_printf(m, " %12llu", (unsigned long long)lat->hist[i].max);
+	seq_putc(m, '\n');
+
+	seq_printf(m, "thread_wakeups %lu\n",
+		   atomic_long_read(&lat->thread_wakeups));
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	seq_printf(m, "thread_rate %lu/s\n", lat->rate);
+	seq_printf(m, "thread_steered %d\n", lat->steered);
+	if (lat->steered) {
+		seq_puts(m, "thread_cpus ");
+		seq_cpumask_list(m, lat->steer_mask);
+		seq_putc(m, '\n');
+	}
+#endif
+
+	irq_lat_show_hist(m, lat);
+	return 0;
+}
+
+static ssize_t irq_latency_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	unsigned int irq = (int)(long)PDE(file->f_path.dentry->d_inode)->data;
+	struct irq_desc *desc = irq_to_desc(irq);
+
+	/* any write clears the histograms */
+	if (desc->latency)
+		irq_lat_reset(desc->latency);
+
+	return count;
+}
+
+static int irq_latency_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_latency_proc_show, PDE(inode)->data);
+}
+
+const struct file_operations irq_latency_proc_fops = {
+	.open		= irq_latency_proc_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+	.write		= irq_latency_proc_write,
+};
+
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+
+int sysctl_irq_thread_balance;
+int sysctl_irq_thread_balance_rate = 1000;
+
+#define IRQ_BALANCE_INTERVAL	HZ
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static DEFINE_PER_CPU(unsigned long, irq_balance_rt_ticks);
+static struct cpumask irq_balance_rt_cpus;
+static struct cpumask irq_balance_tmp;
+static unsigned long irq_balance_last;
+
+/*
+ * A CPU counts as busy with real-time work when real-time tasks other
+ * than interrupt threads held it for a quarter of the last interval.
+ */
+static void irq_balance_update_rt_cpus(unsigned long elapsed)
+{
+	unsigned long ticks, delta;
+	int cpu;
+
+	cpumask_clear(&irq_balance_rt_cpus);
+	for_each_online_cpu(cpu) {
+		ticks = sched_rt_task_ticks(cpu);
+		delta = ticks - per_cpu(irq_balance_rt_ticks, cpu);
+		per_cpu(irq_balance_rt_ticks, cpu) = ticks;
+
+		if (delta * 4 >= elapsed)
+			cpumask_set_cpu(cpu, &irq_balance_rt_cpus);
+	}
+}
+
+static void irq_balance_desc(struct irq_desc *desc, unsigned long elapsed)
+{
+	struct irq_latency *lat = desc->latency;
+	struct cpumask *mask = &irq_balance_tmp;
+	unsigned long wakeups, threshold;
+	bool steer;
+
+	wakeups = atomic_long_read(&lat->thread_wakeups);
+	lat->rate = (wakeups - lat->last_wakeups) * HZ / elapsed;
+	lat->last_wakeups = wakeups;
+
+	/* hysteresis, so a thread does not bounce around the threshold */
+	threshold = sysctl_irq_thread_balance_rate;
+	if (lat->steered)
+		threshold /= 2;
+	steer = sysctl_irq_thread_balance && lat->rate >= threshold;
+
+	raw_spin_lock_irq(&desc->lock);
+	if (steer) {
+		cpumask_andnot(mask, desc->irq_data.affinity,
+			       &irq_balance_rt_cpus);
+		cpumask_and(mask, mask, cpu_online_mask);
+		/* nowhere else to go, or nothing to get away from */
+		if (cpumask_empty(mask) ||
+		    !cpumask_intersects(desc->irq_data.affinity,
+					&irq_balance_rt_cpus))
+			steer = false;
+	}
+
+	if (steer != lat->steered ||
+	    (steer && !cpumask_equal(mask, lat->steer_mask))) {
+		if (steer)
+			cpumask_copy(lat->steer_mask, mask);
+		lat->steered = steer;
+		irq_set_thread_affinity(desc);
+	}
+	raw_spin_unlock_irq(&desc->lock);
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	unsigned long elapsed = jiffies - irq_balance_last;
+	struct irq_desc *desc;
+	int irq;
+
+	irq_balance_last = jiffies;
+	if (!elapsed)
+		elapsed = 1;
+
+	irq_balance_update_rt_cpus(elapsed);
+
+	for_each_irq_desc(irq, desc) {
+		if (desc->latency)
+			irq_balance_desc(desc, elapsed);
+	}
+
+	/* one last pass after disabling lets every thread go back */
+	if (sysctl_irq_thread_balance)
+		schedule_delayed_work(&irq_balance_work, IRQ_BALANCE_INTERVAL);
+}
+
+/*
+ * Called by the interrupt thread with desc->lock held when it picks up
+ * a new affinity.  The steered mask is always a subset of the affinity
+ * it was computed from; if the affinity has changed since, the plain
+ * affinity wins until the next balancing pass.
+ */
+void irq_thread_balance_mask(struct irq_desc *desc, struct cpumask *mask)
+{
+	struct irq_latency *lat = desc->latency;
+
+	if (lat && lat->steered && cpumask_subset(lat->steer_mask, mask))
+		cpumask_copy(mask, lat->steer_mask);
+}
+
+int irq_thread_balance_handler(struct ctl_table *table, int write,
+		void __user *buffer, size_t *lenp, loff_t *ppos)
+{
+	int old = sysctl_irq_thread_balance;
+	int ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, lenp, ppos);
+	if (ret || !write)
+		return ret;
+
+	if (sysctl_irq_thread_balance && !old) {
+		int cpu;
+
+		for_each_online_cpu(cpu)
+			per_cpu(irq_balance_rt_ticks, cpu) =
+				sched_rt_task_ticks(cpu);
+		irq_balance_last = jiffies;
+		schedule_delayed_work(&irq_balance_work, IRQ_BALANCE_INTERVAL);
+	}
+
+	return 0;
+}
+
+#endif /* CONFIG_IRQ_THREAD_BALANCE */
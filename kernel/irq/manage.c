@@ -710,6 +710,7 @@ irq_thread_check_affinity(struct irq_desc *desc, struct irqaction *action)
 
 	raw_spin_lock_irq(&desc->lock);
 	cpumask_copy(mask, desc->irq_data.affinity);
+	irq_thread_balance_mask(desc, mask);
 	raw_spin_unlock_irq(&desc->lock);
 
 	set_cpus_allowed_ptr(current, mask);
@@ -778,6 +779,7 @@ static int irq_thread(void *data)
 
 	while (!irq_wait_for_interrupt(action)) {
 
+		irq_lat_thread_woken(desc, action);
 		irq_thread_check_affinity(desc, action);
 
 		atomic_inc(&desc->threads_active);
@@ -795,9 +797,12 @@ static int irq_thread(void *data)
 			raw_spin_unlock_irq(&desc->lock);
 		} else {
 			irqreturn_t action_ret;
+			u64 start;
 
 			raw_spin_unlock_irq(&desc->lock);
+			start = irq_lat_stamp(desc);
 			action_ret = handler_fn(desc, action);
+			irq_lat_add(desc, IRQ_LAT_THREAD, start);
 			if (!noirqdebug)
 				note_interrupt(action->irq, desc, action_ret);
 		}
@@ -951,6 +956,8 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		goto out_thread;
 	}
 
+	irq_latency_alloc(desc);
+
 	/*
 	 * The following block of code has to be executed atomically
 	 */
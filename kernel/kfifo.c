@@ -606,3 +606,157 @@ void __kfifo_dma_out_finish_r(struct __kfifo *fifo, size_t recsize)
 	fifo->out += len + recsize;
 }
 EXPORT_SYMBOL(__kfifo_dma_out_finish_r);
+
+/*
+ * Multi producer / multi consumer fifos.
+ *
+ * Writers claim space by moving mp->head forward with cmpxchg, copy their
+ * data into it and then publish it by moving fifo->in forward.  Several
+ * writers may be copying at the same time, but each waits for the ones
+ * that claimed space before it to publish first, so fifo->in never passes
+ * data that is not there yet.  Readers do the same with mp->tail and
+ * fifo->out.  The waits are short since nobody gets interrupted between
+ * claiming and publishing.
+ */
+static void kfifo_mp_publish(unsigned int *idx, unsigned int start,
+		unsigned int end)
+{
+	while (ACCESS_ONCE(*idx) != start)
+		cpu_relax();
+	/*
+	 * order the copy against the index update; readers need a full
+	 * barrier since their copy only loads from the fifo
+	 */
+	smp_mb();
+	ACCESS_ONCE(*idx) = end;
+}
+
+static unsigned int kfifo_mp_peek_n(struct __kfifo *fifo, unsigned int off,
+		size_t recsize)
+{
+	unsigned int l;
+	unsigned int mask = fifo->mask;
+	unsigned char *data = fifo->data;
+
+	l = __KFIFO_PEEK(data, off, mask);
+
+	if (--recsize)
+		l |= __KFIFO_PEEK(data, off + 1, mask) << 8;
+
+	return l;
+}
+
+static void kfifo_mp_poke_n(struct __kfifo *fifo, unsigned int off,
+		unsigned int n, size_t recsize)
+{
+	unsigned int mask = fifo->mask;
+	unsigned char *data = fifo->data;
+
+	__KFIFO_POKE(data, off, mask, n);
+
+	if (recsize > 1)
+		__KFIFO_POKE(data, off + 1, mask, n >> 8);
+}
+
+unsigned int __kfifo_mp_in(struct __kfifo_mp *mp,
+		const void *buf, unsigned int len)
+{
+	struct __kfifo *fifo = &mp->kfifo;
+	unsigned int head, l;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	do {
+		head = ACCESS_ONCE(mp->head);
+		l = (fifo->mask + 1) - (head - ACCESS_ONCE(fifo->out));
+		l = min(len, l);
+		if (!l)
+			goto out;
+	} while (cmpxchg(&mp->head, head, head + l) != head);
+
+	kfifo_copy_in(fifo, buf, l, head);
+	kfifo_mp_publish(&fifo->in, head, head + l);
+out:
+	local_irq_restore(flags);
+	return l;
+}
+EXPORT_SYMBOL(__kfifo_mp_in);
+
+unsigned int __kfifo_mp_out(struct __kfifo_mp *mp,
+		void *buf, unsigned int len)
+{
+	struct __kfifo *fifo = &mp->kfifo;
+	unsigned int tail, l;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	do {
+		tail = ACCESS_ONCE(mp->tail);
+		l = min(len, ACCESS_ONCE(fifo->in) - tail);
+		if (!l)
+			goto out;
+	} while (cmpxchg(&mp->tail, tail, tail + l) != tail);
+
+	kfifo_copy_out(fifo, buf, l, tail);
+	kfifo_mp_publish(&fifo->out, tail, tail + l);
+out:
+	local_irq_restore(flags);
+	return l;
+}
+EXPORT_SYMBOL(__kfifo_mp_out);
+
+unsigned int __kfifo_mp_in_r(struct __kfifo_mp *mp, const void *buf,
+		unsigned int len, size_t recsize)
+{
+	struct __kfifo *fifo = &mp->kfifo;
+	unsigned int head, total = len + recsize;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	do {
+		head = ACCESS_ONCE(mp->head);
+		if (total > (fifo->mask + 1) - (head - ACCESS_ONCE(fifo->out))) {
+			len = 0;
+			goto out;
+		}
+	} while (cmpxchg(&mp->head, head, head + total) != head);
+
+	kfifo_mp_poke_n(fifo, head, len, recsize);
+	kfifo_copy_in(fifo, buf, len, head + recsize);
+	kfifo_mp_publish(&fifo->in, head, head + total);
+out:
+	local_irq_restore(flags);
+	return len;
+}
+EXPORT_SYMBOL(__kfifo_mp_in_r);
+
+unsigned int __kfifo_mp_out_r(struct __kfifo_mp *mp, void *buf,
+		unsigned int len, size_t recsize)
+{
+	struct __kfifo *fifo = &mp->kfifo;
+	unsigned int tail, n;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	do {
+		tail = ACCESS_ONCE(mp->tail);
+		if (tail == ACCESS_ONCE(fifo->in)) {
+			len = 0;
+			goto out;
+		}
+		smp_rmb();
+		/*
+		 * the header may be stale if another reader claims the
+		 * record meanwhile, but then the cmpxchg fails
+		 */
+		n = kfifo_mp_peek_n(fifo, tail, recsize);
+	} while (cmpxchg(&mp->tail, tail, tail + n + recsize) != tail);
+
+	len = min(len, n);
+	kfifo_copy_out(fifo, buf, len, tail + recsize);
+	kfifo_mp_publish(&fifo->out, tail, tail + n + recsize);
+out:
+	local_irq_restore(flags);
+	return len;
+}
+EXPORT_SYMBOL(__kfifo_mp_out_r);
@@ -0,0 +1,215 @@
+/*
+ * Multi producer kfifo benchmark
+ *
+ * Writer threads push elements into one fifo while reader threads drain
+ * it, first through the lockless kfifo_mp_* functions and then through a
+ * plain kfifo with a spinlock for the writers (and one for the readers if
+ * there are several).  The run is repeated for 1 .. max_threads writers
+ * and the number of elements moved per second is reported through printk.
+ */
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/kfifo.h>
+#include <linux/sched.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
+
+#define KFIFO_BENCH_MAX_THREADS	8
+#define KFIFO_BENCH_MAX_BATCH	64
+#define KFIFO_BENCH_SIZE	1024
+
+static unsigned int max_threads = KFIFO_BENCH_MAX_THREADS;
+module_param(max_threads, uint, 0444);
+MODULE_PARM_DESC(max_threads, "highest writer count of the sweep (1-8)");
+
+static unsigned int readers = 1;
+module_param(readers, uint, 0444);
+MODULE_PARM_DESC(readers, "number of reader threads (1-8)");
+
+static unsigned int run_ms = 1000;
+module_param(run_ms, uint, 0444);
+MODULE_PARM_DESC(run_ms, "run time of each step in milliseconds");
+
+static unsigned int batch = 1;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "elements per kfifo_in/kfifo_out call (1-64)");
+
+struct kfifo_bench_thread {
+	struct task_struct	*task;
+	unsigned long		items;
+};
+
+static DEFINE_KFIFO_MP(bench_fifo_mp, u32, KFIFO_BENCH_SIZE);
+static DEFINE_KFIFO(bench_fifo, u32, KFIFO_BENCH_SIZE);
+static DEFINE_SPINLOCK(bench_in_lock);
+static DEFINE_SPINLOCK(bench_out_lock);
+
+static struct kfifo_bench_thread bench_writers[KFIFO_BENCH_MAX_THREADS];
+static struct kfifo_bench_thread bench_readers[KFIFO_BENCH_MAX_THREADS];
+static struct task_struct *bench_task;
+static bool bench_locked;
+static int bench_stop;
+
+static unsigned int kfifo_bench_in(const u32 *buf)
+{
+	if (!bench_locked)
+		return kfifo_mp_in(&bench_fifo_mp, buf, batch);
+
+	return kfifo_in_spinlocked(&bench_fifo, buf, batch, &bench_in_lock);
+}
+
+static unsigned int kfifo_bench_out(u32 *buf)
+{
+	if (!bench_locked)
+		return kfifo_mp_out(&bench_fifo_mp, buf, batch);
+
+	/* a single reader needs no lock with a plain kfifo */
+	if (readers == 1)
+		return kfifo_out(&bench_fifo, buf, batch);
+
+	return kfifo_out_spinlocked(&bench_fifo, buf, batch, &bench_out_lock);
+}
+
+static void kfifo_bench_park(void)
+{
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+}
+
+static int kfifo_bench_writer(void *arg)
+{
+	struct kfifo_bench_thread *bt = arg;
+	u32 buf[KFIFO_BENCH_MAX_BATCH];
+	unsigned int i, n;
+
+	for (i = 0; i < batch; i++)
+		buf[i] = i;
+
+	while (!ACCESS_ONCE(bench_stop)) {
+		n = kfifo_bench_in(buf);
+		if (!n)
+			cpu_relax();
+		bt->items += n;
+		cond_resched();
+	}
+
+	kfifo_bench_park();
+	return 0;
+}
+
+static int kfifo_bench_reader(void *arg)
+{
+	struct kfifo_bench_thread *bt = arg;
+	u32 buf[KFIFO_BENCH_MAX_BATCH];
+	unsigned int n;
+
+	while (!ACCESS_ONCE(bench_stop)) {
+		n = kfifo_bench_out(buf);
+		if (!n)
+			cpu_relax();
+		bt->items += n;
+		cond_resched();
+	}
+
+	kfifo_bench_park();
+	return 0;
+}
+
+static unsigned int kfifo_bench_start(struct kfifo_bench_thread *threads,
+				      unsigned int nr, int (*fn)(void *),
+				      const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		struct task_struct *p;
+
+		p = kthread_run(fn, &threads[i], "kfifo_bench_%s/%u", name, i);
+		if (IS_ERR(p))
+			break;
+		threads[i].task = p;
+	}
+
+	return i;
+}
+
+static void kfifo_bench_run(bool locked, unsigned int nr_writers)
+{
+	unsigned int i, started_w, started_r;
+	unsigned long items = 0;
+	u64 start, elapsed;
+
+	memset(bench_writers, 0, sizeof(bench_writers));
+	memset(bench_readers, 0, sizeof(bench_readers));
+	INIT_KFIFO_MP(bench_fifo_mp);
+	INIT_KFIFO(bench_fifo);
+	bench_locked = locked;
+	bench_stop = 0;
+
+	start = local_clock();
+	started_r = kfifo_bench_start(bench_readers, readers,
+				      kfifo_bench_reader, "r");
+	started_w = kfifo_bench_start(bench_writers, nr_writers,
+				      kfifo_bench_writer, "w");
+
+	msleep(run_ms);
+	ACCESS_ONCE(bench_stop) = 1;
+
+	for (i = 0; i < started_w; i++)
+		kthread_stop(bench_writers[i].task);
+	for (i = 0; i < started_r; i++)
+		kthread_stop(bench_readers[i].task);
+	elapsed = local_clock() - start;
+
+	for (i = 0; i < started_r; i++)
+		items += bench_readers[i].items;
+
+	printk(KERN_INFO "kfifo_bench: %s writers=%u readers=%u batch=%u "
+	       "items/sec=%llu\n", locked ? "spinlock" : "lockless",
+	       started_w, started_r, batch,
+	       div64_u64((u64)items * NSEC_PER_SEC, elapsed ?: 1));
+}
+
+static int kfifo_bench_main(void *arg)
+{
+	unsigned int nr;
+
+	for (nr = 1; nr <= max_threads && !kthread_should_stop(); nr++) {
+		kfifo_bench_run(false, nr);
+		kfifo_bench_run(true, nr);
+	}
+
+	kfifo_bench_park();
+	return 0;
+}
+
+static int __init kfifo_bench_init(void)
+{
+	if (!max_threads || max_threads > KFIFO_BENCH_MAX_THREADS)
+		max_threads = KFIFO_BENCH_MAX_THREADS;
+	if (!readers || readers > KFIFO_BENCH_MAX_THREADS)
+		readers = 1;
+	if (!batch || batch > KFIFO_BENCH_MAX_BATCH)
+		batch = 1;
+
+	bench_task = kthread_run(kfifo_bench_main, NULL, "kfifo_bench");
+	if (IS_ERR(bench_task))
+		return PTR_ERR(bench_task);
+
+	return 0;
+}
+
+static void __exit kfifo_bench_exit(void)
+{
+	kthread_stop(bench_task);
+}
+
+module_init(kfifo_bench_init);
+module_exit(kfifo_bench_exit);
+
+MODULE_DESCRIPTION("multi producer kfifo benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,273 @@
+/*
+ * kernel/lock_contention.c
+ *
+ * Lock contention statistics without lockdep.
+ *
+ * Contended acquisitions of spinlocks, rwlocks, mutexes and rw semaphores
+ * are charged to the call site that had to wait.  Nothing is done for a
+ * lock that is taken on the first try: the lock slowpaths read the clock
+ * only once the trylock has failed, see LOCK_CONTENDED() in lockdep.h.
+ *
+ * Every CPU has its own small open-addressing table keyed by call site
+ * and lock type, so recording never takes a lock and never touches a
+ * shared cache line.  The tables are merged when read:
+ *
+ *   /sys/kernel/debug/lock_contention/stats	statistics, write to clear
+ *   /sys/kernel/debug/lock_contention/enable	0/1
+ *
+ * Each contended acquisition also emits the lock:lock_contention event.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/hash.h>
+#include <linux/sort.h>
+#include <linux/percpu.h>
+#include <linux/vmalloc.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kallsyms.h>
+#include <asm/div64.h>
+
+#define CREATE_TRACE_POINTS
+#include <trace/events/lock.h>
+
+#define LC_HASH_BITS	10
+#define LC_HASH_SIZE	(1UL << LC_HASH_BITS)
+#define LC_HASH_MASK	(LC_HASH_SIZE - 1)
+/* how far to probe before giving up on a site */
+#define LC_PROBE	8
+
+struct lc_entry {
+	unsigned long	ip;
+	void		*lock;		/* last lock seen at this site */
+	unsigned long	count;
+	u64		total_ns;
+	u64		max_ns;
+	int		type;
+};
+
+static const char * const lc_type_names[LOCK_CONTENTION_NR] = {
+	[LOCK_CONTENTION_SPIN]		= "spin",
+	[LOCK_CONTENTION_RWLOCK]	= "rwlock",
+	[LOCK_CONTENTION_MUTEX]		= "mutex",
+	[LOCK_CONTENTION_RWSEM]		= "rwsem",
+};
+
+static DEFINE_PER_CPU(struct lc_entry *, lc_table);
+static DEFINE_PER_CPU(unsigned long, lc_dropped);
+static DEFINE_PER_CPU(int, lc_recursion);
+
+static u32 lc_enabled = 1;
+
+static inline unsigned long lc_hash(unsigned long ip, int type)
+{
+	return hash_long(ip ^ type, LC_HASH_BITS);
+}
+
+u64 lock_contention_begin(void)
+{
+	return lc_enabled ? local_clock() : 0;
+}
+EXPORT_SYMBOL(lock_contention_begin);
+
+static void lc_record(unsigned long ip, void *lock, int type, u64 delta)
+{
+	struct lc_entry *table = __this_cpu_read(lc_table);
+	struct lc_entry *e;
+	unsigned long idx;
+	int i;
+
+	if (!table)
+		return;
+
+	idx = lc_hash(ip, type);
+	for (i = 0; i < LC_PROBE; i++, idx = (idx + 1) & LC_HASH_MASK) {
+		e = &table[idx];
+		if (!e->ip) {
+			e->ip = ip;
+			e->type = type;
+		} else if (e->ip != ip || e->type != type) {
+			continue;
+		}
+		e->lock = lock;
+		e->count++;
+		e->total_ns += delta;
+		if (delta > e->max_ns)
+			e->max_ns = delta;
+		return;
+	}
+
+	__this_cpu_inc(lc_dropped);
+}
+
+void lock_contention_end(void *lock, unsigned long ip, int type, u64 start)
+{
+	unsigned long flags;
+	s64 delta;
+
+	if (!start)
+		return;
+
+	local_irq_save(flags);
+	/* the tracepoint below may take locks of its own */
+	if (__this_cpu_read(lc_recursion))
+		goto out;
+	__this_cpu_inc(lc_recursion);
+
+	/* a sleeping lock may be acquired on another CPU than it waited on */
+	delta = local_clock() - start;
+	if (delta < 0)
+		delta = 0;
+
+	lc_record(ip, lock, type, delta);
+	trace_lock_contention(lock, ip, type, delta);
+
+	__this_cpu_dec(lc_recursion);
+out:
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(lock_contention_end);
+
+/*
+ * Runs on every CPU with interrupts disabled, so it cannot race with
+ * lc_record() on that CPU.
+ */
+static void lc_clear_cpu(void *unused)
+{
+	struct lc_entry *table = __this_cpu_read(lc_table);
+
+	if (table)
+		memset(table, 0, LC_HASH_SIZE * sizeof(*table));
+	__this_cpu_write(lc_dropped, 0);
+}
+
+static void lc_merge(struct lc_entry *merged, struct lc_entry *e)
+{
+	unsigned long idx = lc_hash(e->ip, e->type);
+	struct lc_entry *m;
+	int i;
+
+	for (i = 0; i < LC_HASH_SIZE; i++, idx = (idx + 1) & LC_HASH_MASK) {
+		m = &merged[idx];
+		if (!m->ip) {
+			*m = *e;
+			return;
+		}
+		if (m->ip == e->ip && m->type == e->type) {
+			m->lock = e->lock;
+			m->count += e->count;
+			m->total_ns += e->total_ns;
+			m->max_ns = max(m->max_ns, e->max_ns);
+			return;
+		}
+	}
+}
+
+static int lc_cmp(const void *a, const void *b)
+{
+	const struct lc_entry *ea = a, *eb = b;
+
+	if (ea->total_ns == eb->total_ns)
+		return 0;
+	return ea->total_ns < eb->total_ns ? 1 : -1;
+}
+
+static int lc_stats_show(struct seq_file *m, void *v)
+{
+	unsigned long dropped = 0;
+	struct lc_entry *merged, *table, e;
+	int cpu, i, nr = 0;
+
+	merged = vzalloc(LC_HASH_SIZE * sizeof(*merged));
+	if (!merged)
+		return -ENOMEM;
+
+	/* the copies are racy against the owning CPU, fine for statistics */
+	for_each_possible_cpu(cpu) {
+		table = per_cpu(lc_table, cpu);
+		dropped += per_cpu(lc_dropped, cpu);
+		if (!table)
+			continue;
+		for (i = 0; i < LC_HASH_SIZE; i++) {
+			e = table[i];
+			if (e.ip && e.count)
+				lc_merge(merged, &e);
+		}
+	}
+
+	for (i = 0; i < LC_HASH_SIZE; i++) {
+		if (merged[i].ip)
+			merged[nr++] = merged[i];
+	}
+	sort(merged, nr, sizeof(*merged), lc_cmp, NULL);
+
+	seq_printf(m, "enabled: %d\n", lc_enabled);
+	seq_printf(m, "dropped: %lu\n\n", dropped);
+	seq_printf(m, "%-7s %12s %16s %12s %12s %18s  %s\n", "type",
+		   "contentions", "total_ns", "avg_ns", "max_ns",
+		   "lock", "site");
+
+	for (i = 0; i < nr; i++) {
+		struct lc_entry *s = &merged[i];
+		u64 avg = s->total_ns;
+
+		do_div(avg, s->count);
+		seq_printf(m, "%-7s %12lu %16llu %12llu %12llu %18p  %pS\n",
+			   lc_type_names[s->type], s->count,
+			   (unsigned long long)s->total_ns,
+			   (unsigned long long)avg,
+			   (unsigned long long)s->max_ns,
+			   s->lock, (void *)s->ip);
+	}
+
+	vfree(merged);
+	return 0;
+}
+
+static int lc_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lc_stats_show, NULL);
+}
+
+static ssize_t lc_stats_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	/* any write clears the statistics */
+	on_each_cpu(lc_clear_cpu, NULL, 1);
+
+	return count;
+}
+
+static const struct file_operations lc_stats_fops = {
+	.open		= lc_stats_open,
+	.read		= seq_read,
+	.write		= lc_stats_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lock_contention_init(void)
+{
+	struct dentry *dir;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(lc_table, cpu) = kzalloc_node(LC_HASH_SIZE *
+				sizeof(struct lc_entry), GFP_KERNEL,
+				cpu_to_node(cpu));
+		if (!per_cpu(lc_table, cpu))
+			pr_warning("lock_contention: no table for cpu %d\n",
+				   cpu);
+	}
+
+	dir = debugfs_create_dir("lock_contention", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_bool("enable", 0644, dir, &lc_enabled);
+	debugfs_create_file("stats", 0644, dir, NULL, &lc_stats_fops);
+
+	return 0;
+}
+fs_initcall(lock_contention_init);
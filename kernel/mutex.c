@@ -59,6 +59,20 @@ EXPORT_SYMBOL(__mutex_init);
 static __used noinline void __sched
 __mutex_lock_slowpath(atomic_t *lock_count);
 
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+/*
+ * The contention profiler charges a wait to the caller of mutex_lock(),
+ * which the slowpath called from the arch fastpath cannot see.  Open-code
+ * the fastpath so the slowpath can be handed the caller's address.
+ */
+static noinline int __sched
+__mutex_lock_contended(struct mutex *lock, long state, unsigned long ip);
+
+# define mutex_fastpath_lock_ip(lock, state)				\
+	(likely(atomic_cmpxchg(&(lock)->count, 1, 0) == 1) ? 0 :	\
+	 __mutex_lock_contended((lock), (state), _RET_IP_))
+#endif
+
 /**
  * mutex_lock - acquire the mutex
  * @lock: the mutex to be acquired
@@ -87,7 +101,11 @@ void __sched mutex_lock(struct mutex *lock)
 	 * The locking fastpath is the 1->0 transition from
 	 * 'unlocked' into 'locked' state.
 	 */
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+	mutex_fastpath_lock_ip(lock, TASK_UNINTERRUPTIBLE);
+#else
 	__mutex_fastpath_lock(&lock->count, __mutex_lock_slowpath);
+#endif
 	mutex_set_owner(lock);
 }
 
@@ -134,6 +152,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 		    struct lockdep_map *nest_lock, unsigned long ip)
 {
 	struct task_struct *task = current;
+	u64 wait_start = lock_contention_begin();
 	struct mutex_waiter waiter;
 	unsigned long flags;
 
@@ -172,6 +191,8 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 
 		if (atomic_cmpxchg(&lock->count, 1, 0) == 1) {
 			lock_acquired(&lock->dep_map, ip);
+			lock_contention_end(lock, ip, LOCK_CONTENTION_MUTEX,
+					    wait_start);
 			mutex_set_owner(lock);
 			preempt_enable();
 			return 0;
@@ -248,6 +269,7 @@ __mutex_lock_common(struct mutex *lock, long state, unsigned int subclass,
 
 done:
 	lock_acquired(&lock->dep_map, ip);
+	lock_contention_end(lock, ip, LOCK_CONTENTION_MUTEX, wait_start);
 	/* got the lock - rejoice! */
 	mutex_remove_waiter(lock, &waiter, current_thread_info());
 	mutex_set_owner(lock);
@@ -351,10 +373,10 @@ __mutex_unlock_slowpath(atomic_t *lock_count)
  * Here come the less common (and hence less performance-critical) APIs:
  * mutex_lock_interruptible() and mutex_trylock().
  */
-static noinline int __sched
+static __used noinline int __sched
 __mutex_lock_killable_slowpath(atomic_t *lock_count);
 
-static noinline int __sched
+static __used noinline int __sched
 __mutex_lock_interruptible_slowpath(atomic_t *lock_count);
 
 /**
@@ -373,8 +395,12 @@ int __sched mutex_lock_interruptible(struct mutex *lock)
 	int ret;
 
 	might_sleep();
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+	ret = mutex_fastpath_lock_ip(lock, TASK_INTERRUPTIBLE);
+#else
 	ret =  __mutex_fastpath_lock_retval
 			(&lock->count, __mutex_lock_interruptible_slowpath);
+#endif
 	if (!ret)
 		mutex_set_owner(lock);
 
@@ -388,8 +414,12 @@ int __sched mutex_lock_killable(struct mutex *lock)
 	int ret;
 
 	might_sleep();
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+	ret = mutex_fastpath_lock_ip(lock, TASK_KILLABLE);
+#else
 	ret = __mutex_fastpath_lock_retval
 			(&lock->count, __mutex_lock_killable_slowpath);
+#endif
 	if (!ret)
 		mutex_set_owner(lock);
 
@@ -405,7 +435,7 @@ __mutex_lock_slowpath(atomic_t *lock_count)
 	__mutex_lock_common(lock, TASK_UNINTERRUPTIBLE, 0, NULL, _RET_IP_);
 }
 
-static noinline int __sched
+static __used noinline int __sched
 __mutex_lock_killable_slowpath(atomic_t *lock_count)
 {
 	struct mutex *lock = container_of(lock_count, struct mutex, count);
@@ -413,13 +443,21 @@ __mutex_lock_killable_slowpath(atomic_t *lock_count)
 	return __mutex_lock_common(lock, TASK_KILLABLE, 0, NULL, _RET_IP_);
 }
 
-static noinline int __sched
+static __used noinline int __sched
 __mutex_lock_interruptible_slowpath(atomic_t *lock_count)
 {
 	struct mutex *lock = container_of(lock_count, struct mutex, count);
 
 	return __mutex_lock_common(lock, TASK_INTERRUPTIBLE, 0, NULL, _RET_IP_);
 }
+
+#ifdef CONFIG_LOCK_CONTENTION_STAT
+static noinline int __sched
+__mutex_lock_contended(struct mutex *lock, long state, unsigned long ip)
+{
+	return __mutex_lock_common(lock, state, 0, NULL, ip);
+}
+#endif
 #endif
 
 /*
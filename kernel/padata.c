@@ -31,6 +31,7 @@
 
 #define MAX_SEQ_NR (INT_MAX - NR_CPUS)
 #define MAX_OBJ_NUM 1000
+#define PADATA_STEAL_BATCH 16
 
 static int padata_index_to_cpu(struct parallel_data *pd, int cpu_index)
 {
@@ -59,12 +60,72 @@ static int padata_cpu_hash(struct padata_priv *padata)
 	return padata_index_to_cpu(pd, cpu_index);
 }
 
+/*
+ * Sequence numbers wrap at pd->max_seq_nr, so compare them on the circle:
+ * a comes before b if b is less than half the range ahead of it.
+ */
+static bool padata_seq_before(struct parallel_data *pd, int a, int b)
+{
+	unsigned int range = pd->max_seq_nr + 1;
+	int delta = b - a;
+
+	if (delta < 0)
+		delta += range;
+
+	return delta && (unsigned int)delta < range / 2;
+}
+
+static struct padata_priv *padata_dequeue(struct padata_list *parallel)
+{
+	struct padata_priv *padata = NULL;
+
+	spin_lock(&parallel->lock);
+	if (!list_empty(&parallel->list)) {
+		padata = list_entry(parallel->list.next,
+				    struct padata_priv, list);
+		list_del_init(&padata->list);
+	}
+	spin_unlock(&parallel->lock);
+
+	return padata;
+}
+
+/*
+ * Take the oldest object off another cpu's parallel queue. Objects are
+ * hashed round robin, so a single cpu that is busy with something else
+ * holds up the serialization of everything behind its queue. A worker
+ * that ran out of work of its own helps out. The object still goes to
+ * the reorder queue of the cpu it was hashed to, see padata_do_serial.
+ */
+static struct padata_priv *padata_steal(struct padata_parallel_queue *pqueue)
+{
+	struct parallel_data *pd = pqueue->pd;
+	struct padata_parallel_queue *victim;
+	struct padata_priv *padata;
+	int cpu;
+
+	for_each_cpu(cpu, pd->cpumask.pcpu) {
+		victim = per_cpu_ptr(pd->pqueue, cpu);
+		if (victim == pqueue || list_empty(&victim->parallel.list))
+			continue;
+
+		padata = padata_dequeue(&victim->parallel);
+		if (padata) {
+			atomic_long_inc(&pd->pinst->steals);
+			return padata;
+		}
+	}
+
+	return NULL;
+}
+
 static void padata_parallel_worker(struct work_struct *parallel_work)
 {
 	struct padata_parallel_queue *pqueue;
 	struct parallel_data *pd;
 	struct padata_instance *pinst;
-	LIST_HEAD(local_list);
+	struct padata_priv *padata;
+	int stolen = 0;
 
 	local_bh_disable();
 	pqueue = container_of(parallel_work,
@@ -72,17 +133,21 @@ static void padata_parallel_worker(struct work_struct *parallel_work)
 	pd = pqueue->pd;
 	pinst = pd->pinst;
 
-	spin_lock(&pqueue->parallel.lock);
-	list_replace_init(&pqueue->parallel.list, &local_list);
-	spin_unlock(&pqueue->parallel.lock);
-
-	while (!list_empty(&local_list)) {
-		struct padata_priv *padata;
-
-		padata = list_entry(local_list.next,
-				    struct padata_priv, list);
-
-		list_del_init(&padata->list);
+	/*
+	 * Objects are taken off the queue one at a time, so that the ones
+	 * still waiting can be stolen if this worker gets preempted. Our
+	 * own queue always comes first, and the number of stolen objects
+	 * is bounded to not keep BHs off for too long.
+	 */
+	while (1) {
+		padata = padata_dequeue(&pqueue->parallel);
+		if (!padata && pinst->work_stealing &&
+		    stolen < PADATA_STEAL_BATCH) {
+			padata = padata_steal(pqueue);
+			stolen++;
+		}
+		if (!padata)
+			break;
 
 		padata->parallel(padata);
 	}
@@ -138,6 +203,7 @@ int padata_do_parallel(struct padata_instance *pinst,
 	padata->seq_nr = atomic_inc_return(&pd->seq_nr);
 
 	target_cpu = padata_cpu_hash(padata);
+	padata->cpu = target_cpu;
 	queue = per_cpu_ptr(pd->pqueue, target_cpu);
 
 	spin_lock(&queue->parallel.lock);
@@ -153,6 +219,22 @@ out:
 }
 EXPORT_SYMBOL(padata_do_parallel);
 
+static void padata_account_wait(struct padata_instance *pinst,
+				struct padata_priv *padata)
+{
+	/* the object may have been queued on another cpu */
+	s64 delta = local_clock() - padata->stamp;
+
+	if (delta < 0)
+		delta = 0;
+
+	atomic_long_inc(&pinst->serialized);
+	atomic64_add(delta, &pinst->reorder_wait);
+	/* racy against the reorder of a replaced pd, fine for a maximum */
+	if (delta > pinst->reorder_wait_max)
+		pinst->reorder_wait_max = delta;
+}
+
 /*
  * padata_get_next - Get the next object that needs serialization.
  *
@@ -168,7 +250,7 @@ EXPORT_SYMBOL(padata_do_parallel);
  *  the cpu's reorder queue.
  *
  * -ENODATA, if this cpu has to do the parallel processing for
- *  the next object.
+ *  the next object, unless another cpu steals it.
  */
 static struct padata_priv *padata_get_next(struct parallel_data *pd)
 {
@@ -201,21 +283,27 @@ static struct padata_priv *padata_get_next(struct parallel_data *pd)
 
 	reorder = &next_queue->reorder;
 
+	spin_lock(&reorder->lock);
 	if (!list_empty(&reorder->list)) {
 		padata = list_entry(reorder->list.next,
 				    struct padata_priv, list);
 
-		BUG_ON(next_nr != padata->seq_nr);
-
-		spin_lock(&reorder->lock);
-		list_del_init(&padata->list);
-		atomic_dec(&pd->reorder_objects);
-		spin_unlock(&reorder->lock);
+		/*
+		 * A stolen object can get here before an older object of
+		 * the same queue that is still being processed.
+		 */
+		if (padata->seq_nr == next_nr) {
+			list_del_init(&padata->list);
+			atomic_dec(&pd->reorder_objects);
+			spin_unlock(&reorder->lock);
 
-		pd->processed++;
+			pd->processed++;
+			padata_account_wait(pd->pinst, padata);
 
-		goto out;
+			goto out;
+		}
 	}
+	spin_unlock(&reorder->lock);
 
 	queue = per_cpu_ptr(pd->pqueue, smp_processor_id());
 	if (queue->cpu_index == next_queue->cpu_index) {
@@ -228,6 +316,33 @@ out:
 	return padata;
 }
 
+/* Is the next object to serialize waiting in its reorder queue? */
+static bool padata_next_ready(struct parallel_data *pd)
+{
+	struct padata_parallel_queue *next_queue;
+	struct padata_priv *padata;
+	int next_nr, cpu;
+	bool ready = false;
+
+	next_nr = ACCESS_ONCE(pd->processed);
+	if (unlikely(next_nr > pd->max_seq_nr))
+		next_nr = next_nr - pd->max_seq_nr - 1;
+
+	cpu = padata_index_to_cpu(pd, next_nr %
+				  cpumask_weight(pd->cpumask.pcpu));
+	next_queue = per_cpu_ptr(pd->pqueue, cpu);
+
+	spin_lock_bh(&next_queue->reorder.lock);
+	if (!list_empty(&next_queue->reorder.list)) {
+		padata = list_entry(next_queue->reorder.list.next,
+				    struct padata_priv, list);
+		ready = padata->seq_nr == next_nr;
+	}
+	spin_unlock_bh(&next_queue->reorder.lock);
+
+	return ready;
+}
+
 static void padata_reorder(struct parallel_data *pd)
 {
 	struct padata_priv *padata;
@@ -244,6 +359,7 @@ static void padata_reorder(struct parallel_data *pd)
 	 * moment. Therefore we use a trylock and let the holder of the lock
 	 * care for all the objects enqueued during the holdtime of the lock.
 	 */
+again:
 	if (!spin_trylock_bh(&pd->lock))
 		return;
 
@@ -267,7 +383,7 @@ static void padata_reorder(struct parallel_data *pd)
 		if (PTR_ERR(padata) == -ENODATA) {
 			del_timer(&pd->timer);
 			spin_unlock_bh(&pd->lock);
-			return;
+			goto recheck;
 		}
 
 		squeue = per_cpu_ptr(pd->squeue, padata->cb_cpu);
@@ -292,7 +408,15 @@ static void padata_reorder(struct parallel_data *pd)
 	else
 		del_timer(&pd->timer);
 
-	return;
+recheck:
+	/*
+	 * The next object may have been queued, by a thief or by its own
+	 * cpu, while we held the lock and its padata_reorder() call failed
+	 * the trylock. Don't leave it to the timer.
+	 */
+	smp_mb();
+	if (padata_next_ready(pd))
+		goto again;
 }
 
 static void padata_reorder_timer(unsigned long arg)
@@ -340,21 +464,30 @@ static void padata_serial_worker(struct work_struct *serial_work)
  */
 void padata_do_serial(struct padata_priv *padata)
 {
-	int cpu;
 	struct padata_parallel_queue *pqueue;
+	struct padata_priv *cur;
 	struct parallel_data *pd;
 
 	pd = padata->pd;
 
-	cpu = get_cpu();
-	pqueue = per_cpu_ptr(pd->pqueue, cpu);
+	/*
+	 * The reorder queue is the one of the cpu the object was hashed
+	 * to, whichever cpu did the parallel processing.
+	 */
+	pqueue = per_cpu_ptr(pd->pqueue, padata->cpu);
+	padata->stamp = local_clock();
 
 	spin_lock(&pqueue->reorder.lock);
 	atomic_inc(&pd->reorder_objects);
-	list_add_tail(&padata->list, &pqueue->reorder.list);
+	/* keep it sorted, a stolen object may overtake older ones */
+	list_for_each_entry_reverse(cur, &pqueue->reorder.list, list)
+		if (padata_seq_before(pd, cur->seq_nr, padata->seq_nr))
+			break;
+	list_add(&padata->list, &cur->list);
 	spin_unlock(&pqueue->reorder.lock);
 
-	put_cpu();
+	/* pairs with the barrier before padata_next_ready() */
+	smp_mb();
 
 	padata_reorder(pd);
 }
@@ -987,17 +1120,69 @@ out:
 	static struct padata_sysfs_entry _name##_attr = \
 		__ATTR(_name, 0400, _show_name, NULL)
 
+static ssize_t show_work_stealing(struct padata_instance *pinst,
+				  struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", pinst->work_stealing);
+}
+
+static ssize_t store_work_stealing(struct padata_instance *pinst,
+				   struct attribute *attr,
+				   const char *buf, size_t count)
+{
+	unsigned long val;
+
+	if (strict_strtoul(buf, 10, &val) || val > 1)
+		return -EINVAL;
+
+	pinst->work_stealing = val;
+	return count;
+}
+
+static ssize_t show_stat(struct padata_instance *pinst,
+			 struct attribute *attr, char *buf)
+{
+	unsigned long long val;
+
+	if (!strcmp(attr->name, "steals"))
+		val = atomic_long_read(&pinst->steals);
+	else if (!strcmp(attr->name, "serialized"))
+		val = atomic_long_read(&pinst->serialized);
+	else if (!strcmp(attr->name, "reorder_wait_ns"))
+		val = atomic64_read(&pinst->reorder_wait);
+	else
+		val = pinst->reorder_wait_max;
+
+	return sprintf(buf, "%llu\n", val);
+}
+
 PADATA_ATTR_RW(serial_cpumask, show_cpumask, store_cpumask);
 PADATA_ATTR_RW(parallel_cpumask, show_cpumask, store_cpumask);
+PADATA_ATTR_RW(work_stealing, show_work_stealing, store_work_stealing);
+PADATA_ATTR_RO(steals, show_stat);
+PADATA_ATTR_RO(serialized, show_stat);
+PADATA_ATTR_RO(reorder_wait_ns, show_stat);
+PADATA_ATTR_RO(reorder_wait_max_ns, show_stat);
 
 /*
  * Padata sysfs provides the following objects:
- * serial_cpumask   [RW] - cpumask for serial workers
- * parallel_cpumask [RW] - cpumask for parallel workers
+ * serial_cpumask      [RW] - cpumask for serial workers
+ * parallel_cpumask    [RW] - cpumask for parallel workers
+ * work_stealing       [RW] - let idle parallel workers steal objects
+ * steals              [RO] - objects processed by a cpu they were not
+ *                            hashed to
+ * serialized          [RO] - objects that passed the reorder queues
+ * reorder_wait_ns     [RO] - total time they spent waiting there
+ * reorder_wait_max_ns [RO] - longest time one of them spent there
  */
 static struct attribute *padata_default_attrs[] = {
 	&serial_cpumask_attr.attr,
 	&parallel_cpumask_attr.attr,
+	&work_stealing_attr.attr,
+	&steals_attr.attr,
+	&serialized_attr.attr,
+	&reorder_wait_ns_attr.attr,
+	&reorder_wait_max_ns_attr.attr,
 	NULL,
 };
 
@@ -1097,6 +1282,7 @@ struct padata_instance *padata_alloc(struct workqueue_struct *wq,
 	cpumask_copy(pinst->cpumask.cbcpu, cbcpumask);
 
 	pinst->flags = 0;
+	pinst->work_stealing = 1;
 
 #ifdef CONFIG_HOTPLUG_CPU
 	pinst->cpu_notifier.notifier_call = padata_cpu_callback;
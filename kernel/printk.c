@@ -41,6 +41,9 @@
 #include <linux/cpu.h>
 #include <linux/notifier.h>
 #include <linux/rculist.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <trace/stm.h>
 
 #include <asm/uaccess.h>
@@ -147,6 +150,20 @@ EXPORT_SYMBOL(console_set_on_cmdline);
 /* Flag: console code may call schedule() */
 static int console_may_schedule;
 
+/* Work left for printk_tick() on this cpu */
+#define PRINTK_PENDING_WAKEUP	0x01	/* wake up klogd */
+#define PRINTK_PENDING_FLUSH	0x02	/* wake up the printk flush thread */
+
+static DEFINE_PER_CPU(int, printk_pending);
+
+/* Time spent in the console drivers, protected by console_sem */
+static struct console_stats {
+	unsigned long	calls;
+	unsigned long	chars;
+	u64		time_ns;
+	u64		max_ns;
+} console_stats;
+
 #ifdef CONFIG_PRINTK
 
 static char __log_buf[__LOG_BUF_LEN];
@@ -879,61 +896,20 @@ static inline void printk_delay(void)
 	}
 }
 
-asmlinkage int vprintk(const char *fmt, va_list args)
+/*
+ * Copy one formatted message into log_buf. If the caller didn't provide
+ * the appropriate log prefix, we insert it here, followed by the time
+ * stamp @t if printk_time is set. Must be called with logbuf_lock held.
+ * Returns the number of prefix characters added.
+ */
+static int log_store_text(const char *text, unsigned long long t)
 {
-	int printed_len = 0;
-	int current_log_level = default_message_loglevel;
-	unsigned long flags;
-	int this_cpu;
-	char *p;
+	unsigned int current_log_level = default_message_loglevel;
+	const char *p = text;
+	int added = 0;
 	size_t plen;
 	char special;
 
-	boot_delay_msec();
-	printk_delay();
-
-	preempt_disable();
-	/* This stops the holder of console_sem just where we want him */
-	raw_local_irq_save(flags);
-	this_cpu = smp_processor_id();
-
-	/*
-	 * Ouch, printk recursed into itself!
-	 */
-	if (unlikely(printk_cpu == this_cpu)) {
-		/*
-		 * If a crash is occurring during printk() on this CPU,
-		 * then try to get the crash message out but make sure
-		 * we can't deadlock. Otherwise just return to avoid the
-		 * recursion and return - but flag the recursion so that
-		 * it can be printed at the next appropriate moment:
-		 */
-		if (!oops_in_progress) {
-			recursion_bug = 1;
-			goto out_restore_irqs;
-		}
-		zap_locks();
-	}
-
-	lockdep_off();
-	spin_lock(&logbuf_lock);
-	printk_cpu = this_cpu;
-
-	if (recursion_bug) {
-		recursion_bug = 0;
-		strcpy(printk_buf, recursion_bug_msg);
-		printed_len = strlen(recursion_bug_msg);
-	}
-	/* Emit the output into the temporary buffer */
-	printed_len += vscnprintf(printk_buf + printed_len,
-				  sizeof(printk_buf) - printed_len, fmt, args);
-
-#ifdef	CONFIG_DEBUG_LL
-	printascii(printk_buf);
-#endif
-
-	p = printk_buf;
-
 	/* Read log level and handle special printk prefix */
 	plen = log_prefix(p, &current_log_level, &special);
 	if (plen) {
@@ -953,13 +929,6 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 		}
 	}
 
-	/* Send printk buffer to MIPI STM trace hardware too if enable */
-	stm_dup_printk(printk_buf, printed_len);
-
-	/*
-	 * Copy the output into log_buf. If the caller didn't provide
-	 * the appropriate log prefix, we insert them here
-	 */
 	for (; *p; p++) {
 		if (new_text_line) {
 			new_text_line = 0;
@@ -969,32 +938,31 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 				int i;
 
 				for (i = 0; i < plen; i++)
-					emit_log_char(printk_buf[i]);
-				printed_len += plen;
+					emit_log_char(text[i]);
+				added += plen;
 			} else {
 				/* Add log prefix */
 				emit_log_char('<');
 				emit_log_char(current_log_level + '0');
 				emit_log_char('>');
-				printed_len += 3;
+				added += 3;
 			}
 
 			if (printk_time) {
-				/* Add the current time stamp */
+				/* Add the time stamp */
 				char tbuf[50], *tp;
 				unsigned tlen;
-				unsigned long long t;
+				unsigned long long ts = t;
 				unsigned long nanosec_rem;
 
-				t = cpu_clock(printk_cpu);
-				nanosec_rem = do_div(t, 1000000000);
+				nanosec_rem = do_div(ts, 1000000000);
 				tlen = sprintf(tbuf, "[%5lu.%06lu] ",
-						(unsigned long) t,
+						(unsigned long) ts,
 						nanosec_rem / 1000);
 
 				for (tp = tbuf; tp < tbuf + tlen; tp++)
 					emit_log_char(*tp);
-				printed_len += tlen;
+				added += tlen;
 			}
 
 			if (!*p)
@@ -1006,6 +974,318 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 			new_text_line = 1;
 	}
 
+	return added;
+}
+
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+/*
+ * Deferred console output.
+ *
+ * Once the system is up, printk() does not touch logbuf_lock or the
+ * console drivers at all. Each CPU formats its messages into a private
+ * staging ring, with interrupts disabled, and the printk flush thread
+ * later merges the rings into log_buf in time stamp order and pushes
+ * log_buf out to the consoles. Slow serial consoles then only delay the
+ * flush thread, not whoever happened to call printk().
+ *
+ * Every ring has a single producer, its own CPU, and a single consumer,
+ * whoever holds logbuf_lock. Oopses, panics and early boot take the old
+ * synchronous path, which drains the rings first so that nothing is
+ * printed out of order. The same happens when a ring overflows.
+ */
+#define PRINTK_CPU_BUF_LEN	(1 << CONFIG_PRINTK_CPU_BUF_SHIFT)
+#define PRINTK_CPU_BUF_MASK	(PRINTK_CPU_BUF_LEN - 1)
+
+struct printk_record {
+	unsigned long long	ts;
+	unsigned int		len;
+};
+
+struct printk_cpu_buf {
+	unsigned int	head;		/* written by the owning CPU only */
+	unsigned int	tail;		/* written under logbuf_lock only */
+	unsigned int	drain_head;	/* snapshot of head for one drain */
+	int		busy;		/* owning CPU is inside vprintk_stage() */
+	unsigned long	staged;		/* messages staged */
+	unsigned long	overflows;	/* messages that found the ring full */
+	char		text[1024];
+	char		ring[PRINTK_CPU_BUF_LEN];
+};
+
+static DEFINE_PER_CPU(struct printk_cpu_buf, printk_cpu_bufs);
+
+static int printk_deferred = 1;
+module_param_named(deferred, printk_deferred, bool, S_IRUGO | S_IWUSR);
+
+static struct task_struct *printk_flush_task;
+
+static void printk_ring_copy_in(struct printk_cpu_buf *pcb, unsigned int pos,
+				const void *src, unsigned int len)
+{
+	unsigned int off = pos & PRINTK_CPU_BUF_MASK;
+	unsigned int first = min(len, PRINTK_CPU_BUF_LEN - off);
+
+	memcpy(pcb->ring + off, src, first);
+	memcpy(pcb->ring, src + first, len - first);
+}
+
+static void printk_ring_copy_out(struct printk_cpu_buf *pcb, unsigned int pos,
+				 void *dst, unsigned int len)
+{
+	unsigned int off = pos & PRINTK_CPU_BUF_MASK;
+	unsigned int first = min(len, PRINTK_CPU_BUF_LEN - off);
+
+	memcpy(dst, pcb->ring + off, first);
+	memcpy(dst + first, pcb->ring, len - first);
+}
+
+/*
+ * Only defer once the flush thread can run. Oopses and panics may never
+ * get to schedule it again, and neither may a halting system.
+ */
+static inline int printk_deferred_ok(void)
+{
+	return printk_deferred && printk_flush_task && !oops_in_progress &&
+		system_state == SYSTEM_RUNNING;
+}
+
+static inline int printk_cpu_busy(int cpu)
+{
+	return per_cpu(printk_cpu_bufs, cpu).busy;
+}
+
+/*
+ * Format a message into this CPU's staging ring. Called with interrupts
+ * disabled. Returns the length of the message, or -1 if the ring is full
+ * and the caller has to go through log_buf directly.
+ */
+static int vprintk_stage(int cpu, const char *fmt, va_list args)
+{
+	struct printk_cpu_buf *pcb = &per_cpu(printk_cpu_bufs, cpu);
+	struct printk_record rec;
+	unsigned int head, tail;
+	int len;
+
+	pcb->busy = 1;
+	len = vscnprintf(pcb->text, sizeof(pcb->text), fmt, args);
+	rec.ts = cpu_clock(cpu);
+	rec.len = len;
+
+	head = pcb->head;
+	tail = ACCESS_ONCE(pcb->tail);
+	/* read tail before overwriting what the consumer has released */
+	smp_mb();
+	if (PRINTK_CPU_BUF_LEN - (head - tail) < sizeof(rec) + len) {
+		pcb->overflows++;
+		pcb->busy = 0;
+		return -1;
+	}
+
+#ifdef	CONFIG_DEBUG_LL
+	printascii(pcb->text);
+#endif
+	stm_dup_printk(pcb->text, len);
+
+	printk_ring_copy_in(pcb, head, &rec, sizeof(rec));
+	printk_ring_copy_in(pcb, head + sizeof(rec), pcb->text, len);
+	/* publish the record only after it is complete */
+	smp_wmb();
+	pcb->head = head + sizeof(rec) + len;
+	pcb->staged++;
+
+	__this_cpu_or(printk_pending, PRINTK_PENDING_FLUSH);
+	pcb->busy = 0;
+
+	return len;
+}
+
+/*
+ * Move every staged message into log_buf, oldest first. Must be called
+ * with logbuf_lock held. Messages staged after the drain started are
+ * left for the next one so that a busy CPU cannot keep us here.
+ */
+static void printk_drain_cpu_bufs(void)
+{
+	static char drain_text[1024 + 1];
+	struct printk_cpu_buf *pcb, *first;
+	struct printk_record rec, first_rec;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		pcb = &per_cpu(printk_cpu_bufs, cpu);
+		pcb->drain_head = ACCESS_ONCE(pcb->head);
+	}
+	/* pairs with the smp_wmb() in vprintk_stage() */
+	smp_rmb();
+
+	for (;;) {
+		first = NULL;
+		for_each_possible_cpu(cpu) {
+			pcb = &per_cpu(printk_cpu_bufs, cpu);
+			if (pcb->tail == pcb->drain_head)
+				continue;
+			printk_ring_copy_out(pcb, pcb->tail, &rec, sizeof(rec));
+			if (!first || rec.ts < first_rec.ts) {
+				first = pcb;
+				first_rec = rec;
+			}
+		}
+		if (!first)
+			break;
+
+		printk_ring_copy_out(first, first->tail + sizeof(rec),
+				     drain_text, first_rec.len);
+		drain_text[first_rec.len] = '\0';
+		/* finish reading the record before releasing its space */
+		smp_mb();
+		first->tail += sizeof(rec) + first_rec.len;
+
+		log_store_text(drain_text, first_rec.ts);
+	}
+
+	if (recursion_bug) {
+		recursion_bug = 0;
+		log_store_text(recursion_bug_msg, local_clock());
+	}
+}
+
+static int printk_flush_needed(void)
+{
+	int cpu;
+
+	if (con_start != log_end && !console_suspended)
+		return 1;
+
+	for_each_possible_cpu(cpu) {
+		struct printk_cpu_buf *pcb = &per_cpu(printk_cpu_bufs, cpu);
+
+		if (pcb->tail != ACCESS_ONCE(pcb->head))
+			return 1;
+	}
+	return recursion_bug;
+}
+
+static int printk_flush_thread(void *unused)
+{
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!printk_flush_needed())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+
+		spin_lock_irq(&logbuf_lock);
+		printk_drain_cpu_bufs();
+		spin_unlock_irq(&logbuf_lock);
+
+		console_lock();
+		console_unlock();
+	}
+
+	return 0;
+}
+
+static int __init printk_flush_init(void)
+{
+	struct task_struct *p;
+
+	p = kthread_run(printk_flush_thread, NULL, "printk");
+	if (IS_ERR(p))
+		return PTR_ERR(p);
+	printk_flush_task = p;
+
+	return 0;
+}
+early_initcall(printk_flush_init);
+#else
+static inline int printk_deferred_ok(void)
+{
+	return 0;
+}
+
+static inline int printk_cpu_busy(int cpu)
+{
+	return 0;
+}
+
+static inline int vprintk_stage(int cpu, const char *fmt, va_list args)
+{
+	return -1;
+}
+
+static inline void printk_drain_cpu_bufs(void)
+{
+}
+#endif /* CONFIG_PRINTK_DEFERRED_CONSOLE */
+
+asmlinkage int vprintk(const char *fmt, va_list args)
+{
+	int printed_len = 0;
+	unsigned long flags;
+	int this_cpu;
+
+	boot_delay_msec();
+	printk_delay();
+
+	preempt_disable();
+	/* This stops the holder of console_sem just where we want him */
+	raw_local_irq_save(flags);
+	this_cpu = smp_processor_id();
+
+	/*
+	 * Ouch, printk recursed into itself!
+	 */
+	if (unlikely(printk_cpu == this_cpu || printk_cpu_busy(this_cpu))) {
+		/*
+		 * If a crash is occurring during printk() on this CPU,
+		 * then try to get the crash message out but make sure
+		 * we can't deadlock. Otherwise just return to avoid the
+		 * recursion and return - but flag the recursion so that
+		 * it can be printed at the next appropriate moment:
+		 */
+		if (!oops_in_progress) {
+			recursion_bug = 1;
+			goto out_restore_irqs;
+		}
+		zap_locks();
+	}
+
+	if (printk_deferred_ok()) {
+		va_list aq;
+
+		/* args must survive a ring overflow for the slow path */
+		va_copy(aq, args);
+		printed_len = vprintk_stage(this_cpu, fmt, aq);
+		va_end(aq);
+		if (printed_len >= 0)
+			goto out_restore_irqs;
+		printed_len = 0;
+	}
+
+	lockdep_off();
+	spin_lock(&logbuf_lock);
+	printk_cpu = this_cpu;
+
+	/* Staged messages are older than this one */
+	printk_drain_cpu_bufs();
+
+	if (recursion_bug) {
+		recursion_bug = 0;
+		strcpy(printk_buf, recursion_bug_msg);
+		printed_len = strlen(recursion_bug_msg);
+	}
+	/* Emit the output into the temporary buffer */
+	printed_len += vscnprintf(printk_buf + printed_len,
+				  sizeof(printk_buf) - printed_len, fmt, args);
+
+#ifdef	CONFIG_DEBUG_LL
+	printascii(printk_buf);
+#endif
+
+	/* Send printk buffer to MIPI STM trace hardware too if enable */
+	stm_dup_printk(printk_buf, printed_len);
+
+	printed_len += log_store_text(printk_buf, cpu_clock(printk_cpu));
+
 	/*
 	 * Try to acquire and then immediately release the
 	 * console semaphore. The release will do all the
@@ -1015,8 +1295,15 @@ asmlinkage int vprintk(const char *fmt, va_list args)
 	 * The console_trylock_for_printk() function
 	 * will release 'logbuf_lock' regardless of whether it
 	 * actually gets the semaphore or not.
+	 *
+	 * A staging ring overflow with deferral enabled only
+	 * kicks the flush thread, the console is its business.
 	 */
-	if (console_trylock_for_printk(this_cpu))
+	if (printk_deferred_ok()) {
+		printk_cpu = UINT_MAX;
+		spin_unlock(&logbuf_lock);
+		__this_cpu_or(printk_pending, PRINTK_PENDING_FLUSH);
+	} else if (console_trylock_for_printk(this_cpu))
 		console_unlock();
 
 	lockdep_on();
@@ -1263,13 +1550,17 @@ int is_console_locked(void)
 	return console_locked;
 }
 
-static DEFINE_PER_CPU(int, printk_pending);
-
 void printk_tick(void)
 {
 	if (__this_cpu_read(printk_pending)) {
-		__this_cpu_write(printk_pending, 0);
-		wake_up_interruptible(&log_wait);
+		int pending = __this_cpu_xchg(printk_pending, 0);
+
+		if (pending & PRINTK_PENDING_WAKEUP)
+			wake_up_interruptible(&log_wait);
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+		if (pending & PRINTK_PENDING_FLUSH)
+			wake_up_process(printk_flush_task);
+#endif
 	}
 }
 
@@ -1283,7 +1574,7 @@ int printk_needs_cpu(int cpu)
 void wake_up_klogd(void)
 {
 	if (waitqueue_active(&log_wait))
-		this_cpu_write(printk_pending, 1);
+		this_cpu_or(printk_pending, PRINTK_PENDING_WAKEUP);
 }
 
 /**
@@ -1305,6 +1596,7 @@ void console_unlock(void)
 	unsigned long flags;
 	unsigned _con_start, _log_end;
 	unsigned wake_klogd = 0, retry = 0;
+	u64 t;
 
 	if (console_suspended) {
 		up(&console_sem);
@@ -1324,8 +1616,15 @@ again:
 		con_start = log_end;		/* Flush */
 		spin_unlock(&logbuf_lock);
 		stop_critical_timings();	/* don't trace print latency */
+		t = local_clock();
 		call_console_drivers(_con_start, _log_end);
+		t = local_clock() - t;
 		start_critical_timings();
+		console_stats.calls++;
+		console_stats.chars += _log_end - _con_start;
+		console_stats.time_ns += t;
+		if (t > console_stats.max_ns)
+			console_stats.max_ns = t;
 		local_irq_restore(flags);
 	}
 	console_locked = 0;
@@ -1790,6 +2089,7 @@ void kmsg_dump(enum kmsg_dump_reason reason)
 	   there's not a lot we can do about that. The new messages
 	   will overwrite the start of what we dump. */
 	spin_lock_irqsave(&logbuf_lock, flags);
+	printk_drain_cpu_bufs();
 	end = log_end & LOG_BUF_MASK;
 	chars = logged_chars;
 	spin_unlock_irqrestore(&logbuf_lock, flags);
@@ -1813,4 +2113,57 @@ void kmsg_dump(enum kmsg_dump_reason reason)
 		dumper->dump(dumper, reason, s1, l1, s2, l2);
 	rcu_read_unlock();
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int printk_stats_show(struct seq_file *m, void *v)
+{
+	struct console_stats stats;
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+	unsigned long staged = 0, overflows = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		staged += per_cpu(printk_cpu_bufs, cpu).staged;
+		overflows += per_cpu(printk_cpu_bufs, cpu).overflows;
+	}
+#endif
+
+	console_lock();
+	stats = console_stats;
+	console_unlock();
+
+	seq_printf(m, "console_calls: %lu\n", stats.calls);
+	seq_printf(m, "console_chars: %lu\n", stats.chars);
+	seq_printf(m, "console_time_ns: %llu\n",
+		   (unsigned long long)stats.time_ns);
+	seq_printf(m, "console_max_ns: %llu\n",
+		   (unsigned long long)stats.max_ns);
+#ifdef CONFIG_PRINTK_DEFERRED_CONSOLE
+	seq_printf(m, "deferred: %d\n", printk_deferred);
+	seq_printf(m, "staged: %lu\n", staged);
+	seq_printf(m, "overflows: %lu\n", overflows);
+#endif
+	return 0;
+}
+
+static int printk_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, printk_stats_show, NULL);
+}
+
+static const struct file_operations printk_stats_fops = {
+	.open		= printk_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init printk_debugfs_init(void)
+{
+	debugfs_create_file("printk_stats", 0444, NULL, NULL,
+			    &printk_stats_fops);
+	return 0;
+}
+late_initcall(printk_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
 #endif
@@ -14,7 +14,7 @@
 #include <linux/timer.h>
 #include <linux/freezer.h>
 
-#include "rtmutex.h"
+#include "rtmutex_common.h"
 
 #define MAX_RT_TEST_THREADS	8
 #define MAX_RT_TEST_MUTEXES	8
@@ -27,6 +27,9 @@ struct test_thread_data {
 	int			opdata;
 	int			mutexes[MAX_RT_TEST_MUTEXES];
 	int			event;
+#ifdef CONFIG_FUTEX_BOOST
+	struct rt_mutex_boost	boost;
+#endif
 	struct sys_device	sysdev;
 };
 
@@ -46,6 +49,8 @@ enum test_opcodes {
 	RTTEST_UNLOCK,		/* 8 Unlock, data = lockindex */
 	/* 9, 10 - reserved for BKL commemoration */
 	RTTEST_SIGNAL = 11,	/* 11 Signal other test thread, data = thread id */
+	RTTEST_BOOSTWAIT,	/* 12 Boost thread and block, data = thread id */
+	RTTEST_UNBOOST,		/* 13 Stop blocking and drop the boost */
 	RTTEST_RESETEVENT = 98,	/* 98 Reset event counter */
 	RTTEST_RESET = 99,	/* 99 Reset all pending operations */
 };
@@ -121,6 +126,37 @@ static int handle_op(struct test_thread_data *td, int lockwakeup)
 		td->mutexes[id] = 0;
 		return 0;
 
+#ifdef CONFIG_FUTEX_BOOST
+	case RTTEST_BOOSTWAIT:
+		id = td->opdata;
+		if (id < 0 || id >= MAX_RT_TEST_THREADS ||
+		    threads[id] == current)
+			return ret;
+
+		/*
+		 * Block like a FUTEX_WAIT_BOOST waiter until told to
+		 * unboost; other commands are rejected meanwhile.
+		 */
+		td->event = atomic_add_return(1, &rttest_event);
+		rt_mutex_boost_owner(&td->boost, threads[id]);
+		td->event = atomic_add_return(1, &rttest_event);
+
+		td->opcode = 0;
+		for (;;) {
+			set_current_state(TASK_INTERRUPTIBLE);
+			if (td->opcode == RTTEST_UNBOOST)
+				break;
+			if (td->opcode > 0)
+				td->opcode = -EINVAL;
+			schedule();
+		}
+		__set_current_state(TASK_RUNNING);
+
+		rt_mutex_unboost_owner(&td->boost);
+		td->event = atomic_add_return(1, &rttest_event);
+		return 0;
+#endif
+
 	default:
 		break;
 	}
@@ -98,11 +98,15 @@ static inline void mark_rt_mutex_waiters(struct rt_mutex *lock)
  */
 int rt_mutex_getprio(struct task_struct *task)
 {
-	if (likely(!task_has_pi_waiters(task)))
-		return task->normal_prio;
+	int prio = task->normal_prio;
 
-	return min(task_top_pi_waiter(task)->pi_list_entry.prio,
-		   task->normal_prio);
+	if (unlikely(task_has_pi_waiters(task)))
+		prio = min(task_top_pi_waiter(task)->pi_list_entry.prio, prio);
+#ifdef CONFIG_FUTEX_BOOST
+	if (unlikely(task_has_boost_waiters(task)))
+		prio = min(plist_first(&task->boost_waiters)->prio, prio);
+#endif
+	return prio;
 }
 
 /*
@@ -563,6 +567,53 @@ void rt_mutex_adjust_pi(struct task_struct *task)
 	rt_mutex_adjust_prio_chain(task, 0, NULL, NULL, task);
 }
 
+#ifdef CONFIG_FUTEX_BOOST
+/**
+ * rt_mutex_boost_owner - boost the owner of a lock we are about to block on
+ * @boost:	the boost request, on the stack of the blocking task
+ * @owner:	the task holding the lock
+ *
+ * Lightweight priority inheritance for locks which are not rt_mutexes
+ * (FUTEX_WAIT_BOOST): @owner runs at least at the priority of current
+ * until rt_mutex_unboost_owner() is called.  There is no lock object,
+ * so unlike the rt_mutex PI chain this does not follow @owner into
+ * other boosted waits; an rt_mutex @owner is blocked on is adjusted
+ * though.  The caller must hold a reference on @owner.
+ */
+void rt_mutex_boost_owner(struct rt_mutex_boost *boost,
+			  struct task_struct *owner)
+{
+	unsigned long flags;
+
+	boost->owner = owner;
+	plist_node_init(&boost->entry, current->prio);
+
+	raw_spin_lock_irqsave(&owner->pi_lock, flags);
+	plist_add(&boost->entry, &owner->boost_waiters);
+	__rt_mutex_adjust_prio(owner);
+	raw_spin_unlock_irqrestore(&owner->pi_lock, flags);
+
+	rt_mutex_adjust_pi(owner);
+}
+
+/**
+ * rt_mutex_unboost_owner - drop a boost set up by rt_mutex_boost_owner()
+ * @boost:	the boost request
+ */
+void rt_mutex_unboost_owner(struct rt_mutex_boost *boost)
+{
+	struct task_struct *owner = boost->owner;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&owner->pi_lock, flags);
+	plist_del(&boost->entry, &owner->boost_waiters);
+	__rt_mutex_adjust_prio(owner);
+	raw_spin_unlock_irqrestore(&owner->pi_lock, flags);
+
+	rt_mutex_adjust_pi(owner);
+}
+#endif
+
 /**
  * __rt_mutex_slowlock() - Perform the wait-wake-try-to-take loop
  * @lock:		 the rt_mutex to take
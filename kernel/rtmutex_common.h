@@ -88,6 +88,29 @@ task_top_pi_waiter(struct task_struct *p)
 				  pi_list_entry);
 }
 
+#ifdef CONFIG_FUTEX_BOOST
+/*
+ * Priority boost request of a task blocked on a lock that is not an
+ * rt_mutex, see rt_mutex_boost_owner().
+ *
+ * @entry:	node to enqueue into the owner boost_waiters list
+ * @owner:	the boosted task
+ */
+struct rt_mutex_boost {
+	struct plist_node	entry;
+	struct task_struct	*owner;
+};
+
+static inline int task_has_boost_waiters(struct task_struct *p)
+{
+	return !plist_head_empty(&p->boost_waiters);
+}
+
+extern void rt_mutex_boost_owner(struct rt_mutex_boost *boost,
+				 struct task_struct *owner);
+extern void rt_mutex_unboost_owner(struct rt_mutex_boost *boost);
+#endif
+
 /*
  * lock->owner state tracking:
  */
@@ -0,0 +1,169 @@
+/*
+ * rw_semaphore contention benchmark
+ *
+ * Models mmap_sem: most threads take the semaphore for read for a short
+ * time (page faults), a few take it for write for longer (mmap/munmap).
+ * The run is repeated for 1 .. max_threads threads and the throughput of
+ * each step is reported through printk.
+ */
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/delay.h>
+#include <linux/math64.h>
+
+#define RWSEM_BENCH_MAX_THREADS	8
+
+static unsigned int max_threads = RWSEM_BENCH_MAX_THREADS;
+module_param(max_threads, uint, 0444);
+MODULE_PARM_DESC(max_threads, "highest thread count of the sweep (1-8)");
+
+static unsigned int run_ms = 1000;
+module_param(run_ms, uint, 0444);
+MODULE_PARM_DESC(run_ms, "run time of each step in milliseconds");
+
+static unsigned int write_ratio = 5;
+module_param(write_ratio, uint, 0444);
+MODULE_PARM_DESC(write_ratio, "percentage of operations taking the write lock");
+
+static unsigned int read_hold = 100;
+module_param(read_hold, uint, 0444);
+MODULE_PARM_DESC(read_hold, "cpu_relax() loops with the read lock held");
+
+static unsigned int write_hold = 1000;
+module_param(write_hold, uint, 0444);
+MODULE_PARM_DESC(write_hold, "cpu_relax() loops with the write lock held");
+
+struct rwsem_bench_thread {
+	struct task_struct	*task;
+	unsigned long		reads;
+	unsigned long		writes;
+	u64			write_wait_ns;
+};
+
+static DECLARE_RWSEM(bench_sem);
+static struct rwsem_bench_thread bench_threads[RWSEM_BENCH_MAX_THREADS];
+static struct task_struct *bench_task;
+static int bench_stop;
+
+static void rwsem_bench_hold(unsigned int loops)
+{
+	while (loops--)
+		cpu_relax();
+}
+
+static int rwsem_bench_worker(void *arg)
+{
+	struct rwsem_bench_thread *bt = arg;
+	unsigned int seq = 0;
+	u64 start;
+
+	while (!ACCESS_ONCE(bench_stop)) {
+		if (++seq % 100 < write_ratio) {
+			start = local_clock();
+			down_write(&bench_sem);
+			bt->write_wait_ns += local_clock() - start;
+			rwsem_bench_hold(write_hold);
+			up_write(&bench_sem);
+			bt->writes++;
+		} else {
+			down_read(&bench_sem);
+			rwsem_bench_hold(read_hold);
+			up_read(&bench_sem);
+			bt->reads++;
+		}
+		cond_resched();
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static void rwsem_bench_run(unsigned int nr_threads)
+{
+	unsigned long reads = 0, writes = 0;
+	u64 start, elapsed, write_wait_ns = 0;
+	unsigned int i, started = 0;
+
+	memset(bench_threads, 0, sizeof(bench_threads));
+	bench_stop = 0;
+
+	start = local_clock();
+	for (i = 0; i < nr_threads; i++) {
+		struct task_struct *p;
+
+		p = kthread_run(rwsem_bench_worker, &bench_threads[i],
+				"rwsem_bench/%u", i);
+		if (IS_ERR(p))
+			break;
+		bench_threads[i].task = p;
+		started++;
+	}
+
+	msleep(run_ms);
+	ACCESS_ONCE(bench_stop) = 1;
+
+	for (i = 0; i < started; i++)
+		kthread_stop(bench_threads[i].task);
+	elapsed = local_clock() - start;
+
+	for (i = 0; i < started; i++) {
+		reads += bench_threads[i].reads;
+		writes += bench_threads[i].writes;
+		write_wait_ns += bench_threads[i].write_wait_ns;
+	}
+
+	printk(KERN_INFO "rwsem_bench: threads=%u reads=%lu writes=%lu "
+	       "ops/sec=%llu avg_write_wait_ns=%llu\n", started, reads, writes,
+	       div64_u64((u64)(reads + writes) * NSEC_PER_SEC, elapsed ?: 1),
+	       div64_u64(write_wait_ns, writes ?: 1));
+}
+
+static int rwsem_bench_main(void *arg)
+{
+	unsigned int nr;
+
+	for (nr = 1; nr <= max_threads && !kthread_should_stop(); nr++)
+		rwsem_bench_run(nr);
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+static int __init rwsem_bench_init(void)
+{
+	if (!max_threads || max_threads > RWSEM_BENCH_MAX_THREADS)
+		max_threads = RWSEM_BENCH_MAX_THREADS;
+	if (write_ratio > 100)
+		write_ratio = 100;
+
+	bench_task = kthread_run(rwsem_bench_main, NULL, "rwsem_bench");
+	if (IS_ERR(bench_task))
+		return PTR_ERR(bench_task);
+
+	return 0;
+}
+
+static void __exit rwsem_bench_exit(void)
+{
+	kthread_stop(bench_task);
+}
+
+module_init(rwsem_bench_init);
+module_exit(rwsem_bench_exit);
+
+MODULE_DESCRIPTION("rw_semaphore contention benchmark");
+MODULE_LICENSE("GPL");
@@ -479,6 +479,10 @@ struct rq {
 
 	struct cfs_rq cfs;
 	struct rt_rq rt;
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	/* ticks that hit a real-time task which is not an irq thread */
+	unsigned long rt_task_ticks;
+#endif
 
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
@@ -3261,6 +3265,13 @@ unsigned long nr_iowait_cpu(int cpu)
 	return atomic_read(&this->nr_iowait);
 }
 
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+unsigned long sched_rt_task_ticks(int cpu)
+{
+	return ACCESS_ONCE(cpu_rq(cpu)->rt_task_ticks);
+}
+#endif
+
 unsigned long this_cpu_load(void)
 {
 	struct rq *this = this_rq();
@@ -4403,6 +4414,50 @@ int mutex_spin_on_owner(struct mutex *lock, struct task_struct *owner)
 }
 #endif
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+
+static inline bool rwsem_owner_running(struct rw_semaphore *sem,
+				       struct task_struct *owner)
+{
+	if (sem->owner != owner)
+		return false;
+
+	/*
+	 * Same as owner_running(): only look at owner->on_cpu after
+	 * re-checking sem->owner, rcu_read_lock() keeps it valid.
+	 */
+	barrier();
+
+	return owner->on_cpu;
+}
+
+/*
+ * Spin while the writer owning @sem keeps running. Like
+ * mutex_spin_on_owner(), "owner" is a speculative pointer.
+ */
+int rwsem_spin_on_owner(struct rw_semaphore *sem, struct task_struct *owner)
+{
+	if (!sched_feat(OWNER_SPIN))
+		return 0;
+
+	rcu_read_lock();
+	while (rwsem_owner_running(sem, owner)) {
+		if (need_resched())
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	rcu_read_unlock();
+
+	/*
+	 * The writer released the lock (owner == NULL) or went to sleep.
+	 * Only keep spinning in the former case; an owner change means
+	 * heavy contention.
+	 */
+	return sem->owner == NULL;
+}
+#endif
+
 #ifdef CONFIG_PREEMPT
 /*
  * this is the entry point to schedule() from in-kernel preemption
@@ -1774,6 +1774,11 @@ static void task_tick_rt(struct rq *rq, struct task_struct *p, int queued)
 
 	watchdog(rq, p);
 
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	if (!p->irqaction)
+		rq->rt_task_ticks++;
+#endif
+
 	/*
 	 * RR tasks need a special form of timeslice management.
 	 * FIFO tasks have no timeslices.
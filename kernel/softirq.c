@@ -194,8 +194,9 @@ void local_bh_enable_ip(unsigned long ip)
 EXPORT_SYMBOL(local_bh_enable_ip);
 
 /*
- * We restart softirq processing MAX_SOFTIRQ_RESTART times,
- * and we fall back to softirqd after that.
+ * We restart softirq processing MAX_SOFTIRQ_RESTART times, or until
+ * the vectors have run for sysctl_softirq_budget_us, and we fall back
+ * to softirqd after that.
  *
  * This number has been established via experimentation.
  * The two things to balance is latency against fairness -
@@ -204,16 +205,46 @@ EXPORT_SYMBOL(local_bh_enable_ip);
  */
 #define MAX_SOFTIRQ_RESTART 10
 
+unsigned int sysctl_softirq_budget_us __read_mostly = 2000;
+
+/*
+ * Vectors in sysctl_softirq_defer_mask are not run on the back of an
+ * interrupt that hit a real-time task, or while ksoftirqd is already
+ * busy with a softirq storm; they are left to ksoftirqd instead, which
+ * competes with everything else as a normal task.  This keeps e.g.
+ * NET_RX floods from adding to the latency of audio threads.
+ */
+unsigned int sysctl_softirq_defer_mask __read_mostly;
+
+static __u32 softirq_deferred_vectors(void)
+{
+	struct task_struct *tsk = __this_cpu_read(ksoftirqd);
+	__u32 mask = ACCESS_ONCE(sysctl_softirq_defer_mask);
+
+	if (!mask || !tsk || current == tsk)
+		return 0;
+
+	if (rt_task(current) || tsk->state == TASK_RUNNING)
+		return mask;
+
+	return 0;
+}
+
 asmlinkage void __do_softirq(void)
 {
 	struct softirq_action *h;
-	__u32 pending;
+	__u32 pending, defer, deferred = 0;
 	int max_restart = MAX_SOFTIRQ_RESTART;
+	u64 start, now, budget;
 	int cpu;
 
 	pending = local_softirq_pending();
 	account_system_vtime(current);
 
+	budget = (u64)sysctl_softirq_budget_us * NSEC_PER_USEC;
+	defer = softirq_deferred_vectors();
+	start = now = local_clock();
+
 	__local_bh_disable((unsigned long)__builtin_return_address(0),
 				SOFTIRQ_OFFSET);
 	lockdep_softirq_enter();
@@ -223,20 +254,27 @@ restart:
 	/* Reset the pending bitmask before enabling irqs */
 	set_softirq_pending(0);
 
+	deferred |= pending & defer;
+	pending &= ~defer;
+
 	local_irq_enable();
 
 	h = softirq_vec;
 
-	do {
+	while (pending) {
 		if (pending & 1) {
 			unsigned int vec_nr = h - softirq_vec;
 			int prev_count = preempt_count();
+			u64 t = now;
 
 			kstat_incr_softirqs_this_cpu(vec_nr);
 
 			trace_softirq_entry(vec_nr);
 			h->action(h);
 			trace_softirq_exit(vec_nr);
+
+			now = local_clock();
+			kstat_add_softirq_time_this_cpu(vec_nr, now - t);
 			if (unlikely(prev_count != preempt_count())) {
 				printk(KERN_ERR "huh, entered softirq %u %s %p"
 				       "with preempt_count %08x,"
@@ -250,15 +288,25 @@ restart:
 		}
 		h++;
 		pending >>= 1;
-	} while (pending);
+	}
 
 	local_irq_disable();
 
 	pending = local_softirq_pending();
-	if (pending && --max_restart)
+	if ((pending & ~defer) && --max_restart &&
+	    (!budget || now - start < budget))
 		goto restart;
 
-	if (pending)
+	if (deferred) {
+		unsigned long bits = deferred;
+		unsigned int vec_nr;
+
+		for_each_set_bit(vec_nr, &bits, NR_SOFTIRQS)
+			kstat_incr_softirqs_deferred_this_cpu(vec_nr);
+		or_softirq_pending(deferred);
+	}
+
+	if (pending || deferred)
 		wakeup_softirqd();
 
 	lockdep_softirq_exit();
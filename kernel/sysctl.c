@@ -57,6 +57,7 @@
 #include <linux/pipe_fs_i.h>
 #include <linux/oom.h>
 #include <linux/kmod.h>
+#include <linux/interrupt.h>
 
 #include <asm/uaccess.h>
 #include <asm/processor.h>
@@ -122,6 +123,7 @@ static int __maybe_unused two = 2;
 static int __maybe_unused three = 3;
 static unsigned long one_ul = 1;
 static int one_hundred = 100;
+static int softirq_mask_max = (1 << NR_SOFTIRQS) - 1;
 #ifdef CONFIG_PRINTK
 static int ten_thousand = 10000;
 #endif
@@ -380,6 +382,14 @@ static struct ctl_table kern_table[] = {
 		.extra2		= &one,
 	},
 #endif
+	{
+		.procname	= "rwsem_reader_batch",
+		.data		= &sysctl_rwsem_reader_batch,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
 #ifdef CONFIG_PROVE_LOCKING
 	{
 		.procname	= "prove_locking",
@@ -914,6 +924,42 @@ static struct ctl_table kern_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+#endif
+	{
+		.procname	= "softirq_budget_us",
+		.data		= &sysctl_softirq_budget_us,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+	},
+	{
+		.procname	= "softirq_defer_mask",
+		.data		= &sysctl_softirq_defer_mask,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &zero,
+		.extra2		= &softirq_mask_max,
+	},
+#ifdef CONFIG_IRQ_THREAD_BALANCE
+	{
+		.procname	= "irq_thread_balance",
+		.data		= &sysctl_irq_thread_balance,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= irq_thread_balance_handler,
+		.extra1		= &zero,
+		.extra2		= &one,
+	},
+	{
+		.procname	= "irq_thread_balance_rate",
+		.data		= &sysctl_irq_thread_balance_rate,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &one,
+	},
 #endif
 	{
 		.procname	= "poweroff_cmd",
@@ -1179,6 +1225,15 @@ static struct ctl_table vm_table[] = {
 		.extra1		= &min_extfrag_threshold,
 		.extra2		= &max_extfrag_threshold,
 	},
+	{
+		.procname	= "compaction_proactive_threshold",
+		.data		= &sysctl_compaction_proactive_threshold,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= sysctl_compaction_proactive_handler,
+		.extra1		= &min_extfrag_threshold,
+		.extra2		= &max_extfrag_threshold,
+	},
 
 #endif /* CONFIG_COMPACTION */
 	{
@@ -410,6 +410,7 @@ void tick_nohz_stop_sched_tick(int inidle)
 			ts->tick_stopped = 1;
 			ts->idle_jiffies = last_jiffies;
 			rcu_enter_nohz();
+			hrtimer_idle_enter();
 		}
 
 		ts->idle_sleeps++;
@@ -546,6 +547,7 @@ void tick_nohz_restart_sched_tick(void)
 	 */
 	ts->tick_stopped  = 0;
 	ts->idle_exittime = now;
+	hrtimer_idle_exit();
 
 	tick_nohz_restart(ts, now);
 
@@ -135,12 +135,23 @@ static atomic_t overflow_count;
 
 static struct entry *tstat_hash_table[TSTAT_HASH_SIZE] __read_mostly;
 
+/*
+ * Per-CPU timer wheel events, protected by the timer base lock of
+ * the CPU they are counted for:
+ */
+static DEFINE_PER_CPU(unsigned long [TIMER_WHEEL_NR_STATS], wheel_stats);
+
 static void reset_entries(void)
 {
+	int cpu;
+
 	nr_entries = 0;
 	memset(entries, 0, sizeof(entries));
 	memset(tstat_hash_table, 0, sizeof(tstat_hash_table));
 	atomic_set(&overflow_count, 0);
+	for_each_possible_cpu(cpu)
+		memset(per_cpu(wheel_stats, cpu), 0,
+		       sizeof(per_cpu(wheel_stats, cpu)));
 }
 
 static struct entry *alloc_entry(void)
@@ -267,6 +278,11 @@ void timer_stats_update_stats(void *timer, pid_t pid, void *startf,
 	raw_spin_unlock_irqrestore(lock, flags);
 }
 
+void __timer_stats_wheel_event(int cpu, enum timer_wheel_stat stat)
+{
+	per_cpu(wheel_stats, cpu)[stat]++;
+}
+
 static void print_name_offset(struct seq_file *m, unsigned long addr)
 {
 	char symname[KSYM_NAME_LEN];
@@ -333,6 +349,14 @@ static int tstats_show(struct seq_file *m, void *v)
 	else
 		seq_printf(m, "%ld total events\n", events);
 
+	for_each_online_cpu(i) {
+		unsigned long *ws = per_cpu(wheel_stats, i);
+
+		seq_printf(m, "cpu%d: %lu fired, %lu cascaded, %lu coalesced\n",
+			   i, ws[TIMER_WHEEL_FIRED], ws[TIMER_WHEEL_CASCADED],
+			   ws[TIMER_WHEEL_COALESCED]);
+	}
+
 	mutex_unlock(&show_mutex);
 
 	return 0;
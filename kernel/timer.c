@@ -55,33 +55,87 @@ u64 jiffies_64 __cacheline_aligned_in_smp = INITIAL_JIFFIES;
 EXPORT_SYMBOL(jiffies_64);
 
 /*
- * per-CPU timer vector definitions:
+ * per-CPU timer wheel definitions:
+ *
+ * The wheel has LVL_DEPTH levels of LVL_SIZE buckets each. Level 0 has a
+ * granularity of one jiffy, and every further level is LVL_CLK_DIV times
+ * coarser than the one below it. A timer is queued once, in the level
+ * whose range covers its timeout, and is never moved between levels
+ * again: there is no cascading. In exchange a timer in level n may fire
+ * up to LVL_GRAN(n) - 1 jiffies late, which is about 1/8 of its timeout
+ * with the default geometry.
+ *
+ * Level	Granularity	Range (HZ=1000)
+ *   0		1 ms		0 ms - 63 ms
+ *   1		8 ms		63 ms - 504 ms
+ *   2		64 ms		504 ms - 4 s
+ *   3		512 ms		4 s - 32 s
+ *   4		4 s		32 s - 4 min
+ *   5		33 s		4 min - 34 min
+ *   6		4 min		34 min - 4 h
+ *   7		35 min		4 h - 36 h
+ *   8		4 h		36 h - 12 days
+ *
+ * Timers with slack (see set_timer_slack()) are placed in the coarsest
+ * level whose rounded up expiry still lies within the slack, so that
+ * they share expiry slots with each other instead of each waking the
+ * CPU on their own.
  */
-#define TVN_BITS (CONFIG_BASE_SMALL ? 4 : 6)
-#define TVR_BITS (CONFIG_BASE_SMALL ? 6 : 8)
-#define TVN_SIZE (1 << TVN_BITS)
-#define TVR_SIZE (1 << TVR_BITS)
-#define TVN_MASK (TVN_SIZE - 1)
-#define TVR_MASK (TVR_SIZE - 1)
+#define LVL_CLK_SHIFT	3
+#define LVL_CLK_DIV	(1UL << LVL_CLK_SHIFT)
+#define LVL_CLK_MASK	(LVL_CLK_DIV - 1)
+#define LVL_SHIFT(n)	((n) * LVL_CLK_SHIFT)
+#define LVL_GRAN(n)	(1UL << LVL_SHIFT(n))
+
+#define LVL_BITS	(CONFIG_BASE_SMALL ? 4 : 6)
+#define LVL_SIZE	(1UL << LVL_BITS)
+#define LVL_MASK	(LVL_SIZE - 1)
+#define LVL_OFFS(n)	((n) * LVL_SIZE)
+
+/* Timeouts of LVL_START(n) jiffies or more go into level n */
+#define LVL_START(n)	((LVL_SIZE - 1) << (((n) - 1) * LVL_CLK_SHIFT))
+
+#if CONFIG_BASE_SMALL
+# define LVL_DEPTH	10
+#elif HZ > 100
+# define LVL_DEPTH	9
+#else
+# define LVL_DEPTH	8
+#endif
+
+#define WHEEL_SIZE	(LVL_SIZE * LVL_DEPTH)
+
+/*
+ * Timeouts beyond the last level are queued at WHEEL_TIMEOUT_MAX and
+ * requeued from there until they really expire.
+ */
+#define WHEEL_TIMEOUT_CUTOFF	(LVL_START(LVL_DEPTH))
+#define WHEEL_TIMEOUT_MAX	(WHEEL_TIMEOUT_CUTOFF - LVL_GRAN(LVL_DEPTH - 1))
 
 struct tvec {
-	struct list_head vec[TVN_SIZE];
+	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
+	struct list_head vec[WHEEL_SIZE];
 };
 
-struct tvec_root {
-	struct list_head vec[TVR_SIZE];
-};
+/*
+ * With NO_HZ deferrable timers get a wheel of their own, so that finding
+ * the next event for an idle CPU does not have to look at every timer.
+ */
+#ifdef CONFIG_NO_HZ
+# define NR_TVECS	2
+#else
+# define NR_TVECS	1
+#endif
+#define TVEC_STD	0
+#define TVEC_DEF	(NR_TVECS - 1)
 
 struct tvec_base {
 	spinlock_t lock;
 	struct timer_list *running_timer;
 	unsigned long timer_jiffies;
 	unsigned long next_timer;
-	struct tvec_root tv1;
-	struct tvec tv2;
-	struct tvec tv3;
-	struct tvec tv4;
-	struct tvec tv5;
+	int cpu;
+	struct tvec tv[NR_TVECS];
 } ____cacheline_aligned;
 
 struct tvec_base boot_tvec_bases;
@@ -319,7 +373,8 @@ EXPORT_SYMBOL_GPL(round_jiffies_up_relative);
  * Set the amount of time, in jiffies, that a certain timer has
  * in terms of slack. By setting this value, the timer subsystem
  * will schedule the actual timer somewhere between
- * the time mod_timer() asks for, and that time plus the slack.
+ * the time mod_timer() asks for, and that time plus the slack,
+ * sharing its expiry with as many other timers as possible.
  *
  * By setting the slack to -1, a percentage of the delay is used
  * instead.
@@ -330,46 +385,131 @@ void set_timer_slack(struct timer_list *timer, int slack_hz)
 }
 EXPORT_SYMBOL_GPL(set_timer_slack);
 
-static void internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+static inline struct tvec *timer_tvec(struct tvec_base *base,
+				      struct timer_list *timer)
+{
+	return &base->tv[tbase_get_deferrable(timer->base) ? TVEC_DEF : TVEC_STD];
+}
+
+/*
+ * Bucket index of @expires in level @lvl. The expiry is rounded up to the
+ * granularity of the level, so a timer never fires early; the rounded
+ * expiry is returned in @bucket_expiry.
+ */
+static inline unsigned int calc_index(unsigned long expires, unsigned int lvl,
+				      unsigned long *bucket_expiry)
 {
+	expires = (expires + LVL_GRAN(lvl) - 1) >> LVL_SHIFT(lvl);
+	*bucket_expiry = expires << LVL_SHIFT(lvl);
+	return LVL_OFFS(lvl) + (expires & LVL_MASK);
+}
+
+/*
+ * The latest expiry a timer can live with: its explicit slack if it has
+ * one, otherwise 0.4% of the timeout as before.
+ */
+static unsigned long timer_slack_limit(struct timer_list *timer,
+				       unsigned long expires, unsigned long clk)
+{
+	long delta;
+
+	if (timer->slack >= 0)
+		return expires + timer->slack;
+
+	delta = expires - clk;
+	if (delta < 256)
+		return expires;
+
+	return expires + delta / 256;
+}
+
+static unsigned int calc_wheel_index(struct tvec_base *base,
+				     struct timer_list *timer,
+				     unsigned long *bucket_expiry)
+{
+	unsigned long clk = base->timer_jiffies;
 	unsigned long expires = timer->expires;
-	unsigned long idx = expires - base->timer_jiffies;
-	struct list_head *vec;
-
-	if (idx < TVR_SIZE) {
-		int i = expires & TVR_MASK;
-		vec = base->tv1.vec + i;
-	} else if (idx < 1 << (TVR_BITS + TVN_BITS)) {
-		int i = (expires >> TVR_BITS) & TVN_MASK;
-		vec = base->tv2.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK;
-		vec = base->tv3.vec + i;
-	} else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS)) {
-		int i = (expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv4.vec + i;
-	} else if ((signed long) idx < 0) {
-		/*
-		 * Can happen if you add a timer with expires == jiffies,
-		 * or you set a timer to go off in the past
-		 */
-		vec = base->tv1.vec + (base->timer_jiffies & TVR_MASK);
-	} else {
-		int i;
-		/* If the timeout is larger than 0xffffffff on 64-bit
-		 * architectures then we use the maximum timeout:
-		 */
-		if (idx > 0xffffffffUL) {
-			idx = 0xffffffffUL;
-			expires = idx + base->timer_jiffies;
+	unsigned long delta = expires - clk;
+	unsigned long limit, next_expiry;
+	unsigned int lvl, idx, next_idx;
+
+	/*
+	 * Can happen if you add a timer with expires == jiffies,
+	 * or you set a timer to go off in the past
+	 */
+	if ((long)delta < 0) {
+		*bucket_expiry = clk;
+		return clk & LVL_MASK;
+	}
+
+	if (delta >= WHEEL_TIMEOUT_CUTOFF) {
+		expires = clk + WHEEL_TIMEOUT_MAX;
+		delta = WHEEL_TIMEOUT_MAX;
+	}
+
+	for (lvl = 0; lvl < LVL_DEPTH - 1; lvl++)
+		if (delta < LVL_START(lvl + 1))
+			break;
+	idx = calc_index(expires, lvl, bucket_expiry);
+
+	/* Move up while the coarser slot still expires within the slack */
+	limit = timer_slack_limit(timer, expires, clk);
+	if (lvl < LVL_DEPTH - 1 && !time_after(*bucket_expiry, limit)) {
+		unsigned int natural = lvl;
+
+		while (lvl < LVL_DEPTH - 1) {
+			next_idx = calc_index(expires, lvl + 1, &next_expiry);
+			if (time_after(next_expiry, limit))
+				break;
+			idx = next_idx;
+			*bucket_expiry = next_expiry;
+			lvl++;
 		}
-		i = (expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK;
-		vec = base->tv5.vec + i;
+		if (lvl != natural)
+			timer_stats_wheel_event(base->cpu,
+						TIMER_WHEEL_COALESCED);
 	}
+
+	return idx;
+}
+
+static void internal_add_timer(struct tvec_base *base, struct timer_list *timer)
+{
+	struct tvec *tv = timer_tvec(base, timer);
+	unsigned long bucket_expiry;
+	unsigned int idx;
+
+	idx = calc_wheel_index(base, timer, &bucket_expiry);
 	/*
 	 * Timers are FIFO:
 	 */
-	list_add_tail(&timer->entry, vec);
+	list_add_tail(&timer->entry, tv->vec + idx);
+	__set_bit(idx, tv->pending_map);
+
+	if (time_before(bucket_expiry, base->next_timer) &&
+	    !tbase_get_deferrable(timer->base))
+		base->next_timer = bucket_expiry;
+}
+
+/*
+ * Clear the pending bit of the bucket @head if it is one of @base's and
+ * has become empty. @head may also be a private list of __run_timers().
+ */
+static void wheel_clear_pending(struct tvec_base *base, struct list_head *head)
+{
+	int i;
+
+	if (!list_empty(head))
+		return;
+
+	for (i = 0; i < NR_TVECS; i++) {
+		struct tvec *tv = &base->tv[i];
+
+		if (head >= tv->vec && head < tv->vec + WHEEL_SIZE) {
+			__clear_bit(head - tv->vec, tv->pending_map);
+			return;
+		}
+	}
 }
 
 #ifdef CONFIG_TIMER_STATS
@@ -621,6 +761,25 @@ static inline void detach_timer(struct timer_list *timer,
 	entry->prev = LIST_POISON2;
 }
 
+static int detach_if_pending(struct timer_list *timer, struct tvec_base *base,
+			     int clear_pending)
+{
+	struct list_head *prev;
+
+	if (!timer_pending(timer))
+		return 0;
+
+	prev = timer->entry.prev;
+	detach_timer(timer, clear_pending);
+	wheel_clear_pending(base, prev);
+
+	/* base->next_timer may have been this timer's bucket */
+	if (!time_after(timer->expires, base->next_timer) &&
+	    !tbase_get_deferrable(timer->base))
+		base->next_timer = base->timer_jiffies;
+	return 1;
+}
+
 /*
  * We are using hashed locking: holding per_cpu(tvec_bases).lock
  * means that all timers which are tied to this base via timer->base are
@@ -666,16 +825,9 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 
 	base = lock_timer_base(timer, &flags);
 
-	if (timer_pending(timer)) {
-		detach_timer(timer, 0);
-		if (timer->expires == base->next_timer &&
-		    !tbase_get_deferrable(timer->base))
-			base->next_timer = base->timer_jiffies;
-		ret = 1;
-	} else {
-		if (pending_only)
-			goto out_unlock;
-	}
+	ret = detach_if_pending(timer, base, 0);
+	if (!ret && pending_only)
+		goto out_unlock;
 
 	debug_activate(timer, expires);
 
@@ -706,9 +858,6 @@ __mod_timer(struct timer_list *timer, unsigned long expires,
 	}
 
 	timer->expires = expires;
-	if (time_before(timer->expires, base->next_timer) &&
-	    !tbase_get_deferrable(timer->base))
-		base->next_timer = timer->expires;
 	internal_add_timer(base, timer);
 
 out_unlock:
@@ -733,45 +882,6 @@ int mod_timer_pending(struct timer_list *timer, unsigned long expires)
 }
 EXPORT_SYMBOL(mod_timer_pending);
 
-/*
- * Decide where to put the timer while taking the slack into account
- *
- * Algorithm:
- *   1) calculate the maximum (absolute) time
- *   2) calculate the highest bit where the expires and new max are different
- *   3) use this bit to make a mask
- *   4) use the bitmask to round down the maximum time, so that all last
- *      bits are zeros
- */
-static inline
-unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
-{
-	unsigned long expires_limit, mask;
-	int bit;
-
-	if (timer->slack >= 0) {
-		expires_limit = expires + timer->slack;
-	} else {
-		long delta = expires - jiffies;
-
-		if (delta < 256)
-			return expires;
-
-		expires_limit = expires + delta / 256;
-	}
-	mask = expires ^ expires_limit;
-	if (mask == 0)
-		return expires;
-
-	bit = find_last_bit(&mask, BITS_PER_LONG);
-
-	mask = (1 << bit) - 1;
-
-	expires_limit = expires_limit & ~(mask);
-
-	return expires_limit;
-}
-
 /**
  * mod_timer - modify a timer's timeout
  * @timer: the timer to be modified
@@ -794,8 +904,6 @@ unsigned long apply_slack(struct timer_list *timer, unsigned long expires)
  */
 int mod_timer(struct timer_list *timer, unsigned long expires)
 {
-	expires = apply_slack(timer, expires);
-
 	/*
 	 * This is a common optimization triggered by the
 	 * networking code - if the timer is re-modified
@@ -868,9 +976,6 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	spin_lock_irqsave(&base->lock, flags);
 	timer_set_base(timer, base);
 	debug_activate(timer, timer->expires);
-	if (time_before(timer->expires, base->next_timer) &&
-	    !tbase_get_deferrable(timer->base))
-		base->next_timer = timer->expires;
 	internal_add_timer(base, timer);
 	/*
 	 * Check whether the other CPU is idle and needs to be
@@ -905,13 +1010,7 @@ int del_timer(struct timer_list *timer)
 	timer_stats_timer_clear_start_info(timer);
 	if (timer_pending(timer)) {
 		base = lock_timer_base(timer, &flags);
-		if (timer_pending(timer)) {
-			detach_timer(timer, 1);
-			if (timer->expires == base->next_timer &&
-			    !tbase_get_deferrable(timer->base))
-				base->next_timer = base->timer_jiffies;
-			ret = 1;
-		}
+		ret = detach_if_pending(timer, base, 1);
 		spin_unlock_irqrestore(&base->lock, flags);
 	}
 
@@ -938,14 +1037,7 @@ int try_to_del_timer_sync(struct timer_list *timer)
 		goto out;
 
 	timer_stats_timer_clear_start_info(timer);
-	ret = 0;
-	if (timer_pending(timer)) {
-		detach_timer(timer, 1);
-		if (timer->expires == base->next_timer &&
-		    !tbase_get_deferrable(timer->base))
-			base->next_timer = base->timer_jiffies;
-		ret = 1;
-	}
+	ret = detach_if_pending(timer, base, 1);
 out:
 	spin_unlock_irqrestore(&base->lock, flags);
 
@@ -1019,26 +1111,6 @@ int del_timer_sync(struct timer_list *timer)
 EXPORT_SYMBOL(del_timer_sync);
 #endif
 
-static int cascade(struct tvec_base *base, struct tvec *tv, int index)
-{
-	/* cascade all the timers from tv up one level */
-	struct timer_list *timer, *tmp;
-	struct list_head tv_list;
-
-	list_replace_init(tv->vec + index, &tv_list);
-
-	/*
-	 * We are removing _all_ timers from the list, so we
-	 * don't have to detach them individually.
-	 */
-	list_for_each_entry_safe(timer, tmp, &tv_list, entry) {
-		BUG_ON(tbase_get_base(timer->base) != base);
-		internal_add_timer(base, timer);
-	}
-
-	return index;
-}
-
 static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 			  unsigned long data)
 {
@@ -1080,52 +1152,153 @@ static void call_timer_fn(struct timer_list *timer, void (*fn)(unsigned long),
 	}
 }
 
-#define INDEX(N) ((base->timer_jiffies >> (TVR_BITS + (N) * TVN_BITS)) & TVN_MASK)
+/*
+ * Move the buckets of @tv that expire at base->timer_jiffies to @heads.
+ * Returns the number of buckets moved.
+ */
+static int collect_expired_timers(struct tvec_base *base, struct tvec *tv,
+				  struct list_head *heads)
+{
+	unsigned long clk = base->timer_jiffies;
+	unsigned int idx;
+	int i, levels = 0;
+
+	for (i = 0; i < LVL_DEPTH; i++) {
+		idx = (clk & LVL_MASK) + i * LVL_SIZE;
+
+		if (__test_and_clear_bit(idx, tv->pending_map))
+			list_replace_init(tv->vec + idx, heads + levels++);
+		/* Is it time to look at the next level? */
+		if (clk & LVL_CLK_MASK)
+			break;
+		/* Shift clock for the next level granularity */
+		clk >>= LVL_CLK_SHIFT;
+	}
+	return levels;
+}
+
+/*
+ * First pending bucket of one level, counted from the bucket @clk, or
+ * -1 if the level is empty.
+ */
+static int next_pending_bucket(struct tvec *tv, unsigned int offset,
+			       unsigned int clk)
+{
+	unsigned int pos, start = offset + clk;
+	unsigned int end = offset + LVL_SIZE;
+
+	pos = find_next_bit(tv->pending_map, end, start);
+	if (pos < end)
+		return pos - start;
+
+	pos = find_next_bit(tv->pending_map, start, offset);
+	return pos < start ? pos + LVL_SIZE - start : -1;
+}
+
+/*
+ * Expiry of the first pending bucket of @tv, or clk + NEXT_TIMER_MAX_DELTA
+ * if there is none.
+ */
+static unsigned long tvec_next_expiry(struct tvec *tv, unsigned long clk)
+{
+	unsigned long next = clk + NEXT_TIMER_MAX_DELTA;
+	unsigned int lvl, offset = 0;
+
+	for (lvl = 0; lvl < LVL_DEPTH; lvl++, offset += LVL_SIZE) {
+		int pos = next_pending_bucket(tv, offset, clk & LVL_MASK);
+		unsigned long adj;
+
+		if (pos >= 0) {
+			unsigned long tmp = (clk + pos) << LVL_SHIFT(lvl);
+
+			if (time_before(tmp, next))
+				next = tmp;
+		}
+		/*
+		 * The next bucket of the coarser level is the one at or
+		 * after the current clock, so round the clock up when
+		 * moving to that level's granularity.
+		 */
+		adj = clk & LVL_CLK_MASK ? 1 : 0;
+		clk >>= LVL_CLK_SHIFT;
+		clk += adj;
+	}
+	return next;
+}
+
+static void expire_timers(struct tvec_base *base, struct list_head *head,
+			  unsigned long clk)
+{
+	struct timer_list *timer;
+
+	while (!list_empty(head)) {
+		void (*fn)(unsigned long);
+		unsigned long data;
+
+		timer = list_first_entry(head, struct timer_list, entry);
+
+		/* Queued beyond the wheel's range, it is not due yet */
+		if (unlikely(time_before(clk, timer->expires))) {
+			detach_timer(timer, 0);
+			internal_add_timer(base, timer);
+			timer_stats_wheel_event(base->cpu,
+						TIMER_WHEEL_CASCADED);
+			continue;
+		}
+
+		fn = timer->function;
+		data = timer->data;
+
+		timer_stats_account_timer(timer);
+		timer_stats_wheel_event(base->cpu, TIMER_WHEEL_FIRED);
+
+		base->running_timer = timer;
+		detach_timer(timer, 1);
+
+		spin_unlock_irq(&base->lock);
+		call_timer_fn(timer, fn, data);
+		spin_lock_irq(&base->lock);
+	}
+}
 
 /**
  * __run_timers - run all expired timers (if any) on this CPU.
  * @base: the timer vector to be processed.
  *
- * This function cascades all vectors and executes all expired timer
- * vectors.
+ * This function executes all expired timer buckets. After an idle
+ * period the stretch of jiffies without any expiring bucket is skipped
+ * in one step.
  */
 static inline void __run_timers(struct tvec_base *base)
 {
-	struct timer_list *timer;
+	struct list_head heads[NR_TVECS * LVL_DEPTH];
 
 	spin_lock_irq(&base->lock);
 	while (time_after_eq(jiffies, base->timer_jiffies)) {
-		struct list_head work_list;
-		struct list_head *head = &work_list;
-		int index = base->timer_jiffies & TVR_MASK;
-
-		/*
-		 * Cascade timers:
-		 */
-		if (!index &&
-			(!cascade(base, &base->tv2, INDEX(0))) &&
-				(!cascade(base, &base->tv3, INDEX(1))) &&
-					!cascade(base, &base->tv4, INDEX(2)))
-			cascade(base, &base->tv5, INDEX(3));
-		++base->timer_jiffies;
-		list_replace_init(base->tv1.vec + index, &work_list);
-		while (!list_empty(head)) {
-			void (*fn)(unsigned long);
-			unsigned long data;
+		unsigned long clk;
+		int i, levels = 0;
 
-			timer = list_first_entry(head, struct timer_list,entry);
-			fn = timer->function;
-			data = timer->data;
+		if (time_after(jiffies, base->timer_jiffies + 1)) {
+			unsigned long next = jiffies;
 
-			timer_stats_account_timer(timer);
+			for (i = 0; i < NR_TVECS; i++) {
+				clk = tvec_next_expiry(&base->tv[i],
+						       base->timer_jiffies);
+				if (time_before(clk, next))
+					next = clk;
+			}
+			if (time_after(next, base->timer_jiffies))
+				base->timer_jiffies = next;
+		}
 
-			base->running_timer = timer;
-			detach_timer(timer, 1);
+		clk = base->timer_jiffies;
+		for (i = 0; i < NR_TVECS; i++)
+			levels += collect_expired_timers(base, &base->tv[i],
+							 heads + levels);
+		++base->timer_jiffies;
 
-			spin_unlock_irq(&base->lock);
-			call_timer_fn(timer, fn, data);
-			spin_lock_irq(&base->lock);
-		}
+		while (levels--)
+			expire_timers(base, heads + levels, clk);
 	}
 	base->running_timer = NULL;
 	spin_unlock_irq(&base->lock);
@@ -1136,75 +1309,11 @@ static inline void __run_timers(struct tvec_base *base)
  * Find out when the next timer event is due to happen. This
  * is used on S/390 to stop all activity when a CPU is idle.
  * This function needs to be called with interrupts disabled.
+ * Deferrable timers live in their own wheel and are ignored.
  */
 static unsigned long __next_timer_interrupt(struct tvec_base *base)
 {
-	unsigned long timer_jiffies = base->timer_jiffies;
-	unsigned long expires = timer_jiffies + NEXT_TIMER_MAX_DELTA;
-	int index, slot, array, found = 0;
-	struct timer_list *nte;
-	struct tvec *varray[4];
-
-	/* Look for timer events in tv1. */
-	index = slot = timer_jiffies & TVR_MASK;
-	do {
-		list_for_each_entry(nte, base->tv1.vec + slot, entry) {
-			if (tbase_get_deferrable(nte->base))
-				continue;
-
-			found = 1;
-			expires = nte->expires;
-			/* Look at the cascade bucket(s)? */
-			if (!index || slot < index)
-				goto cascade;
-			return expires;
-		}
-		slot = (slot + 1) & TVR_MASK;
-	} while (slot != index);
-
-cascade:
-	/* Calculate the next cascade event */
-	if (index)
-		timer_jiffies += TVR_SIZE - index;
-	timer_jiffies >>= TVR_BITS;
-
-	/* Check tv2-tv5. */
-	varray[0] = &base->tv2;
-	varray[1] = &base->tv3;
-	varray[2] = &base->tv4;
-	varray[3] = &base->tv5;
-
-	for (array = 0; array < 4; array++) {
-		struct tvec *varp = varray[array];
-
-		index = slot = timer_jiffies & TVN_MASK;
-		do {
-			list_for_each_entry(nte, varp->vec + slot, entry) {
-				if (tbase_get_deferrable(nte->base))
-					continue;
-
-				found = 1;
-				if (time_before(nte->expires, expires))
-					expires = nte->expires;
-			}
-			/*
-			 * Do we still search for the first timer or are
-			 * we looking up the cascade buckets ?
-			 */
-			if (found) {
-				/* Look at the cascade bucket(s)? */
-				if (!index || slot < index)
-					break;
-				return expires;
-			}
-			slot = (slot + 1) & TVN_MASK;
-		} while (slot != index);
-
-		if (index)
-			timer_jiffies += TVN_SIZE - index;
-		timer_jiffies >>= TVN_BITS;
-	}
-	return expires;
+	return tvec_next_expiry(&base->tv[TVEC_STD], base->timer_jiffies);
 }
 
 /*
@@ -1594,7 +1703,7 @@ SYSCALL_DEFINE1(sysinfo, struct sysinfo __user *, info)
 
 static int __cpuinit init_timers_cpu(int cpu)
 {
-	int j;
+	int i, j;
 	struct tvec_base *base;
 	static char __cpuinitdata tvec_base_done[NR_CPUS];
 
@@ -1635,15 +1744,13 @@ static int __cpuinit init_timers_cpu(int cpu)
 
 	spin_lock_init(&base->lock);
 
-	for (j = 0; j < TVN_SIZE; j++) {
-		INIT_LIST_HEAD(base->tv5.vec + j);
-		INIT_LIST_HEAD(base->tv4.vec + j);
-		INIT_LIST_HEAD(base->tv3.vec + j);
-		INIT_LIST_HEAD(base->tv2.vec + j);
+	for (i = 0; i < NR_TVECS; i++) {
+		bitmap_zero(base->tv[i].pending_map, WHEEL_SIZE);
+		for (j = 0; j < WHEEL_SIZE; j++)
+			INIT_LIST_HEAD(base->tv[i].vec + j);
 	}
-	for (j = 0; j < TVR_SIZE; j++)
-		INIT_LIST_HEAD(base->tv1.vec + j);
 
+	base->cpu = cpu;
 	base->timer_jiffies = jiffies;
 	base->next_timer = base->timer_jiffies;
 	return 0;
@@ -1658,9 +1765,6 @@ static void migrate_timer_list(struct tvec_base *new_base, struct list_head *hea
 		timer = list_first_entry(head, struct timer_list, entry);
 		detach_timer(timer, 0);
 		timer_set_base(timer, new_base);
-		if (time_before(timer->expires, new_base->next_timer) &&
-		    !tbase_get_deferrable(timer->base))
-			new_base->next_timer = timer->expires;
 		internal_add_timer(new_base, timer);
 	}
 }
@@ -1669,7 +1773,7 @@ static void __cpuinit migrate_timers(int cpu)
 {
 	struct tvec_base *old_base;
 	struct tvec_base *new_base;
-	int i;
+	int i, j;
 
 	BUG_ON(cpu_online(cpu));
 	old_base = per_cpu(tvec_bases, cpu);
@@ -1683,13 +1787,10 @@ static void __cpuinit migrate_timers(int cpu)
 
 	BUG_ON(old_base->running_timer);
 
-	for (i = 0; i < TVR_SIZE; i++)
-		migrate_timer_list(new_base, old_base->tv1.vec + i);
-	for (i = 0; i < TVN_SIZE; i++) {
-		migrate_timer_list(new_base, old_base->tv2.vec + i);
-		migrate_timer_list(new_base, old_base->tv3.vec + i);
-		migrate_timer_list(new_base, old_base->tv4.vec + i);
-		migrate_timer_list(new_base, old_base->tv5.vec + i);
+	for (i = 0; i < NR_TVECS; i++) {
+		for (j = 0; j < WHEEL_SIZE; j++)
+			migrate_timer_list(new_base, old_base->tv[i].vec + j);
+		bitmap_zero(old_base->tv[i].pending_map, WHEEL_SIZE);
 	}
 
 	spin_unlock(&old_base->lock);
@@ -7,6 +7,8 @@
 #include <linux/completion.h>
 #include <linux/kthread.h>
 #include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
 #include <linux/time.h>
 #include <asm/local.h>
 
@@ -58,7 +60,40 @@ MODULE_PARM_DESC(producer_fifo, "fifo prio for producer");
 module_param(consumer_fifo, uint, 0644);
 MODULE_PARM_DESC(consumer_fifo, "fifo prio for consumer");
 
-static int read_events;
+/*
+ * How the consumer takes data out of the buffer. Each mode mirrors one
+ * way user space reads the trace buffers:
+ *  events - one event at a time (trace_pipe)
+ *  splice - a new page for every read, full pages only (splice of
+ *           trace_pipe_raw)
+ *  read   - swap with a spare page and copy it out (read of trace_pipe_raw)
+ *  mmap   - swap with a spare page and parse it in place (mmap of
+ *           trace_pipe_raw)
+ */
+enum read_mode {
+	READ_EVENTS,
+	READ_SPLICE,
+	READ_COPY,
+	READ_MMAP,
+	NR_READ_MODES,
+};
+
+static const char *read_mode_names[NR_READ_MODES] = {
+	[READ_EVENTS]	= "events",
+	[READ_SPLICE]	= "splice",
+	[READ_COPY]	= "read",
+	[READ_MMAP]	= "mmap",
+};
+
+static int consumer_mode = -1;
+module_param(consumer_mode, int, 0644);
+MODULE_PARM_DESC(consumer_mode, "0 events, 1 splice, 2 read, 3 mmap, -1 cycle through all");
+
+static int read_mode = NR_READ_MODES - 1;
+static unsigned long read_pages;
+
+static DEFINE_PER_CPU(void *, spare_page);
+static void *copy_page_buf;
 
 static int kill_test;
 
@@ -95,76 +130,83 @@ static enum event_status read_event(int cpu)
 	return EVENT_FOUND;
 }
 
-static enum event_status read_page(int cpu)
+static void parse_page(int cpu, void *bpage)
 {
 	struct ring_buffer_event *event;
-	struct rb_page *rpage;
+	struct rb_page *rpage = bpage;
 	unsigned long commit;
-	void *bpage;
 	int *entry;
-	int ret;
 	int inc;
 	int i;
 
-	bpage = ring_buffer_alloc_read_page(buffer, cpu);
-	if (!bpage)
-		return EVENT_DROPPED;
+	read_pages++;
 
-	ret = ring_buffer_read_page(buffer, &bpage, PAGE_SIZE, cpu, 1);
-	if (ret >= 0) {
-		rpage = bpage;
-		/* The commit may have missed event flags set, clear them */
-		commit = local_read(&rpage->commit) & 0xfffff;
-		for (i = 0; i < commit && !kill_test; i += inc) {
+	/* The commit may have missed event flags set, clear them */
+	commit = local_read(&rpage->commit) & 0xfffff;
+	for (i = 0; i < commit && !kill_test; i += inc) {
 
-			if (i >= (PAGE_SIZE - offsetof(struct rb_page, data))) {
+		if (i >= (PAGE_SIZE - offsetof(struct rb_page, data))) {
+			KILL_TEST();
+			break;
+		}
+
+		inc = -1;
+		event = (void *)&rpage->data[i];
+		switch (event->type_len) {
+		case RINGBUF_TYPE_PADDING:
+			/* failed writes may be discarded events */
+			if (!event->time_delta)
+				KILL_TEST();
+			inc = event->array[0] + 4;
+			break;
+		case RINGBUF_TYPE_TIME_EXTEND:
+			inc = 8;
+			break;
+		case 0:
+			entry = ring_buffer_event_data(event);
+			if (*entry != cpu) {
 				KILL_TEST();
 				break;
 			}
-
-			inc = -1;
-			event = (void *)&rpage->data[i];
-			switch (event->type_len) {
-			case RINGBUF_TYPE_PADDING:
-				/* failed writes may be discarded events */
-				if (!event->time_delta)
-					KILL_TEST();
-				inc = event->array[0] + 4;
-				break;
-			case RINGBUF_TYPE_TIME_EXTEND:
-				inc = 8;
-				break;
-			case 0:
-				entry = ring_buffer_event_data(event);
-				if (*entry != cpu) {
-					KILL_TEST();
-					break;
-				}
-				read++;
-				if (!event->array[0]) {
-					KILL_TEST();
-					break;
-				}
-				inc = event->array[0] + 4;
+			read++;
+			if (!event->array[0]) {
+				KILL_TEST();
 				break;
-			default:
-				entry = ring_buffer_event_data(event);
-				if (*entry != cpu) {
-					KILL_TEST();
-					break;
-				}
-				read++;
-				inc = ((event->type_len + 1) * 4);
 			}
-			if (kill_test)
-				break;
-
-			if (inc <= 0) {
+			inc = event->array[0] + 4;
+			break;
+		default:
+			entry = ring_buffer_event_data(event);
+			if (*entry != cpu) {
 				KILL_TEST();
 				break;
 			}
+			read++;
+			inc = ((event->type_len + 1) * 4);
+		}
+		if (kill_test)
+			break;
+
+		if (inc <= 0) {
+			KILL_TEST();
+			break;
 		}
 	}
+}
+
+/* splice: a new page per read, only full pages are taken */
+static enum event_status read_page(int cpu)
+{
+	void *bpage;
+	int ret;
+
+	bpage = ring_buffer_alloc_read_page(buffer, cpu);
+	if (!bpage)
+		return EVENT_DROPPED;
+
+	ret = ring_buffer_read_page(buffer, &bpage, PAGE_SIZE, cpu, 1);
+	if (ret >= 0)
+		parse_page(cpu, bpage);
 	ring_buffer_free_read_page(buffer, bpage);
 
 	if (ret < 0)
@@ -172,12 +214,40 @@ static enum event_status read_page(int cpu)
 	return EVENT_FOUND;
 }
 
+/* read and mmap: swap with a per cpu spare page, optionally copy it out */
+static enum event_status swap_page(int cpu, int copy)
+{
+	void **spare = &per_cpu(spare_page, cpu);
+	int ret;
+
+	if (!*spare)
+		*spare = ring_buffer_alloc_read_page(buffer, cpu);
+	if (!*spare)
+		return EVENT_DROPPED;
+
+	ret = ring_buffer_read_page(buffer, spare, PAGE_SIZE, cpu, 0);
+	if (ret < 0)
+		return EVENT_DROPPED;
+
+	if (copy) {
+		memcpy(copy_page_buf, *spare, PAGE_SIZE);
+		parse_page(cpu, copy_page_buf);
+	} else
+		parse_page(cpu, *spare);
+
+	return EVENT_FOUND;
+}
+
 static void ring_buffer_consumer(void)
 {
-	/* toggle between reading pages and events */
-	read_events ^= 1;
+	/* cycle through the read modes unless one was asked for */
+	if (consumer_mode >= 0 && consumer_mode < NR_READ_MODES)
+		read_mode = consumer_mode;
+	else
+		read_mode = (read_mode + 1) % NR_READ_MODES;
 
 	read = 0;
+	read_pages = 0;
 	while (!reader_finish && !kill_test) {
 		int found;
 
@@ -188,10 +258,16 @@ static void ring_buffer_consumer(void)
 			for_each_online_cpu(cpu) {
 				enum event_status stat;
 
-				if (read_events)
+				switch (read_mode) {
+				case READ_EVENTS:
 					stat = read_event(cpu);
-				else
+					break;
+				case READ_SPLICE:
 					stat = read_page(cpu);
+					break;
+				default:
+					stat = swap_page(cpu, read_mode == READ_COPY);
+				}
 
 				if (kill_test)
 					break;
@@ -317,7 +393,9 @@ static void ring_buffer_producer(void)
 		trace_printk("Read:     (reader disabled)\n");
 	else
 		trace_printk("Read:     %ld  (by %s)\n", read,
-			read_events ? "events" : "pages");
+			read_mode_names[read_mode]);
+	if (!disable_reader && read_mode != READ_EVENTS)
+		trace_printk("Pages:    %ld\n", read_pages);
 	trace_printk("Entries:  %lld\n", entries);
 	trace_printk("Total:    %lld\n", entries + overruns + read);
 	trace_printk("Missed:   %ld\n", missed);
@@ -331,6 +409,8 @@ static void ring_buffer_producer(void)
 		trace_printk("TIME IS ZERO??\n");
 
 	trace_printk("Entries per millisec: %ld\n", hit);
+	if (!disable_reader && time)
+		trace_printk("Read per millisec: %ld\n", read / (long)time);
 
 	if (hit) {
 		/* Calculate the average time in nanosecs */
@@ -420,10 +500,16 @@ static int __init ring_buffer_benchmark_init(void)
 {
 	int ret;
 
+	copy_page_buf = (void *)__get_free_page(GFP_KERNEL);
+	if (!copy_page_buf)
+		return -ENOMEM;
+
 	/* make a one meg buffer in overwite mode */
 	buffer = ring_buffer_alloc(1000000, RB_FL_OVERWRITE);
-	if (!buffer)
+	if (!buffer) {
+		free_page((unsigned long)copy_page_buf);
 		return -ENOMEM;
+	}
 
 	if (!disable_reader) {
 		consumer = kthread_create(ring_buffer_consumer_thread,
@@ -469,15 +555,24 @@ static int __init ring_buffer_benchmark_init(void)
 
  out_fail:
 	ring_buffer_free(buffer);
+	free_page((unsigned long)copy_page_buf);
 	return ret;
 }
 
 static void __exit ring_buffer_benchmark_exit(void)
 {
+	int cpu;
+
 	kthread_stop(producer);
 	if (consumer)
 		kthread_stop(consumer);
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(spare_page, cpu))
+			ring_buffer_free_read_page(buffer,
+						   per_cpu(spare_page, cpu));
+	}
 	ring_buffer_free(buffer);
+	free_page((unsigned long)copy_page_buf);
 }
 
 module_init(ring_buffer_benchmark_init);
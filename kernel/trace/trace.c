@@ -37,6 +37,7 @@
 #include <linux/init.h>
 #include <linux/poll.h>
 #include <linux/fs.h>
+#include <linux/trace_mmap.h>
 #include <trace/stm.h>
 
 #include "trace.h"
@@ -3772,6 +3773,11 @@ struct ftrace_buffer_info {
 	void			*spare;
 	int			cpu;
 	unsigned int		read;
+	/* user mapping of @spare, see tracing_buffers_mmap() */
+	struct mutex		mmap_lock;
+	int			mapped;
+	struct vm_area_struct	*vma;
+	struct mm_struct	*mm;
 };
 
 static int tracing_buffers_open(struct inode *inode, struct file *filp)
@@ -3791,6 +3797,7 @@ static int tracing_buffers_open(struct inode *inode, struct file *filp)
 	info->spare	= NULL;
 	/* Force reading ring buffer for first read */
 	info->read	= (unsigned int)-1;
+	mutex_init(&info->mmap_lock);
 
 	filp->private_data = info;
 
@@ -3808,10 +3815,19 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 	if (!count)
 		return 0;
 
+	mutex_lock(&info->mmap_lock);
+	/* read() would swap the page out from under the mapping */
+	if (info->mapped) {
+		mutex_unlock(&info->mmap_lock);
+		return -EBUSY;
+	}
+
 	if (!info->spare)
 		info->spare = ring_buffer_alloc_read_page(info->tr->buffer, info->cpu);
-	if (!info->spare)
+	if (!info->spare) {
+		mutex_unlock(&info->mmap_lock);
 		return -ENOMEM;
+	}
 
 	/* Do we have previous read data to read? */
 	if (info->read < PAGE_SIZE)
@@ -3825,10 +3841,14 @@ tracing_buffers_read(struct file *filp, char __user *ubuf,
 				    count,
 				    info->cpu, 0);
 	trace_access_unlock(info->cpu);
-	if (ret < 0)
+	if (ret < 0) {
+		mutex_unlock(&info->mmap_lock);
 		return 0;
+	}
 
 read:
+	/* Don't copy_to_user() under the lock, mmap() nests it in mmap_sem */
+	mutex_unlock(&info->mmap_lock);
 	size = PAGE_SIZE - info->read;
 	if (size > count)
 		size = count;
@@ -3855,6 +3875,151 @@ static int tracing_buffers_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/*
+ * The mapping always shows info->spare. The ioctl below zaps the pte
+ * before the page is handed back to the ring buffer, so the next access
+ * faults in whatever page ring_buffer_read_page() swapped in.
+ */
+static int tracing_buffers_mmap_fault(struct vm_area_struct *vma,
+				      struct vm_fault *vmf)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+	struct page *page;
+
+	if (vmf->pgoff)
+		return VM_FAULT_SIGBUS;
+
+	page = virt_to_page(info->spare);
+	get_page(page);
+	vmf->page = page;
+
+	return 0;
+}
+
+/*
+ * mremap() opens the new vma before it closes the old one, so count
+ * the vmas and follow the newest; only the last close ends the mapping.
+ * Both run under the mmap_sem of the mm, which nests outside mmap_lock.
+ */
+static void tracing_buffers_mmap_open(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+
+	mutex_lock(&info->mmap_lock);
+	info->mapped++;
+	info->vma = vma;
+	mutex_unlock(&info->mmap_lock);
+}
+
+static void tracing_buffers_mmap_close(struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = vma->vm_file->private_data;
+
+	mutex_lock(&info->mmap_lock);
+	if (!--info->mapped) {
+		info->mm = NULL;
+		info->vma = NULL;
+	}
+	mutex_unlock(&info->mmap_lock);
+}
+
+static const struct vm_operations_struct tracing_buffers_vmops = {
+	.open		= tracing_buffers_mmap_open,
+	.fault		= tracing_buffers_mmap_fault,
+	.close		= tracing_buffers_mmap_close,
+};
+
+static int tracing_buffers_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+	int ret = 0;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	mutex_lock(&info->mmap_lock);
+	/* Only one mapping per open file */
+	if (info->mapped) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	if (!info->spare)
+		info->spare = ring_buffer_alloc_read_page(info->tr->buffer,
+							  info->cpu);
+	if (!info->spare) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	info->mapped = 1;
+	info->vma = vma;
+	info->mm = vma->vm_mm;
+
+	/* The single page must not be grown, written or inherited */
+	vma->vm_flags &= ~VM_MAYWRITE;
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTCOPY | VM_RESERVED;
+	vma->vm_ops = &tracing_buffers_vmops;
+ out:
+	mutex_unlock(&info->mmap_lock);
+
+	return ret;
+}
+
+static long tracing_buffers_swap_reader(struct ftrace_buffer_info *info)
+{
+	struct mm_struct *mm = current->mm;
+	size_t size;
+	long ret;
+
+	if (!mm)
+		return -EINVAL;
+
+	down_write(&mm->mmap_sem);
+	/* The vma is stable while we hold the mmap_sem of its mm */
+	mutex_lock(&info->mmap_lock);
+	if (!info->mapped || info->mm != mm) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	zap_page_range(info->vma, info->vma->vm_start, PAGE_SIZE, NULL);
+
+	trace_access_lock(info->cpu);
+	ret = ring_buffer_read_page(info->tr->buffer, &info->spare,
+				    PAGE_SIZE, info->cpu, 0);
+	trace_access_unlock(info->cpu);
+	if (ret < 0) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	/* A partial page was copied over old data; don't expose that */
+	size = ring_buffer_page_len(info->spare);
+	if (size < PAGE_SIZE)
+		memset(info->spare + size, 0, PAGE_SIZE - size);
+	ret = 0;
+ out:
+	mutex_unlock(&info->mmap_lock);
+	up_write(&mm->mmap_sem);
+
+	return ret;
+}
+
+static long tracing_buffers_ioctl(struct file *filp, unsigned int cmd,
+				  unsigned long arg)
+{
+	struct ftrace_buffer_info *info = filp->private_data;
+
+	switch (cmd) {
+	case TRACE_MMAP_IOCTL_GET_READER:
+		return tracing_buffers_swap_reader(info);
+	default:
+		return -ENOTTY;
+	}
+}
+
 struct buffer_ref {
 	struct ring_buffer	*buffer;
 	void			*page;
@@ -4024,6 +4189,8 @@ static const struct file_operations tracing_buffers_fops = {
 	.read		= tracing_buffers_read,
 	.release	= tracing_buffers_release,
 	.splice_read	= tracing_buffers_splice_read,
+	.mmap		= tracing_buffers_mmap,
+	.unlocked_ioctl	= tracing_buffers_ioctl,
 	.llseek		= no_llseek,
 };
 
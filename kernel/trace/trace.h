@@ -796,6 +796,20 @@ extern int filter_assign_type(const char *type);
 
 struct list_head *
 trace_get_fields(struct ftrace_event_call *event_call);
+extern struct ftrace_event_field *
+trace_find_event_field(struct ftrace_event_call *call, char *name);
+
+#ifdef CONFIG_EVENT_HISTOGRAM
+extern const struct file_operations event_hist_fops;
+extern int event_hist_update(struct ftrace_event_call *call, void *rec);
+extern void event_hist_remove(struct ftrace_event_call *call);
+#else
+static inline int event_hist_update(struct ftrace_event_call *call, void *rec)
+{
+	return 0;
+}
+static inline void event_hist_remove(struct ftrace_event_call *call) { }
+#endif
 
 static inline int
 filter_check_discard(struct ftrace_event_call *call, void *rec,
@@ -808,6 +822,12 @@ filter_check_discard(struct ftrace_event_call *call, void *rec,
 		return 1;
 	}
 
+	if (unlikely(call->flags & TRACE_EVENT_FL_HIST) &&
+	    event_hist_update(call, rec)) {
+		ring_buffer_discard_commit(buffer, event);
+		return 1;
+	}
+
 	return 0;
 }
 
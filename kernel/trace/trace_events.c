@@ -1186,6 +1186,12 @@ event_create_dir(struct ftrace_event_call *call, struct dentry *d_events,
 	trace_create_file("filter", 0644, call->dir, call,
 			  filter);
 
+#ifdef CONFIG_EVENT_HISTOGRAM
+	if (call->event.type && call->class->reg)
+		trace_create_file("hist", 0644, call->dir, call,
+				  &event_hist_fops);
+#endif
+
 	trace_create_file("format", 0444, call->dir, call,
 			  format);
 
@@ -1266,6 +1272,7 @@ static void remove_subsystem_dir(const char *name)
 static void __trace_remove_event_call(struct ftrace_event_call *call)
 {
 	ftrace_event_enable_disable(call, 0);
+	event_hist_remove(call);
 	if (call->event.funcs)
 		__unregister_ftrace_event(&call->event);
 	debugfs_remove_recursive(call->dir);
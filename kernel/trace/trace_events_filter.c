@@ -614,8 +614,8 @@ __find_event_field(struct list_head *head, char *name)
 	return NULL;
 }
 
-static struct ftrace_event_field *
-find_event_field(struct ftrace_event_call *call, char *name)
+struct ftrace_event_field *
+trace_find_event_field(struct ftrace_event_call *call, char *name)
 {
 	struct ftrace_event_field *field;
 	struct list_head *head;
@@ -956,7 +956,7 @@ static int filter_add_pred(struct filter_parse_state *ps,
 	else if (pred->op == OP_OR)
 		goto add_pred_fn;
 
-	field = find_event_field(call, pred->field_name);
+	field = trace_find_event_field(call, pred->field_name);
 	if (!field) {
 		parse_error(ps, FILT_ERR_FIELD_NOT_FOUND, 0);
 		return -EINVAL;
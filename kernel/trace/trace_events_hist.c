@@ -0,0 +1,655 @@
+/*
+ * trace_events_hist - log2 histograms over trace events
+ *
+ * A histogram is attached to an event through its 'hist' file:
+ *
+ *   key=<field> [val=<field> | start=<system>:<event>[:<field>]]
+ *	[size=<entries>] [discard]
+ *
+ * Every hit of the event is counted under the value of the key field.
+ * With val= the value of a second field goes into a log2 histogram of
+ * that key, with start= the time in ns since the start event last fired
+ * with the same key value does. The tables are per-CPU and updated
+ * without locks from the event itself, so only the reader pays for
+ * merging them. With 'discard' the event is dropped from the ring buffer
+ * once counted.
+ */
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/vmalloc.h>
+#include <linux/ctype.h>
+#include <linux/uaccess.h>
+#include <linux/seq_file.h>
+#include <linux/debugfs.h>
+#include <asm/local.h>
+
+#include "trace.h"
+
+#define HIST_NR_BUCKETS		65		/* value 0 and 2^0 .. 2^63 */
+#define HIST_DEFAULT_BITS	6
+#define HIST_MAX_BITS		10
+#define HIST_START_EXTRA_BITS	4		/* start slots per entry */
+
+enum {
+	HIST_SLOT_FREE,
+	HIST_SLOT_CLAIMED,
+	HIST_SLOT_VALID,
+};
+
+struct event_hist_entry {
+	u64		key;
+	int		state;
+	local_t		hits;
+	local_t		buckets[HIST_NR_BUCKETS];
+};
+
+struct event_hist_start {
+	u64		key;
+	int		state;
+	atomic64_t	ts;
+};
+
+struct event_hist {
+	struct list_head		list;
+	struct ftrace_event_call	*call;
+	struct ftrace_event_field	*key_field;
+	struct ftrace_event_field	*val_field;
+	struct ftrace_event_call	*start_call;
+	struct ftrace_event_field	*start_field;
+	unsigned int			bits;
+	int				discard;
+	atomic_t			drops;
+	struct event_hist_entry		**tables;	/* per cpu */
+	struct event_hist_start		*starts;
+};
+
+/* All histograms, protected by event_mutex */
+static LIST_HEAD(event_hists);
+
+static u64 hist_field_value(struct ftrace_event_field *field, void *rec)
+{
+	void *p = rec + field->offset;
+
+	switch (field->size) {
+	case 1:
+		return field->is_signed ? (u64)*(s8 *)p : *(u8 *)p;
+	case 2:
+		return field->is_signed ? (u64)*(s16 *)p : *(u16 *)p;
+	case 4:
+		return field->is_signed ? (u64)*(s32 *)p : *(u32 *)p;
+	default:
+		return *(u64 *)p;
+	}
+}
+
+static int hist_field_ok(struct ftrace_event_field *field)
+{
+	if (field->filter_type != FILTER_OTHER)
+		return 0;
+
+	switch (field->size) {
+	case 1:
+	case 2:
+	case 4:
+	case 8:
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned int hist_bucket(u64 val)
+{
+	return fls64(val);
+}
+
+/*
+ * Find or add @key in this CPU's table. Only this CPU adds entries, but
+ * an interrupt or NMI may do so while we are in the middle of it.
+ */
+static struct event_hist_entry *
+hist_entry_lookup(struct event_hist *hist, struct event_hist_entry *table,
+		  u64 key)
+{
+	unsigned int size = 1 << hist->bits;
+	unsigned int i, idx = hash_64(key, hist->bits);
+
+	for (i = 0; i < size; i++, idx = (idx + 1) & (size - 1)) {
+		struct event_hist_entry *entry = &table[idx];
+
+		if (entry->state == HIST_SLOT_VALID) {
+			if (entry->key == key)
+				return entry;
+			continue;
+		}
+		if (entry->state == HIST_SLOT_FREE &&
+		    cmpxchg_local(&entry->state, HIST_SLOT_FREE,
+				  HIST_SLOT_CLAIMED) == HIST_SLOT_FREE) {
+			entry->key = key;
+			/* pairs with the smp_rmb() in hist_merge() */
+			smp_wmb();
+			entry->state = HIST_SLOT_VALID;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * The start table is shared by all CPUs. A slot is reused once its start
+ * time has been consumed by the end event.
+ */
+static struct event_hist_start *
+hist_start_lookup(struct event_hist *hist, u64 key, int create)
+{
+	unsigned int bits = hist->bits + HIST_START_EXTRA_BITS;
+	unsigned int size = 1 << bits;
+	unsigned int i, idx = hash_64(key, bits);
+	struct event_hist_start *slot;
+
+	for (i = 0; i < size; i++) {
+		slot = &hist->starts[(idx + i) & (size - 1)];
+		if (slot->state == HIST_SLOT_VALID) {
+			smp_rmb();
+			if (slot->key == key)
+				return slot;
+		}
+	}
+	if (!create)
+		return NULL;
+
+	for (i = 0; i < size; i++) {
+		int state;
+
+		slot = &hist->starts[(idx + i) & (size - 1)];
+		state = slot->state;
+		if (state == HIST_SLOT_CLAIMED)
+			continue;
+		if (state == HIST_SLOT_VALID && atomic64_read(&slot->ts))
+			continue;
+		if (cmpxchg(&slot->state, state, HIST_SLOT_CLAIMED) != state)
+			continue;
+		slot->key = key;
+		smp_wmb();
+		slot->state = HIST_SLOT_VALID;
+		return slot;
+	}
+	return NULL;
+}
+
+static void event_hist_start(struct event_hist *hist, void *rec)
+{
+	struct event_hist_start *slot;
+	u64 key, now;
+
+	key = hist_field_value(hist->start_field, rec);
+	slot = hist_start_lookup(hist, key, 1);
+	if (!slot) {
+		atomic_inc(&hist->drops);
+		return;
+	}
+	/* zero means "no start pending" */
+	now = local_clock();
+	atomic64_set(&slot->ts, now ? now : 1);
+}
+
+static void event_hist_record(struct event_hist *hist, void *rec)
+{
+	struct event_hist_entry *entry;
+	u64 key, val = 0;
+
+	key = hist_field_value(hist->key_field, rec);
+
+	if (hist->start_call) {
+		struct event_hist_start *slot;
+		s64 ts;
+
+		slot = hist_start_lookup(hist, key, 0);
+		if (!slot)
+			return;
+		ts = atomic64_xchg(&slot->ts, 0);
+		if (!ts)
+			return;
+		val = max_t(s64, local_clock() - ts, 0);
+	} else if (hist->val_field) {
+		val = hist_field_value(hist->val_field, rec);
+		if (hist->val_field->is_signed && (s64)val < 0)
+			val = 0;
+	}
+
+	entry = hist_entry_lookup(hist,
+				  hist->tables[smp_processor_id()], key);
+	if (!entry) {
+		atomic_inc(&hist->drops);
+		return;
+	}
+	local_inc(&entry->hits);
+	if (hist->start_call || hist->val_field)
+		local_inc(&entry->buckets[hist_bucket(val)]);
+}
+
+/*
+ * Called from filter_check_discard() with preemption disabled. Returns
+ * non-zero if the event should be dropped from the ring buffer.
+ */
+int event_hist_update(struct ftrace_event_call *call, void *rec)
+{
+	struct event_hist *hist;
+	int discard = 0;
+
+	hist = rcu_dereference_sched(call->hist_start);
+	if (hist) {
+		event_hist_start(hist, rec);
+		discard |= hist->discard;
+	}
+
+	hist = rcu_dereference_sched(call->hist);
+	if (hist) {
+		event_hist_record(hist, rec);
+		discard |= hist->discard;
+	}
+
+	return discard;
+}
+
+static void hist_free(struct event_hist *hist)
+{
+	int cpu;
+
+	if (hist->tables) {
+		for_each_possible_cpu(cpu)
+			vfree(hist->tables[cpu]);
+		kfree(hist->tables);
+	}
+	vfree(hist->starts);
+	kfree(hist);
+}
+
+static void hist_update_flags(struct ftrace_event_call *call)
+{
+	if (call->hist || call->hist_start)
+		call->flags |= TRACE_EVENT_FL_HIST;
+	else
+		call->flags &= ~TRACE_EVENT_FL_HIST;
+}
+
+/* Must be called with event_mutex held */
+static void hist_detach(struct event_hist *hist)
+{
+	rcu_assign_pointer(hist->call->hist, NULL);
+	hist_update_flags(hist->call);
+	if (hist->start_call) {
+		rcu_assign_pointer(hist->start_call->hist_start, NULL);
+		hist_update_flags(hist->start_call);
+	}
+	list_del(&hist->list);
+
+	/* Wait for event_hist_update() callers to finish with it */
+	synchronize_sched();
+	hist_free(hist);
+}
+
+static struct ftrace_event_call *hist_find_call(char *system, char *event)
+{
+	struct ftrace_event_call *call;
+
+	list_for_each_entry(call, &ftrace_events, list) {
+		if (!strcmp(call->class->system, system) &&
+		    !strcmp(call->name, event))
+			return call;
+	}
+	return NULL;
+}
+
+/* Must be called with event_mutex held */
+static int hist_parse(struct ftrace_event_call *call, char *buf,
+		      struct event_hist **histp)
+{
+	struct event_hist *hist;
+	char *tok, *arg, *start_name = NULL;
+	int cpu, ret = -EINVAL;
+	size_t size;
+
+	hist = kzalloc(sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+	hist->call = call;
+	hist->bits = HIST_DEFAULT_BITS;
+
+	while ((tok = strsep(&buf, " \t")) != NULL) {
+		if (!*tok)
+			continue;
+
+		if (!strcmp(tok, "discard")) {
+			hist->discard = 1;
+			continue;
+		}
+
+		arg = strchr(tok, '=');
+		if (!arg)
+			goto out_free;
+		*arg++ = '\0';
+
+		if (!strcmp(tok, "key")) {
+			hist->key_field = trace_find_event_field(call, arg);
+			if (!hist->key_field || !hist_field_ok(hist->key_field))
+				goto out_free;
+		} else if (!strcmp(tok, "val")) {
+			hist->val_field = trace_find_event_field(call, arg);
+			if (!hist->val_field || !hist_field_ok(hist->val_field))
+				goto out_free;
+		} else if (!strcmp(tok, "start")) {
+			char *system = strsep(&arg, ":");
+			char *event = strsep(&arg, ":");
+
+			if (!event)
+				goto out_free;
+			hist->start_call = hist_find_call(system, event);
+			if (!hist->start_call || hist->start_call == call)
+				goto out_free;
+			/* resolved below, it defaults to the key's name */
+			start_name = arg;
+		} else if (!strcmp(tok, "size")) {
+			unsigned long entries;
+
+			if (strict_strtoul(arg, 0, &entries) || !entries)
+				goto out_free;
+			/* hash_64() wants at least one bit */
+			hist->bits = clamp_t(unsigned int,
+					     ilog2(roundup_pow_of_two(entries)),
+					     1, HIST_MAX_BITS);
+		} else
+			goto out_free;
+	}
+
+	if (!hist->key_field || (hist->val_field && hist->start_call))
+		goto out_free;
+
+	if (hist->start_call) {
+		/* the histogram this one replaces may use the start event */
+		if (hist->start_call->hist_start &&
+		    hist->start_call->hist_start != call->hist)
+			goto out_busy;
+		hist->start_field = trace_find_event_field(hist->start_call,
+				start_name ? start_name : hist->key_field->name);
+		if (!hist->start_field || !hist_field_ok(hist->start_field))
+			goto out_free;
+
+		size = sizeof(*hist->starts) <<
+			(hist->bits + HIST_START_EXTRA_BITS);
+		hist->starts = vzalloc(size);
+		if (!hist->starts)
+			goto out_nomem;
+	}
+
+	hist->tables = kzalloc(nr_cpu_ids * sizeof(*hist->tables), GFP_KERNEL);
+	if (!hist->tables)
+		goto out_nomem;
+	/* up to half a megabyte per cpu, no need for it to be contiguous */
+	size = sizeof(struct event_hist_entry) << hist->bits;
+	for_each_possible_cpu(cpu) {
+		hist->tables[cpu] = vzalloc_node(size, cpu_to_node(cpu));
+		if (!hist->tables[cpu])
+			goto out_nomem;
+	}
+	/* the tables are written from events that may fire in NMI context */
+	vmalloc_sync_all();
+
+	*histp = hist;
+	return 0;
+
+ out_busy:
+	ret = -EBUSY;
+	goto out_free;
+ out_nomem:
+	ret = -ENOMEM;
+ out_free:
+	hist_free(hist);
+	return ret;
+}
+
+static int hist_cmp_key(const void *a, const void *b)
+{
+	const struct event_hist_entry *ea = a, *eb = b;
+
+	if (ea->key == eb->key)
+		return 0;
+	return ea->key < eb->key ? -1 : 1;
+}
+
+/* Number of entries hist_merge() needs, a power of two */
+static unsigned long hist_merge_size(struct event_hist *hist)
+{
+	return roundup_pow_of_two(num_possible_cpus() << hist->bits);
+}
+
+/*
+ * Sum up the per-CPU tables by key into @merged, a hash table of
+ * hist_merge_size() entries, then move the keys found to its front in
+ * order.  Returns the number of keys.
+ */
+static int hist_merge(struct event_hist *hist, struct event_hist_entry *merged)
+{
+	unsigned int size = 1 << hist->bits;
+	unsigned long msize = hist_merge_size(hist);
+	unsigned int mbits = ilog2(msize);
+	unsigned long idx;
+	int cpu, i, b, nr = 0;
+
+	for_each_possible_cpu(cpu) {
+		struct event_hist_entry *table = hist->tables[cpu];
+
+		for (i = 0; i < size; i++) {
+			struct event_hist_entry *entry = &table[i];
+			struct event_hist_entry *m;
+
+			if (entry->state != HIST_SLOT_VALID)
+				continue;
+			smp_rmb();
+
+			/* never full: it has room for every cpu's entries */
+			idx = hash_64(entry->key, mbits);
+			for (;;) {
+				m = &merged[idx];
+				if (m->state != HIST_SLOT_VALID) {
+					m->state = HIST_SLOT_VALID;
+					m->key = entry->key;
+					nr++;
+					break;
+				}
+				if (m->key == entry->key)
+					break;
+				idx = (idx + 1) & (msize - 1);
+			}
+
+			local_add(local_read(&entry->hits), &m->hits);
+			for (b = 0; b < HIST_NR_BUCKETS; b++)
+				local_add(local_read(&entry->buckets[b]),
+					  &m->buckets[b]);
+		}
+	}
+
+	for (i = 0, idx = 0; idx < msize; idx++) {
+		if (merged[idx].state != HIST_SLOT_VALID)
+			continue;
+		if (i != idx)
+			merged[i] = merged[idx];
+		i++;
+	}
+
+	sort(merged, nr, sizeof(*merged), hist_cmp_key, NULL);
+	return nr;
+}
+
+static void hist_print_key(struct seq_file *m, struct ftrace_event_field *field,
+			   u64 key)
+{
+	if (field->is_signed)
+		seq_printf(m, "%s: %lld", field->name, (long long)key);
+	else
+		seq_printf(m, "%s: %llu", field->name, (unsigned long long)key);
+}
+
+static int event_hist_show(struct seq_file *m, void *v)
+{
+	struct ftrace_event_call *call = m->private;
+	struct event_hist_entry *merged;
+	struct event_hist *hist;
+	unsigned long hits, total = 0;
+	int i, b, nr;
+
+	mutex_lock(&event_mutex);
+	hist = call->hist;
+	if (!hist) {
+		seq_puts(m, "none\n");
+		goto out;
+	}
+
+	merged = vzalloc(sizeof(*merged) * hist_merge_size(hist));
+	if (!merged) {
+		mutex_unlock(&event_mutex);
+		return -ENOMEM;
+	}
+	nr = hist_merge(hist, merged);
+
+	seq_printf(m, "# key=%s", hist->key_field->name);
+	if (hist->val_field)
+		seq_printf(m, " val=%s", hist->val_field->name);
+	if (hist->start_call)
+		seq_printf(m, " start=%s:%s:%s (ns)",
+			   hist->start_call->class->system,
+			   hist->start_call->name, hist->start_field->name);
+	seq_printf(m, " size=%u%s\n", 1 << hist->bits,
+		   hist->discard ? " discard" : "");
+
+	for (i = 0; i < nr; i++) {
+		hits = local_read(&merged[i].hits);
+		total += hits;
+
+		hist_print_key(m, hist->key_field, merged[i].key);
+		seq_printf(m, " hits: %lu\n", hits);
+		if (!hist->val_field && !hist->start_call)
+			continue;
+
+		for (b = 0; b < HIST_NR_BUCKETS; b++) {
+			unsigned long cnt = local_read(&merged[i].buckets[b]);
+
+			if (!cnt)
+				continue;
+			if (!b)
+				seq_printf(m, "  %20u - %-20u %lu\n", 0, 0, cnt);
+			else
+				seq_printf(m, "  %20llu - %-20llu %lu\n",
+					   1ULL << (b - 1),
+					   (1ULL << (b - 1)) - 1 + (1ULL << (b - 1)),
+					   cnt);
+		}
+	}
+	seq_printf(m, "\nTotals: keys: %d hits: %lu drops: %d\n",
+		   nr, total, atomic_read(&hist->drops));
+	vfree(merged);
+ out:
+	mutex_unlock(&event_mutex);
+	return 0;
+}
+
+static int event_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, event_hist_show, inode->i_private);
+}
+
+static ssize_t event_hist_write(struct file *file, const char __user *ubuf,
+				size_t cnt, loff_t *ppos)
+{
+	struct ftrace_event_call *call =
+		((struct seq_file *)file->private_data)->private;
+	struct event_hist *hist, *new = NULL;
+	char *buf, *cmd;
+	int err = 0;
+
+	if (cnt >= PAGE_SIZE)
+		return -EINVAL;
+
+	buf = (char *)__get_free_page(GFP_TEMPORARY);
+	if (!buf)
+		return -ENOMEM;
+
+	if (copy_from_user(buf, ubuf, cnt)) {
+		free_page((unsigned long)buf);
+		return -EFAULT;
+	}
+	buf[cnt] = '\0';
+	cmd = strim(buf);
+
+	mutex_lock(&event_mutex);
+	hist = call->hist;
+
+	if (!strcmp(cmd, "clear")) {
+		int cpu;
+
+		if (!hist)
+			goto out;
+		rcu_assign_pointer(call->hist, NULL);
+		synchronize_sched();
+		for_each_possible_cpu(cpu)
+			memset(hist->tables[cpu], 0,
+			       sizeof(struct event_hist_entry) << hist->bits);
+		atomic_set(&hist->drops, 0);
+		rcu_assign_pointer(call->hist, hist);
+		goto out;
+	}
+
+	if (!*cmd || !strcmp(cmd, "0")) {
+		if (hist)
+			hist_detach(hist);
+		goto out;
+	}
+
+	/* keep the old histogram unless the new one is good */
+	err = hist_parse(call, cmd, &new);
+	if (err)
+		goto out;
+	if (hist)
+		hist_detach(hist);
+
+	list_add(&new->list, &event_hists);
+	if (new->start_call) {
+		rcu_assign_pointer(new->start_call->hist_start, new);
+		hist_update_flags(new->start_call);
+	}
+	rcu_assign_pointer(call->hist, new);
+	hist_update_flags(call);
+ out:
+	mutex_unlock(&event_mutex);
+	free_page((unsigned long)buf);
+
+	if (err)
+		return err;
+
+	*ppos += cnt;
+	return cnt;
+}
+
+const struct file_operations event_hist_fops = {
+	.open		= event_hist_open,
+	.read		= seq_read,
+	.write		= event_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * An event is going away: drop every histogram that refers to it.
+ * Must be called with event_mutex held.
+ */
+void event_hist_remove(struct ftrace_event_call *call)
+{
+	struct event_hist *hist, *n;
+
+	list_for_each_entry_safe(hist, n, &event_hists, list) {
+		if (hist->call == call || hist->start_call == call)
+			hist_detach(hist);
+	}
+}
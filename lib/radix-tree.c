@@ -218,22 +218,26 @@ radix_tree_node_free(struct radix_tree_node *node)
 int radix_tree_preload(gfp_t gfp_mask)
 {
 	struct radix_tree_preload *rtp;
-	struct radix_tree_node *node;
+	void *nodes[RADIX_TREE_MAX_PATH];
 	int ret = -ENOMEM;
+	int nr, i;
 
 	preempt_disable();
 	rtp = &__get_cpu_var(radix_tree_preloads);
 	while (rtp->nr < ARRAY_SIZE(rtp->nodes)) {
+		/* refill all the missing nodes with one bulk allocation */
+		nr = ARRAY_SIZE(rtp->nodes) - rtp->nr;
 		preempt_enable();
-		node = kmem_cache_alloc(radix_tree_node_cachep, gfp_mask);
-		if (node == NULL)
+		if (!kmem_cache_alloc_bulk(radix_tree_node_cachep, gfp_mask,
+					   nr, nodes))
 			goto out;
 		preempt_disable();
 		rtp = &__get_cpu_var(radix_tree_preloads);
-		if (rtp->nr < ARRAY_SIZE(rtp->nodes))
-			rtp->nodes[rtp->nr++] = node;
-		else
-			kmem_cache_free(radix_tree_node_cachep, node);
+		for (i = 0; i < nr && rtp->nr < ARRAY_SIZE(rtp->nodes); i++)
+			rtp->nodes[rtp->nr++] = nodes[i];
+		if (i < nr)
+			kmem_cache_free_bulk(radix_tree_node_cachep, nr - i,
+					     nodes + i);
 	}
 	ret = 0;
 out:
@@ -17,6 +17,12 @@ struct rwsem_waiter {
 #define RWSEM_WAITING_FOR_WRITE	0x00000002
 };
 
+/*
+ * Number of readers queued behind a writer that may join a batch of
+ * readers being granted the lock.  Zero keeps strict FIFO order.
+ */
+int sysctl_rwsem_reader_batch;
+
 int rwsem_is_locked(struct rw_semaphore *sem)
 {
 	int ret = 1;
@@ -46,6 +52,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	sem->activity = 0;
 	spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 EXPORT_SYMBOL(__init_rwsem);
 
@@ -61,8 +70,10 @@ EXPORT_SYMBOL(__init_rwsem);
 static inline struct rw_semaphore *
 __rwsem_do_wake(struct rw_semaphore *sem, int wakewrite)
 {
-	struct rwsem_waiter *waiter;
+	struct rwsem_waiter *waiter, *tmp;
 	struct task_struct *tsk;
+	int batched;
+	bool passed_writer;
 	int woken;
 
 	waiter = list_entry(sem->wait_list.next, struct rwsem_waiter, list);
@@ -90,11 +101,23 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wakewrite)
 		goto out;
 	}
 
-	/* grant an infinite number of read locks to the front of the queue */
+	/* grant an infinite number of read locks to the front of the queue,
+	 * and batch up to sysctl_rwsem_reader_batch readers queued behind
+	 * writers with them
+	 */
  dont_wake_writers:
 	woken = 0;
-	while (waiter->flags & RWSEM_WAITING_FOR_READ) {
-		struct list_head *next = waiter->list.next;
+	batched = 0;
+	passed_writer = false;
+	list_for_each_entry_safe(waiter, tmp, &sem->wait_list, list) {
+		if (waiter->flags & RWSEM_WAITING_FOR_WRITE) {
+			if (!sysctl_rwsem_reader_batch)
+				break;
+			passed_writer = true;
+			continue;
+		}
+		if (passed_writer && ++batched > sysctl_rwsem_reader_batch)
+			break;
 
 		list_del(&waiter->list);
 		tsk = waiter->task;
@@ -103,9 +126,6 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wakewrite)
 		wake_up_process(tsk);
 		put_task_struct(tsk);
 		woken++;
-		if (list_empty(&sem->wait_list))
-			break;
-		waiter = list_entry(next, struct rwsem_waiter, list);
 	}
 
 	sem->activity += woken;
@@ -202,6 +222,49 @@ int __down_read_trylock(struct rw_semaphore *sem)
 	return ret;
 }
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+/*
+ * Optimistic spinning for writers: while the writer owning the semaphore
+ * is running, spin on it rather than queueing.  The wait_lock is only
+ * taken once the semaphore looks free.
+ */
+static int rwsem_optimistic_spin(struct rw_semaphore *sem)
+{
+	struct task_struct *owner;
+	unsigned long flags;
+	int taken = 0;
+
+	preempt_disable();
+	for (;;) {
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (ACCESS_ONCE(sem->activity) == 0) {
+			spin_lock_irqsave(&sem->wait_lock, flags);
+			if (sem->activity == 0 && list_empty(&sem->wait_list)) {
+				sem->activity = -1;
+				taken = 1;
+			}
+			spin_unlock_irqrestore(&sem->wait_lock, flags);
+			if (taken)
+				break;
+		}
+
+		/* readers hold the semaphore or a writer has not set ->owner */
+		if (!owner && (need_resched() || rt_task(current) ||
+			       ACCESS_ONCE(sem->activity) != 0 ||
+			       !list_empty(&sem->wait_list)))
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	preempt_enable();
+
+	return taken;
+}
+#endif
+
 /*
  * get a write lock on the semaphore
  * - we increment the waiting count anyway to indicate an exclusive lock
@@ -212,6 +275,11 @@ void __sched __down_write_nested(struct rw_semaphore *sem, int subclass)
 	struct task_struct *tsk;
 	unsigned long flags;
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	if (rwsem_optimistic_spin(sem))
+		return;
+#endif
+
 	spin_lock_irqsave(&sem->wait_lock, flags);
 
 	if (sem->activity == 0 && list_empty(&sem->wait_list)) {
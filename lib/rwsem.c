@@ -24,6 +24,9 @@ void __init_rwsem(struct rw_semaphore *sem, const char *name,
 	sem->count = RWSEM_UNLOCKED_VALUE;
 	spin_lock_init(&sem->wait_lock);
 	INIT_LIST_HEAD(&sem->wait_list);
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	sem->owner = NULL;
+#endif
 }
 
 EXPORT_SYMBOL(__init_rwsem);
@@ -37,12 +40,21 @@ struct rwsem_waiter {
 };
 
 /* Wake types for __rwsem_do_wake().  Note that RWSEM_WAKE_NO_ACTIVE and
- * RWSEM_WAKE_READ_OWNED imply that the spinlock must have been kept held
- * since the rwsem value was observed.
+ * RWSEM_WAKE_READERS imply that the spinlock must have been kept held
+ * since the rwsem value was observed.  A spinning writer may still steal
+ * the lock in the meantime, so only RWSEM_WAKE_READ_OWNED (the caller
+ * holds a read lock itself) skips the reader grant check.
  */
 #define RWSEM_WAKE_ANY        0 /* Wake whatever's at head of wait list */
 #define RWSEM_WAKE_NO_ACTIVE  1 /* rwsem was observed with no active thread */
-#define RWSEM_WAKE_READ_OWNED 2 /* rwsem was observed to be read owned */
+#define RWSEM_WAKE_READERS    2 /* rwsem was observed to be read owned */
+#define RWSEM_WAKE_READ_OWNED 3 /* rwsem is read owned by the caller */
+
+/*
+ * Number of readers queued behind a writer that may join a batch of
+ * readers being granted the lock.  Zero keeps strict FIFO order.
+ */
+int sysctl_rwsem_reader_batch;
 
 /*
  * handle the lock release when processes blocked on it that can now run
@@ -57,16 +69,20 @@ struct rwsem_waiter {
 static struct rw_semaphore *
 __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 {
-	struct rwsem_waiter *waiter;
+	struct rwsem_waiter *waiter, *tmp;
 	struct task_struct *tsk;
 	struct list_head *next;
 	signed long oldcount, woken, loop, adjustment;
+	int batched;
+	bool passed_writer;
+	LIST_HEAD(wake_list);
 
 	waiter = list_entry(sem->wait_list.next, struct rwsem_waiter, list);
 	if (!(waiter->flags & RWSEM_WAITING_FOR_WRITE))
 		goto readers_only;
 
-	if (wake_type == RWSEM_WAKE_READ_OWNED)
+	if (wake_type == RWSEM_WAKE_READERS ||
+	    wake_type == RWSEM_WAKE_READ_OWNED)
 		/* Another active reader was observed, so wakeup is not
 		 * likely to succeed. Save the atomic op.
 		 */
@@ -101,47 +117,63 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
  readers_only:
 	/* If we come here from up_xxxx(), another thread might have reached
 	 * rwsem_down_failed_common() before we acquired the spinlock and
-	 * woken up a waiter, making it now active.  We prefer to check for
-	 * this first in order to not spend too much time with the spinlock
-	 * held if we're not going to be able to wake up readers in the end.
-	 *
-	 * Note that we do not need to update the rwsem count: any writer
-	 * trying to acquire rwsem will run rwsem_down_write_failed() due
-	 * to the waiting threads and block trying to acquire the spinlock.
+	 * woken up a waiter, making it now active.  A spinning writer may
+	 * also have stolen the lock since the count was observed.  Grant
+	 * the first read lock before counting readers, so that we can back
+	 * off early without spending time with the spinlock held.
 	 *
-	 * We use a dummy atomic update in order to acquire the cache line
-	 * exclusively since we expect to succeed and run the final rwsem
-	 * count adjustment pretty soon.
+	 * Note that we do not need to update the rwsem count for the
+	 * remaining readers yet: any writer trying to acquire rwsem will run
+	 * rwsem_down_write_failed() due to the waiting threads and block
+	 * trying to acquire the spinlock.
 	 */
-	if (wake_type == RWSEM_WAKE_ANY &&
-	    rwsem_atomic_update(0, sem) < RWSEM_WAITING_BIAS)
-		/* Someone grabbed the sem for write already */
-		goto out;
+	adjustment = 0;
+	if (wake_type != RWSEM_WAKE_READ_OWNED) {
+		adjustment = RWSEM_ACTIVE_READ_BIAS;
+ try_reader_grant:
+		oldcount = rwsem_atomic_update(adjustment, sem) - adjustment;
+		if (unlikely(oldcount < RWSEM_WAITING_BIAS)) {
+			/* A writer grabbed the sem; undo our reader grant */
+			if (rwsem_atomic_update(-adjustment, sem) &
+			    RWSEM_ACTIVE_MASK)
+				goto out;
+			/* The last active locker left, retry waking readers */
+			goto try_reader_grant;
+		}
+	}
 
 	/* Grant an infinite number of read locks to the readers at the front
-	 * of the queue.  Note we increment the 'active part' of the count by
-	 * the number of readers before waking any processes up.
+	 * of the queue, and batch up to sysctl_rwsem_reader_batch readers
+	 * queued behind writers with them so that they share this read-owned
+	 * period instead of waiting for one of their own each.  Readers are
+	 * moved to a private list before the count is adjusted, and woken
+	 * only after that.
 	 */
 	woken = 0;
-	do {
-		woken++;
-
-		if (waiter->list.next == &sem->wait_list)
+	batched = 0;
+	passed_writer = false;
+	list_for_each_entry_safe(waiter, tmp, &sem->wait_list, list) {
+		if (waiter->flags & RWSEM_WAITING_FOR_WRITE) {
+			if (!sysctl_rwsem_reader_batch)
+				break;
+			passed_writer = true;
+			continue;
+		}
+		if (passed_writer && ++batched > sysctl_rwsem_reader_batch)
 			break;
+		list_move_tail(&waiter->list, &wake_list);
+		woken++;
+	}
 
-		waiter = list_entry(waiter->list.next,
-					struct rwsem_waiter, list);
-
-	} while (waiter->flags & RWSEM_WAITING_FOR_READ);
-
-	adjustment = woken * RWSEM_ACTIVE_READ_BIAS;
-	if (waiter->flags & RWSEM_WAITING_FOR_READ)
-		/* hit end of list above */
+	adjustment = woken * RWSEM_ACTIVE_READ_BIAS - adjustment;
+	if (list_empty(&sem->wait_list))
+		/* granted everybody */
 		adjustment -= RWSEM_WAITING_BIAS;
 
-	rwsem_atomic_add(adjustment, sem);
+	if (adjustment)
+		rwsem_atomic_add(adjustment, sem);
 
-	next = sem->wait_list.next;
+	next = wake_list.next;
 	for (loop = woken; loop > 0; loop--) {
 		waiter = list_entry(next, struct rwsem_waiter, list);
 		next = waiter->list.next;
@@ -152,9 +184,6 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 		put_task_struct(tsk);
 	}
 
-	sem->wait_list.next = next;
-	next->prev = &sem->wait_list;
-
  out:
 	return sem;
 
@@ -166,6 +195,64 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 	goto try_again_write;
 }
 
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+/*
+ * Try to grab the write lock without queueing: the active part of the
+ * count must be zero, waiters may be present.
+ */
+static inline int rwsem_try_write_lock_unqueued(struct rw_semaphore *sem)
+{
+	long old, count = ACCESS_ONCE(sem->count);
+
+	while (count == 0 || count == RWSEM_WAITING_BIAS) {
+		old = cmpxchg(&sem->count, count,
+			      count + RWSEM_ACTIVE_WRITE_BIAS);
+		if (old == count)
+			return 1;
+		count = old;
+	}
+	return 0;
+}
+
+/*
+ * Optimistic spinning for writers, see __mutex_lock_common(): as long as
+ * the writer owning the lock is running it is likely to release it soon,
+ * so spin instead of going through the wait queue.  The caller must not
+ * hold an active bias on the count.
+ */
+static int rwsem_optimistic_spin(struct rw_semaphore *sem)
+{
+	struct task_struct *owner;
+	int taken = 0;
+
+	preempt_disable();
+	for (;;) {
+		owner = ACCESS_ONCE(sem->owner);
+		if (owner && !rwsem_spin_on_owner(sem, owner))
+			break;
+
+		if (rwsem_try_write_lock_unqueued(sem)) {
+			taken = 1;
+			break;
+		}
+
+		/*
+		 * No owner and the lock is active: readers hold it, which
+		 * we cannot spin on, or a writer has not set ->owner yet.
+		 * An RT task could live-lock in the latter case.
+		 */
+		if (!owner && (need_resched() || rt_task(current) ||
+			       (ACCESS_ONCE(sem->count) & RWSEM_ACTIVE_MASK)))
+			break;
+
+		arch_mutex_cpu_relax();
+	}
+	preempt_enable();
+
+	return taken;
+}
+#endif
+
 /*
  * wait for a lock to be granted
  */
@@ -201,8 +288,8 @@ rwsem_down_failed_common(struct rw_semaphore *sem,
 	if (count == RWSEM_WAITING_BIAS)
 		sem = __rwsem_do_wake(sem, RWSEM_WAKE_NO_ACTIVE);
 	else if (count > RWSEM_WAITING_BIAS &&
-		 adjustment == -RWSEM_ACTIVE_WRITE_BIAS)
-		sem = __rwsem_do_wake(sem, RWSEM_WAKE_READ_OWNED);
+		 (flags & RWSEM_WAITING_FOR_WRITE))
+		sem = __rwsem_do_wake(sem, RWSEM_WAKE_READERS);
 
 	spin_unlock_irq(&sem->wait_lock);
 
@@ -233,8 +320,17 @@ struct rw_semaphore __sched *rwsem_down_read_failed(struct rw_semaphore *sem)
  */
 struct rw_semaphore __sched *rwsem_down_write_failed(struct rw_semaphore *sem)
 {
+#ifdef CONFIG_RWSEM_SPIN_ON_OWNER
+	/* drop our write bias so that the lock can be stolen while we spin */
+	rwsem_atomic_update(-RWSEM_ACTIVE_WRITE_BIAS, sem);
+	if (rwsem_optimistic_spin(sem))
+		return sem;
+
+	return rwsem_down_failed_common(sem, RWSEM_WAITING_FOR_WRITE, 0);
+#else
 	return rwsem_down_failed_common(sem, RWSEM_WAITING_FOR_WRITE,
 					-RWSEM_ACTIVE_WRITE_BIAS);
+#endif
 }
 
 /*
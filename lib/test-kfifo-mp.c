@@ -0,0 +1,409 @@
+/*
+ * Test cases for the multi producer / multi consumer kfifo.
+ *
+ * The first part checks the basic semantics on one CPU: fill levels,
+ * partial writes, index wrap-around and records.  The second part lets a
+ * kernel thread per online CPU and an hrtimer in hard interrupt context
+ * write tagged values concurrently, and checks that the readers get every
+ * value exactly once: in order with a single reader, and without loss or
+ * duplicates with several.  The same is done with variable length records,
+ * which must come out whole.
+ */
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/kfifo.h>
+#include <linux/kthread.h>
+#include <linux/hrtimer.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/bitmap.h>
+#include <linux/completion.h>
+
+#define MP_TEST_THREADS		8
+#define MP_TEST_IRQ_ID		MP_TEST_THREADS
+#define MP_TEST_IDS		(MP_TEST_THREADS + 1)
+#define MP_TEST_ITEMS		(1 << 16)
+#define MP_TEST_IRQ_ITEMS	(1 << 12)
+#define MP_TEST_IRQ_BATCH	4
+#define MP_TEST_REC_MAX		48
+
+static int failures;
+
+#define MP_CHECK(cond)							\
+({									\
+	int __ok = !!(cond);						\
+	if (!__ok) {							\
+		WARN(1, "test-kfifo-mp: %s failed\n", #cond);		\
+		failures++;						\
+	}								\
+	__ok;								\
+})
+
+static void __init test_kfifo_mp_basic(void)
+{
+	DEFINE_KFIFO_MP(fifo, int, 8);
+	int buf[16], i, val;
+
+	for (i = 0; i < 8; i++)
+		MP_CHECK(kfifo_mp_put(&fifo, &i) == 1);
+	MP_CHECK(kfifo_mp_put(&fifo, &i) == 0);
+	MP_CHECK(kfifo_len(&fifo) == 8);
+
+	for (i = 0; i < 8; i++) {
+		MP_CHECK(kfifo_mp_get(&fifo, &val) == 1);
+		MP_CHECK(val == i);
+	}
+	MP_CHECK(kfifo_mp_get(&fifo, &val) == 0);
+	MP_CHECK(kfifo_is_empty(&fifo));
+
+	/* partial writes, and copies across the end of the buffer */
+	for (i = 0; i < 16; i++)
+		buf[i] = 100 + i;
+	MP_CHECK(kfifo_mp_in(&fifo, buf, 5) == 5);
+	MP_CHECK(kfifo_mp_in(&fifo, buf + 5, 11) == 3);
+	MP_CHECK(kfifo_mp_out(&fifo, buf, 3) == 3);
+	MP_CHECK(buf[0] == 100 && buf[2] == 102);
+	MP_CHECK(kfifo_mp_in(&fifo, buf + 8, 3) == 3);
+	memset(buf, 0, sizeof(buf));
+	MP_CHECK(kfifo_mp_out(&fifo, buf, 16) == 8);
+	MP_CHECK(buf[0] == 103 && buf[4] == 107 && buf[7] == 110);
+
+	/* the indices are free running, make them wrap */
+	fifo.mp.kfifo.in = fifo.mp.kfifo.out = -3U;
+	fifo.mp.head = fifo.mp.tail = -3U;
+	for (i = 0; i < 6; i++)
+		MP_CHECK(kfifo_mp_put(&fifo, &i) == 1);
+	for (i = 0; i < 6; i++)
+		MP_CHECK(kfifo_mp_get(&fifo, &val) == 1 && val == i);
+
+	kfifo_mp_reset(&fifo);
+	MP_CHECK(kfifo_is_empty(&fifo) && fifo.mp.head == 0);
+}
+
+static void __init test_kfifo_mp_records(void)
+{
+	STRUCT_KFIFO_MP_REC_1(32) fifo;
+	struct kfifo_mp_rec_ptr_2 dyn;
+	char buf[32];
+
+	INIT_KFIFO_MP(fifo);
+
+	MP_CHECK(kfifo_mp_in(&fifo, "hello", 5) == 5);
+	MP_CHECK(kfifo_mp_in(&fifo, "multi producer", 14) == 14);
+	/* 6 + 15 used, a record needs its length byte too */
+	MP_CHECK(kfifo_mp_in(&fifo, "0123456789ab", 12) == 0);
+	MP_CHECK(kfifo_mp_in(&fifo, "012345678", 9) == 9);
+	MP_CHECK(kfifo_peek_len(&fifo) == 5);
+
+	MP_CHECK(kfifo_mp_out(&fifo, buf, sizeof(buf)) == 5);
+	MP_CHECK(!memcmp(buf, "hello", 5));
+	/* a short buffer truncates the record, the rest is skipped */
+	MP_CHECK(kfifo_mp_out(&fifo, buf, 5) == 5);
+	MP_CHECK(!memcmp(buf, "multi", 5));
+	MP_CHECK(kfifo_mp_out(&fifo, buf, sizeof(buf)) == 9);
+	MP_CHECK(!memcmp(buf, "012345678", 9));
+	MP_CHECK(kfifo_mp_out(&fifo, buf, sizeof(buf)) == 0);
+
+	if (!MP_CHECK(kfifo_mp_alloc(&dyn, 1024, GFP_KERNEL) == 0))
+		return;
+	MP_CHECK(kfifo_recsize(&dyn) == 2);
+	memset(buf, 0x5a, sizeof(buf));
+	while (kfifo_mp_in(&dyn, buf, 30))
+		;
+	/* a length field of 2 bytes makes it exactly 32 records */
+	MP_CHECK(kfifo_len(&dyn) == 1024);
+	while (kfifo_mp_out(&dyn, buf, sizeof(buf)) == 30)
+		;
+	MP_CHECK(kfifo_is_empty(&dyn));
+	kfifo_mp_free(&dyn);
+}
+
+/*
+ * Concurrent writers and readers.  Values carry the writer id in the top
+ * byte and a sequence number below it.  Records carry the id and the
+ * sequence number followed by a pattern derived from both.
+ */
+static DEFINE_KFIFO_MP(stress_fifo, u32, 256);
+static STRUCT_KFIFO_MP_REC_1(1024) stress_rec_fifo;
+
+struct mp_stress;
+
+struct mp_stress_writer {
+	struct mp_stress	*st;
+	unsigned int		id;
+};
+
+struct mp_stress {
+	struct mp_stress_writer	writers[MP_TEST_THREADS];
+	bool			records;
+	int			nr_readers;
+	atomic_t		writers_left;
+	atomic_t		readers_left;
+	atomic_t		errors;
+	unsigned long		*seen[MP_TEST_IDS];
+	unsigned int		next[MP_TEST_IDS];
+	unsigned int		irq_seq;
+	struct hrtimer		timer;
+	struct completion	done;
+};
+
+struct mp_stress_rec {
+	u8	id;
+	u8	len;
+	u32	seq;
+	u8	pattern[MP_TEST_REC_MAX];
+} __packed;
+
+static unsigned int mp_stress_rec_fill(struct mp_stress_rec *rec,
+				       unsigned int id, unsigned int seq)
+{
+	unsigned int i;
+
+	rec->id = id;
+	rec->seq = seq;
+	rec->len = 1 + (seq * 7 + id) % MP_TEST_REC_MAX;
+	for (i = 0; i < rec->len; i++)
+		rec->pattern[i] = seq + id + i;
+
+	return offsetof(struct mp_stress_rec, pattern) + rec->len;
+}
+
+static bool mp_stress_put(struct mp_stress *st, unsigned int id,
+			  unsigned int seq)
+{
+	struct mp_stress_rec rec;
+	u32 val = (id << 24) | seq;
+
+	if (!st->records)
+		return kfifo_mp_put(&stress_fifo, &val);
+
+	return kfifo_mp_in(&stress_rec_fifo, &rec,
+			   mp_stress_rec_fill(&rec, id, seq));
+}
+
+static void mp_stress_park(void)
+{
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+}
+
+static void mp_stress_writer_done(struct mp_stress *st)
+{
+	/* all of our data is published before the count drops */
+	smp_mb__before_atomic_dec();
+	atomic_dec(&st->writers_left);
+}
+
+static int mp_stress_writer_fn(void *arg)
+{
+	struct mp_stress_writer *w = arg;
+	struct mp_stress *st = w->st;
+	unsigned int id = w->id;
+	unsigned int seq;
+
+	for (seq = 0; seq < MP_TEST_ITEMS; seq++) {
+		while (!mp_stress_put(st, id, seq))
+			cond_resched();
+	}
+	mp_stress_writer_done(st);
+
+	mp_stress_park();
+	return 0;
+}
+
+static enum hrtimer_restart mp_stress_irq_writer(struct hrtimer *timer)
+{
+	struct mp_stress *st = container_of(timer, struct mp_stress, timer);
+	int i;
+
+	for (i = 0; i < MP_TEST_IRQ_BATCH; i++) {
+		if (st->irq_seq == MP_TEST_IRQ_ITEMS ||
+		    !mp_stress_put(st, MP_TEST_IRQ_ID, st->irq_seq))
+			break;
+		st->irq_seq++;
+	}
+
+	if (st->irq_seq == MP_TEST_IRQ_ITEMS) {
+		mp_stress_writer_done(st);
+		return HRTIMER_NORESTART;
+	}
+
+	hrtimer_forward_now(timer, ns_to_ktime(10 * NSEC_PER_USEC));
+	return HRTIMER_RESTART;
+}
+
+static void mp_stress_check(struct mp_stress *st, unsigned int id,
+			    unsigned int seq)
+{
+	unsigned int items = id == MP_TEST_IRQ_ID ? MP_TEST_IRQ_ITEMS :
+						    MP_TEST_ITEMS;
+
+	if (id >= MP_TEST_IDS || seq >= items ||
+	    test_and_set_bit(seq, st->seen[id])) {
+		atomic_inc(&st->errors);
+		return;
+	}
+	/* a single reader sees the values of each writer in order */
+	if (st->nr_readers == 1 && st->next[id]++ != seq)
+		atomic_inc(&st->errors);
+}
+
+static bool mp_stress_get(struct mp_stress *st)
+{
+	struct mp_stress_rec rec;
+	unsigned int len, i;
+	u32 val;
+
+	if (!st->records) {
+		if (!kfifo_mp_get(&stress_fifo, &val))
+			return false;
+		mp_stress_check(st, val >> 24, val & 0xffffff);
+		return true;
+	}
+
+	len = kfifo_mp_out(&stress_rec_fifo, &rec, sizeof(rec));
+	if (!len)
+		return false;
+
+	if (len != offsetof(struct mp_stress_rec, pattern) + rec.len) {
+		atomic_inc(&st->errors);
+		return true;
+	}
+	for (i = 0; i < rec.len; i++) {
+		if (rec.pattern[i] != (u8)(rec.seq + rec.id + i)) {
+			atomic_inc(&st->errors);
+			return true;
+		}
+	}
+	mp_stress_check(st, rec.id, rec.seq);
+	return true;
+}
+
+static int mp_stress_reader(void *arg)
+{
+	struct mp_stress *st = arg;
+	int done;
+
+	for (;;) {
+		done = !atomic_read(&st->writers_left);
+		smp_rmb();
+		if (mp_stress_get(st))
+			continue;
+		/* or the writers could not be started */
+		if (done || kthread_should_stop())
+			break;
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(&st->readers_left))
+		complete(&st->done);
+
+	mp_stress_park();
+	return 0;
+}
+
+static void __init test_kfifo_mp_stress(bool records, int nr_writers,
+					int nr_readers)
+{
+	struct task_struct *tasks[2 * MP_TEST_THREADS];
+	struct mp_stress *st;
+	int i, nr_tasks = 0;
+
+	st = kzalloc(sizeof(*st), GFP_KERNEL);
+	if (!MP_CHECK(st))
+		return;
+	for (i = 0; i < MP_TEST_IDS; i++) {
+		st->seen[i] = vzalloc(BITS_TO_LONGS(MP_TEST_ITEMS) *
+				      sizeof(long));
+		if (!MP_CHECK(st->seen[i]))
+			goto out;
+	}
+
+	INIT_KFIFO_MP(stress_fifo);
+	INIT_KFIFO_MP(stress_rec_fifo);
+	st->records = records;
+	st->nr_readers = nr_readers;
+	atomic_set(&st->writers_left, nr_writers + 1);
+	atomic_set(&st->readers_left, nr_readers);
+	init_completion(&st->done);
+
+	for (i = 0; i < nr_readers; i++) {
+		tasks[nr_tasks] = kthread_run(mp_stress_reader, st,
+					      "kfifo_mp_r/%d", i);
+		if (!MP_CHECK(!IS_ERR(tasks[nr_tasks])))
+			goto stop;
+		nr_tasks++;
+	}
+	for (i = 0; i < nr_writers; i++) {
+		struct task_struct *p;
+
+		st->writers[i].st = st;
+		st->writers[i].id = i;
+		p = kthread_create(mp_stress_writer_fn, &st->writers[i],
+				   "kfifo_mp_w/%d", i);
+		if (!MP_CHECK(!IS_ERR(p)))
+			goto stop;
+		tasks[nr_tasks++] = p;
+	}
+
+	hrtimer_init(&st->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	st->timer.function = mp_stress_irq_writer;
+	hrtimer_start(&st->timer, ns_to_ktime(10 * NSEC_PER_USEC),
+		      HRTIMER_MODE_REL);
+	for (i = nr_readers; i < nr_tasks; i++)
+		wake_up_process(tasks[i]);
+
+	wait_for_completion(&st->done);
+	hrtimer_cancel(&st->timer);
+
+	for (i = 0; i < MP_TEST_THREADS && i < nr_writers; i++)
+		MP_CHECK(bitmap_full(st->seen[i], MP_TEST_ITEMS));
+	MP_CHECK(bitmap_full(st->seen[MP_TEST_IRQ_ID], MP_TEST_IRQ_ITEMS));
+	MP_CHECK(atomic_read(&st->errors) == 0);
+
+	pr_info("test-kfifo-mp: %s, %d writers + irq, %d readers: %d errors\n",
+		records ? "records" : "values", nr_writers, nr_readers,
+		atomic_read(&st->errors));
+stop:
+	/* unstarted threads get stopped without ever running */
+	for (i = 0; i < nr_tasks; i++)
+		kthread_stop(tasks[i]);
+out:
+	for (i = 0; i < MP_TEST_IDS; i++)
+		vfree(st->seen[i]);
+	kfree(st);
+}
+
+static int __init test_kfifo_mp_init(void)
+{
+	int writers = clamp_t(int, num_online_cpus(), 2, MP_TEST_THREADS);
+
+	test_kfifo_mp_basic();
+	test_kfifo_mp_records();
+
+	test_kfifo_mp_stress(false, writers, 1);
+	test_kfifo_mp_stress(false, writers, min(writers, 4));
+	test_kfifo_mp_stress(true, writers, 1);
+	test_kfifo_mp_stress(true, writers, min(writers, 4));
+
+	if (failures) {
+		pr_err("test-kfifo-mp: %d failures\n", failures);
+		return -EINVAL;
+	}
+
+	pr_info("test-kfifo-mp: passed\n");
+	return 0;
+}
+
+static void __exit test_kfifo_mp_exit(void)
+{
+}
+
+module_init(test_kfifo_mp_init);
+module_exit(test_kfifo_mp_exit);
+MODULE_LICENSE("GPL");
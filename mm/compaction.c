@@ -14,6 +14,8 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -644,6 +646,8 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 
 		status = compact_zone_order(zone, order, gfp_mask, sync);
 		rc = max(status, rc);
+		if (status != COMPACT_SKIPPED)
+			inc_zone_state(zone, NR_COMPACT_STALL);
 
 		/* If a normal allocation would succeed, stop compacting */
 		if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0))
@@ -653,6 +657,203 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	return rc;
 }
 
+/*
+ * kcompactd compacts in the background what kswapd could not make
+ * available by reclaim: kswapd wakes it for the order it gave up on.
+ * It also checks its node every KCOMPACTD_PROACTIVE_INTERVAL and
+ * compacts zones whose fragmentation index at PAGE_ALLOC_COSTLY_ORDER is
+ * above sysctl_compaction_proactive_threshold, so high-order allocations
+ * find their pages before they have to stall in direct compaction.
+ */
+#define KCOMPACTD_PROACTIVE_INTERVAL	(HZ / 2)
+
+/*
+ * 1000 is above any fragmentation index and disables it. Off by default,
+ * the periodic check wakes every node's kcompactd even on idle systems.
+ */
+int sysctl_compaction_proactive_threshold = 1000;
+
+static bool kcompactd_proactive_enabled(void)
+{
+	return sysctl_compaction_proactive_threshold < 1000;
+}
+
+/* bumped by the sysctl, so that kcompactd recomputes its timeout */
+static unsigned int kcompactd_proactive_gen;
+
+static bool kcompactd_work_requested(pg_data_t *pgdat, unsigned int gen)
+{
+	return pgdat->kcompactd_max_order > 0 || kthread_should_stop() ||
+		ACCESS_ONCE(kcompactd_proactive_gen) != gen;
+}
+
+static void kcompactd_compact_zone(struct zone *zone, int order)
+{
+	int status;
+
+	if (compaction_suitable(zone, order) != COMPACT_CONTINUE ||
+	    compaction_deferred(zone))
+		return;
+
+	status = compact_zone_order(zone, order, GFP_KERNEL, true);
+
+	/* Page migration frees to the PCP lists but we want merging */
+	drain_local_pages(NULL);
+
+	if (zone_watermark_ok(zone, order, low_wmark_pages(zone), 0, 0)) {
+		zone->compact_considered = 0;
+		zone->compact_defer_shift = 0;
+		inc_zone_state(zone, NR_KCOMPACTD_SUCCESS);
+		return;
+	}
+
+	inc_zone_state(zone, NR_KCOMPACTD_FAIL);
+	/* The whole zone was scanned in vain, back off */
+	if (status == COMPACT_COMPLETE)
+		defer_compaction(zone);
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int order = pgdat->kcompactd_max_order;
+	enum zone_type classzone_idx = pgdat->kcompactd_classzone_idx;
+	int zoneid;
+
+	/* Wakeups from here on ask for another run */
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+
+	count_vm_event(KCOMPACTD_WAKE);
+
+	for (zoneid = 0; zoneid <= classzone_idx; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		if (kthread_should_stop())
+			return;
+
+		kcompactd_compact_zone(zone, order);
+	}
+}
+
+static void kcompactd_proactive(pg_data_t *pgdat)
+{
+	int zoneid;
+
+	for (zoneid = 0; zoneid < pgdat->nr_zones; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+		if (kthread_should_stop())
+			return;
+
+		if (fragmentation_index(zone, PAGE_ALLOC_COSTLY_ORDER) <=
+		    sysctl_compaction_proactive_threshold)
+			continue;
+
+		count_vm_event(KCOMPACTD_PROACTIVE);
+		kcompactd_compact_zone(zone, PAGE_ALLOC_COSTLY_ORDER);
+	}
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		unsigned int gen = ACCESS_ONCE(kcompactd_proactive_gen);
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		smp_rmb();
+		if (kcompactd_proactive_enabled())
+			timeout = KCOMPACTD_PROACTIVE_INTERVAL;
+
+		wait_event_freezable_timeout(pgdat->kcompactd_wait,
+				kcompactd_work_requested(pgdat, gen), timeout);
+		if (kthread_should_stop())
+			break;
+
+		if (pgdat->kcompactd_max_order)
+			kcompactd_do_work(pgdat);
+		else if (kcompactd_proactive_enabled())
+			kcompactd_proactive(pgdat);
+	}
+
+	return 0;
+}
+
+/**
+ * wakeup_kcompactd - ask kcompactd to compact a node in the background
+ * @pgdat: the node
+ * @order: the order kswapd could not balance the node for
+ * @classzone_idx: the highest zone to compact
+ */
+void wakeup_kcompactd(pg_data_t *pgdat, int order, enum zone_type classzone_idx)
+{
+	if (!order)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	if (pgdat->kcompactd_classzone_idx > classzone_idx)
+		pgdat->kcompactd_classzone_idx = classzone_idx;
+
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * Started by init and node-hot-add, like kswapd.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd_max_order = 0;
+	pgdat->kcompactd_classzone_idx = pgdat->nr_zones - 1;
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
 
 /* Compact all zones within a node */
 static int compact_node(int nid)
@@ -724,6 +925,25 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/* Wake the kcompactds so they pick up the new proactive interval */
+int sysctl_compaction_proactive_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int ret, nid;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	/* pairs with the smp_rmb() in kcompactd() */
+	smp_wmb();
+	kcompactd_proactive_gen++;
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		wake_up_interruptible(&NODE_DATA(nid)->kcompactd_wait);
+
+	return 0;
+}
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
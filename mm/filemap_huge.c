@@ -0,0 +1,429 @@
+/*
+ * mm/filemap_huge.c - transparent hugepages in the page cache
+ *
+ * The page cache of a regular file that nobody has open for writing can
+ * hold hugepages, which do_huge_pmd_file_page() maps with huge pmds into
+ * read-only mappings of the file.
+ *
+ * A hugepage is assembled at the first fault in an aligned range: the
+ * range is read into the page cache as usual, copied into a compound
+ * page, and the compound page takes the place of the regular pages in
+ * the radix-tree, each subpage at its own index.  Lookups and reads then
+ * see the subpages like any other page; only their reference counts go
+ * through the head page.  Filesystems never get to attach buffers to the
+ * subpages, which is why they are never read into directly and why they
+ * have to go before anyone gets to write to the file.
+ *
+ * The hugepages are not on the LRU lists and not charged to a memory
+ * cgroup.  They leave the page cache as a whole: when the file is opened
+ * for writing or truncated, when the cache is invalidated, and from a
+ * shrinker under memory pressure.
+ */
+#include <linux/mm.h>
+#include <linux/fs.h>
+#include <linux/pagemap.h>
+#include <linux/pagevec.h>
+#include <linux/highmem.h>
+#include <linux/swap.h>
+#include <linux/slab.h>
+#include <linux/memcontrol.h>
+
+/* the hugepages in the page cache, for the shrinker */
+static LIST_HEAD(filemap_huge_list);
+static DEFINE_SPINLOCK(filemap_huge_lock);
+static unsigned long filemap_huge_nr;
+
+static void free_filemap_huge_page(struct page *page)
+{
+	init_page_count(page);
+	__free_pages(page, HPAGE_PMD_ORDER);
+}
+
+int PageFileHuge(struct page *page)
+{
+	if (!PageCompound(page))
+		return 0;
+
+	page = compound_head(page);
+	return get_compound_page_dtor(page) == free_filemap_huge_page;
+}
+
+/*
+ * page_cache_get_speculative() of a subpage: the page may have been freed
+ * and reused since the radix-tree lookup, so its first_page cannot be
+ * trusted until the hugepage it would belong to is pinned.  The
+ * compound_lock serializes against __split_huge_page_refcount() in case
+ * the page is an anonymous one by now.
+ */
+int page_cache_get_speculative_tail(struct page *page)
+{
+	struct page *head;
+	unsigned long flags;
+	int ret = 0;
+
+	head = pfn_to_page(page_to_pfn(page) & ~(HPAGE_PMD_NR - 1));
+	if (unlikely(!get_page_unless_zero(head)))
+		return 0;
+
+	flags = compound_lock_irqsave(head);
+	if (likely(PageTail(page) && page->first_page == head)) {
+		atomic_inc(&page->_count);
+		ret = 1;
+	}
+	compound_unlock_irqrestore(head, flags);
+
+	if (unlikely(!ret))
+		put_page(head);
+	return ret;
+}
+
+/*
+ * Take the locked hugepage out of the page cache.  All the subpages are
+ * locked and none of them is mapped; the tails are unlocked on return,
+ * the caller keeps its reference and the lock of the head.
+ */
+static void filemap_huge_remove(struct address_space *mapping,
+				struct page *head)
+{
+	void (*freepage)(struct page *) = mapping->a_ops->freepage;
+	int i;
+
+	spin_lock_irq(&mapping->tree_lock);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		__delete_from_page_cache(head + i);
+	__dec_zone_page_state(head, NR_FILE_TRANSPARENT_HUGEPAGES);
+	spin_unlock_irq(&mapping->tree_lock);
+
+	spin_lock(&filemap_huge_lock);
+	list_del(&head->lru);
+	filemap_huge_nr--;
+	spin_unlock(&filemap_huge_lock);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		if (freepage)
+			freepage(head + i);
+		if (i)
+			unlock_page(head + i);
+		page_cache_release(head + i);	/* pagecache ref */
+	}
+	count_vm_event(THP_FILE_DROP);
+}
+
+/*
+ * Drop the hugepage with the locked @head from the page cache, unless a
+ * subpage is mapped and @unmap is not set.  With @wait the subpages are
+ * locked whatever it takes, without it only if they are not locked
+ * already.  Returns the number of pages dropped.
+ */
+static int filemap_huge_drop(struct address_space *mapping, struct page *head,
+			     int wait, int unmap)
+{
+	int i, locked;
+
+	VM_BUG_ON(!PageLocked(head));
+
+	for (locked = 1; locked < HPAGE_PMD_NR; locked++) {
+		if (wait)
+			lock_page(head + locked);
+		else if (!trylock_page(head + locked))
+			goto out;
+	}
+
+	if (unmap)
+		unmap_mapping_range(mapping,
+				    (loff_t)head->index << PAGE_CACHE_SHIFT,
+				    HPAGE_PMD_SIZE, 0);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		if (page_mapped(head + i))
+			goto out;
+	}
+
+	filemap_huge_remove(mapping, head);
+	return HPAGE_PMD_NR;
+out:
+	while (--locked > 0)
+		unlock_page(head + locked);
+	return 0;
+}
+
+/*
+ * Drop the hugepage that @page, found in @mapping, is a subpage of.  With
+ * @sync it goes even if it is mapped or locked, without only if that is
+ * cheap.  The caller holds a reference on @page.
+ */
+int filemap_huge_invalidate(struct address_space *mapping, struct page *page,
+			    int sync)
+{
+	struct page *head = compound_head(page);
+	int ret = 0;
+
+	if (sync)
+		lock_page(head);
+	else if (!trylock_page(head))
+		return 0;
+	if (head->mapping == mapping)
+		ret = filemap_huge_drop(mapping, head, sync, sync);
+	unlock_page(head);
+	return ret;
+}
+
+/*
+ * Called once the i_writecount of the inode of @mapping was raised: drop
+ * all the hugepages, nobody must get to write to one.
+ */
+void filemap_huge_write_access(struct address_space *mapping)
+{
+	struct pagevec pvec;
+	pgoff_t index = 0;
+	int i;
+
+	/* pairs with the barrier in filemap_huge_collapse() */
+	smp_mb();
+	if (likely(!test_bit(AS_HUGE, &mapping->flags)))
+		return;
+
+	pagevec_init(&pvec, 0);
+	while (pagevec_lookup(&pvec, mapping, index, PAGEVEC_SIZE)) {
+		for (i = 0; i < pagevec_count(&pvec); i++) {
+			struct page *page = pvec.pages[i];
+
+			/* We rely upon deletion not changing page->index */
+			index = page->index;
+			if (PageFileHuge(page))
+				filemap_huge_invalidate(mapping, page, 1);
+		}
+		pagevec_release(&pvec);
+		cond_resched();
+		index++;
+	}
+
+	/* no new hugepage survives while the file is open for writing */
+	clear_bit(AS_HUGE, &mapping->flags);
+}
+
+/*
+ * Assemble a hugepage for the HPAGE_PMD_NR pages of @file from @index
+ * from its regular page cache pages.  Returns the hugepage locked and
+ * with a reference, or NULL if the range does not qualify, a page of it
+ * is in use or the allocation failed.
+ */
+static struct page *filemap_huge_collapse(struct file *file, pgoff_t index,
+					  gfp_t gfp_mask)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	void (*freepage)(struct page *) = mapping->a_ops->freepage;
+	struct page **pages, *page, *head;
+	int i, nr, locked;
+
+	/*
+	 * Only regular files: the writers of a block device go through
+	 * its device nodes, whose i_writecount we don't see, and open()
+	 * doesn't call filemap_huge_write_access() for special files.
+	 */
+	if (!S_ISREG(inode->i_mode) ||
+	    atomic_read(&inode->i_writecount) > 0 ||
+	    !mapping->a_ops->readpage ||
+	    i_size_read(inode) <
+	    (loff_t)(index + HPAGE_PMD_NR) << PAGE_CACHE_SHIFT)
+		return NULL;
+
+	pages = kmalloc(HPAGE_PMD_NR * sizeof(struct page *), GFP_KERNEL);
+	if (!pages)
+		return NULL;
+
+	/* don't read in the whole range for a hugepage we can't get */
+	head = alloc_pages(gfp_mask, HPAGE_PMD_ORDER);
+	if (unlikely(!head)) {
+		count_vm_event(THP_FILE_FALLBACK);
+		kfree(pages);
+		return NULL;
+	}
+	count_vm_event(THP_FILE_ALLOC);
+
+	force_page_cache_readahead(mapping, file, index, HPAGE_PMD_NR);
+	for (nr = 0; nr < HPAGE_PMD_NR; nr++) {
+		page = read_mapping_page(mapping, index + nr, file);
+		if (IS_ERR(page))
+			goto out_free;
+		/* somebody else was faster */
+		if (PageCompound(page)) {
+			page_cache_release(page);
+			goto out_free;
+		}
+		pages[nr] = page;
+	}
+
+	/* the pages we just read may still sit in our lru pagevecs */
+	lru_add_drain();
+	for (locked = 0; locked < HPAGE_PMD_NR; locked++) {
+		page = pages[locked];
+		if (!trylock_page(page))
+			goto out_unlock;
+		if (page->mapping != mapping || !PageUptodate(page) ||
+		    PageDirty(page) || PageWriteback(page) ||
+		    page_mapped(page) ||
+		    (page_has_private(page) && !try_to_release_page(page, 0))) {
+			unlock_page(page);
+			goto out_unlock;
+		}
+	}
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		copy_highpage(head + i, pages[i]);
+		cond_resched();
+	}
+	set_compound_page_dtor(head, free_filemap_huge_page);
+	/* the head's reference from the allocation is its pagecache ref */
+	get_page(head);
+
+	spin_lock_irq(&mapping->tree_lock);
+	/* fails unless the page cache and we are the only users */
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		if (!page_freeze_refs(pages[i], 2))
+			break;
+	}
+	if (i < HPAGE_PMD_NR) {
+		while (i--)
+			page_unfreeze_refs(pages[i], 2);
+		spin_unlock_irq(&mapping->tree_lock);
+		put_page(head);
+		goto out_unlock;
+	}
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		void **slot;
+
+		page = head + i;
+		__set_page_locked(page);
+		__SetPageUptodate(page);
+		page->mapping = mapping;
+		page->index = index + i;
+		if (i)
+			get_page(page);
+
+		slot = radix_tree_lookup_slot(&mapping->page_tree, index + i);
+		VM_BUG_ON(radix_tree_deref_slot_protected(slot,
+				&mapping->tree_lock) != pages[i]);
+		radix_tree_replace_slot(slot, page);
+
+		pages[i]->mapping = NULL;
+		page_unfreeze_refs(pages[i], 1);
+		__dec_zone_page_state(pages[i], NR_FILE_PAGES);
+		__inc_zone_page_state(page, NR_FILE_PAGES);
+	}
+	__inc_zone_page_state(head, NR_FILE_TRANSPARENT_HUGEPAGES);
+	spin_unlock_irq(&mapping->tree_lock);
+
+	mem_cgroup_uncharge_start();
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		mem_cgroup_uncharge_cache_page(pages[i]);
+		if (freepage)
+			freepage(pages[i]);
+		unlock_page(pages[i]);
+		page_cache_release(pages[i]);
+	}
+	mem_cgroup_uncharge_end();
+	kfree(pages);
+
+	spin_lock(&filemap_huge_lock);
+	list_add_tail(&head->lru, &filemap_huge_list);
+	filemap_huge_nr++;
+	spin_unlock(&filemap_huge_lock);
+
+	/*
+	 * Either filemap_huge_write_access() sees the flag and drops the
+	 * hugepage, or we see the writer and drop it ourselves.
+	 */
+	set_bit(AS_HUGE, &mapping->flags);
+	smp_mb();
+	if (unlikely(atomic_read(&inode->i_writecount) > 0)) {
+		filemap_huge_remove(mapping, head);
+		unlock_page(head);
+		put_page(head);
+		return NULL;
+	}
+
+	for (i = 1; i < HPAGE_PMD_NR; i++)
+		unlock_page(head + i);
+	return head;
+
+out_unlock:
+	while (locked--)
+		unlock_page(pages[locked]);
+out_free:
+	while (nr--)
+		page_cache_release(pages[nr]);
+	put_page(head);
+	kfree(pages);
+	return NULL;
+}
+
+/**
+ * filemap_huge_get_page - find or assemble a page cache hugepage
+ * @file: the file
+ * @index: the index of the hugepage, a multiple of HPAGE_PMD_NR
+ * @gfp_mask: the allocation mode of a new hugepage
+ *
+ * Returns the head page locked and with a reference, or NULL when the
+ * range has to be mapped with regular pages.
+ */
+struct page *filemap_huge_get_page(struct file *file, pgoff_t index,
+				   gfp_t gfp_mask)
+{
+	struct page *page;
+
+	page = find_lock_page(file->f_mapping, index);
+	if (page) {
+		if (PageHead(page) && PageFileHuge(page))
+			return page;
+		unlock_page(page);
+		page_cache_release(page);
+	}
+	return filemap_huge_collapse(file, index, gfp_mask);
+}
+
+/*
+ * The hugepages are counted in regular pages, so they see the pressure
+ * the LRU pages see.  One that was not mapped since the last scan goes,
+ * mapped or not.
+ */
+static int filemap_huge_shrink(struct shrinker *shrink,
+			       struct shrink_control *sc)
+{
+	unsigned long nr = DIV_ROUND_UP(sc->nr_to_scan, HPAGE_PMD_NR);
+	struct page *head;
+
+	while (nr--) {
+		spin_lock(&filemap_huge_lock);
+		if (list_empty(&filemap_huge_list)) {
+			spin_unlock(&filemap_huge_lock);
+			break;
+		}
+		head = list_first_entry(&filemap_huge_list, struct page, lru);
+		list_move_tail(&head->lru, &filemap_huge_list);
+		/* the page cache holds it as long as it is on the list */
+		get_page(head);
+		spin_unlock(&filemap_huge_lock);
+
+		if (trylock_page(head)) {
+			if (head->mapping && !TestClearPageReferenced(head))
+				filemap_huge_drop(head->mapping, head, 0, 1);
+			unlock_page(head);
+		}
+		put_page(head);
+	}
+
+	return filemap_huge_nr * HPAGE_PMD_NR;
+}
+
+static struct shrinker filemap_huge_shrinker = {
+	.shrink = filemap_huge_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int __init filemap_huge_init(void)
+{
+	register_shrinker(&filemap_huge_shrinker);
+	return 0;
+}
+module_init(filemap_huge_init)
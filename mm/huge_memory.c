@@ -17,6 +17,7 @@
 #include <linux/khugepaged.h>
 #include <linux/freezer.h>
 #include <linux/mman.h>
+#include <linux/pagemap.h>
 #include <asm/tlb.h>
 #include <asm/pgalloc.h>
 #include "internal.h"
@@ -34,6 +35,9 @@ unsigned long transparent_hugepage_flags __read_mostly =
 #endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE_MADVISE
 	(1<<TRANSPARENT_HUGEPAGE_REQ_MADV_FLAG)|
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+	(1<<TRANSPARENT_HUGEPAGE_FILE_REQ_MADV_FLAG)|
 #endif
 	(1<<TRANSPARENT_HUGEPAGE_DEFRAG_FLAG)|
 	(1<<TRANSPARENT_HUGEPAGE_DEFRAG_KHUGEPAGED_FLAG);
@@ -293,6 +297,26 @@ static ssize_t defrag_store(struct kobject *kobj,
 static struct kobj_attribute defrag_attr =
 	__ATTR(defrag, 0644, defrag_show, defrag_store);
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+static ssize_t file_enabled_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return double_flag_show(kobj, attr, buf,
+				TRANSPARENT_HUGEPAGE_FILE_FLAG,
+				TRANSPARENT_HUGEPAGE_FILE_REQ_MADV_FLAG);
+}
+static ssize_t file_enabled_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	return double_flag_store(kobj, attr, buf, count,
+				 TRANSPARENT_HUGEPAGE_FILE_FLAG,
+				 TRANSPARENT_HUGEPAGE_FILE_REQ_MADV_FLAG);
+}
+static struct kobj_attribute file_enabled_attr =
+	__ATTR(file_enabled, 0644, file_enabled_show, file_enabled_store);
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE_FILE */
+
 #ifdef CONFIG_DEBUG_VM
 static ssize_t debug_cow_show(struct kobject *kobj,
 				struct kobj_attribute *attr, char *buf)
@@ -314,6 +338,9 @@ static struct kobj_attribute debug_cow_attr =
 static struct attribute *hugepage_attr[] = {
 	&enabled_attr.attr,
 	&defrag_attr.attr,
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+	&file_enabled_attr.attr,
+#endif
 #ifdef CONFIG_DEBUG_VM
 	&debug_cow_attr.attr,
 #endif
@@ -669,13 +696,40 @@ static inline struct page *alloc_hugepage(int defrag)
 }
 #endif
 
+/* the fault could not be handled with a huge pmd, map a regular page */
+static int do_huge_pmd_fallback(struct mm_struct *mm,
+				struct vm_area_struct *vma,
+				unsigned long address, pmd_t *pmd,
+				unsigned int flags)
+{
+	pte_t *pte;
+
+	/*
+	 * Use __pte_alloc instead of pte_alloc_map, because we can't
+	 * run pte_offset_map on the pmd, if an huge pmd could
+	 * materialize from under us from a different thread.
+	 */
+	if (unlikely(__pte_alloc(mm, vma, pmd, address)))
+		return VM_FAULT_OOM;
+	/* if an huge pmd materialized from under us just retry later */
+	if (unlikely(pmd_trans_huge(*pmd)))
+		return 0;
+	/*
+	 * A regular pmd is established and it can't morph into a huge pmd
+	 * from under us anymore at this point because we hold the mmap_sem
+	 * read mode and khugepaged takes it in write mode. So now it's
+	 * safe to run pte_offset_map().
+	 */
+	pte = pte_offset_map(pmd, address);
+	return handle_pte_fault(mm, vma, address, pte, pmd, flags);
+}
+
 int do_huge_pmd_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 			       unsigned long address, pmd_t *pmd,
 			       unsigned int flags)
 {
 	struct page *page;
 	unsigned long haddr = address & HPAGE_PMD_MASK;
-	pte_t *pte;
 
 	if (haddr >= vma->vm_start && haddr + HPAGE_PMD_SIZE <= vma->vm_end) {
 		if (unlikely(anon_vma_prepare(vma)))
@@ -697,25 +751,70 @@ int do_huge_pmd_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		return __do_huge_pmd_anonymous_page(mm, vma, haddr, pmd, page);
 	}
 out:
-	/*
-	 * Use __pte_alloc instead of pte_alloc_map, because we can't
-	 * run pte_offset_map on the pmd, if an huge pmd could
-	 * materialize from under us from a different thread.
-	 */
-	if (unlikely(__pte_alloc(mm, vma, pmd, address)))
+	return do_huge_pmd_fallback(mm, vma, address, pmd, flags);
+}
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+/*
+ * Read fault in a read-only file mapping: map the hugepage that the page
+ * cache holds for the aligned range, or assembles from its regular pages,
+ * with a huge pmd.  The pmd is never made writable, a write fault splits
+ * it and copies the subpage on write as usual.
+ */
+int do_huge_pmd_file_page(struct mm_struct *mm, struct vm_area_struct *vma,
+			  unsigned long address, pmd_t *pmd,
+			  unsigned int flags)
+{
+	unsigned long haddr = address & HPAGE_PMD_MASK;
+	pgoff_t index = linear_page_index(vma, haddr);
+	struct page *page;
+	pgtable_t pgtable;
+	pmd_t entry;
+	gfp_t gfp;
+
+	if (haddr < vma->vm_start || haddr + HPAGE_PMD_SIZE > vma->vm_end ||
+	    index & (HPAGE_PMD_NR - 1))
+		goto out;
+
+	/* not movable, the page cache hugepages are not on the LRU */
+	gfp = alloc_hugepage_gfpmask(transparent_hugepage_defrag(vma), 0) &
+		~__GFP_MOVABLE;
+	page = filemap_huge_get_page(vma->vm_file, index, gfp);
+	if (!page)
+		goto out;
+
+	pgtable = pte_alloc_one(mm, haddr);
+	if (unlikely(!pgtable)) {
+		unlock_page(page);
+		put_page(page);
 		return VM_FAULT_OOM;
-	/* if an huge pmd materialized from under us just retry later */
-	if (unlikely(pmd_trans_huge(*pmd)))
+	}
+
+	spin_lock(&mm->page_table_lock);
+	if (unlikely(!pmd_none(*pmd))) {
+		spin_unlock(&mm->page_table_lock);
+		pte_free(mm, pgtable);
+		unlock_page(page);
+		put_page(page);
 		return 0;
-	/*
-	 * A regular pmd is established and it can't morph into a huge pmd
-	 * from under us anymore at this point because we hold the mmap_sem
-	 * read mode and khugepaged takes it in write mode. So now it's
-	 * safe to run pte_offset_map().
-	 */
-	pte = pte_offset_map(pmd, address);
-	return handle_pte_fault(mm, vma, address, pte, pmd, flags);
+	}
+	entry = mk_pmd(page, vma->vm_page_prot);
+	entry = pmd_mkhuge(pmd_mkyoung(entry));
+	/* the reference filemap_huge_get_page() took is the pmd's */
+	page_add_file_rmap(page);
+	set_pmd_at(mm, haddr, pmd, entry);
+	prepare_pmd_huge_pte(pgtable, mm);
+	add_mm_counter(mm, MM_FILEPAGES, HPAGE_PMD_NR);
+	spin_unlock(&mm->page_table_lock);
+
+	SetPageReferenced(page);
+	unlock_page(page);
+	count_vm_event(THP_FILE_MAPPED);
+	return 0;
+out:
+	return do_huge_pmd_fallback(mm, vma, address, pmd, flags);
 }
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE_FILE */
 
 int copy_huge_pmd(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 		  pmd_t *dst_pmd, pmd_t *src_pmd, unsigned long addr,
@@ -753,7 +852,8 @@ int copy_huge_pmd(struct mm_struct *dst_mm, struct mm_struct *src_mm,
 	VM_BUG_ON(!PageHead(src_page));
 	get_page(src_page);
 	page_dup_rmap(src_page);
-	add_mm_counter(dst_mm, MM_ANONPAGES, HPAGE_PMD_NR);
+	add_mm_counter(dst_mm, PageAnon(src_page) ? MM_ANONPAGES : MM_FILEPAGES,
+		       HPAGE_PMD_NR);
 
 	pmdp_set_wrprotect(src_mm, addr, src_pmd);
 	pmd = pmd_mkold(pmd_wrprotect(pmd));
@@ -1014,7 +1114,8 @@ int zap_huge_pmd(struct mmu_gather *tlb, struct vm_area_struct *vma,
 			pmd_clear(pmd);
 			page_remove_rmap(page);
 			VM_BUG_ON(page_mapcount(page) < 0);
-			add_mm_counter(tlb->mm, MM_ANONPAGES, -HPAGE_PMD_NR);
+			add_mm_counter(tlb->mm, PageAnon(page) ?
+				       MM_ANONPAGES : MM_FILEPAGES, -HPAGE_PMD_NR);
 			VM_BUG_ON(!PageHead(page));
 			spin_unlock(&tlb->mm->page_table_lock);
 			tlb_remove_page(tlb, page);
@@ -1414,12 +1515,18 @@ out:
 int hugepage_madvise(struct vm_area_struct *vma,
 		     unsigned long *vm_flags, int advice)
 {
+	unsigned long no_thp = VM_NO_THP;
+
+	/* read-only shared mappings of a file are as good as private ones */
+	if (filemap_huge_vma(vma))
+		no_thp &= ~VM_MAYSHARE;
+
 	switch (advice) {
 	case MADV_HUGEPAGE:
 		/*
 		 * Be somewhat over-protective like KSM for now!
 		 */
-		if (*vm_flags & (VM_HUGEPAGE | VM_NO_THP))
+		if (*vm_flags & (VM_HUGEPAGE | no_thp))
 			return -EINVAL;
 		*vm_flags &= ~VM_NOHUGEPAGE;
 		*vm_flags |= VM_HUGEPAGE;
@@ -1435,7 +1542,7 @@ int hugepage_madvise(struct vm_area_struct *vma,
 		/*
 		 * Be somewhat over-protective like KSM for now!
 		 */
-		if (*vm_flags & (VM_NOHUGEPAGE | VM_NO_THP))
+		if (*vm_flags & (VM_NOHUGEPAGE | no_thp))
 			return -EINVAL;
 		*vm_flags &= ~VM_HUGEPAGE;
 		*vm_flags |= VM_NOHUGEPAGE;
@@ -2300,6 +2407,73 @@ static int khugepaged(void *none)
 	return 0;
 }
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+/*
+ * A huge pmd mapping page cache is split by mapping its subpages with
+ * ptes instead: the hugepage itself stays whole in the page cache.  The
+ * caller holds the mmap_sem, which keeps the vma list stable while we
+ * look for the vma of the pmd.
+ */
+static void __split_file_huge_pmd(struct mm_struct *mm, pmd_t *pmd,
+				  struct page *page)
+{
+	struct vm_area_struct *vma;
+	unsigned long haddr = 0;
+	pgtable_t pgtable;
+	pmd_t orig_pmd, _pmd;
+	int i;
+
+	assert_spin_locked(&mm->page_table_lock);
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (!vma->vm_file || vma->vm_file->f_mapping != page->mapping ||
+		    page->index < vma->vm_pgoff ||
+		    page->index - vma->vm_pgoff >= vma_pages(vma))
+			continue;
+		haddr = vma->vm_start +
+			((page->index - vma->vm_pgoff) << PAGE_SHIFT);
+		if (page_check_address_pmd(page, mm, haddr,
+					   PAGE_CHECK_ADDRESS_PMD_FLAG) == pmd)
+			break;
+	}
+	if (WARN_ON_ONCE(!vma))
+		return;
+
+	orig_pmd = *pmd;
+	pmdp_clear_flush_notify(vma, haddr, pmd);
+	/* leave pmd empty until pte is filled */
+
+	pgtable = get_pmd_huge_pte(mm);
+	pmd_populate(mm, &_pmd, pgtable);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++, haddr += PAGE_SIZE) {
+		pte_t *pte, entry;
+		entry = mk_pte(page + i, vma->vm_page_prot);
+		if (pmd_young(orig_pmd))
+			entry = pte_mkyoung(entry);
+		get_page(page + i);
+		page_add_file_rmap(page + i);
+		pte = pte_offset_map(&_pmd, haddr);
+		VM_BUG_ON(!pte_none(*pte));
+		set_pte_at(mm, haddr, pte, entry);
+		pte_unmap(pte);
+	}
+
+	mm->nr_ptes++;
+	smp_wmb(); /* make pte visible before pmd */
+	pmd_populate(mm, pmd, pgtable);
+	page_remove_rmap(page);
+	/* the subpages hold the hugepage */
+	put_page(page);
+}
+#else
+static inline void __split_file_huge_pmd(struct mm_struct *mm, pmd_t *pmd,
+					 struct page *page)
+{
+	BUG();
+}
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE_FILE */
+
 void __split_huge_page_pmd(struct mm_struct *mm, pmd_t *pmd)
 {
 	struct page *page;
@@ -2311,6 +2485,11 @@ void __split_huge_page_pmd(struct mm_struct *mm, pmd_t *pmd)
 	}
 	page = pmd_page(*pmd);
 	VM_BUG_ON(!page_count(page));
+	if (!PageAnon(page)) {
+		__split_file_huge_pmd(mm, pmd, page);
+		spin_unlock(&mm->page_table_lock);
+		return;
+	}
 	get_page(page);
 	spin_unlock(&mm->page_table_lock);
 
@@ -45,6 +45,45 @@ extern unsigned long highest_memmap_pfn;
 extern int isolate_lru_page(struct page *page);
 extern void putback_lru_page(struct page *page);
 
+/*
+ * in mm/lru_gen.c and mm/swap.c:
+ */
+#ifdef CONFIG_LRU_GEN
+struct pagevec;
+
+extern void lru_gen_init_zone(struct zone *zone);
+extern void lru_gen_age(struct zone *zone);
+extern struct list_head *lru_gen_evict_list(struct zone *zone, int file);
+extern void lru_gen_promote_pages(struct pagevec *pvec);
+
+/*
+ * Aging is due when the oldest generation of a type has been evicted and
+ * it cannot be retired without dropping below MIN_NR_GENS.
+ */
+static inline bool lru_gen_need_aging(struct zone *zone, int file)
+{
+	struct lru_gen *lrugen = &zone->lrugen;
+	unsigned long min_seq = ACCESS_ONCE(lrugen->min_seq[file]);
+
+	if (ACCESS_ONCE(lrugen->max_seq) - min_seq + 1 > MIN_NR_GENS)
+		return false;
+	return list_empty(&lrugen->lists[lru_gen_from_seq(min_seq)][file]);
+}
+#else
+static inline void lru_gen_init_zone(struct zone *zone)
+{
+}
+
+static inline void lru_gen_age(struct zone *zone)
+{
+}
+
+static inline bool lru_gen_need_aging(struct zone *zone, int file)
+{
+	return false;
+}
+#endif
+
 /*
  * in mm/page_alloc.c
  */
@@ -70,6 +109,15 @@ static inline unsigned long page_order(struct page *page)
 void __vma_link_list(struct mm_struct *mm, struct vm_area_struct *vma,
 		struct vm_area_struct *prev, struct rb_node *rb_parent);
 
+/*
+ * in mm/mmap.c:
+ */
+extern void put_vma(struct vm_area_struct *vma);
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+extern struct vm_area_struct *get_speculative_vma(struct mm_struct *mm,
+						  unsigned long addr);
+#endif
+
 #ifdef CONFIG_MMU
 extern long mlock_vma_pages_range(struct vm_area_struct *vma,
 			unsigned long start, unsigned long end);
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/math64.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -100,6 +101,9 @@ struct mm_slot {
  * @address: the next address inside that to be scanned
  * @rmap_list: link to the next rmap to be scanned in the rmap_list
  * @seqnr: count of completed full scans (needed when removing unstable node)
+ * @vma_start: start of the vma being scanned, to notice when we leave it
+ * @vma_scanned: pages of that vma scanned so far in this pass over it
+ * @vma_merged: pages of that vma merged so far in this pass over it
  *
  * There is only the one ksm_scan instance of this cursor structure.
  */
@@ -108,6 +112,9 @@ struct ksm_scan {
 	unsigned long address;
 	struct rmap_item **rmap_list;
 	unsigned long seqnr;
+	unsigned long vma_start;
+	unsigned long vma_scanned;
+	unsigned long vma_merged;
 };
 
 /**
@@ -129,6 +136,8 @@ struct stable_node {
  * @mm: the memory structure this rmap_item is pointing into
  * @address: the virtual address this rmap_item tracks (+ flags in low bits)
  * @oldchecksum: previous checksum of the page at that virtual address
+ * @volatility: number of consecutive scans that found the checksum changed
+ * @skip_scans: number of full scans still to pass over this volatile page
  * @node: rb node of this rmap_item in the unstable tree
  * @head: pointer to stable_node heading this list in the stable tree
  * @hlist: link into hlist of rmap_items hanging off that stable_node
@@ -139,6 +148,8 @@ struct rmap_item {
 	struct mm_struct *mm;
 	unsigned long address;		/* + low bits used for flags below */
 	unsigned int oldchecksum;	/* when unstable */
+	unsigned char volatility;
+	unsigned char skip_scans;
 	union {
 		struct rb_node node;	/* when node of unstable tree */
 		struct {		/* when listed from stable tree */
@@ -189,6 +200,56 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Whether ksmd passes over volatile pages and low yield areas */
+static unsigned int ksm_adaptive_scan = 1;
+
+/* The number of volatile pages passed over without a checksum */
+static unsigned long ksm_pages_skipped;
+
+/* The number of low yield areas passed over in a full scan */
+static unsigned long ksm_vmas_skipped;
+
+/* The number of stable tree searches answered from ksm_stable_hints */
+static unsigned long ksm_stable_hint_hits;
+
+/* The number of pages ksmd has merged */
+static unsigned long ksm_pages_merged;
+
+/* The cpu time ksmd has spent scanning, in nanoseconds */
+static u64 ksm_scan_cpu_ns;
+
+/* Pages merged and cpu time spent: totals at the start of this full scan */
+static unsigned long ksm_scan_start_merged;
+static u64 ksm_scan_start_cpu_ns;
+
+/* Pages merged and cpu time spent in the last completed full scan */
+static unsigned long ksm_last_scan_merged;
+static u64 ksm_last_scan_cpu_ns;
+
+/*
+ * A page whose checksum has changed on n consecutive scans is passed over
+ * for 2^(n-1) - 1 full scans after that, up to KSM_MAX_VOLATILITY.
+ */
+#define KSM_MAX_VOLATILITY	5
+
+/*
+ * An area that merged less than KSM_VMA_LOW_YIELD of each 1000 pages
+ * scanned, on a decaying average, is passed over for 1, 3, 7 and then
+ * KSM_VMA_MAX_BACKOFF full scans, until it yields again.  The first pass
+ * over an area only takes checksums, so it is not rated.
+ */
+#define KSM_VMA_LOW_YIELD	1
+#define KSM_VMA_MAX_BACKOFF	8
+
+/*
+ * Recently found ksm pages by checksum: processes forked from the same
+ * parent, or started from the same binaries, tend to present the same
+ * content again and again, and a hit costs one memcmp instead of a walk
+ * down the stable tree.  Only a hint: the page found there is checked.
+ */
+#define KSM_STABLE_HINTS	1024
+static unsigned long ksm_stable_hints[KSM_STABLE_HINTS];
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -983,10 +1044,45 @@ static struct page *try_to_merge_two_pages(struct rmap_item *rmap_item,
  * This function returns the stable tree node of identical content if found,
  * NULL otherwise.
  */
-static struct page *stable_tree_search(struct page *page)
+static inline unsigned long *stable_hint(u32 checksum)
+{
+	/* the checksum is a jhash already */
+	return &ksm_stable_hints[checksum & (KSM_STABLE_HINTS - 1)];
+}
+
+static struct page *stable_hint_search(struct page *page, u32 checksum)
+{
+	unsigned long kpfn = *stable_hint(checksum);
+	struct page *hint_page, *tree_page = NULL;
+
+	if (!kpfn || !pfn_valid(kpfn))
+		return NULL;
+
+	/*
+	 * Our reference keeps the page from being freed or migrated, so
+	 * if it is a ksm page, its mapping points to a valid stable_node.
+	 */
+	hint_page = pfn_to_page(kpfn);
+	if (!get_page_unless_zero(hint_page))
+		return NULL;
+	if (PageKsm(hint_page))
+		tree_page = get_ksm_page(page_stable_node(hint_page));
+	put_page(hint_page);
+
+	if (tree_page && memcmp_pages(page, tree_page)) {
+		put_page(tree_page);
+		tree_page = NULL;
+	}
+	if (tree_page)
+		ksm_stable_hint_hits++;
+	return tree_page;
+}
+
+static struct page *stable_tree_search(struct page *page, u32 checksum)
 {
 	struct rb_node *node = root_stable_tree.rb_node;
 	struct stable_node *stable_node;
+	struct page *tree_page;
 
 	stable_node = page_stable_node(page);
 	if (stable_node) {			/* ksm page forked */
@@ -994,6 +1090,10 @@ static struct page *stable_tree_search(struct page *page)
 		return page;
 	}
 
+	tree_page = stable_hint_search(page, checksum);
+	if (tree_page)
+		return tree_page;
+
 	while (node) {
 		struct page *tree_page;
 		int ret;
@@ -1012,8 +1112,10 @@ static struct page *stable_tree_search(struct page *page)
 		} else if (ret > 0) {
 			put_page(tree_page);
 			node = node->rb_right;
-		} else
+		} else {
+			*stable_hint(checksum) = stable_node->kpfn;
 			return tree_page;
+		}
 	}
 
 	return NULL;
@@ -1026,7 +1128,8 @@ static struct page *stable_tree_search(struct page *page)
  * This function returns the stable tree node just allocated on success,
  * NULL otherwise.
  */
-static struct stable_node *stable_tree_insert(struct page *kpage)
+static struct stable_node *stable_tree_insert(struct page *kpage,
+					      u32 checksum)
 {
 	struct rb_node **new = &root_stable_tree.rb_node;
 	struct rb_node *parent = NULL;
@@ -1071,6 +1174,7 @@ static struct stable_node *stable_tree_insert(struct page *kpage)
 
 	stable_node->kpfn = page_to_pfn(kpage);
 	set_page_stable_node(kpage, stable_node);
+	*stable_hint(checksum) = stable_node->kpfn;
 
 	return stable_node;
 }
@@ -1157,6 +1261,7 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_sharing++;
 	else
 		ksm_pages_shared++;
+	ksm_pages_merged++;
 }
 
 /*
@@ -1179,8 +1284,17 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	/* A page that keeps changing is not worth its checksum every scan */
+	if (rmap_item->skip_scans && ksm_adaptive_scan) {
+		rmap_item->skip_scans--;
+		ksm_pages_skipped++;
+		return;
+	}
+
+	checksum = calc_checksum(page);
+
 	/* We first start with searching the page inside the stable tree */
-	kpage = stable_tree_search(page);
+	kpage = stable_tree_search(page, checksum);
 	if (kpage) {
 		err = try_to_merge_with_ksm_page(rmap_item, page, kpage);
 		if (!err) {
@@ -1201,12 +1315,17 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * we calculated it, this page is changing frequently: therefore we
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
+	 * If it changes scan after scan, leave it alone for a while: the
+	 * first change says nothing, an rmap_item starts out without one.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
+		if (rmap_item->volatility < KSM_MAX_VOLATILITY)
+			rmap_item->volatility++;
+		rmap_item->skip_scans = (1 << (rmap_item->volatility - 1)) - 1;
 		return;
 	}
+	rmap_item->volatility = 0;
 
 	tree_rmap_item =
 		unstable_tree_search_insert(rmap_item, page, &tree_page);
@@ -1223,7 +1342,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			remove_rmap_item_from_tree(tree_rmap_item);
 
 			lock_page(kpage);
-			stable_node = stable_tree_insert(kpage);
+			stable_node = stable_tree_insert(kpage, checksum);
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
@@ -1272,6 +1391,71 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Fold the pages scanned and merged in the area at ksm_scan.vma_start
+ * into its decaying yield, and decide how many full scans to pass over
+ * it next.  Called with mmap_sem held, when the scan leaves the area.
+ */
+static void ksm_vma_account(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	unsigned long yield;
+
+	if (!ksm_scan.vma_scanned)
+		return;
+
+	vma = find_vma(mm, ksm_scan.vma_start);
+	if (!vma || vma->vm_start != ksm_scan.vma_start)
+		goto out;
+
+	if (!vma->ksm_yield && !vma->ksm_backoff) {
+		/*
+		 * Never rated (a rated area has a yield or a backoff): start
+		 * it at the threshold, so only a barren second pass counts.
+		 */
+		vma->ksm_yield = KSM_VMA_LOW_YIELD;
+	} else {
+		yield = ksm_scan.vma_merged * 1000 / ksm_scan.vma_scanned;
+		yield = min(yield, 1000UL);
+		vma->ksm_yield = (vma->ksm_yield * 3 + yield) / 4;
+		if (vma->ksm_yield < KSM_VMA_LOW_YIELD) {
+			vma->ksm_backoff = min(vma->ksm_backoff * 2 + 1,
+					       KSM_VMA_MAX_BACKOFF);
+			vma->ksm_skip = vma->ksm_backoff;
+		} else
+			vma->ksm_backoff = 0;
+	}
+out:
+	ksm_scan.vma_scanned = 0;
+	ksm_scan.vma_merged = 0;
+}
+
+/*
+ * Pass over a low yield area in this full scan.  Its rmap_items in the
+ * stable tree stay there, but those in the unstable tree would be stale
+ * in the next scan, so take them out as the scan itself would have done;
+ * and free those left behind by areas since unmapped below it.
+ */
+static void ksm_skip_vma(struct vm_area_struct *vma)
+{
+	struct rmap_item *rmap_item;
+
+	while ((rmap_item = *ksm_scan.rmap_list) &&
+	       (rmap_item->address & PAGE_MASK) < vma->vm_end) {
+		if ((rmap_item->address & PAGE_MASK) < vma->vm_start) {
+			*ksm_scan.rmap_list = rmap_item->rmap_list;
+			remove_rmap_item_from_tree(rmap_item);
+			free_rmap_item(rmap_item);
+			continue;
+		}
+		if (rmap_item->address & UNSTABLE_FLAG)
+			remove_rmap_item_from_tree(rmap_item);
+		ksm_scan.rmap_list = &rmap_item->rmap_list;
+	}
+	ksm_scan.address = vma->vm_end;
+	ksm_vmas_skipped++;
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1311,6 +1495,9 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 next_mm:
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
+		ksm_scan.vma_start = -1UL;
+		ksm_scan.vma_scanned = 0;
+		ksm_scan.vma_merged = 0;
 	}
 
 	mm = slot->mm;
@@ -1325,6 +1512,15 @@ next_mm:
 			continue;
 		if (ksm_scan.address < vma->vm_start)
 			ksm_scan.address = vma->vm_start;
+		if (vma->vm_start != ksm_scan.vma_start) {
+			ksm_vma_account(mm);
+			ksm_scan.vma_start = vma->vm_start;
+			if (vma->ksm_skip && ksm_adaptive_scan) {
+				vma->ksm_skip--;
+				ksm_skip_vma(vma);
+				continue;
+			}
+		}
 		if (!vma->anon_vma)
 			ksm_scan.address = vma->vm_end;
 
@@ -1347,6 +1543,7 @@ next_mm:
 					ksm_scan.rmap_list =
 							&rmap_item->rmap_list;
 					ksm_scan.address += PAGE_SIZE;
+					ksm_scan.vma_scanned++;
 				} else
 					put_page(*page);
 				up_read(&mm->mmap_sem);
@@ -1361,7 +1558,8 @@ next_mm:
 	if (ksm_test_exit(mm)) {
 		ksm_scan.address = 0;
 		ksm_scan.rmap_list = &slot->rmap_list;
-	}
+	} else
+		ksm_vma_account(mm);
 	/*
 	 * Nuke all the rmap_items that are above this current rmap:
 	 * because there were no VM_MERGEABLE vmas with such addresses.
@@ -1411,16 +1609,31 @@ static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	unsigned long seqnr = ksm_scan.seqnr;
+	unsigned long merged;
+	u64 runtime = task_sched_runtime(current);
 
 	while (scan_npages-- && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
-		if (!PageKsm(page) || !in_stable_tree(rmap_item))
+			break;
+		if (!PageKsm(page) || !in_stable_tree(rmap_item)) {
+			merged = ksm_pages_merged;
 			cmp_and_merge_page(page, rmap_item);
+			ksm_scan.vma_merged += ksm_pages_merged - merged;
+		}
 		put_page(page);
 	}
+
+	ksm_scan_cpu_ns += task_sched_runtime(current) - runtime;
+	if (ksm_scan.seqnr != seqnr) {
+		/* a full scan completed in this batch: it yielded so much */
+		ksm_last_scan_merged = ksm_pages_merged - ksm_scan_start_merged;
+		ksm_last_scan_cpu_ns = ksm_scan_cpu_ns - ksm_scan_start_cpu_ns;
+		ksm_scan_start_merged = ksm_pages_merged;
+		ksm_scan_start_cpu_ns = ksm_scan_cpu_ns;
+	}
 }
 
 static int ksmd_should_run(void)
@@ -1805,6 +2018,8 @@ static int ksm_memory_callback(struct notifier_block *self,
 		while ((stable_node = ksm_check_stable_tree(mn->start_pfn,
 					mn->start_pfn + mn->nr_pages)) != NULL)
 			remove_node_from_stable_tree(stable_node);
+		/* nor leave hints to memory that may be removed */
+		memset(ksm_stable_hints, 0, sizeof(ksm_stable_hints));
 		/* fallthrough */
 
 	case MEM_CANCEL_OFFLINE:
@@ -1966,6 +2181,80 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t adaptive_scan_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive_scan);
+}
+
+static ssize_t adaptive_scan_store(struct kobject *kobj,
+				   struct kobj_attribute *attr,
+				   const char *buf, size_t count)
+{
+	int err;
+	unsigned long adaptive;
+
+	err = strict_strtoul(buf, 10, &adaptive);
+	if (err || adaptive > 1)
+		return -EINVAL;
+
+	ksm_adaptive_scan = adaptive;
+
+	return count;
+}
+KSM_ATTR(adaptive_scan);
+
+static ssize_t pages_skipped_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_skipped);
+}
+KSM_ATTR_RO(pages_skipped);
+
+static ssize_t vmas_skipped_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_vmas_skipped);
+}
+KSM_ATTR_RO(vmas_skipped);
+
+static ssize_t stable_hint_hits_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_stable_hint_hits);
+}
+KSM_ATTR_RO(stable_hint_hits);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_cpu_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       div_u64(ksm_scan_cpu_ns, NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_cpu_msecs);
+
+static ssize_t merge_yield_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	u64 yield = 0;
+
+	mutex_lock(&ksm_thread_mutex);
+	if (ksm_last_scan_cpu_ns)
+		yield = div64_u64((u64)ksm_last_scan_merged * NSEC_PER_SEC,
+				  ksm_last_scan_cpu_ns);
+	mutex_unlock(&ksm_thread_mutex);
+
+	return sprintf(buf, "%llu\n", yield);
+}
+KSM_ATTR_RO(merge_yield);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -1975,6 +2264,13 @@ static struct attribute *ksm_attrs[] = {
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&adaptive_scan_attr.attr,
+	&pages_skipped_attr.attr,
+	&vmas_skipped_attr.attr,
+	&stable_hint_hits_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_cpu_msecs_attr.attr,
+	&merge_yield_attr.attr,
 	NULL,
 };
 
@@ -0,0 +1,391 @@
+/*
+ * linux/mm/lru_gen.c
+ *
+ * Multi-generational LRU: page aging by page table walks.
+ *
+ * The two list LRU decides what is hot by looking at every page it
+ * deactivates: shrink_active_list() runs page_referenced(), a reverse map
+ * walk, for each mapped page it scans, and it scans a lot of them just to
+ * keep the inactive list at its target size.  Hot pages of an application
+ * that has been in the background for a few seconds easily lose that race.
+ *
+ * The multi-generational LRU instead sorts the evictable pages of a zone
+ * into generations.  New pages join one of the older generations, pages
+ * that are found in use are promoted to the youngest one, and reclaim only
+ * ever takes pages from the oldest generation.  Finding the pages in use is
+ * the job of the aging: it creates a new generation and then walks the page
+ * tables of every process, a batch of PTEs under one lock, clearing the
+ * accessed bits and promoting what was accessed.  Page tables are dense
+ * where rmap is sparse, so one walk costs far less than a page_referenced()
+ * per mapped page.
+ *
+ * Aging is global: one walk covers all zones, so every zone gets a new
+ * generation at the same time.  It runs when a zone has only MIN_NR_GENS
+ * generations left of a type it has to evict from and the oldest of them
+ * is empty.  Pages that are not mapped are promoted by mark_page_accessed()
+ * like they are activated on the two list LRU.
+ *
+ * The engine is selected at boot, with lru_gen= on the command line or
+ * CONFIG_LRU_GEN_ENABLED; see Documentation/vm/multigen_lru.txt.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/sched.h>
+#include <linux/pagevec.h>
+#include <linux/hugetlb.h>
+#include <linux/lru_gen.h>
+#include <linux/vmstat.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/uaccess.h>
+
+#include "internal.h"
+
+#ifdef CONFIG_LRU_GEN_ENABLED
+bool lru_gen_active __read_mostly = true;
+#else
+bool lru_gen_active __read_mostly;
+#endif
+
+static int __init setup_lru_gen(char *str)
+{
+	if (!str)
+		return 0;
+	return strtobool(str, &lru_gen_active);
+}
+early_param("lru_gen", setup_lru_gen);
+
+/* every mm that may map evictable pages, walked by the aging */
+static LIST_HEAD(lru_gen_mm_list);
+static DEFINE_SPINLOCK(lru_gen_mm_lock);
+
+/* one aging pass at a time */
+static DEFINE_MUTEX(lru_gen_age_mutex);
+
+void lru_gen_add_mm(struct mm_struct *mm)
+{
+	if (!lru_gen_enabled())
+		return;
+
+	spin_lock(&lru_gen_mm_lock);
+	list_add_tail(&mm->lru_gen_list, &lru_gen_mm_list);
+	spin_unlock(&lru_gen_mm_lock);
+}
+
+/*
+ * Called from mmput() once the last user is gone.  A walker that got in
+ * before holds mmap_sem for reading; the write lock below waits for it,
+ * so exit_mmap() does not tear down the page tables under its feet.
+ */
+void __lru_gen_del_mm(struct mm_struct *mm)
+{
+	spin_lock(&lru_gen_mm_lock);
+	list_del_init(&mm->lru_gen_list);
+	spin_unlock(&lru_gen_mm_lock);
+
+	down_write(&mm->mmap_sem);
+	up_write(&mm->mmap_sem);
+}
+
+void lru_gen_init_zone(struct zone *zone)
+{
+	struct lru_gen *lrugen = &zone->lrugen;
+	int gen, file;
+
+	for (gen = 0; gen < MAX_NR_GENS; gen++) {
+		for (file = 0; file < 2; file++)
+			INIT_LIST_HEAD(&lrugen->lists[gen][file]);
+		lrugen->timestamps[gen] = jiffies;
+	}
+	lrugen->min_seq[0] = lrugen->min_seq[1] = 0;
+	lrugen->max_seq = MIN_NR_GENS - 1;
+}
+
+/**
+ * lru_gen_evict_list - the list reclaim isolates pages from
+ * @zone: the zone to reclaim from
+ * @file: page type
+ *
+ * Retires the oldest generations of @file that have been evicted, as long
+ * as more than MIN_NR_GENS remain, and returns the list of the oldest one
+ * left.  That may be empty, then lru_gen_need_aging() is true.  Called
+ * with zone->lru_lock held.
+ */
+struct list_head *lru_gen_evict_list(struct zone *zone, int file)
+{
+	struct lru_gen *lrugen = &zone->lrugen;
+	struct list_head *list;
+
+	for (;;) {
+		list = &lrugen->lists[lru_gen_from_seq(lrugen->min_seq[file])][file];
+		if (!list_empty(list) ||
+		    lrugen->max_seq - lrugen->min_seq[file] + 1 <= MIN_NR_GENS)
+			return list;
+		lrugen->min_seq[file]++;
+	}
+}
+
+/*
+ * Start a new youngest generation.  If a type already has MAX_NR_GENS,
+ * its oldest generation is folded into the next one first; the list of
+ * the new generation is then guaranteed to be empty.
+ */
+static void lru_gen_inc_max_seq(struct zone *zone)
+{
+	struct lru_gen *lrugen = &zone->lrugen;
+	int file;
+
+	spin_lock_irq(&zone->lru_lock);
+	for (file = 0; file < 2; file++) {
+		unsigned long min_seq = lrugen->min_seq[file];
+
+		if (lrugen->max_seq - min_seq + 1 < MAX_NR_GENS)
+			continue;
+
+		/* the oldest pages go to the tail, the end evicted first */
+		list_splice_tail_init(
+			&lrugen->lists[lru_gen_from_seq(min_seq)][file],
+			&lrugen->lists[lru_gen_from_seq(min_seq + 1)][file]);
+		lrugen->min_seq[file]++;
+	}
+	lrugen->max_seq++;
+	lrugen->timestamps[lru_gen_from_seq(lrugen->max_seq)] = jiffies;
+	spin_unlock_irq(&zone->lru_lock);
+}
+
+struct lru_gen_walk {
+	struct vm_area_struct	*vma;
+	struct pagevec		pvec;
+	unsigned long		nr_young;
+};
+
+static void lru_gen_walk_add(struct lru_gen_walk *lw, struct page *page)
+{
+	/* racy, the promotion checks again under the lru_lock */
+	if (!PageLRU(page) || PageUnevictable(page))
+		return;
+
+	get_page(page);
+	if (!pagevec_add(&lw->pvec, page))
+		lru_gen_promote_pages(&lw->pvec);
+	lw->nr_young++;
+}
+
+/*
+ * The accessed bits are cleared without a TLB flush.  A CPU that still
+ * has the translation cached will not set the bit again until it drops
+ * that entry, so the page may look cold for a while longer than it is;
+ * page_check_references() still gets a say before it is reclaimed.
+ */
+static int lru_gen_pmd_entry(pmd_t *pmd, unsigned long addr,
+			     unsigned long end, struct mm_walk *walk)
+{
+	struct lru_gen_walk *lw = walk->private;
+	struct vm_area_struct *vma = lw->vma;
+	struct page *page;
+	spinlock_t *ptl;
+	pte_t *pte;
+
+	spin_lock(&walk->mm->page_table_lock);
+	if (pmd_trans_huge(*pmd)) {
+		/*
+		 * Do not wait for a split in progress: the splitter may be
+		 * reclaiming and waiting for this aging pass in turn.
+		 */
+		if (!pmd_trans_splitting(*pmd) &&
+		    pmdp_test_and_clear_young(vma, addr, pmd))
+			lru_gen_walk_add(lw, pmd_page(*pmd));
+		spin_unlock(&walk->mm->page_table_lock);
+		return 0;
+	}
+	spin_unlock(&walk->mm->page_table_lock);
+
+	pte = pte_offset_map_lock(walk->mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		if (!pte_present(*pte) || !pte_young(*pte))
+			continue;
+
+		page = vm_normal_page(vma, addr, *pte);
+		if (!page)
+			continue;
+
+		if (ptep_test_and_clear_young(vma, addr, pte))
+			lru_gen_walk_add(lw, page);
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+	cond_resched();
+	return 0;
+}
+
+static void lru_gen_walk_mm(struct mm_struct *mm, struct lru_gen_walk *lw)
+{
+	struct vm_area_struct *vma;
+	struct mm_walk walk = {
+		.pmd_entry = lru_gen_pmd_entry,
+		.mm = mm,
+		.private = lw,
+	};
+
+	/*
+	 * Reclaim may run with this mm's mmap_sem held for writing, or
+	 * behind a writer queued on it: never wait for it.
+	 */
+	if (!down_read_trylock(&mm->mmap_sem)) {
+		count_vm_event(LRU_GEN_MM_SKIPPED);
+		return;
+	}
+
+	/* exiting, see __lru_gen_del_mm() */
+	if (!atomic_read(&mm->mm_users))
+		goto out;
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		/*
+		 * Pages of sequentially read mappings are used once; they
+		 * are better off in the generation they came in with.
+		 */
+		if (vma->vm_flags & (VM_LOCKED | VM_IO | VM_PFNMAP |
+				     VM_HUGETLB | VM_SEQ_READ))
+			continue;
+
+		lw->vma = vma;
+		walk_page_range(vma->vm_start, vma->vm_end, &walk);
+	}
+out:
+	up_read(&mm->mmap_sem);
+}
+
+/*
+ * Walk every mm on lru_gen_mm_list.  A cursor entry keeps our place while
+ * the lock is dropped; entries before and after it may come and go.
+ */
+static void lru_gen_walk_mms(struct lru_gen_walk *lw)
+{
+	struct list_head cursor;
+	struct mm_struct *mm;
+
+	spin_lock(&lru_gen_mm_lock);
+	list_add(&cursor, &lru_gen_mm_list);
+	while (cursor.next != &lru_gen_mm_list) {
+		mm = list_entry(cursor.next, struct mm_struct, lru_gen_list);
+		list_move(&cursor, &mm->lru_gen_list);
+		/* on the list, so mmput() has not dropped its mm_count yet */
+		atomic_inc(&mm->mm_count);
+		spin_unlock(&lru_gen_mm_lock);
+
+		lru_gen_walk_mm(mm, lw);
+		mmdrop(mm);
+
+		spin_lock(&lru_gen_mm_lock);
+	}
+	list_del(&cursor);
+	spin_unlock(&lru_gen_mm_lock);
+}
+
+static void __lru_gen_age(void)
+{
+	struct lru_gen_walk lw = { .nr_young = 0, };
+	struct zone *zone;
+
+	for_each_populated_zone(zone)
+		lru_gen_inc_max_seq(zone);
+
+	pagevec_init(&lw.pvec, 0);
+	lru_gen_walk_mms(&lw);
+	if (pagevec_count(&lw.pvec))
+		lru_gen_promote_pages(&lw.pvec);
+
+	count_vm_event(LRU_GEN_AGING);
+	count_vm_events(LRU_GEN_PROMOTED, lw.nr_young);
+}
+
+/**
+ * lru_gen_age - create a new generation and promote the pages in use
+ * @zone: the zone reclaim ran out of old generations in
+ *
+ * Reclaimers that find aging due at the same time all end up here; only
+ * the first one walks, the others wait for it and then find @zone has a
+ * new generation.
+ */
+void lru_gen_age(struct zone *zone)
+{
+	unsigned long seq = ACCESS_ONCE(zone->lrugen.max_seq);
+
+	mutex_lock(&lru_gen_age_mutex);
+	if (ACCESS_ONCE(zone->lrugen.max_seq) == seq)
+		__lru_gen_age();
+	mutex_unlock(&lru_gen_age_mutex);
+}
+
+#ifdef CONFIG_DEBUG_FS
+static int lru_gen_show(struct seq_file *m, void *v)
+{
+	struct zone *zone;
+	unsigned long seq;
+	int file;
+
+	for_each_populated_zone(zone) {
+		struct lru_gen *lrugen = &zone->lrugen;
+		unsigned long max_seq, min_seq[2];
+
+		spin_lock_irq(&zone->lru_lock);
+		max_seq = lrugen->max_seq;
+		min_seq[0] = lrugen->min_seq[0];
+		min_seq[1] = lrugen->min_seq[1];
+		spin_unlock_irq(&zone->lru_lock);
+
+		seq_printf(m, "node %d zone %-8s %12s %8s %8s\n",
+			   zone_to_nid(zone), zone->name, "age_ms",
+			   "anon", "file");
+		for (seq = min(min_seq[0], min_seq[1]); seq <= max_seq; seq++) {
+			int gen = lru_gen_from_seq(seq);
+
+			seq_printf(m, "%28lu %12u", seq,
+				   jiffies_to_msecs(jiffies -
+						    lrugen->timestamps[gen]));
+			for (file = 0; file < 2; file++)
+				seq_printf(m, " %8s", seq < min_seq[file] ? "-" :
+					   list_empty(&lrugen->lists[gen][file]) ?
+					   "empty" : "pages");
+			seq_putc(m, '\n');
+		}
+	}
+
+	return 0;
+}
+
+static int lru_gen_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lru_gen_show, NULL);
+}
+
+static ssize_t lru_gen_write(struct file *file, const char __user *buf,
+			     size_t count, loff_t *ppos)
+{
+	/* any write runs an aging pass */
+	mutex_lock(&lru_gen_age_mutex);
+	__lru_gen_age();
+	mutex_unlock(&lru_gen_age_mutex);
+
+	return count;
+}
+
+static const struct file_operations lru_gen_fops = {
+	.open		= lru_gen_open,
+	.read		= seq_read,
+	.write		= lru_gen_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lru_gen_debugfs_init(void)
+{
+	if (!lru_gen_enabled())
+		return 0;
+
+	debugfs_create_file("lru_gen", 0644, NULL, NULL, &lru_gen_fops);
+	return 0;
+}
+late_initcall(lru_gen_debugfs_init);
+#endif /* CONFIG_DEBUG_FS */
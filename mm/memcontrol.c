@@ -40,6 +40,7 @@
 #include <linux/swapops.h>
 #include <linux/spinlock.h>
 #include <linux/eventfd.h>
+#include <linux/vmpressure.h>
 #include <linux/sort.h>
 #include <linux/fs.h>
 #include <linux/seq_file.h>
@@ -270,6 +271,11 @@ struct mem_cgroup {
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
 
+	/* reclaim efficiency, for memory.pressure_level listeners */
+	struct vmpressure vmpressure;
+	/* frees the mem_cgroup once the last reference is gone */
+	struct work_struct work_freeing;
+
 	/*
 	 * Should we move charges of a task when a task is moved into this
 	 * mem_cgroup ? And what type of charges should we move ?
@@ -4547,6 +4553,43 @@ static void mem_cgroup_oom_unregister_event(struct cgroup *cgrp,
 	spin_unlock(&memcg_oom_lock);
 }
 
+struct vmpressure *memcg_to_vmpressure(struct mem_cgroup *mem)
+{
+	if (!mem)
+		mem = root_mem_cgroup;
+	/* reclaim before the root cgroup was set up */
+	if (!mem)
+		return NULL;
+	return &mem->vmpressure;
+}
+
+struct vmpressure *vmpressure_parent(struct vmpressure *vmpr)
+{
+	struct mem_cgroup *mem;
+
+	mem = container_of(vmpr, struct mem_cgroup, vmpressure);
+	mem = parent_mem_cgroup(mem);
+	if (!mem)
+		return NULL;
+	return &mem->vmpressure;
+}
+
+static int mem_cgroup_pressure_register_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd, const char *args)
+{
+	struct mem_cgroup *mem = mem_cgroup_from_cont(cgrp);
+
+	return vmpressure_register_event(&mem->vmpressure, eventfd, args);
+}
+
+static void mem_cgroup_pressure_unregister_event(struct cgroup *cgrp,
+	struct cftype *cft, struct eventfd_ctx *eventfd)
+{
+	struct mem_cgroup *mem = mem_cgroup_from_cont(cgrp);
+
+	vmpressure_unregister_event(&mem->vmpressure, eventfd);
+}
+
 static int mem_cgroup_oom_control_read(struct cgroup *cgrp,
 	struct cftype *cft,  struct cgroup_map_cb *cb)
 {
@@ -4666,6 +4709,11 @@ static struct cftype mem_cgroup_files[] = {
 		.unregister_event = mem_cgroup_oom_unregister_event,
 		.private = MEMFILE_PRIVATE(_OOM_TYPE, OOM_CONTROL),
 	},
+	{
+		.name = "pressure_level",
+		.register_event = mem_cgroup_pressure_register_event,
+		.unregister_event = mem_cgroup_pressure_unregister_event,
+	},
 #ifdef CONFIG_NUMA
 	{
 		.name = "numa_stat",
@@ -4773,6 +4821,7 @@ static struct mem_cgroup *mem_cgroup_alloc(void)
 	if (!mem->stat)
 		goto out_free;
 	spin_lock_init(&mem->pcp_counter_lock);
+	vmpressure_init(&mem->vmpressure);
 	return mem;
 
 out_free:
@@ -4798,6 +4847,7 @@ static void __mem_cgroup_free(struct mem_cgroup *mem)
 {
 	int node;
 
+	vmpressure_cleanup(&mem->vmpressure);
 	mem_cgroup_remove_from_trees(mem);
 	free_css_id(&mem_cgroup_subsys, &mem->css);
 
@@ -4816,13 +4866,27 @@ static void mem_cgroup_get(struct mem_cgroup *mem)
 	atomic_inc(&mem->refcnt);
 }
 
+/*
+ * The last reference can be dropped under rcu_read_lock() or swap_lock
+ * (see mem_cgroup_uncharge_swap()), but freeing has to wait for the
+ * vmpressure work, so do it from a workqueue.
+ */
+static void mem_cgroup_free_work(struct work_struct *work)
+{
+	struct mem_cgroup *mem, *parent;
+
+	mem = container_of(work, struct mem_cgroup, work_freeing);
+	parent = parent_mem_cgroup(mem);
+	__mem_cgroup_free(mem);
+	if (parent)
+		mem_cgroup_put(parent);
+}
+
 static void __mem_cgroup_put(struct mem_cgroup *mem, int count)
 {
 	if (atomic_sub_and_test(count, &mem->refcnt)) {
-		struct mem_cgroup *parent = parent_mem_cgroup(mem);
-		__mem_cgroup_free(mem);
-		if (parent)
-			mem_cgroup_put(parent);
+		INIT_WORK(&mem->work_freeing, mem_cgroup_free_work);
+		schedule_work(&mem->work_freeing);
 	}
 }
 
@@ -57,6 +57,7 @@
 #include <linux/swapops.h>
 #include <linux/elf.h>
 #include <linux/gfp.h>
+#include <linux/file.h>
 
 #include <asm/io.h>
 #include <asm/pgalloc.h>
@@ -1228,7 +1229,12 @@ static inline unsigned long zap_pmd_range(struct mmu_gather *tlb,
 	do {
 		next = pmd_addr_end(addr, end);
 		if (pmd_trans_huge(*pmd)) {
-			if (next-addr != HPAGE_PMD_SIZE) {
+			/*
+			 * A huge pmd of a file mapping only maps page cache,
+			 * so it can go as a whole: truncation zaps without
+			 * the mmap_sem the split needs.
+			 */
+			if (next-addr != HPAGE_PMD_SIZE && !vma->vm_ops) {
 				VM_BUG_ON(!rwsem_is_locked(&tlb->mm->mmap_sem));
 				split_huge_page_pmd(vma->vm_mm, pmd);
 			} else if (zap_huge_pmd(tlb, vma, pmd))
@@ -3465,20 +3471,27 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	pmd = pmd_alloc(mm, pud, address);
 	if (!pmd)
 		return VM_FAULT_OOM;
-	if (pmd_none(*pmd) && transparent_hugepage_enabled(vma)) {
-		if (!vma->vm_ops)
+	if (pmd_none(*pmd)) {
+		if (!vma->vm_ops && transparent_hugepage_enabled(vma))
 			return do_huge_pmd_anonymous_page(mm, vma, address,
 							  pmd, flags);
+		if (!(flags & FAULT_FLAG_WRITE) &&
+		    transparent_hugepage_file_enabled(vma))
+			return do_huge_pmd_file_page(mm, vma, address,
+						     pmd, flags);
 	} else {
 		pmd_t orig_pmd = *pmd;
 		barrier();
 		if (pmd_trans_huge(orig_pmd)) {
-			if (flags & FAULT_FLAG_WRITE &&
-			    !pmd_write(orig_pmd) &&
-			    !pmd_trans_splitting(orig_pmd))
+			if (!(flags & FAULT_FLAG_WRITE) ||
+			    pmd_write(orig_pmd) ||
+			    pmd_trans_splitting(orig_pmd))
+				return 0;
+			if (!vma->vm_ops)
 				return do_huge_pmd_wp_page(mm, vma, address,
 							   pmd, orig_pmd);
-			return 0;
+			/* page cache: copy on write the subpage only */
+			split_huge_page_pmd(mm, pmd);
 		}
 	}
 
@@ -3503,6 +3516,231 @@ int handle_mm_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	return handle_pte_fault(mm, vma, address, pte, pmd, flags);
 }
 
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+/*
+ * Find the pmd of a page table mapping address, without mmap_sem.  The
+ * caller has interrupts disabled, which holds off the TLB flush IPI that
+ * comes before page tables are freed, as in get_user_pages_fast().
+ */
+static pmd_t *spf_walk(struct mm_struct *mm, unsigned long address,
+		       pmd_t *pmdval)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+	pmd_t *pmd;
+
+	pgd = pgd_offset(mm, address);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return NULL;
+	pud = pud_offset(pgd, address);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return NULL;
+	pmd = pmd_offset(pud, address);
+	*pmdval = *pmd;
+	barrier();
+	/* new page tables and huge pmds are left to handle_mm_fault */
+	if (pmd_none(*pmdval) || pmd_trans_huge(*pmdval) ||
+	    unlikely(pmd_bad(*pmdval)))
+		return NULL;
+	return pmd;
+}
+
+/*
+ * Map and lock the pte of address, if the walk still ends at the page
+ * table it found before and the vma has not changed since seq.  Every
+ * change to the vma that matters to the fault is followed by a walk of
+ * its page tables under their locks, so once the check has passed here
+ * the vma cannot change under us until we unlock.
+ */
+static pte_t *spf_pte_map_lock(struct mm_struct *mm,
+			       struct vm_area_struct *vma,
+			       unsigned long address, pmd_t pmdval,
+			       unsigned int seq, spinlock_t **ptlp)
+{
+	spinlock_t *ptl;
+	pmd_t *pmd, cur;
+	pte_t *pte;
+
+	local_irq_disable();
+	pmd = spf_walk(mm, address, &cur);
+	if (!pmd || pmd_val(cur) != pmd_val(pmdval))
+		goto fail;
+	ptl = pte_lockptr(mm, pmd);
+	/* the holder may be waiting for us to take its IPI: don't spin */
+	if (!spin_trylock(ptl))
+		goto fail;
+	if (read_seqcount_retry(&vma->vm_sequence, seq)) {
+		spin_unlock(ptl);
+		goto fail;
+	}
+	pte = pte_offset_map(pmd, address);
+	local_irq_enable();
+
+	*ptlp = ptl;
+	return pte;
+fail:
+	local_irq_enable();
+	return NULL;
+}
+
+/*
+ * Handle a fault on a pte that was never populated without mmap_sem:
+ * anonymous faults, and read faults on mappings of the page cache.  The
+ * fault works on a copy of the vma, taken while its vm_sequence was even
+ * and checked again under the pte lock before the pte is set.  Returns
+ * VM_FAULT_RETRY when the fault has to go through handle_mm_fault()
+ * under mmap_sem, because it races with a change to the vma or is not
+ * one of the simple cases handled here.
+ */
+int handle_speculative_fault(struct mm_struct *mm, unsigned long address,
+			     unsigned int flags)
+{
+	struct vm_area_struct *vma, copy;
+	struct page *page = NULL;
+	struct file *file;
+	bool mapped = false;
+	spinlock_t *ptl;
+	pmd_t *pmd, pmdval;
+	pte_t *pte, entry;
+	unsigned int seq;
+	int major = 0, ret = VM_FAULT_RETRY;
+
+	/* with no mmap_sem to drop there is nothing to retry */
+	flags &= ~(FAULT_FLAG_ALLOW_RETRY | FAULT_FLAG_KILLABLE);
+
+	__set_current_state(TASK_RUNNING);
+	check_sync_rss_stat(current);
+
+	vma = get_speculative_vma(mm, address);
+	if (!vma)
+		goto out;
+	file = vma->vm_file;
+
+	seq = ACCESS_ONCE(vma->vm_sequence.sequence);
+	smp_rmb();
+	if (seq & 1)
+		goto out_put;
+	copy = *vma;
+	if (read_seqcount_retry(&vma->vm_sequence, seq))
+		goto out_put;
+
+	if (address < copy.vm_start || address >= copy.vm_end)
+		goto out_put;
+	if (copy.vm_flags & (VM_HUGETLB | VM_PFNMAP | VM_MIXEDMAP | VM_IO |
+			     VM_NONLINEAR | VM_GROWSDOWN | VM_GROWSUP))
+		goto out_put;
+	if (flags & FAULT_FLAG_WRITE) {
+		if (!(copy.vm_flags & VM_WRITE))
+			goto out_put;
+	} else if (!(copy.vm_flags & (VM_READ | VM_EXEC | VM_WRITE)))
+		goto out_put;
+	/* a policy could be replaced and freed under us */
+	if (vma_policy(&copy))
+		goto out_put;
+	if (copy.vm_ops) {
+		if (copy.vm_ops->fault != filemap_fault || !file ||
+		    (flags & FAULT_FLAG_WRITE))
+			goto out_put;
+	} else if ((flags & FAULT_FLAG_WRITE) && !copy.anon_vma)
+		goto out_put;
+
+	local_irq_disable();
+	pmd = spf_walk(mm, address, &pmdval);
+	if (pmd) {
+		pte = pte_offset_map(&pmdval, address);
+		entry = *pte;
+		pte_unmap(pte);
+	}
+	local_irq_enable();
+	if (!pmd || !pte_none(entry))
+		goto out_put;
+
+	if (!copy.vm_ops && !(flags & FAULT_FLAG_WRITE)) {
+		/* Use the zero-page for reads */
+		entry = pte_mkspecial(pfn_pte(my_zero_pfn(address),
+					      copy.vm_page_prot));
+	} else if (!copy.vm_ops) {
+		page = alloc_zeroed_user_highpage_movable(&copy, address);
+		if (!page)
+			goto out_put;
+		__SetPageUptodate(page);
+		if (mem_cgroup_newpage_charge(page, mm, GFP_KERNEL)) {
+			page_cache_release(page);
+			goto out_put;
+		}
+		entry = mk_pte(page, copy.vm_page_prot);
+		entry = pte_mkwrite(pte_mkdirty(entry));
+	} else {
+		struct vm_fault vmf;
+		int fault;
+
+		vmf.virtual_address = (void __user *)(address & PAGE_MASK);
+		vmf.pgoff = (((address & PAGE_MASK) - copy.vm_start) >>
+			     PAGE_SHIFT) + copy.vm_pgoff;
+		vmf.flags = flags;
+		vmf.page = NULL;
+
+		fault = filemap_fault(&copy, &vmf);
+		if (unlikely(fault & (VM_FAULT_ERROR | VM_FAULT_NOPAGE |
+				      VM_FAULT_RETRY)))
+			goto out_put;
+		page = vmf.page;
+		if (unlikely(!(fault & VM_FAULT_LOCKED)))
+			lock_page(page);
+		if (unlikely(PageHWPoison(page)))
+			goto out_page;
+		flush_icache_page(&copy, page);
+		entry = mk_pte(page, copy.vm_page_prot);
+		major = fault & VM_FAULT_MAJOR;
+	}
+
+	pte = spf_pte_map_lock(mm, vma, address, pmdval, seq, &ptl);
+	if (!pte)
+		goto out_page;
+	/* Only go through if we didn't race with another fault */
+	if (likely(pte_none(*pte))) {
+		if (page && !copy.vm_ops) {
+			inc_mm_counter_fast(mm, MM_ANONPAGES);
+			page_add_new_anon_rmap(page, &copy, address);
+		} else if (page) {
+			inc_mm_counter_fast(mm, MM_FILEPAGES);
+			page_add_file_rmap(page);
+		}
+		set_pte_at(mm, address, pte, entry);
+
+		/* No need to invalidate - it was non-present before */
+		update_mmu_cache(&copy, address, pte);
+		mapped = true;
+	}
+	pte_unmap_unlock(pte, ptl);
+	ret = major;
+
+out_page:
+	if (page) {
+		if (copy.vm_ops)
+			unlock_page(page);
+		if (!mapped) {
+			if (!copy.vm_ops)
+				mem_cgroup_uncharge_page(page);
+			page_cache_release(page);
+		}
+	}
+out_put:
+	if (file)
+		fput(file);
+	put_vma(vma);
+out:
+	if (ret == VM_FAULT_RETRY) {
+		count_vm_event(SPECULATIVE_PGFAULT_ABORT);
+	} else {
+		count_vm_event(PGFAULT);
+		mem_cgroup_count_vm_event(mm, PGFAULT);
+		count_vm_event(SPECULATIVE_PGFAULT);
+	}
+	return ret;
+}
+#endif /* CONFIG_SPECULATIVE_PAGE_FAULT */
+
 #ifndef __PAGETABLE_PUD_FOLDED
 /*
  * Allocate page upper directory.
@@ -0,0 +1,258 @@
+/*
+ * Page allocator benchmark
+ *
+ * Measures the cost of the page allocator fast paths for orders 0 up to
+ * max_order, on one or several CPUs at once:
+ *
+ *   single	alloc_pages() immediately followed by __free_pages()
+ *   batch	nr_batch allocations, then nr_batch frees, so the pcp-lists
+ *		have to be refilled from and drained to the buddy lists
+ *   bulk	alloc_pages_bulk() of nr_batch order-0 pages, then the frees
+ *
+ * Orders above PAGE_ALLOC_COSTLY_ORDER are not cached on the pcp-lists
+ * and show the cost of taking zone->lock for every allocation.  The time
+ * per page of each step is reported through printk.
+ */
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/gfp.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/completion.h>
+#include <linux/math64.h>
+
+#define PAB_MAX_THREADS	8
+#define PAB_MAX_BATCH	512
+
+static unsigned int max_order = PAGE_ALLOC_COSTLY_ORDER + 1;
+module_param(max_order, uint, 0444);
+MODULE_PARM_DESC(max_order, "highest order measured");
+
+static unsigned int threads = 1;
+module_param(threads, uint, 0444);
+MODULE_PARM_DESC(threads, "number of CPUs allocating at once (1-8)");
+
+static unsigned int loops = 100000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "pages allocated per thread and step");
+
+static unsigned int nr_batch = 64;
+module_param(nr_batch, uint, 0444);
+MODULE_PARM_DESC(nr_batch, "pages per batch and bulk call (1-512)");
+
+enum pab_test {
+	PAB_SINGLE,
+	PAB_BATCH,
+	PAB_BULK,
+};
+
+static const char * const pab_test_names[] = {
+	[PAB_SINGLE]	= "single",
+	[PAB_BATCH]	= "batch",
+	[PAB_BULK]	= "bulk",
+};
+
+struct pab_thread {
+	struct page		**pages;
+	u64			ns;
+	unsigned long		done;
+	unsigned long		failed;
+};
+
+static struct pab_thread pab_threads[PAB_MAX_THREADS];
+static enum pab_test pab_test;
+static unsigned int pab_order;
+static DECLARE_COMPLETION(pab_done);
+static struct task_struct *bench_task;
+
+static void pab_single(struct pab_thread *pt)
+{
+	struct page *page;
+	unsigned long i;
+
+	for (i = 0; i < loops; i++) {
+		page = alloc_pages(GFP_KERNEL | __GFP_NOWARN, pab_order);
+		if (!page) {
+			pt->failed++;
+			continue;
+		}
+		__free_pages(page, pab_order);
+		pt->done++;
+	}
+}
+
+static void pab_batch(struct pab_thread *pt)
+{
+	unsigned long i, n;
+
+	for (i = 0; i < loops; i += nr_batch) {
+		for (n = 0; n < nr_batch; n++) {
+			pt->pages[n] = alloc_pages(GFP_KERNEL | __GFP_NOWARN,
+						   pab_order);
+			if (!pt->pages[n]) {
+				pt->failed++;
+				break;
+			}
+		}
+		pt->done += n;
+		while (n--)
+			__free_pages(pt->pages[n], pab_order);
+	}
+}
+
+static void pab_bulk(struct pab_thread *pt)
+{
+	struct page *page, *next;
+	unsigned long i, n;
+	LIST_HEAD(list);
+
+	for (i = 0; i < loops; i += nr_batch) {
+		n = alloc_pages_bulk(GFP_KERNEL | __GFP_NOWARN, nr_batch, &list);
+		pt->failed += nr_batch - n;
+		pt->done += n;
+		list_for_each_entry_safe(page, next, &list, lru) {
+			list_del(&page->lru);
+			__free_page(page);
+		}
+	}
+}
+
+static int pab_worker(void *arg)
+{
+	struct pab_thread *pt = arg;
+	u64 start = local_clock();
+
+	switch (pab_test) {
+	case PAB_SINGLE:
+		pab_single(pt);
+		break;
+	case PAB_BATCH:
+		pab_batch(pt);
+		break;
+	case PAB_BULK:
+		pab_bulk(pt);
+		break;
+	}
+	pt->ns = local_clock() - start;
+
+	/* not a single instruction of this module after the completion */
+	complete_and_exit(&pab_done, 0);
+}
+
+static void pab_run(enum pab_test test, unsigned int order)
+{
+	unsigned long done = 0, failed = 0;
+	u64 ns = 0;
+	unsigned int i, started = 0;
+	int cpu = -1;
+
+	pab_test = test;
+	pab_order = order;
+	for (i = 0; i < threads; i++) {
+		pab_threads[i].ns = 0;
+		pab_threads[i].done = 0;
+		pab_threads[i].failed = 0;
+	}
+
+	INIT_COMPLETION(pab_done);
+	for (i = 0; i < threads; i++) {
+		struct task_struct *p;
+
+		p = kthread_create(pab_worker, &pab_threads[i],
+				   "page_alloc_bench/%u", i);
+		if (IS_ERR(p))
+			continue;
+		/* one thread per CPU, so they contend for the zone */
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		kthread_bind(p, cpu);
+		wake_up_process(p);
+		started++;
+	}
+	while (started--)
+		wait_for_completion(&pab_done);
+
+	for (i = 0; i < threads; i++) {
+		ns += pab_threads[i].ns;
+		done += pab_threads[i].done;
+		failed += pab_threads[i].failed;
+	}
+
+	printk(KERN_INFO "page_alloc_bench: %-6s order=%u threads=%u "
+	       "ns/page=%llu failed=%lu\n", pab_test_names[test], order,
+	       threads, div64_u64(ns, done ?: 1), failed);
+}
+
+static int page_alloc_bench_main(void *arg)
+{
+	unsigned int order;
+
+	for (order = 0; order <= max_order && !kthread_should_stop(); order++) {
+		pab_run(PAB_SINGLE, order);
+		pab_run(PAB_BATCH, order);
+		if (!order)
+			pab_run(PAB_BULK, order);
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+static void pab_free_arrays(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < PAB_MAX_THREADS; i++)
+		kfree(pab_threads[i].pages);
+}
+
+static int __init page_alloc_bench_init(void)
+{
+	unsigned int i;
+
+	if (max_order >= MAX_ORDER)
+		max_order = MAX_ORDER - 1;
+	if (!threads || threads > min_t(unsigned int, PAB_MAX_THREADS,
+					num_online_cpus()))
+		threads = min_t(unsigned int, PAB_MAX_THREADS,
+				num_online_cpus());
+	if (!nr_batch || nr_batch > PAB_MAX_BATCH)
+		nr_batch = 64;
+
+	for (i = 0; i < threads; i++) {
+		pab_threads[i].pages = kmalloc(nr_batch * sizeof(struct page *),
+					       GFP_KERNEL);
+		if (!pab_threads[i].pages) {
+			pab_free_arrays();
+			return -ENOMEM;
+		}
+	}
+
+	bench_task = kthread_run(page_alloc_bench_main, NULL,
+				 "page_alloc_bench");
+	if (IS_ERR(bench_task)) {
+		pab_free_arrays();
+		return PTR_ERR(bench_task);
+	}
+
+	return 0;
+}
+
+static void __exit page_alloc_bench_exit(void)
+{
+	kthread_stop(bench_task);
+	pab_free_arrays();
+}
+
+module_init(page_alloc_bench_init);
+module_exit(page_alloc_bench_exit);
+
+MODULE_DESCRIPTION("page allocator benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,141 @@
+/*
+ * Slab bulk allocation benchmark
+ *
+ * Measures the cost per object of getting objects from and returning
+ * them to a kmem cache, for batch sizes 1, 2, 4, ... up to max_batch:
+ *
+ *   single	batch calls of kmem_cache_alloc(), then batch calls of
+ *		kmem_cache_free()
+ *   bulk	one kmem_cache_alloc_bulk() and one kmem_cache_free_bulk()
+ *		of batch objects
+ *
+ * The objects are object_size bytes from a cache of their own, which
+ * the allocator may merge with a kmalloc cache of the same size.  The
+ * time per object of each run is reported through printk.
+ */
+#include <linux/kthread.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/math64.h>
+
+#define SBB_MAX_BATCH	64
+
+static unsigned int object_size = 256;
+module_param(object_size, uint, 0444);
+MODULE_PARM_DESC(object_size, "size of the objects");
+
+static unsigned int max_batch = SBB_MAX_BATCH;
+module_param(max_batch, uint, 0444);
+MODULE_PARM_DESC(max_batch, "largest batch measured (1-64)");
+
+static unsigned int loops = 1000000;
+module_param(loops, uint, 0444);
+MODULE_PARM_DESC(loops, "objects allocated per run");
+
+static struct kmem_cache *sbb_cache;
+static struct task_struct *bench_task;
+static void *sbb_objs[SBB_MAX_BATCH];
+
+static unsigned long sbb_single(unsigned int batch)
+{
+	unsigned long i, done = 0;
+	unsigned int n;
+
+	for (i = 0; i < loops; i += batch) {
+		for (n = 0; n < batch; n++) {
+			sbb_objs[n] = kmem_cache_alloc(sbb_cache, GFP_KERNEL);
+			if (!sbb_objs[n])
+				break;
+		}
+		done += n;
+		while (n--)
+			kmem_cache_free(sbb_cache, sbb_objs[n]);
+	}
+	return done;
+}
+
+static unsigned long sbb_bulk(unsigned int batch)
+{
+	unsigned long i, done = 0;
+
+	for (i = 0; i < loops; i += batch) {
+		if (!kmem_cache_alloc_bulk(sbb_cache, GFP_KERNEL, batch,
+					   sbb_objs))
+			continue;
+		done += batch;
+		kmem_cache_free_bulk(sbb_cache, batch, sbb_objs);
+	}
+	return done;
+}
+
+static void sbb_run(unsigned int batch)
+{
+	unsigned long single, bulk;
+	u64 t0, t1, t2;
+
+	t0 = local_clock();
+	single = sbb_single(batch);
+	t1 = local_clock();
+	bulk = sbb_bulk(batch);
+	t2 = local_clock();
+
+	printk(KERN_INFO "slab_bulk_bench: size=%u batch=%-2u "
+	       "single ns/obj=%llu bulk ns/obj=%llu\n", object_size, batch,
+	       div64_u64(t1 - t0, single ?: 1), div64_u64(t2 - t1, bulk ?: 1));
+}
+
+static int slab_bulk_bench_main(void *arg)
+{
+	unsigned int batch;
+
+	for (batch = 1; batch <= max_batch && !kthread_should_stop();
+	     batch *= 2) {
+		sbb_run(batch);
+		cond_resched();
+	}
+
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+	return 0;
+}
+
+static int __init slab_bulk_bench_init(void)
+{
+	if (!max_batch || max_batch > SBB_MAX_BATCH)
+		max_batch = SBB_MAX_BATCH;
+	if (!object_size)
+		object_size = 256;
+	if (!loops)
+		loops = 1000000;
+
+	sbb_cache = kmem_cache_create("slab_bulk_bench", object_size, 0, 0,
+				      NULL);
+	if (!sbb_cache)
+		return -ENOMEM;
+
+	bench_task = kthread_run(slab_bulk_bench_main, NULL,
+				 "slab_bulk_bench");
+	if (IS_ERR(bench_task)) {
+		kmem_cache_destroy(sbb_cache);
+		return PTR_ERR(bench_task);
+	}
+
+	return 0;
+}
+
+static void __exit slab_bulk_bench_exit(void)
+{
+	kthread_stop(bench_task);
+	kmem_cache_destroy(sbb_cache);
+}
+
+module_init(slab_bulk_bench_init);
+module_exit(slab_bulk_bench_exit);
+
+MODULE_DESCRIPTION("slab bulk allocation benchmark");
+MODULE_LICENSE("GPL");
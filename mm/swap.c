@@ -213,7 +213,7 @@ static void pagevec_move_tail_fn(struct page *page, void *arg)
 
 	if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
 		enum lru_list lru = page_lru_base_type(page);
-		list_move_tail(&page->lru, &zone->lru[lru].list);
+		list_move_tail(&page->lru, lru_reclaim_head(zone, lru));
 		mem_cgroup_rotate_reclaimable_page(page);
 		(*pgmoved)++;
 	}
@@ -290,6 +290,33 @@ static void __activate_page(struct page *page, void *arg)
 	}
 }
 
+#ifdef CONFIG_LRU_GEN
+static void lru_gen_promote_fn(struct page *page, void *arg)
+{
+	struct zone *zone = page_zone(page);
+
+	if (!PageLRU(page) || PageUnevictable(page))
+		return;
+
+	if (!PageActive(page)) {
+		__activate_page(page, NULL);
+		return;
+	}
+
+	list_move(&page->lru, lru_add_head(zone, page_lru(page)));
+	mem_cgroup_rotate_lru_list(page, page_lru(page));
+}
+
+/*
+ * Move pages the aging found young to the youngest generation of their
+ * zone, see mm/lru_gen.c.  Drops the references held by @pvec.
+ */
+void lru_gen_promote_pages(struct pagevec *pvec)
+{
+	pagevec_lru_move_fn(pvec, lru_gen_promote_fn, NULL);
+}
+#endif
+
 #ifdef CONFIG_SMP
 static DEFINE_PER_CPU(struct pagevec, activate_page_pvecs);
 
@@ -457,7 +484,7 @@ static void lru_deactivate_fn(struct page *page, void *arg)
 		 * The page's writeback ends up during pagevec
 		 * We moves tha page into tail of inactive.
 		 */
-		list_move_tail(&page->lru, &zone->lru[lru].list);
+		list_move_tail(&page->lru, lru_reclaim_head(zone, lru));
 		mem_cgroup_rotate_reclaimable_page(page);
 		__count_vm_event(PGROTATED);
 	}
@@ -661,7 +688,7 @@ void lru_add_page_tail(struct zone* zone,
 		if (likely(PageLRU(page)))
 			head = page->lru.prev;
 		else
-			head = &zone->lru[lru].list;
+			head = lru_add_head(zone, lru);
 		__add_page_to_lru_list(zone, page_tail, lru, head);
 	} else {
 		SetPageUnevictable(page_tail);
@@ -233,6 +233,9 @@ void truncate_inode_pages_range(struct address_space *mapping,
 			if (index > end)
 				break;
 
+			/* hugepages go as a whole in the second pass */
+			if (PageFileHuge(page))
+				continue;
 			if (!trylock_page(page))
 				continue;
 			WARN_ON(page->index != index);
@@ -282,6 +285,10 @@ void truncate_inode_pages_range(struct address_space *mapping,
 			if (index > end)
 				break;
 
+			if (PageFileHuge(page)) {
+				filemap_huge_invalidate(mapping, page, 1);
+				continue;
+			}
 			lock_page(page);
 			WARN_ON(page->index != index);
 			wait_on_page_writeback(page);
@@ -356,6 +363,10 @@ unsigned long invalidate_mapping_pages(struct address_space *mapping,
 			if (index > end)
 				break;
 
+			if (PageFileHuge(page)) {
+				count += filemap_huge_invalidate(mapping, page, 0);
+				continue;
+			}
 			if (!trylock_page(page))
 				continue;
 			WARN_ON(page->index != index);
@@ -458,6 +469,10 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 			if (index > end)
 				break;
 
+			if (PageFileHuge(page)) {
+				filemap_huge_invalidate(mapping, page, 1);
+				continue;
+			}
 			lock_page(page);
 			WARN_ON(page->index != index);
 			if (page->mapping != mapping) {
@@ -254,8 +254,9 @@ struct vmap_area {
 	unsigned long va_end;
 	unsigned long flags;
 	struct rb_node rb_node;		/* address sorted rbtree */
+	unsigned long subtree_max_gap;	/* largest hole below an area of the subtree */
 	struct list_head list;		/* address sorted list */
-	struct list_head purge_list;	/* "lazy purge" list */
+	struct list_head purge_list;	/* "lazy purge" list, or vmap_area_cache */
 	void *private;
 	struct rcu_head rcu_head;
 };
@@ -264,14 +265,84 @@ static DEFINE_SPINLOCK(vmap_area_lock);
 static LIST_HEAD(vmap_area_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 
-/* The vmap cache globals are protected by vmap_area_lock */
-static struct rb_node *free_vmap_cache;
-static unsigned long cached_hole_size;
-static unsigned long cached_vstart;
-static unsigned long cached_align;
-
 static unsigned long vmap_area_pcpu_hole;
 
+/*
+ * Small vmalloc areas, guard page included, that were purged are kept on
+ * the freeing cpu for a while, so the next vmalloc of the same size needs
+ * neither vmap_area_lock nor a search of the tree.  The cached areas stay
+ * in the tree and are unmapped and flushed, they only are handed back to
+ * the tree when an allocation fails.
+ */
+#define VMAP_CACHE_PAGES	16	/* largest area cached, in pages */
+#define VMAP_CACHE_DEPTH	8	/* areas cached per size and cpu */
+
+struct vmap_area_cache {
+	spinlock_t lock;
+	unsigned int nr[VMAP_CACHE_PAGES];
+	struct list_head free[VMAP_CACHE_PAGES];
+	unsigned long hits;
+	unsigned long misses;
+};
+
+static DEFINE_PER_CPU(struct vmap_area_cache, vmap_area_cache);
+
+/* Statistics of the lazy purges, protected by purge_lock */
+static struct {
+	unsigned long passes;
+	unsigned long areas;
+	unsigned long pages;
+	unsigned long flushes;		/* flush_tlb_kernel_range() calls */
+	unsigned long flush_pages;	/* pages covered by them */
+	unsigned long span_flushes;	/* too many ranges, flushed as one */
+} vmap_purge_stats;
+
+/* Start of the hole below @va: the end of the previous area */
+static unsigned long va_gap_start(struct vmap_area *va)
+{
+	if (va->list.prev == &vmap_area_list)
+		return 0;
+	return list_entry(va->list.prev, struct vmap_area, list)->va_end;
+}
+
+static unsigned long va_subtree_max_gap(struct rb_node *n)
+{
+	return n ? rb_entry(n, struct vmap_area, rb_node)->subtree_max_gap : 0;
+}
+
+/*
+ * Update subtree_max_gap of a node from its own hole and its children.
+ * The hole of an area depends on the previous one in address order, so
+ * the list must be up to date before this runs.
+ */
+static void vmap_area_augment_cb(struct rb_node *node, void *unused)
+{
+	struct vmap_area *va = rb_entry(node, struct vmap_area, rb_node);
+	unsigned long max_gap = va->va_start - va_gap_start(va);
+
+	max_gap = max(max_gap, va_subtree_max_gap(node->rb_left));
+	max_gap = max(max_gap, va_subtree_max_gap(node->rb_right));
+	va->subtree_max_gap = max_gap;
+}
+
+/* The hole below @va changed size, fix up the path to the root */
+static void vmap_area_augment_path(struct vmap_area *va)
+{
+	struct rb_node *node = &va->rb_node;
+
+	while (node) {
+		vmap_area_augment_cb(node, NULL);
+		node = rb_parent(node);
+	}
+}
+
+static struct vmap_area *va_next(struct vmap_area *va)
+{
+	if (va->list.next == &vmap_area_list)
+		return NULL;
+	return list_entry(va->list.next, struct vmap_area, list);
+}
+
 static struct vmap_area *__find_vmap_area(unsigned long addr)
 {
 	struct rb_node *n = vmap_area_root.rb_node;
@@ -296,6 +367,7 @@ static void __insert_vmap_area(struct vmap_area *va)
 	struct rb_node **p = &vmap_area_root.rb_node;
 	struct rb_node *parent = NULL;
 	struct rb_node *tmp;
+	struct vmap_area *next;
 
 	while (*p) {
 		struct vmap_area *tmp_va;
@@ -321,10 +393,180 @@ static void __insert_vmap_area(struct vmap_area *va)
 		list_add_rcu(&va->list, &prev->list);
 	} else
 		list_add_rcu(&va->list, &vmap_area_list);
+
+	rb_augment_insert(&va->rb_node, vmap_area_augment_cb, NULL);
+	/* the new area ate into the hole below the next one */
+	next = va_next(va);
+	if (next)
+		vmap_area_augment_path(next);
+}
+
+/*
+ * Find the lowest address of a hole of @size bytes, aligned to @align,
+ * within @vstart and @vend.  Subtrees without a hole of @size, and left
+ * subtrees that end below @vstart, are skipped, so this is O(log n) but
+ * for alignment failures.  Returns @vend when there is no such hole.
+ */
+static unsigned long find_vmap_lowest_match(unsigned long size,
+				unsigned long align,
+				unsigned long vstart, unsigned long vend)
+{
+	struct rb_node *n = vmap_area_root.rb_node;
+	struct vmap_area *va;
+	unsigned long addr;
+
+	if (!n || va_subtree_max_gap(n) < size)
+		goto check_highest;
+
+	va = rb_entry(n, struct vmap_area, rb_node);
+	while (true) {
+		/* visit the left subtree if it looks promising */
+		if (va->va_start > vstart &&
+		    va_subtree_max_gap(va->rb_node.rb_left) >= size) {
+			va = rb_entry(va->rb_node.rb_left,
+				      struct vmap_area, rb_node);
+			continue;
+		}
+
+check_current:
+		/* the hole right below va */
+		addr = ALIGN(max(va_gap_start(va), vstart), align);
+		if (addr >= vend || addr + size - 1 < addr)
+			return vend;
+		if (addr + size <= va->va_start)
+			return addr + size <= vend ? addr : vend;
+
+		/* visit the right subtree if it looks promising */
+		if (va_subtree_max_gap(va->rb_node.rb_right) >= size) {
+			va = rb_entry(va->rb_node.rb_right,
+				      struct vmap_area, rb_node);
+			continue;
+		}
+
+		/* go back up to the next area in address order */
+		while (true) {
+			struct rb_node *prev = &va->rb_node;
+
+			if (!rb_parent(prev))
+				goto check_highest;
+			va = rb_entry(rb_parent(prev), struct vmap_area, rb_node);
+			if (prev == va->rb_node.rb_left)
+				goto check_current;
+		}
+	}
+
+check_highest:
+	/* the hole above the last area */
+	addr = 0;
+	if (!list_empty(&vmap_area_list))
+		addr = list_entry(vmap_area_list.prev,
+				  struct vmap_area, list)->va_end;
+	addr = ALIGN(max(addr, vstart), align);
+	if (addr + size - 1 < addr || addr + size > vend)
+		return vend;
+	return addr;
 }
 
 static void purge_vmap_area_lazy(void);
 
+static bool vmap_cache_sized(unsigned long start, unsigned long end)
+{
+	return end - start <= VMAP_CACHE_PAGES * PAGE_SIZE &&
+		start >= VMALLOC_START && end <= VMALLOC_END;
+}
+
+/*
+ * Take an area of @size from the cache of this cpu.  Only plain vmalloc
+ * space requests can be served from it, cached areas are page aligned.
+ */
+static struct vmap_area *vmap_cache_get(unsigned long size,
+				unsigned long align,
+				unsigned long vstart, unsigned long vend)
+{
+	struct vmap_area_cache *vac;
+	struct vmap_area *va = NULL;
+	unsigned int idx;
+
+	if (vstart != VMALLOC_START || vend != VMALLOC_END ||
+	    align > PAGE_SIZE || size > VMAP_CACHE_PAGES * PAGE_SIZE)
+		return NULL;
+
+	idx = (size >> PAGE_SHIFT) - 1;
+	vac = &get_cpu_var(vmap_area_cache);
+	spin_lock(&vac->lock);
+	if (vac->nr[idx]) {
+		va = list_first_entry(&vac->free[idx],
+				      struct vmap_area, purge_list);
+		list_del(&va->purge_list);
+		vac->nr[idx]--;
+		vac->hits++;
+	} else
+		vac->misses++;
+	spin_unlock(&vac->lock);
+	put_cpu_var(vmap_area_cache);
+
+	return va;
+}
+
+/*
+ * Keep a purged area on this cpu instead of freeing it, if it is small
+ * and there is room.  It stays in the tree, so nobody else can have it.
+ */
+static bool vmap_cache_put(struct vmap_area *va)
+{
+	struct vmap_area_cache *vac;
+	unsigned int idx;
+	bool cached = false;
+
+	if (!vmap_cache_sized(va->va_start, va->va_end))
+		return false;
+
+	idx = ((va->va_end - va->va_start) >> PAGE_SHIFT) - 1;
+	vac = &get_cpu_var(vmap_area_cache);
+	spin_lock(&vac->lock);
+	if (vac->nr[idx] < VMAP_CACHE_DEPTH) {
+		va->flags = 0;
+		va->private = NULL;
+		list_add(&va->purge_list, &vac->free[idx]);
+		vac->nr[idx]++;
+		cached = true;
+	}
+	spin_unlock(&vac->lock);
+	put_cpu_var(vmap_area_cache);
+
+	return cached;
+}
+
+static void __free_vmap_area(struct vmap_area *va);
+
+/* Hand all cached areas back to the tree, to make room for a failed alloc */
+static void vmap_cache_drain_all(void)
+{
+	struct vmap_area *va, *n_va;
+	LIST_HEAD(drain);
+	unsigned int idx;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_area_cache *vac = &per_cpu(vmap_area_cache, cpu);
+
+		spin_lock(&vac->lock);
+		for (idx = 0; idx < VMAP_CACHE_PAGES; idx++) {
+			list_splice_init(&vac->free[idx], &drain);
+			vac->nr[idx] = 0;
+		}
+		spin_unlock(&vac->lock);
+	}
+
+	if (list_empty(&drain))
+		return;
+
+	spin_lock(&vmap_area_lock);
+	list_for_each_entry_safe(va, n_va, &drain, purge_list)
+		__free_vmap_area(va);
+	spin_unlock(&vmap_area_lock);
+}
+
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
  * vstart and vend.
@@ -335,15 +577,17 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 				int node, gfp_t gfp_mask)
 {
 	struct vmap_area *va;
-	struct rb_node *n;
 	unsigned long addr;
 	int purged = 0;
-	struct vmap_area *first;
 
 	BUG_ON(!size);
 	BUG_ON(size & ~PAGE_MASK);
 	BUG_ON(!is_power_of_2(align));
 
+	va = vmap_cache_get(size, align, vstart, vend);
+	if (va)
+		return va;
+
 	va = kmalloc_node(sizeof(struct vmap_area),
 			gfp_mask & GFP_RECLAIM_MASK, node);
 	if (unlikely(!va))
@@ -351,84 +595,14 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 
 retry:
 	spin_lock(&vmap_area_lock);
-	/*
-	 * Invalidate cache if we have more permissive parameters.
-	 * cached_hole_size notes the largest hole noticed _below_
-	 * the vmap_area cached in free_vmap_cache: if size fits
-	 * into that hole, we want to scan from vstart to reuse
-	 * the hole instead of allocating above free_vmap_cache.
-	 * Note that __free_vmap_area may update free_vmap_cache
-	 * without updating cached_hole_size or cached_align.
-	 */
-	if (!free_vmap_cache ||
-			size < cached_hole_size ||
-			vstart < cached_vstart ||
-			align < cached_align) {
-nocache:
-		cached_hole_size = 0;
-		free_vmap_cache = NULL;
-	}
-	/* record if we encounter less permissive parameters */
-	cached_vstart = vstart;
-	cached_align = align;
-
-	/* find starting point for our search */
-	if (free_vmap_cache) {
-		first = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-		addr = ALIGN(first->va_end, align);
-		if (addr < vstart)
-			goto nocache;
-		if (addr + size - 1 < addr)
-			goto overflow;
-
-	} else {
-		addr = ALIGN(vstart, align);
-		if (addr + size - 1 < addr)
-			goto overflow;
-
-		n = vmap_area_root.rb_node;
-		first = NULL;
-
-		while (n) {
-			struct vmap_area *tmp;
-			tmp = rb_entry(n, struct vmap_area, rb_node);
-			if (tmp->va_end >= addr) {
-				first = tmp;
-				if (tmp->va_start <= addr)
-					break;
-				n = n->rb_left;
-			} else
-				n = n->rb_right;
-		}
-
-		if (!first)
-			goto found;
-	}
-
-	/* from the starting point, walk areas until a suitable hole is found */
-	while (addr + size > first->va_start && addr + size <= vend) {
-		if (addr + cached_hole_size < first->va_start)
-			cached_hole_size = first->va_start - addr;
-		addr = ALIGN(first->va_end, align);
-		if (addr + size - 1 < addr)
-			goto overflow;
-
-		n = rb_next(&first->rb_node);
-		if (n)
-			first = rb_entry(n, struct vmap_area, rb_node);
-		else
-			goto found;
-	}
-
-found:
-	if (addr + size > vend)
+	addr = find_vmap_lowest_match(size, align, vstart, vend);
+	if (addr == vend)
 		goto overflow;
 
 	va->va_start = addr;
 	va->va_end = addr + size;
 	va->flags = 0;
 	__insert_vmap_area(va);
-	free_vmap_cache = &va->rb_node;
 	spin_unlock(&vmap_area_lock);
 
 	BUG_ON(va->va_start & (align-1));
@@ -454,26 +628,20 @@ overflow:
 
 static void __free_vmap_area(struct vmap_area *va)
 {
+	struct vmap_area *next;
+	struct rb_node *deepest;
+
 	BUG_ON(RB_EMPTY_NODE(&va->rb_node));
 
-	if (free_vmap_cache) {
-		if (va->va_end < cached_vstart) {
-			free_vmap_cache = NULL;
-		} else {
-			struct vmap_area *cache;
-			cache = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-			if (va->va_start <= cache->va_start) {
-				free_vmap_cache = rb_prev(&va->rb_node);
-				/*
-				 * We don't try to update cached_hole_size or
-				 * cached_align, but it won't go very wrong.
-				 */
-			}
-		}
-	}
+	next = va_next(va);
+	deepest = rb_augment_erase_begin(&va->rb_node);
 	rb_erase(&va->rb_node, &vmap_area_root);
 	RB_CLEAR_NODE(&va->rb_node);
 	list_del_rcu(&va->list);
+	rb_augment_erase_end(deepest, vmap_area_augment_cb, NULL);
+	/* the hole below the next area grew by this one */
+	if (next)
+		vmap_area_augment_path(next);
 
 	/*
 	 * Track the highest possible candidate for pcpu area
@@ -565,10 +733,72 @@ void set_iounmap_nonlazy(void)
 	atomic_set(&vmap_lazy_nr, lazy_max_pages()+1);
 }
 
+/*
+ * Lazily freed areas are scattered all over the vmalloc space, and one
+ * flush from the lowest to the highest of them makes architectures that
+ * flush page by page walk all the holes in between.  Areas closer than
+ * VMAP_PURGE_MERGE_GAP are flushed as one range; if that still leaves
+ * more than VMAP_PURGE_MAX_RANGES ranges, the whole span is flushed at
+ * once as before.
+ */
+#define VMAP_PURGE_MERGE_GAP	(32UL * PAGE_SIZE)
+#define VMAP_PURGE_MAX_RANGES	16
+
+/* Purged areas freed per hold of vmap_area_lock */
+#define VMAP_PURGE_BATCH	32
+
+struct vmap_flush_range {
+	unsigned long start;
+	unsigned long end;
+};
+
+static void vmap_flush_ranges(struct vmap_flush_range *ranges, int nr,
+			      unsigned long start, unsigned long end)
+{
+	int i;
+
+	if (nr > VMAP_PURGE_MAX_RANGES) {
+		flush_tlb_kernel_range(start, end);
+		vmap_purge_stats.flushes++;
+		vmap_purge_stats.flush_pages += (end - start) >> PAGE_SHIFT;
+		vmap_purge_stats.span_flushes++;
+		return;
+	}
+
+	for (i = 0; i < nr; i++) {
+		flush_tlb_kernel_range(ranges[i].start, ranges[i].end);
+		vmap_purge_stats.flushes++;
+		vmap_purge_stats.flush_pages +=
+			(ranges[i].end - ranges[i].start) >> PAGE_SHIFT;
+	}
+}
+
+/*
+ * Add [start, end) to the flush ranges, sorted input merges with the last
+ * range.  Returns the new number of ranges, which may exceed the array.
+ */
+static int vmap_add_flush_range(struct vmap_flush_range *ranges, int nr,
+				unsigned long start, unsigned long end)
+{
+	if (nr && nr <= VMAP_PURGE_MAX_RANGES &&
+	    start <= ranges[nr - 1].end + VMAP_PURGE_MERGE_GAP &&
+	    end >= ranges[nr - 1].start) {
+		ranges[nr - 1].start = min(ranges[nr - 1].start, start);
+		ranges[nr - 1].end = max(ranges[nr - 1].end, end);
+		return nr;
+	}
+	if (nr < VMAP_PURGE_MAX_RANGES) {
+		ranges[nr].start = start;
+		ranges[nr].end = end;
+	}
+	return min(nr + 1, VMAP_PURGE_MAX_RANGES + 1);
+}
+
 /*
  * Purges all lazily-freed vmap areas.
  *
- * If sync is 0 then don't purge if there is already a purge in progress.
+ * If sync is 0 then don't purge if there is already a purge in progress,
+ * and keep small purged areas in the per-cpu caches.
  * If force_flush is 1, then flush kernel TLBs between *start and *end even
  * if we found no lazy vmap areas to unmap (callers can use this to optimise
  * their own TLB flushing).
@@ -579,10 +809,11 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 					int sync, int force_flush)
 {
 	static DEFINE_SPINLOCK(purge_lock);
+	struct vmap_flush_range ranges[VMAP_PURGE_MAX_RANGES];
 	LIST_HEAD(valist);
 	struct vmap_area *va;
 	struct vmap_area *n_va;
-	int nr = 0;
+	int nr = 0, nr_ranges = 0, batch = 0;
 
 	/*
 	 * If sync is 0 but force_flush is 1, we'll go sync anyway but callers
@@ -598,6 +829,10 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	if (sync)
 		purge_fragmented_blocks_allcpus();
 
+	/* the caller's own range, from vm_unmap_aliases() */
+	if (force_flush && *start < *end)
+		nr_ranges = vmap_add_flush_range(ranges, 0, *start, *end);
+
 	rcu_read_lock();
 	list_for_each_entry_rcu(va, &vmap_area_list, list) {
 		if (va->flags & VM_LAZY_FREE) {
@@ -609,20 +844,40 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 			list_add_tail(&va->purge_list, &valist);
 			va->flags |= VM_LAZY_FREEING;
 			va->flags &= ~VM_LAZY_FREE;
+			/* the list is address sorted, the ranges come out so */
+			nr_ranges = vmap_add_flush_range(ranges, nr_ranges,
+						va->va_start, va->va_end);
+			vmap_purge_stats.areas++;
 		}
 	}
 	rcu_read_unlock();
 
-	if (nr)
+	if (nr) {
 		atomic_sub(nr, &vmap_lazy_nr);
+		vmap_purge_stats.passes++;
+		vmap_purge_stats.pages += nr;
+	}
 
 	if (nr || force_flush)
-		flush_tlb_kernel_range(*start, *end);
+		vmap_flush_ranges(ranges, nr_ranges, *start, *end);
 
 	if (nr) {
+		/*
+		 * Don't hold vmap_area_lock across the whole list, a purge
+		 * can free thousands of areas while vmalloc()s wait.
+		 */
 		spin_lock(&vmap_area_lock);
-		list_for_each_entry_safe(va, n_va, &valist, purge_list)
+		list_for_each_entry_safe(va, n_va, &valist, purge_list) {
+			if (!sync && vmap_cache_put(va))
+				continue;
 			__free_vmap_area(va);
+			if (++batch == VMAP_PURGE_BATCH) {
+				batch = 0;
+				spin_unlock(&vmap_area_lock);
+				cpu_relax();
+				spin_lock(&vmap_area_lock);
+			}
+		}
 		spin_unlock(&vmap_area_lock);
 	}
 	spin_unlock(&purge_lock);
@@ -640,13 +895,15 @@ static void try_purge_vmap_area_lazy(void)
 }
 
 /*
- * Kick off a purge of the outstanding lazy areas.
+ * Kick off a purge of the outstanding lazy areas, and give back the cached
+ * ones too: an allocation failed.
  */
 static void purge_vmap_area_lazy(void)
 {
 	unsigned long start = ULONG_MAX, end = 0;
 
 	__purge_vmap_area_lazy(&start, &end, 1, 0);
+	vmap_cache_drain_all();
 }
 
 /*
@@ -1151,10 +1408,17 @@ void __init vmalloc_init(void)
 
 	for_each_possible_cpu(i) {
 		struct vmap_block_queue *vbq;
+		struct vmap_area_cache *vac;
+		int idx;
 
 		vbq = &per_cpu(vmap_block_queue, i);
 		spin_lock_init(&vbq->lock);
 		INIT_LIST_HEAD(&vbq->free);
+
+		vac = &per_cpu(vmap_area_cache, i);
+		spin_lock_init(&vac->lock);
+		for (idx = 0; idx < VMAP_CACHE_PAGES; idx++)
+			INIT_LIST_HEAD(&vac->free[idx]);
 	}
 
 	/* Import existing vmlist entries. */
@@ -1546,7 +1810,25 @@ static void *__vmalloc_area_node(struct vm_struct *area, gfp_t gfp_mask,
 		return NULL;
 	}
 
-	for (i = 0; i < area->nr_pages; i++) {
+	i = 0;
+	/*
+	 * Take what the bulk allocator has under one zone->lock.  Without a
+	 * node on a NUMA machine the pages follow the task's mempolicy, so
+	 * they are allocated one by one.
+	 */
+	if (node >= 0 || nr_online_nodes == 1) {
+		struct page *page, *next;
+		LIST_HEAD(list);
+
+		alloc_pages_bulk_node(node, gfp_mask | __GFP_NOWARN,
+				      area->nr_pages, &list);
+		list_for_each_entry_safe(page, next, &list, lru) {
+			list_del(&page->lru);
+			area->pages[i++] = page;
+		}
+	}
+
+	for (; i < area->nr_pages; i++) {
 		struct page *page;
 		gfp_t tmp_mask = gfp_mask | __GFP_NOWARN;
 
@@ -2494,6 +2776,31 @@ static void show_numa_info(struct seq_file *m, struct vm_struct *v)
 	}
 }
 
+/* Summary of the lazy purges and the area caches, after the last area */
+static void show_vmap_stats(struct seq_file *m)
+{
+	unsigned long hits = 0, misses = 0, cached = 0;
+	int cpu, idx;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_area_cache *vac = &per_cpu(vmap_area_cache, cpu);
+
+		hits += vac->hits;
+		misses += vac->misses;
+		for (idx = 0; idx < VMAP_CACHE_PAGES; idx++)
+			cached += vac->nr[idx];
+	}
+
+	seq_printf(m, "purge passes=%lu areas=%lu pages=%lu "
+		   "tlb_flushes=%lu tlb_flush_pages=%lu span_flushes=%lu\n",
+		   vmap_purge_stats.passes, vmap_purge_stats.areas,
+		   vmap_purge_stats.pages, vmap_purge_stats.flushes,
+		   vmap_purge_stats.flush_pages,
+		   vmap_purge_stats.span_flushes);
+	seq_printf(m, "cache hits=%lu misses=%lu cached=%lu\n",
+		   hits, misses, cached);
+}
+
 static int s_show(struct seq_file *m, void *p)
 {
 	struct vm_struct *v = p;
@@ -2527,6 +2834,9 @@ static int s_show(struct seq_file *m, void *p)
 
 	show_numa_info(m, v);
 	seq_putc(m, '\n');
+
+	if (!v->next)
+		show_vmap_stats(m);
 	return 0;
 }
 
@@ -0,0 +1,307 @@
+/*
+ * linux/mm/vmpressure.c
+ *
+ * Memory pressure levels for userspace.
+ *
+ * Reclaim efficiency is a better measure of memory pressure than the
+ * amount of free memory: a system with little free memory but plenty of
+ * clean page cache is fine, one that scans a lot and frees little is
+ * about to stall.  Every reclaim pass adds the pages it scanned and
+ * reclaimed to the cgroup it reclaimed for; once a window's worth of
+ * pages has been scanned, the share that could not be reclaimed is
+ * turned into a level (low, medium or critical) and passed to the
+ * listeners registered through memory.pressure_level.
+ *
+ * Global reclaim is charged to the root memory cgroup, so listening on
+ * the root cgroup gives the system wide pressure.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/sched.h>
+#include <linux/mmzone.h>
+#include <linux/eventfd.h>
+#include <linux/swap.h>
+#include <linux/memcontrol.h>
+#include <linux/vmpressure.h>
+
+/*
+ * The window size is the number of scanned pages before the pressure is
+ * computed.  A small window reacts quickly but is noisy, a large one
+ * smooths out the spikes of a single reclaim pass.  16 reclaim batches
+ * (2MB with 4K pages) is a compromise.
+ */
+static const unsigned long vmpressure_win = SWAP_CLUSTER_MAX * 16;
+
+/*
+ * Share of scanned pages that could not be reclaimed, in percent, at
+ * which the medium and critical levels begin.
+ */
+static const unsigned int vmpressure_level_med = 60;
+static const unsigned int vmpressure_level_critical = 95;
+
+/*
+ * Once reclaim has worked its way down to this priority it is scanning
+ * 1/8 of the LRU lists per pass and still not meeting its target; that
+ * is reported as critical without waiting for the window to fill.
+ */
+static const int vmpressure_level_critical_prio = ilog2(100 / 10);
+
+enum vmpressure_levels {
+	VMPRESSURE_LOW = 0,
+	VMPRESSURE_MEDIUM,
+	VMPRESSURE_CRITICAL,
+	VMPRESSURE_NUM_LEVELS,
+};
+
+static const char * const vmpressure_str_levels[] = {
+	[VMPRESSURE_LOW] = "low",
+	[VMPRESSURE_MEDIUM] = "medium",
+	[VMPRESSURE_CRITICAL] = "critical",
+};
+
+struct vmpressure_event {
+	struct eventfd_ctx *efd;
+	enum vmpressure_levels level;
+	struct list_head node;
+};
+
+static struct vmpressure *work_to_vmpressure(struct work_struct *work)
+{
+	return container_of(work, struct vmpressure, work);
+}
+
+static enum vmpressure_levels vmpressure_level(unsigned long pressure)
+{
+	if (pressure >= vmpressure_level_critical)
+		return VMPRESSURE_CRITICAL;
+	else if (pressure >= vmpressure_level_med)
+		return VMPRESSURE_MEDIUM;
+	return VMPRESSURE_LOW;
+}
+
+static enum vmpressure_levels vmpressure_calc_level(unsigned long scanned,
+						    unsigned long reclaimed)
+{
+	unsigned long scale = scanned + reclaimed;
+	unsigned long pressure;
+
+	/* lumpy reclaim can free more than it was asked to scan */
+	if (reclaimed >= scanned)
+		return VMPRESSURE_LOW;
+
+	/*
+	 * scanned + reclaimed rather than scanned as the scale rounds the
+	 * result down a little, so a window where everything scanned was
+	 * reclaimed gives exactly 0.
+	 */
+	pressure = scale - (reclaimed * scale / scanned);
+	pressure = pressure * 100 / scale;
+
+	pr_debug("%s: %3lu  (s: %lu  r: %lu)\n", __func__, pressure,
+		 scanned, reclaimed);
+
+	return vmpressure_level(pressure);
+}
+
+static bool vmpressure_event(struct vmpressure *vmpr,
+			     unsigned long scanned, unsigned long reclaimed)
+{
+	struct vmpressure_event *ev;
+	enum vmpressure_levels level;
+	bool signalled = false;
+
+	level = vmpressure_calc_level(scanned, reclaimed);
+
+	mutex_lock(&vmpr->events_lock);
+
+	/* a listener for a level also hears about the levels above it */
+	list_for_each_entry(ev, &vmpr->events, node) {
+		if (level >= ev->level) {
+			eventfd_signal(ev->efd, 1);
+			signalled = true;
+		}
+	}
+
+	mutex_unlock(&vmpr->events_lock);
+
+	return signalled;
+}
+
+static void vmpressure_work_fn(struct work_struct *work)
+{
+	struct vmpressure *vmpr = work_to_vmpressure(work);
+	unsigned long scanned;
+	unsigned long reclaimed;
+
+	spin_lock(&vmpr->sr_lock);
+	/*
+	 * Several reclaimers may have queued the work for the same window;
+	 * whoever runs first takes it, the others find nothing to do.
+	 */
+	scanned = vmpr->scanned;
+	if (!scanned) {
+		spin_unlock(&vmpr->sr_lock);
+		return;
+	}
+
+	reclaimed = vmpr->reclaimed;
+	vmpr->scanned = 0;
+	vmpr->reclaimed = 0;
+	spin_unlock(&vmpr->sr_lock);
+
+	/*
+	 * Pressure in a cgroup is pressure in its parents as well, unless
+	 * a listener further down already heard about it.
+	 */
+	do {
+		if (vmpressure_event(vmpr, scanned, reclaimed))
+			break;
+	} while ((vmpr = vmpressure_parent(vmpr)));
+}
+
+/**
+ * vmpressure() - Account memory pressure through scanned/reclaimed ratio
+ * @gfp:	reclaimer's gfp mask
+ * @memcg:	cgroup memory controller handle, NULL for global reclaim
+ * @scanned:	number of pages scanned
+ * @reclaimed:	number of pages reclaimed
+ *
+ * Called from the reclaim path after each zone was shrunk.  The numbers
+ * are added to the cgroup's current window; a full window is evaluated
+ * from a work item, so the reclaimer never waits for the listeners.
+ */
+void vmpressure(gfp_t gfp, struct mem_cgroup *memcg,
+		unsigned long scanned, unsigned long reclaimed)
+{
+	struct vmpressure *vmpr;
+
+	if (mem_cgroup_disabled())
+		return;
+
+	vmpr = memcg_to_vmpressure(memcg);
+	if (!vmpr)
+		return;
+
+	/*
+	 * Only reclaim for allocations that could have been satisfied
+	 * from the page cache or anonymous memory says something about
+	 * the pressure on those; a GFP_NOFS or lowmem-only reclaim that
+	 * fails is not what userspace can help with.
+	 */
+	if (!(gfp & (__GFP_HIGHMEM | __GFP_MOVABLE | __GFP_IO | __GFP_FS)))
+		return;
+
+	/*
+	 * A reclaim pass that scanned nothing (e.g. only the slab was
+	 * shrunk) carries no information about the LRU lists.
+	 */
+	if (!scanned)
+		return;
+
+	spin_lock(&vmpr->sr_lock);
+	vmpr->scanned += scanned;
+	vmpr->reclaimed += reclaimed;
+	scanned = vmpr->scanned;
+	spin_unlock(&vmpr->sr_lock);
+
+	if (scanned < vmpressure_win)
+		return;
+	schedule_work(&vmpr->work);
+}
+
+/**
+ * vmpressure_prio() - Account memory pressure through reclaimer priority
+ * @gfp:	reclaimer's gfp mask
+ * @memcg:	cgroup memory controller handle, NULL for global reclaim
+ * @prio:	reclaimer's priority
+ *
+ * Called from do_try_to_free_pages() for every priority step.  Reaching
+ * vmpressure_level_critical_prio means reclaim is already struggling, so
+ * a critical window is reported right away.
+ */
+void vmpressure_prio(gfp_t gfp, struct mem_cgroup *memcg, int prio)
+{
+	if (prio > vmpressure_level_critical_prio)
+		return;
+
+	/* a full window with nothing reclaimed is a critical level */
+	vmpressure(gfp, memcg, vmpressure_win, 0);
+}
+
+/**
+ * vmpressure_register_event() - Bind an eventfd to a pressure level
+ * @vmpr:	the cgroup's pressure state
+ * @eventfd:	eventfd context to signal
+ * @args:	"low", "medium" or "critical"
+ *
+ * Called via cgroup.event_control when userspace writes
+ * "<event_fd> <fd of memory.pressure_level> <level>".
+ */
+int vmpressure_register_event(struct vmpressure *vmpr,
+			      struct eventfd_ctx *eventfd, const char *args)
+{
+	struct vmpressure_event *ev;
+	int level;
+
+	for (level = 0; level < VMPRESSURE_NUM_LEVELS; level++) {
+		if (!strcmp(vmpressure_str_levels[level], args))
+			break;
+	}
+
+	if (level >= VMPRESSURE_NUM_LEVELS)
+		return -EINVAL;
+
+	ev = kzalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev)
+		return -ENOMEM;
+
+	ev->efd = eventfd;
+	ev->level = level;
+
+	mutex_lock(&vmpr->events_lock);
+	list_add(&ev->node, &vmpr->events);
+	mutex_unlock(&vmpr->events_lock);
+
+	return 0;
+}
+
+/**
+ * vmpressure_unregister_event() - Unbind an eventfd from pressure levels
+ * @vmpr:	the cgroup's pressure state
+ * @eventfd:	eventfd context that was used to register the event
+ */
+void vmpressure_unregister_event(struct vmpressure *vmpr,
+				 struct eventfd_ctx *eventfd)
+{
+	struct vmpressure_event *ev, *tmp;
+
+	mutex_lock(&vmpr->events_lock);
+	list_for_each_entry_safe(ev, tmp, &vmpr->events, node) {
+		if (ev->efd != eventfd)
+			continue;
+		list_del(&ev->node);
+		kfree(ev);
+		break;
+	}
+	mutex_unlock(&vmpr->events_lock);
+}
+
+void vmpressure_init(struct vmpressure *vmpr)
+{
+	spin_lock_init(&vmpr->sr_lock);
+	mutex_init(&vmpr->events_lock);
+	INIT_LIST_HEAD(&vmpr->events);
+	INIT_WORK(&vmpr->work, vmpressure_work_fn);
+}
+
+/*
+ * Called when the last reference to the cgroup is gone, right before
+ * it is freed; the work item must not run on the freed structure.
+ * Nothing can queue it again by then.
+ */
+void vmpressure_cleanup(struct vmpressure *vmpr)
+{
+	cancel_work_sync(&vmpr->work);
+}
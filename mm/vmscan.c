@@ -39,6 +39,7 @@
 #include <linux/kthread.h>
 #include <linux/freezer.h>
 #include <linux/memcontrol.h>
+#include <linux/vmpressure.h>
 #include <linux/delayacct.h>
 #include <linux/sysctl.h>
 #include <linux/oom.h>
@@ -158,6 +159,16 @@ static DECLARE_RWSEM(shrinker_rwsem);
 #define scanning_global_lru(sc)	(1)
 #endif
 
+/*
+ * The multi-generational LRU replaces the active/inactive balancing for
+ * global reclaim.  Reclaim on behalf of a memory cgroup still isolates
+ * from the cgroup's own lists.
+ */
+static bool lru_gen_reclaim(struct scan_control *sc)
+{
+	return lru_gen_enabled() && scanning_global_lru(sc);
+}
+
 static struct zone_reclaim_stat *get_reclaim_stat(struct zone *zone,
 						  struct scan_control *sc)
 {
@@ -526,6 +537,10 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
 
+	/* the subpages of a page cache hugepage only leave it together */
+	if (PageFileHuge(page))
+		return 0;
+
 	spin_lock_irq(&mapping->tree_lock);
 	/*
 	 * The non racy check for a busy page.
@@ -729,6 +744,14 @@ static enum page_references page_check_references(struct page *page,
 		return PAGEREF_KEEP;
 	}
 
+	/*
+	 * With the multi-generational LRU the mark is only left on pages
+	 * that were used again after their last promotion, see
+	 * shrink_inactive_list().
+	 */
+	if (referenced_page && lru_gen_reclaim(sc))
+		return PAGEREF_ACTIVATE;
+
 	/* Reclaim if clean, defer dirty pages to writeback */
 	if (referenced_page && !PageSwapBacked(page))
 		return PAGEREF_RECLAIM_CLEAN;
@@ -1205,6 +1228,19 @@ static unsigned long isolate_pages_global(unsigned long nr,
 					int active, int file)
 {
 	int lru = LRU_BASE;
+
+#ifdef CONFIG_LRU_GEN
+	/* there are no active lists, everything is evicted oldest first */
+	if (lru_gen_enabled()) {
+		if (active) {
+			*scanned = 0;
+			return 0;
+		}
+		return isolate_lru_pages(nr, lru_gen_evict_list(z, file), dst,
+					 scanned, order, ISOLATE_BOTH, file);
+	}
+#endif
+
 	if (active)
 		lru += LRU_ACTIVE;
 	if (file)
@@ -1492,6 +1528,20 @@ shrink_inactive_list(unsigned long nr_to_scan, struct zone *zone,
 		return 0;
 	}
 
+	/*
+	 * An inactive page is marked referenced on its first use already;
+	 * only the mark on an active page, one that was used again after
+	 * its promotion, means it should stay.
+	 */
+	if (lru_gen_reclaim(sc)) {
+		struct page *page;
+
+		list_for_each_entry(page, &page_list, lru) {
+			if (!PageActive(page))
+				ClearPageReferenced(page);
+		}
+	}
+
 	update_isolated_counts(zone, sc, &nr_anon, &nr_file, &page_list);
 
 	spin_unlock_irq(&zone->lru_lock);
@@ -1553,7 +1603,7 @@ static void move_active_pages_to_lru(struct zone *zone,
 		VM_BUG_ON(PageLRU(page));
 		SetPageLRU(page);
 
-		list_move(&page->lru, &zone->lru[lru].list);
+		list_move(&page->lru, lru_add_head(zone, lru));
 		mem_cgroup_add_lru_list(page, lru);
 		pgmoved += hpage_nr_pages(page);
 
@@ -1766,6 +1816,9 @@ static unsigned long shrink_list(enum lru_list lru, unsigned long nr_to_scan,
 		return 0;
 	}
 
+	if (lru_gen_reclaim(sc) && lru_gen_need_aging(zone, file))
+		lru_gen_age(zone);
+
 	return shrink_inactive_list(nr_to_scan, zone, sc, priority, file);
 }
 
@@ -1989,6 +2042,13 @@ restart:
 	nr_scanned = sc->nr_scanned;
 	get_scan_count(zone, sc, nr, priority);
 
+	/* all of a type is scanned from its oldest generation */
+	if (lru_gen_reclaim(sc)) {
+		nr[LRU_INACTIVE_ANON] += nr[LRU_ACTIVE_ANON];
+		nr[LRU_INACTIVE_FILE] += nr[LRU_ACTIVE_FILE];
+		nr[LRU_ACTIVE_ANON] = nr[LRU_ACTIVE_FILE] = 0;
+	}
+
 	while (nr[LRU_INACTIVE_ANON] || nr[LRU_ACTIVE_FILE] ||
 					nr[LRU_INACTIVE_FILE]) {
 		for_each_evictable_lru(l) {
@@ -2014,11 +2074,14 @@ restart:
 	}
 	sc->nr_reclaimed += nr_reclaimed;
 
+	vmpressure(sc->gfp_mask, sc->mem_cgroup,
+		   sc->nr_scanned - nr_scanned, nr_reclaimed);
+
 	/*
 	 * Even if we did not try to evict anon pages at all, we want to
 	 * rebalance the anon lru active/inactive ratio.
 	 */
-	if (inactive_anon_is_low(zone, sc))
+	if (!lru_gen_reclaim(sc) && inactive_anon_is_low(zone, sc))
 		shrink_active_list(SWAP_CLUSTER_MAX, zone, sc, priority, 0);
 
 	/* reclaim/compaction might need reclaim to continue */
@@ -2144,6 +2207,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 		count_vm_event(ALLOCSTALL);
 
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
+		vmpressure_prio(sc->gfp_mask, sc->mem_cgroup, priority);
 		sc->nr_scanned = 0;
 		if (!priority)
 			disable_swap_token(sc->mem_cgroup);
@@ -2834,8 +2898,18 @@ static int kswapd(void *p)
 		 * after returning from the refrigerator
 		 */
 		if (!ret) {
+			unsigned long balanced_order;
+
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
-			order = balance_pgdat(pgdat, order, &classzone_idx);
+			balanced_order = balance_pgdat(pgdat, order,
+						       &classzone_idx);
+			/*
+			 * Reclaim gave up on the high-order watermarks,
+			 * have kcompactd work on them instead.
+			 */
+			if (balanced_order < order)
+				wakeup_kcompactd(pgdat, order, classzone_idx);
+			order = balanced_order;
 		}
 	}
 	return 0;
@@ -3276,7 +3350,7 @@ retry:
 		enum lru_list l = page_lru_base_type(page);
 
 		__dec_zone_state(zone, NR_UNEVICTABLE);
-		list_move(&page->lru, &zone->lru[l].list);
+		list_move(&page->lru, lru_add_head(zone, l));
 		mem_cgroup_move_lists(page, LRU_UNEVICTABLE, l);
 		__inc_zone_state(zone, NR_INACTIVE_ANON + l);
 		__count_vm_event(UNEVICTABLE_PGRESCUED);
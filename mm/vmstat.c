@@ -718,6 +718,14 @@ const char * const vmstat_text[] = {
 	"numa_other",
 #endif
 	"nr_anon_transparent_hugepages",
+	"nr_file_transparent_hugepages",
+#ifdef CONFIG_COMPACTION
+	"nr_compact_stall",
+	"nr_compact_success",
+	"nr_compact_fail",
+	"nr_kcompactd_success",
+	"nr_kcompactd_fail",
+#endif
 	"nr_dirty_threshold",
 	"nr_dirty_background_threshold",
 
@@ -763,6 +771,8 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_daemon_wake",
+	"compact_daemon_proactive",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -784,6 +794,22 @@ const char * const vmstat_text[] = {
 	"thp_collapse_alloc",
 	"thp_collapse_alloc_failed",
 	"thp_split",
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE_FILE
+	"thp_file_alloc",
+	"thp_file_fallback",
+	"thp_file_mapped",
+	"thp_file_drop",
+#endif
+#endif
+
+#ifdef CONFIG_LRU_GEN
+	"lru_gen_aging",
+	"lru_gen_promoted",
+	"lru_gen_mm_skipped",
+#endif
+#ifdef CONFIG_SPECULATIVE_PAGE_FAULT
+	"speculative_pgfault",
+	"speculative_pgfault_abort",
 #endif
 
 #endif /* CONFIG_VM_EVENTS_COUNTERS */
@@ -297,12 +297,7 @@ static void skb_drop_list(struct sk_buff **listp)
 	struct sk_buff *list = *listp;
 
 	*listp = NULL;
-
-	do {
-		struct sk_buff *this = list;
-		list = list->next;
-		kfree_skb(this);
-	} while (list);
+	kfree_skb_list(list);
 }
 
 static inline void skb_drop_fraglist(struct sk_buff *skb)
@@ -453,6 +448,90 @@ void kfree_skb(struct sk_buff *skb)
 }
 EXPORT_SYMBOL(kfree_skb);
 
+#define KFREE_SKB_BULK_SIZE	16
+
+struct skb_free_array {
+	unsigned int skb_count;
+	void *skb_array[KFREE_SKB_BULK_SIZE];
+};
+
+static void kfree_skb_add_bulk(struct sk_buff *skb, struct skb_free_array *sa)
+{
+	/* fast clones are freed through their shared reference count */
+	if (unlikely(skb->fclone != SKB_FCLONE_UNAVAILABLE)) {
+		__kfree_skb(skb);
+		return;
+	}
+
+	skb_release_all(skb);
+	sa->skb_array[sa->skb_count++] = skb;
+
+	if (unlikely(sa->skb_count == KFREE_SKB_BULK_SIZE)) {
+		kmem_cache_free_bulk(skbuff_head_cache, KFREE_SKB_BULK_SIZE,
+				     sa->skb_array);
+		sa->skb_count = 0;
+	}
+}
+
+static void kfree_skb_flush_bulk(struct skb_free_array *sa)
+{
+	if (sa->skb_count)
+		kmem_cache_free_bulk(skbuff_head_cache, sa->skb_count,
+				     sa->skb_array);
+}
+
+/**
+ *	kfree_skb_list - free a list of sk_buffs
+ *	@segs: first buffer of the list, linked through ->next
+ *
+ *	Drop a reference to every buffer on the list and free those whose
+ *	usage count has hit zero.  The sk_buff heads are returned to their
+ *	cache in batches.
+ */
+void kfree_skb_list(struct sk_buff *segs)
+{
+	struct skb_free_array sa;
+
+	sa.skb_count = 0;
+	while (segs) {
+		struct sk_buff *next = segs->next;
+
+		if (likely(atomic_read(&segs->users) == 1))
+			smp_rmb();
+		else if (likely(!atomic_dec_and_test(&segs->users))) {
+			segs = next;
+			continue;
+		}
+		trace_kfree_skb(segs, __builtin_return_address(0));
+		kfree_skb_add_bulk(segs, &sa);
+		segs = next;
+	}
+	kfree_skb_flush_bulk(&sa);
+}
+EXPORT_SYMBOL(kfree_skb_list);
+
+/**
+ *	__kfree_skb_list - private function
+ *	@segs: first buffer of the list, linked through ->next
+ *
+ *	Free a list of sk_buffs whose last reference is already gone, like
+ *	__kfree_skb() does for one buffer.
+ */
+void __kfree_skb_list(struct sk_buff *segs)
+{
+	struct skb_free_array sa;
+
+	sa.skb_count = 0;
+	while (segs) {
+		struct sk_buff *next = segs->next;
+
+		kfree_skb_add_bulk(segs, &sa);
+		segs = next;
+	}
+	kfree_skb_flush_bulk(&sa);
+}
+EXPORT_SYMBOL(__kfree_skb_list);
+
 /**
  *	consume_skb - free an skbuff
  *	@skb: buffer to free
@@ -34,6 +34,8 @@ cmd_opcodes = {
     "lockcont"      : "7",
     "unlock"        : "8",
     "signal"        : "11",
+    "boostwait"     : "12",
+    "unboost"       : "13",
     "resetevent"    : "98",
     "reset"         : "99",
     }
@@ -0,0 +1,86 @@
+#
+# rt-mutex test
+#
+# Op: C(ommand)/T(est)/W(ait)
+# |  opcode
+# |  |     threadid: 0-7
+# |  |     |  opcode argument
+# |  |     |  |
+# C: lock: 0: 0
+#
+# Commands
+#
+# opcode	opcode argument
+# schedother	nice value
+# schedfifo	priority
+# lock		lock nr (0-7)
+# locknowait	lock nr (0-7)
+# lockint	lock nr (0-7)
+# lockintnowait	lock nr (0-7)
+# lockcont	lock nr (0-7)
+# unlock	lock nr (0-7)
+# signal	thread to signal (0-7)
+# boostwait	thread to boost (0-7)
+# unboost	0
+# reset		0
+# resetevent	0
+#
+# Tests / Wait
+#
+# opcode	opcode argument
+#
+# prioeq	priority
+# priolt	priority
+# priogt	priority
+# nprioeq	normal priority
+# npriolt	normal priority
+# npriogt	normal priority
+# locked	lock nr (0-7)
+# blocked	lock nr (0-7)
+# blockedwake	lock nr (0-7)
+# unlocked	lock nr (0-7)
+# opcodeeq	command opcode or number
+# opcodelt	number
+# opcodegt	number
+# eventeq	number
+# eventgt	number
+# eventlt	number
+
+
+#
+# 3 threads, lightweight boosting (FUTEX_WAIT_BOOST) of a lock holder
+#
+C: resetevent:		0: 	0
+W: opcodeeq:		0: 	0
+
+# Set schedulers
+C: schedother:		0: 	0
+C: schedfifo:		1: 	81
+C: schedfifo:		2: 	82
+
+# T1 waits on T0
+C: boostwait:		1: 	0
+W: prioeq:		0: 	81
+
+# T2 waits on T0
+C: boostwait:		2: 	0
+W: prioeq:		0: 	82
+
+# T2 stops waiting, T0 drops to T1's priority
+C: unboost:		2: 	0
+W: prioeq:		0: 	81
+W: opcodeeq:		2: 	0
+
+# Change T0's policy while boosted: the boost stays
+C: schedfifo:		0: 	10
+T: prioeq:		0: 	81
+T: nprioeq:		0: 	10
+
+# T1 stops waiting, T0 runs at its own priority again
+C: unboost:		1: 	0
+W: prioeq:		0: 	10
+W: opcodeeq:		1: 	0
+
+# Back to SCHED_OTHER
+C: schedother:		0: 	0
+T: priolt:		0: 	1
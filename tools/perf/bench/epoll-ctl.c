@@ -0,0 +1,165 @@
+/*
+ *
+ * epoll-ctl.c
+ *
+ * ctl: Benchmark for epoll_ctl() with many file descriptors
+ *
+ * Every thread adds, modifies and removes a set of file descriptors on
+ * an epoll instance over and over.  Each call looks the fd up in the
+ * instance's tree, so the cost grows with the number of watched fds.
+ * With --shared all threads work on one instance and serialize on it.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static int nthreads;
+static int nfds = 1024;
+static int loops = 100;
+static bool shared_epoll;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_INTEGER('f', "nfds", &nfds,
+		    "Specify number of file descriptors per thread"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of add/mod/del passes over the fds"),
+	OPT_BOOLEAN('S', "shared", &shared_epoll,
+		    "All threads share one epoll instance"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_ctl_usage[] = {
+	"perf bench epoll ctl <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t	thread;
+	int		epfd;
+	int		*fds;
+	struct lat_hist	lat;
+};
+
+static const int ctl_ops[] = { EPOLL_CTL_ADD, EPOLL_CTL_MOD, EPOLL_CTL_DEL };
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	struct epoll_event ev;
+	unsigned int op;
+	int i, j;
+
+	for (i = 0; i < loops; i++) {
+		for (op = 0; op < ARRAY_SIZE(ctl_ops); op++) {
+			for (j = 0; j < nfds; j++) {
+				u64 start = lat_clock_ns();
+
+				ev.events = op ? EPOLLOUT : EPOLLIN;
+				ev.data.fd = w->fds[j];
+				if (epoll_ctl(w->epfd, ctl_ops[op],
+					      w->fds[j], &ev))
+					die("epoll_ctl");
+				lat_hist_add(&w->lat, lat_clock_ns() - start);
+			}
+		}
+	}
+
+	return NULL;
+}
+
+int bench_epoll_ctl(int argc, const char **argv,
+		    const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct worker *workers;
+	struct lat_hist lat;
+	int shared_fd = -1;
+	int i, j;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_ctl_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nfds <= 0)
+		nfds = 1;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	if (shared_epoll) {
+		shared_fd = epoll_create(nfds * nthreads);
+		if (shared_fd < 0)
+			die("epoll_create");
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		struct worker *w = &workers[i];
+
+		w->epfd = shared_epoll ? shared_fd : epoll_create(nfds);
+		if (w->epfd < 0)
+			die("epoll_create");
+		w->fds = calloc(nfds, sizeof(int));
+		if (!w->fds)
+			die("calloc");
+		for (j = 0; j < nfds; j++) {
+			w->fds[j] = eventfd(0, EFD_NONBLOCK);
+			if (w->fds[j] < 0)
+				die("eventfd (raise the open files limit?)");
+		}
+		lat_hist_init(&w->lat);
+	}
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	lat_hist_init(&lat);
+	for (i = 0; i < nthreads; i++)
+		lat_hist_merge(&lat, &workers[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d threads, %d fds each, %s epoll instance%s\n\n",
+		       nthreads, nfds, shared_epoll ? "one shared" : "one",
+		       shared_epoll ? "" : " per thread");
+
+	bench_print_ops(&diff, lat.nr, "epoll_ctl calls", &lat);
+
+	for (i = 0; i < nthreads; i++) {
+		for (j = 0; j < nfds; j++)
+			close(workers[i].fds[j]);
+		free(workers[i].fds);
+		if (!shared_epoll)
+			close(workers[i].epfd);
+	}
+	if (shared_epoll)
+		close(shared_fd);
+	free(workers);
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ *
+ * epoll-wait.c
+ *
+ * wait: Benchmark for epoll_wait() wakeups
+ *
+ * Every thread watches a set of eventfds.  In each round it signals one
+ * of them, collects the event with epoll_wait() and drains the eventfd,
+ * so each operation goes through the wakeup callback, the ready list and
+ * the event transfer to user space.  With --shared all threads use one
+ * epoll instance, which makes them contend on its locks and ready list.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+static int nthreads;
+static int nfds = 64;
+static int loops = 100000;
+static bool shared_epoll;
+static bool edge_triggered;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_INTEGER('f', "nfds", &nfds,
+		    "Specify number of file descriptors per thread"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of wakeups per thread"),
+	OPT_BOOLEAN('S', "shared", &shared_epoll,
+		    "All threads share one epoll instance"),
+	OPT_BOOLEAN('E', "edge", &edge_triggered,
+		    "Use edge triggered events"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_wait_usage[] = {
+	"perf bench epoll wait <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t	thread;
+	int		epfd;
+	int		*fds;
+	struct lat_hist	lat;
+};
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	struct epoll_event ev;
+	u64 one = 1, val;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		u64 start = lat_clock_ns();
+		int ret;
+
+		if (write(w->fds[i % nfds], &one, sizeof(one)) != sizeof(one))
+			die("eventfd write");
+
+		/*
+		 * On a shared instance two signals on one fd can be
+		 * collected as one event, leaving somebody without a
+		 * wakeup; don't let that hang the run.
+		 */
+		do {
+			ret = epoll_wait(w->epfd, &ev, 1,
+					 shared_epoll ? 100 : -1);
+		} while (ret < 0 && errno == EINTR);
+		if (ret < 0)
+			die("epoll_wait");
+		if (!ret)
+			continue;
+
+		/*
+		 * With a shared instance this may be another thread's fd
+		 * which that thread already drained; that is fine.
+		 */
+		if (read(ev.data.fd, &val, sizeof(val)) < 0 && errno != EAGAIN)
+			die("eventfd read");
+
+		lat_hist_add(&w->lat, lat_clock_ns() - start);
+	}
+
+	return NULL;
+}
+
+static void add_fds(struct worker *w)
+{
+	struct epoll_event ev;
+	int i;
+
+	w->fds = calloc(nfds, sizeof(int));
+	if (!w->fds)
+		die("calloc");
+
+	for (i = 0; i < nfds; i++) {
+		w->fds[i] = eventfd(0, EFD_NONBLOCK);
+		if (w->fds[i] < 0)
+			die("eventfd (raise the open files limit?)");
+
+		ev.events = EPOLLIN | (edge_triggered ? EPOLLET : 0);
+		ev.data.fd = w->fds[i];
+		if (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->fds[i], &ev))
+			die("epoll_ctl");
+	}
+}
+
+int bench_epoll_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct worker *workers;
+	struct lat_hist lat;
+	int shared_fd = -1;
+	int i, j;
+
+	argc = parse_options(argc, argv, options,
+			     bench_epoll_wait_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nfds <= 0)
+		nfds = 1;
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	if (shared_epoll) {
+		shared_fd = epoll_create(nfds * nthreads);
+		if (shared_fd < 0)
+			die("epoll_create");
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].epfd = shared_epoll ? shared_fd : epoll_create(nfds);
+		if (workers[i].epfd < 0)
+			die("epoll_create");
+		add_fds(&workers[i]);
+		lat_hist_init(&workers[i].lat);
+	}
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	lat_hist_init(&lat);
+	for (i = 0; i < nthreads; i++)
+		lat_hist_merge(&lat, &workers[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d threads, %d %s-triggered eventfds each, "
+		       "%s epoll instance%s\n\n", nthreads, nfds,
+		       edge_triggered ? "edge" : "level",
+		       shared_epoll ? "one shared" : "one",
+		       shared_epoll ? "" : " per thread");
+
+	bench_print_ops(&diff, lat.nr, "wakeups", &lat);
+
+	for (i = 0; i < nthreads; i++) {
+		for (j = 0; j < nfds; j++)
+			close(workers[i].fds[j]);
+		free(workers[i].fds);
+		if (!shared_epoll)
+			close(workers[i].epfd);
+	}
+	if (shared_epoll)
+		close(shared_fd);
+	free(workers);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ *
+ * futex-requeue.c
+ *
+ * requeue: Benchmark for FUTEX_CMP_REQUEUE
+ *
+ * A crowd of threads blocks on one futex and is moved to a second one
+ * with FUTEX_CMP_REQUEUE, a few waiters per call, the way condition
+ * variable broadcasts hand waiters over to the mutex.  Each call walks
+ * one hash bucket and relinks waiters into another, so this measures the
+ * cost of holding two bucket locks at once.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static int nthreads;
+static int loops = 10;
+static int nrequeue = 1;
+static bool fshared;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of waiters (default: number of CPUs)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of times the crowd is requeued"),
+	OPT_INTEGER('q', "nrequeue", &nrequeue,
+		    "Specify number of waiters to requeue per call"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared (inter-process) futexes"),
+	OPT_END()
+};
+
+static const char * const bench_futex_requeue_usage[] = {
+	"perf bench futex requeue <options>",
+	NULL
+};
+
+static u_int32_t futex1 __attribute__((aligned(64)));
+static u_int32_t futex2 __attribute__((aligned(64)));
+static volatile int done;
+
+static void *waiterfn(void *arg __used)
+{
+	/*
+	 * Requeued waiters sleep on futex2, but recheck the same word.
+	 * Any wakeup after teardown started ends the thread, or it would
+	 * go back to sleep on futex1 where nobody wakes it.
+	 */
+	while (!done) {
+		if (futex_wait(&futex1, 0, !fshared) < 0 &&
+		    errno != EAGAIN && errno != EINTR)
+			die("futex_wait");
+		if (done)
+			break;
+	}
+
+	return NULL;
+}
+
+int bench_futex_requeue(int argc, const char **argv,
+			const char *prefix __used)
+{
+	struct timeval start, stop, diff, runtime;
+	pthread_t *waiters;
+	struct lat_hist lat;
+	u64 calls = 0;
+	int i, j;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_requeue_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (nrequeue <= 0)
+		nrequeue = 1;
+
+	waiters = calloc(nthreads, sizeof(*waiters));
+	if (!waiters)
+		die("calloc");
+
+	lat_hist_init(&lat);
+	timerclear(&runtime);
+
+	for (j = 0; j < loops; j++) {
+		int requeued = 0;
+
+		done = 0;
+		futex1 = 0;
+		for (i = 0; i < nthreads; i++) {
+			if (pthread_create(&waiters[i], NULL, waiterfn, NULL))
+				die("pthread_create");
+		}
+
+		/*
+		 * Waiters may not have gone to sleep yet; keep requeueing
+		 * until every one of them has been moved.
+		 */
+		gettimeofday(&start, NULL);
+		while (requeued < nthreads) {
+			u64 t = lat_clock_ns();
+			int ret;
+
+			ret = futex_cmp_requeue(&futex1, 0, &futex2, 0,
+						nrequeue, !fshared);
+			if (ret < 0)
+				die("futex_cmp_requeue");
+			if (ret) {
+				lat_hist_add(&lat, lat_clock_ns() - t);
+				calls++;
+			}
+			requeued += ret;
+		}
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff);
+		timeradd(&runtime, &diff, &runtime);
+
+		/* a late waiter sees futex1 != 0 and doesn't sleep at all */
+		done = 1;
+		futex1 = 1;
+		__sync_synchronize();
+		for (i = 0; i < nthreads; i++) {
+			/* everybody should sit on futex2 now, but be sure */
+			while (futex_wake(&futex2, nthreads, !fshared) > 0 ||
+			       futex_wake(&futex1, nthreads, !fshared) > 0)
+				;
+			pthread_join(waiters[i], NULL);
+		}
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# requeueing %d waiters %d at a time, %d times, "
+		       "on %s futexes\n\n", nthreads, nrequeue, loops,
+		       fshared ? "shared" : "private");
+
+	/* only the time spent requeueing is counted */
+	bench_print_ops(&runtime, calls, "FUTEX_CMP_REQUEUE calls", &lat);
+
+	free(waiters);
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ *
+ * futex-wait.c
+ *
+ * wait: Benchmark for FUTEX_WAIT/FUTEX_WAKE handoffs
+ *
+ * Threads are paired up and pass a token back and forth through a futex
+ * word: each side wakes the other and blocks in FUTEX_WAIT until the
+ * token comes back.  This is the synchronous request/reply pattern of
+ * binder-style IPC and of contended mutexes, and every round trip goes
+ * through the futex hash twice in each direction.  The latency reported
+ * is that of a full round trip.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static int nthreads;
+static int loops = 100000;
+static bool fshared;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads, paired up (default: number of CPUs)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of round trips per pair"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared (inter-process) futexes"),
+	OPT_END()
+};
+
+static const char * const bench_futex_wait_usage[] = {
+	"perf bench futex wait <options>",
+	NULL
+};
+
+struct pair {
+	pthread_t	client;
+	pthread_t	server;
+	/* 0: the client holds the token, 1: the server does */
+	u_int32_t	turn __attribute__((aligned(64)));
+	struct lat_hist	lat;
+};
+
+static inline u_int32_t read_turn(u_int32_t *turn)
+{
+	return *(volatile u_int32_t *)turn;
+}
+
+/* pass the token to the other side and wait until it comes back */
+static void handoff(u_int32_t *turn, u_int32_t give)
+{
+	__sync_synchronize();
+	*turn = give;
+	if (futex_wake(turn, 1, !fshared) < 0)
+		die("futex_wake");
+
+	while (read_turn(turn) == give) {
+		if (futex_wait(turn, give, !fshared) < 0 &&
+		    errno != EAGAIN && errno != EINTR)
+			die("futex_wait");
+	}
+}
+
+static void *clientfn(void *arg)
+{
+	struct pair *p = arg;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		u64 start = lat_clock_ns();
+
+		handoff(&p->turn, 1);
+		lat_hist_add(&p->lat, lat_clock_ns() - start);
+	}
+
+	return NULL;
+}
+
+static void *serverfn(void *arg)
+{
+	struct pair *p = arg;
+	int i;
+
+	/* wait for the first request */
+	while (read_turn(&p->turn) == 0)
+		futex_wait(&p->turn, 0, !fshared);
+
+	for (i = 0; i < loops; i++) {
+		/* the last reply must not wait for a request that never comes */
+		if (i == loops - 1) {
+			__sync_synchronize();
+			p->turn = 0;
+			futex_wake(&p->turn, 1, !fshared);
+			break;
+		}
+		handoff(&p->turn, 0);
+	}
+
+	return NULL;
+}
+
+int bench_futex_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct lat_hist lat;
+	struct pair *pairs;
+	int npairs, i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_wait_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	npairs = (nthreads + 1) / 2;
+	if (loops <= 0)
+		loops = 1;
+
+	if (posix_memalign((void **)&pairs, 64, npairs * sizeof(*pairs)))
+		die("posix_memalign");
+	memset(pairs, 0, npairs * sizeof(*pairs));
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < npairs; i++) {
+		lat_hist_init(&pairs[i].lat);
+		if (pthread_create(&pairs[i].server, NULL, serverfn, &pairs[i]))
+			die("pthread_create");
+		if (pthread_create(&pairs[i].client, NULL, clientfn, &pairs[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < npairs; i++) {
+		pthread_join(pairs[i].client, NULL);
+		pthread_join(pairs[i].server, NULL);
+	}
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	lat_hist_init(&lat);
+	for (i = 0; i < npairs; i++)
+		lat_hist_merge(&lat, &pairs[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d thread pairs doing %d round trips each "
+		       "through %s futexes\n\n", npairs, loops,
+		       fshared ? "shared" : "private");
+
+	bench_print_ops(&diff, (u64)loops * npairs, "round trips", &lat);
+
+	free(pairs);
+	return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ *
+ * futex-wake.c
+ *
+ * wake: Benchmark for uncontended FUTEX_WAKE
+ *
+ * Each thread repeatedly calls FUTEX_WAKE on a futex nobody waits on,
+ * which is what most mutex and condition variable unlocks look like to
+ * the kernel.  This measures the futex hash lookup and the bucket
+ * checks done on the way.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "futex.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+static int nthreads;
+static int loops = 1000000;
+static bool shared_futex;
+static bool fshared;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of FUTEX_WAKE calls per thread"),
+	OPT_BOOLEAN('s', "same-futex", &shared_futex,
+		    "All threads wake the same futex"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared (inter-process) futexes"),
+	OPT_END()
+};
+
+/*
+ * An uncontended FUTEX_WAKE costs about as much as the two clock reads
+ * around it, so only every LAT_SAMPLE_PERIOD-th call is timed.
+ */
+#define LAT_SAMPLE_PERIOD	64
+
+static const char * const bench_futex_wake_usage[] = {
+	"perf bench futex wake <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t	thread;
+	u_int32_t	*uaddr;
+	u_int32_t	word;
+	struct lat_hist	lat;
+};
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		u64 start;
+
+		if (i % LAT_SAMPLE_PERIOD) {
+			if (futex_wake(w->uaddr, 1, !fshared) < 0)
+				die("futex_wake");
+			continue;
+		}
+
+		start = lat_clock_ns();
+		if (futex_wake(w->uaddr, 1, !fshared) < 0)
+			die("futex_wake");
+		lat_hist_add(&w->lat, lat_clock_ns() - start);
+	}
+
+	return NULL;
+}
+
+int bench_futex_wake(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	static u_int32_t global_word;
+	struct worker *workers;
+	struct lat_hist lat;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_wake_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		workers[i].uaddr = shared_futex ? &global_word :
+						  &workers[i].word;
+		lat_hist_init(&workers[i].lat);
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	lat_hist_init(&lat);
+	for (i = 0; i < nthreads; i++)
+		lat_hist_merge(&lat, &workers[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d threads calling FUTEX_WAKE %d times each "
+		       "on %s %s futex%s\n\n", nthreads, loops,
+		       shared_futex ? "one" : "their own",
+		       fshared ? "shared" : "private",
+		       shared_futex ? "" : "es");
+
+	bench_print_ops(&diff, (u64)loops * nthreads, "FUTEX_WAKE calls", &lat);
+
+	free(workers);
+	return 0;
+}
@@ -0,0 +1,41 @@
+#ifndef BENCH_FUTEX_H
+#define BENCH_FUTEX_H
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <linux/futex.h>
+
+/*
+ * glibc does not provide a futex() wrapper; keep the benchmarks' calls
+ * readable with thin ones.
+ */
+static inline int
+futex(u_int32_t *uaddr, int op, u_int32_t val, const struct timespec *timeout,
+      u_int32_t *uaddr2, u_int32_t val3, int private)
+{
+	if (private)
+		op |= FUTEX_PRIVATE_FLAG;
+	return syscall(__NR_futex, uaddr, op, val, timeout, uaddr2, val3);
+}
+
+static inline int futex_wait(u_int32_t *uaddr, u_int32_t val, int private)
+{
+	return futex(uaddr, FUTEX_WAIT, val, NULL, NULL, 0, private);
+}
+
+static inline int futex_wake(u_int32_t *uaddr, int nr_wake, int private)
+{
+	return futex(uaddr, FUTEX_WAKE, nr_wake, NULL, NULL, 0, private);
+}
+
+/* the requeue count travels in the timeout argument */
+static inline int
+futex_cmp_requeue(u_int32_t *uaddr, u_int32_t val, u_int32_t *uaddr2,
+		  int nr_wake, int nr_requeue, int private)
+{
+	return futex(uaddr, FUTEX_CMP_REQUEUE, nr_wake,
+		     (struct timespec *)(long)nr_requeue, uaddr2, val, private);
+}
+
+#endif /* BENCH_FUTEX_H */
@@ -0,0 +1,139 @@
+/*
+ * latency.c
+ *
+ * Latency histograms and result reporting shared by the benchmarks
+ * that report percentiles.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static unsigned int lat_index(u64 ns)
+{
+	unsigned int msb;
+
+	if (ns < LAT_SUB_BUCKETS)
+		return ns;
+
+	msb = 63 - __builtin_clzll(ns);
+	return (msb - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS +
+		((ns >> (msb - LAT_SUB_BITS)) & (LAT_SUB_BUCKETS - 1));
+}
+
+/* smallest value that lands in bucket @idx */
+static u64 lat_value(unsigned int idx)
+{
+	unsigned int group = idx / LAT_SUB_BUCKETS;
+	unsigned int sub = idx % LAT_SUB_BUCKETS;
+
+	if (!group)
+		return sub;
+	return (u64)(LAT_SUB_BUCKETS + sub) << (group - 1);
+}
+
+void lat_hist_init(struct lat_hist *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = ~0ULL;
+}
+
+void lat_hist_add(struct lat_hist *h, u64 ns)
+{
+	h->bucket[lat_index(ns)]++;
+	h->nr++;
+	h->sum += ns;
+	if (ns < h->min)
+		h->min = ns;
+	if (ns > h->max)
+		h->max = ns;
+}
+
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src)
+{
+	int i;
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++)
+		dst->bucket[i] += src->bucket[i];
+	dst->nr += src->nr;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+u64 lat_hist_percentile(const struct lat_hist *h, double pct)
+{
+	u64 want, seen = 0;
+	int i;
+
+	if (!h->nr)
+		return 0;
+
+	want = (u64)(h->nr * pct / 100.0);
+	if (want >= h->nr)
+		return h->max;
+
+	for (i = 0; i < LAT_HIST_BUCKETS; i++) {
+		seen += h->bucket[i];
+		if (seen > want)
+			break;
+	}
+	if (i == LAT_HIST_BUCKETS)
+		return h->max;
+
+	/* report the upper edge of the bucket, clamped to what was seen */
+	if (i + 1 < LAT_HIST_BUCKETS && lat_value(i + 1) - 1 < h->max)
+		return lat_value(i + 1) - 1;
+	return h->max;
+}
+
+static const double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+
+void bench_print_ops(struct timeval *runtime, u64 ops, const char *op_name,
+		     const struct lat_hist *lat)
+{
+	double secs = runtime->tv_sec + runtime->tv_usec / 1000000.0;
+	unsigned int i;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       runtime->tv_sec,
+		       (unsigned long) (runtime->tv_usec / 1000));
+
+		printf(" %14llu %s\n", (unsigned long long)ops, op_name);
+		printf(" %14llu ops/sec\n",
+		       (unsigned long long)(secs > 0 ? ops / secs : 0));
+
+		if (!lat || !lat->nr)
+			break;
+
+		printf("\n %14.3f usecs avg latency\n",
+		       (double)lat->sum / lat->nr / 1000.0);
+		printf(" %14.3f usecs min\n", lat->min / 1000.0);
+		for (i = 0; i < ARRAY_SIZE(percentiles); i++)
+			printf(" %14.3f usecs p%g\n",
+			       lat_hist_percentile(lat, percentiles[i]) / 1000.0,
+			       percentiles[i]);
+		printf(" %14.3f usecs max\n", lat->max / 1000.0);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		printf("%lu.%03lu\n",
+		       runtime->tv_sec,
+		       (unsigned long) (runtime->tv_usec / 1000));
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+}
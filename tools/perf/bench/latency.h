@@ -0,0 +1,45 @@
+#ifndef BENCH_LATENCY_H
+#define BENCH_LATENCY_H
+
+#include <time.h>
+#include <sys/time.h>
+#include <linux/types.h>
+
+/*
+ * Log-linear latency histogram: values below 16ns get a bucket each,
+ * larger ones 16 buckets per power of two, so percentiles are accurate
+ * to about 6% whatever the range.
+ */
+#define LAT_SUB_BITS		4
+#define LAT_SUB_BUCKETS		(1 << LAT_SUB_BITS)
+#define LAT_HIST_BUCKETS	((64 - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS)
+
+struct lat_hist {
+	u64	nr;
+	u64	sum;
+	u64	min;
+	u64	max;
+	u64	bucket[LAT_HIST_BUCKETS];
+};
+
+static inline u64 lat_clock_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void lat_hist_init(struct lat_hist *h);
+void lat_hist_add(struct lat_hist *h, u64 ns);
+void lat_hist_merge(struct lat_hist *dst, const struct lat_hist *src);
+u64 lat_hist_percentile(const struct lat_hist *h, double pct);
+
+/*
+ * Print the common result block of the latency aware suites:
+ * run time, ops/sec and the latency percentiles of @lat.
+ */
+void bench_print_ops(struct timeval *runtime, u64 ops, const char *op_name,
+		     const struct lat_hist *lat);
+
+#endif /* BENCH_LATENCY_H */
@@ -0,0 +1,142 @@
+/*
+ *
+ * mem-mmap.c
+ *
+ * mmap: Benchmark for mmap()/munmap() scalability
+ *
+ * Threads of one process map and unmap small anonymous areas in a loop,
+ * optionally touching them in between.  Every call takes mmap_sem for
+ * write, so this measures how the address space lock and the vma tree
+ * hold up against many threads of one process.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+
+static int nthreads;
+static const char *size_str = "64KB";
+static int loops = 100000;
+static bool touch;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_STRING('s', "size", &size_str, "64KB",
+		    "Specify size of each mapping. "
+		    "available unit: B, MB, GB (upper and lower)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of mmap/munmap pairs per thread"),
+	OPT_BOOLEAN('T', "touch", &touch,
+		    "Write to every page before unmapping"),
+	OPT_END()
+};
+
+static const char * const bench_mem_mmap_usage[] = {
+	"perf bench mem mmap <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t	thread;
+	struct lat_hist	lat;
+};
+
+static size_t size;
+static long page_size;
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	size_t off;
+	char *area;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		u64 start = lat_clock_ns();
+
+		area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (area == MAP_FAILED)
+			die("mmap");
+
+		if (touch) {
+			for (off = 0; off < size; off += page_size)
+				area[off] = 1;
+		}
+
+		if (munmap(area, size))
+			die("munmap");
+
+		lat_hist_add(&w->lat, lat_clock_ns() - start);
+	}
+
+	return NULL;
+}
+
+int bench_mem_mmap(int argc, const char **argv,
+		   const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct worker *workers;
+	struct lat_hist lat;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_mmap_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	page_size = sysconf(_SC_PAGESIZE);
+
+	size = (size_t)perf_atoll((char *)size_str);
+	if ((s64)size <= 0) {
+		fprintf(stderr, "Invalid size:%s\n", size_str);
+		return 1;
+	}
+	size = (size + page_size - 1) & ~(page_size - 1);
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		lat_hist_init(&workers[i].lat);
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	lat_hist_init(&lat);
+	for (i = 0; i < nthreads; i++)
+		lat_hist_merge(&lat, &workers[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d threads mapping%s and unmapping %s, "
+		       "%d times each\n\n", nthreads,
+		       touch ? ", touching" : "", size_str, loops);
+
+	bench_print_ops(&diff, lat.nr, "mmap/munmap pairs", &lat);
+
+	free(workers);
+	return 0;
+}
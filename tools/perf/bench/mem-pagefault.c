@@ -0,0 +1,261 @@
+/*
+ *
+ * mem-pagefault.c
+ *
+ * pagefault: Benchmark for anonymous page fault scalability
+ *
+ * Threads of one process map private anonymous memory and touch every
+ * page of it, so each access is a fault that allocates, zeroes and maps
+ * a page.  All threads share one mm, which is what stresses mmap_sem and
+ * the page table locks as the thread count goes up.
+ *
+ * With --file the threads read-fault a private mapping of a file in the
+ * page cache instead, and with --churn one more thread keeps mapping,
+ * mprotecting and unmapping a small area, taking mmap_sem for write all
+ * the time, as a thread allocating memory in the same process would.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int nthreads;
+static const char *size_str = "64MB";
+static int loops = 4;
+static bool read_faults;
+static bool churn;
+static const char *file_name;
+
+static const struct option options[] = {
+	OPT_INTEGER('t', "threads", &nthreads,
+		    "Specify number of threads (default: number of CPUs)"),
+	OPT_STRING('s', "size", &size_str, "64MB",
+		    "Specify size of the area each thread faults in. "
+		    "available unit: B, MB, GB (upper and lower)"),
+	OPT_INTEGER('l', "loop", &loops,
+		    "Specify number of times each thread maps and faults its area"),
+	OPT_BOOLEAN('r', "read", &read_faults,
+		    "Fault by reading (maps the zero page) instead of writing"),
+	OPT_STRING('F', "file", &file_name, "file",
+		    "Read-fault a private mapping of file instead"),
+	OPT_BOOLEAN('c', "churn", &churn,
+		    "Map and unmap memory in another thread meanwhile"),
+	OPT_END()
+};
+
+static const char * const bench_mem_pagefault_usage[] = {
+	"perf bench mem pagefault <options>",
+	NULL
+};
+
+struct worker {
+	pthread_t	thread;
+	struct lat_hist	lat;
+};
+
+#define CHURN_PAGES	16
+
+static size_t size;
+static long page_size;
+static int fd = -1;
+static volatile bool done;
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = arg;
+	volatile char *p;
+	size_t off;
+	char *area;
+	int i;
+
+	for (i = 0; i < loops; i++) {
+		if (fd >= 0)
+			area = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		else
+			area = mmap(NULL, size, PROT_READ | PROT_WRITE,
+				    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (area == MAP_FAILED)
+			die("mmap");
+
+		for (off = 0; off < size; off += page_size) {
+			u64 start = lat_clock_ns();
+
+			p = area + off;
+			if (read_faults)
+				(void)*p;
+			else
+				*p = 1;
+			lat_hist_add(&w->lat, lat_clock_ns() - start);
+		}
+
+		if (munmap(area, size))
+			die("munmap");
+	}
+
+	return NULL;
+}
+
+/* takes mmap_sem for write over and over until the workers are done */
+static void *churnfn(void *arg)
+{
+	unsigned long *rounds = arg;
+	size_t len = CHURN_PAGES * page_size;
+	char *area;
+
+	while (!done) {
+		area = mmap(NULL, len, PROT_READ | PROT_WRITE,
+			    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (area == MAP_FAILED)
+			die("mmap");
+		area[0] = 1;
+		if (mprotect(area, len, PROT_READ))
+			die("mprotect");
+		if (munmap(area, len))
+			die("munmap");
+		(*rounds)++;
+	}
+
+	return NULL;
+}
+
+/* system wide count of a vm event, -1 if the kernel has no such event */
+static long long read_vmstat(const char *name)
+{
+	size_t len = strlen(name);
+	long long val = -1;
+	char line[128];
+	FILE *f;
+
+	f = fopen("/proc/vmstat", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, name, len) && line[len] == ' ') {
+			val = atoll(line + len + 1);
+			break;
+		}
+	}
+	fclose(f);
+
+	return val;
+}
+
+int bench_mem_pagefault(int argc, const char **argv,
+			const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	long long spf, spf_abort;
+	unsigned long rounds = 0;
+	struct worker *workers;
+	pthread_t churn_thread;
+	struct lat_hist lat;
+	int i;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_pagefault_usage, 0);
+
+	if (nthreads <= 0)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	page_size = sysconf(_SC_PAGESIZE);
+
+	if (file_name) {
+		struct stat st;
+
+		fd = open(file_name, O_RDONLY);
+		if (fd < 0 || fstat(fd, &st) < 0)
+			die("open");
+		size = st.st_size & ~(page_size - 1);
+		if (!size) {
+			fprintf(stderr, "%s is smaller than a page\n",
+				file_name);
+			return 1;
+		}
+		read_faults = true;
+	} else {
+		size = (size_t)perf_atoll((char *)size_str);
+		if ((s64)size <= 0) {
+			fprintf(stderr, "Invalid size:%s\n", size_str);
+			return 1;
+		}
+		size = (size + page_size - 1) & ~(page_size - 1);
+	}
+
+	workers = calloc(nthreads, sizeof(*workers));
+	if (!workers)
+		die("calloc");
+
+	spf = read_vmstat("speculative_pgfault");
+	spf_abort = read_vmstat("speculative_pgfault_abort");
+
+	if (churn && pthread_create(&churn_thread, NULL, churnfn, &rounds))
+		die("pthread_create");
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		lat_hist_init(&workers[i].lat);
+		if (pthread_create(&workers[i].thread, NULL, workerfn,
+				   &workers[i]))
+			die("pthread_create");
+	}
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	done = true;
+	if (churn)
+		pthread_join(churn_thread, NULL);
+	if (spf >= 0) {
+		spf = read_vmstat("speculative_pgfault") - spf;
+		spf_abort = read_vmstat("speculative_pgfault_abort") -
+			    spf_abort;
+	}
+
+	lat_hist_init(&lat);
+	for (i = 0; i < nthreads; i++)
+		lat_hist_merge(&lat, &workers[i].lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT) {
+		if (file_name)
+			printf("# %d threads read-faulting %zuMB of %s",
+			       nthreads, size >> 20, file_name);
+		else
+			printf("# %d threads %s-faulting %s of anonymous "
+			       "memory", nthreads,
+			       read_faults ? "read" : "write", size_str);
+		printf(", %d times each%s\n\n", loops,
+		       churn ? ", mmap churn in another thread" : "");
+	}
+
+	bench_print_ops(&diff, lat.nr, "page faults", &lat);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT) {
+		if (churn)
+			printf(" %14lu mmap/mprotect/munmap rounds\n", rounds);
+		if (spf >= 0)
+			printf(" %14lld speculative faults, %lld fell back "
+			       "to mmap_sem (system wide)\n", spf, spf_abort);
+	}
+
+	if (fd >= 0)
+		close(fd);
+	free(workers);
+	return 0;
+}
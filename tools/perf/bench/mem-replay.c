@@ -0,0 +1,284 @@
+/*
+ *
+ * mem-replay.c
+ *
+ * replay: Benchmark for page reclaim under application switching
+ *
+ * A number of "apps", each an anonymous working set and a file backed
+ * one, are brought to the foreground in turn.  Bringing an app to the
+ * foreground touches all of its working set, so whatever reclaim took
+ * from it while it was in the background has to be faulted back in.
+ * With working sets that add up to more than the memory available, the
+ * time a switch takes and the major faults it causes show how well the
+ * reclaim picks its victims.
+ *
+ * The order of the switches comes from a trace file, one app number per
+ * line, or is synthetic: the next app is drawn from the most recently
+ * used ones with a probability halving at each step down that list,
+ * which is roughly what a phone user does.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+static int nr_apps = 8;
+static const char *anon_str = "64MB";
+static const char *file_str = "64MB";
+static int nr_switches = 100;
+static const char *trace_file;
+static const char *dir = ".";
+
+static const struct option options[] = {
+	OPT_INTEGER('a', "apps", &nr_apps,
+		    "Specify number of apps"),
+	OPT_STRING('s', "anon-size", &anon_str, "64MB",
+		    "Specify size of the anonymous working set of each app. "
+		    "available unit: B, MB, GB (upper and lower)"),
+	OPT_STRING('f', "file-size", &file_str, "64MB",
+		    "Specify size of the file working set of each app. "
+		    "available unit: B, MB, GB (upper and lower)"),
+	OPT_INTEGER('n', "switches", &nr_switches,
+		    "Specify number of synthetic app switches"),
+	OPT_STRING('T', "trace", &trace_file, "file",
+		    "Replay the app switches of a trace file, one app per line"),
+	OPT_STRING('d', "dir", &dir, "dir",
+		    "Specify directory for the files of the apps"),
+	OPT_END()
+};
+
+static const char * const bench_mem_replay_usage[] = {
+	"perf bench mem replay <options>",
+	NULL
+};
+
+struct app {
+	char	*anon;
+	char	*file;
+};
+
+static size_t anon_size, file_size;
+static long page_size;
+
+static size_t parse_size(const char *str)
+{
+	s64 sz = perf_atoll((char *)str);
+
+	if (sz < 0) {
+		fprintf(stderr, "Invalid size:%s\n", str);
+		exit(1);
+	}
+	return ((size_t)sz + page_size - 1) & ~(page_size - 1);
+}
+
+/* a file full of data, so reclaim has to write nothing but reread it */
+static char *map_app_file(void)
+{
+	char path[PATH_MAX];
+	char *buf, *area;
+	size_t off;
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/perf-bench-replay.XXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd < 0)
+		die("mkstemp");
+	unlink(path);
+
+	buf = malloc(page_size);
+	if (!buf)
+		die("malloc");
+	memset(buf, 0x5a, page_size);
+	for (off = 0; off < file_size; off += page_size) {
+		if (write(fd, buf, page_size) != page_size)
+			die("write");
+	}
+	free(buf);
+
+	area = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (area == MAP_FAILED)
+		die("mmap");
+	close(fd);
+
+	return area;
+}
+
+static void setup_apps(struct app *apps)
+{
+	int i;
+
+	for (i = 0; i < nr_apps; i++) {
+		apps[i].anon = mmap(NULL, anon_size, PROT_READ | PROT_WRITE,
+				    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (apps[i].anon == MAP_FAILED)
+			die("mmap");
+		if (file_size)
+			apps[i].file = map_app_file();
+	}
+}
+
+/* bring an app to the foreground: use all of its memory */
+static void switch_to(struct app *app)
+{
+	volatile char *anon = app->anon;
+	volatile char *file = app->file;
+	size_t off;
+
+	for (off = 0; off < anon_size; off += page_size)
+		anon[off]++;
+	for (off = 0; off < file_size; off += page_size)
+		(void)file[off];
+}
+
+/* move @app to the front of the most recently used list @mru */
+static void mru_touch(int *mru, int app)
+{
+	int i;
+
+	for (i = 0; mru[i] != app; i++)
+		;
+	for (; i > 0; i--)
+		mru[i] = mru[i - 1];
+	mru[0] = app;
+}
+
+static int synthetic_next(const int *mru)
+{
+	int i;
+
+	/* mru[0] is in the foreground already */
+	for (i = 1; i < nr_apps - 1; i++) {
+		if (random() & 1)
+			break;
+	}
+	return mru[i];
+}
+
+static int *read_trace(int *nr)
+{
+	int *trace = NULL;
+	int size = 0, app;
+	char line[64];
+	FILE *fp;
+
+	fp = fopen(trace_file, "r");
+	if (!fp)
+		die("fopen");
+
+	*nr = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (line[0] == '#' || sscanf(line, "%d", &app) != 1)
+			continue;
+		if (app < 0) {
+			fprintf(stderr, "Invalid app in trace:%d\n", app);
+			exit(1);
+		}
+		if (*nr == size) {
+			size = size ? size * 2 : 256;
+			trace = realloc(trace, size * sizeof(*trace));
+			if (!trace)
+				die("realloc");
+		}
+		trace[(*nr)++] = app % nr_apps;
+	}
+	fclose(fp);
+
+	return trace;
+}
+
+int bench_mem_replay(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	struct rusage ru_start, ru_stop;
+	int *trace = NULL, *mru;
+	struct lat_hist lat;
+	struct app *apps;
+	long majflt;
+	int i, app;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_replay_usage, 0);
+
+	page_size = sysconf(_SC_PAGESIZE);
+	anon_size = parse_size(anon_str);
+	file_size = parse_size(file_str);
+
+	if (nr_apps < 2) {
+		fprintf(stderr, "Need at least 2 apps\n");
+		return 1;
+	}
+
+	if (trace_file)
+		trace = read_trace(&nr_switches);
+
+	apps = calloc(nr_apps, sizeof(*apps));
+	mru = calloc(nr_apps, sizeof(*mru));
+	if (!apps || !mru)
+		die("calloc");
+
+	setup_apps(apps);
+
+	/* launch every app once, the last one ends up in front */
+	for (i = 0; i < nr_apps; i++) {
+		switch_to(&apps[i]);
+		mru[i] = nr_apps - 1 - i;
+	}
+
+	lat_hist_init(&lat);
+	getrusage(RUSAGE_SELF, &ru_start);
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < nr_switches; i++) {
+		u64 t;
+
+		app = trace ? trace[i] : synthetic_next(mru);
+		mru_touch(mru, app);
+
+		t = lat_clock_ns();
+		switch_to(&apps[app]);
+		lat_hist_add(&lat, lat_clock_ns() - t);
+	}
+
+	gettimeofday(&stop, NULL);
+	getrusage(RUSAGE_SELF, &ru_stop);
+	timersub(&stop, &start, &diff);
+	majflt = ru_stop.ru_majflt - ru_start.ru_majflt;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %d apps of %s anonymous and %s file memory, "
+		       "%d %s switches\n\n", nr_apps, anon_str, file_str,
+		       nr_switches, trace ? "traced" : "synthetic");
+
+	bench_print_ops(&diff, lat.nr, "app switches", &lat);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14ld major faults\n", majflt);
+		printf(" %14.1f major faults/switch\n",
+		       nr_switches ? (double)majflt / nr_switches : 0.0);
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%ld\n", majflt);
+		break;
+	default:
+		break;
+	}
+
+	free(trace);
+	free(mru);
+	free(apps);
+	return 0;
+}
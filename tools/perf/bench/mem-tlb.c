@@ -0,0 +1,295 @@
+/*
+ *
+ * mem-tlb.c
+ *
+ * tlb: Benchmark for TLB reach of read-only file mappings
+ *
+ * A file is mapped read-only and private, like the text of a large
+ * executable, and a cache line at a random offset of it is read over and
+ * over.  With a working set far larger than the reach of the TLB nearly
+ * every access misses the TLB, so the time per access shows the cost of
+ * the page table walk and whether the mapping is backed by huge pages.
+ * Where the CPU counts them, the dTLB load misses are reported as well.
+ *
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/parse-options.h"
+#include "../builtin.h"
+#include "bench.h"
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MADV_HUGEPAGE
+#define MADV_HUGEPAGE		14
+#endif
+#ifndef MADV_NOHUGEPAGE
+#define MADV_NOHUGEPAGE		15
+#endif
+
+#define HPAGE_SIZE		(2UL << 20)
+#define CACHELINE_SIZE		64
+
+static const char *size_str = "512MB";
+static const char *file_name;
+static const char *dir = ".";
+static int nr_loops = 10000000;
+static bool no_huge;
+
+static const struct option options[] = {
+	OPT_STRING('s', "size", &size_str, "512MB",
+		    "Specify size of the mapping. "
+		    "available unit: B, MB, GB (upper and lower)"),
+	OPT_STRING('F', "file", &file_name, "file",
+		    "Map an existing file instead of a temporary one"),
+	OPT_STRING('d', "dir", &dir, "dir",
+		    "Specify directory for the temporary file"),
+	OPT_INTEGER('l', "loop", &nr_loops,
+		    "Specify number of accesses"),
+	OPT_BOOLEAN('N', "no-huge", &no_huge,
+		    "Use madvise(MADV_NOHUGEPAGE) rather than MADV_HUGEPAGE"),
+	OPT_END()
+};
+
+static const char * const bench_mem_tlb_usage[] = {
+	"perf bench mem tlb <options>",
+	NULL
+};
+
+static struct perf_event_attr dtlb_attr = {
+	.type		= PERF_TYPE_HW_CACHE,
+	.config		= PERF_COUNT_HW_CACHE_DTLB |
+			  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+			  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+	.disabled	= 1,
+	.exclude_kernel	= 1,
+	.exclude_hv	= 1,
+};
+
+static size_t map_size;
+static long page_size;
+
+/* a file nobody has open for writing, so it may get huge pages */
+static int open_file(void)
+{
+	char path[PATH_MAX];
+	char *buf;
+	size_t off;
+	int fd;
+
+	if (file_name) {
+		fd = open(file_name, O_RDONLY);
+		if (fd < 0)
+			die("open");
+		return fd;
+	}
+
+	snprintf(path, sizeof(path), "%s/perf-bench-tlb.XXXXXX", dir);
+	fd = mkstemp(path);
+	if (fd < 0)
+		die("mkstemp");
+
+	buf = malloc(page_size);
+	if (!buf)
+		die("malloc");
+	for (off = 0; off < map_size; off += page_size) {
+		memset(buf, off / page_size, page_size);
+		if (write(fd, buf, page_size) != page_size)
+			die("write");
+	}
+	free(buf);
+	/* dirty or writeback pages can't go into a huge page */
+	if (fsync(fd) < 0)
+		die("fsync");
+	close(fd);
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		die("open");
+	unlink(path);
+
+	return fd;
+}
+
+/* system wide count of a vm event, -1 if the kernel has no such event */
+static long long read_vmstat(const char *name)
+{
+	size_t len = strlen(name);
+	long long val = -1;
+	char line[128];
+	FILE *f;
+
+	f = fopen("/proc/vmstat", "r");
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (!strncmp(line, name, len) && line[len] == ' ') {
+			val = atoll(line + len + 1);
+			break;
+		}
+	}
+	fclose(f);
+
+	return val;
+}
+
+/* map @fd at a huge page aligned address */
+static char *map_file(int fd)
+{
+	char *area, *aligned;
+	size_t lead;
+
+	area = mmap(NULL, map_size + HPAGE_SIZE, PROT_READ,
+		    MAP_PRIVATE | MAP_NORESERVE, fd, 0);
+	if (area == MAP_FAILED)
+		die("mmap");
+
+	aligned = (char *)(((unsigned long)area + HPAGE_SIZE - 1) &
+			   ~(HPAGE_SIZE - 1));
+	lead = aligned - area;
+	if (lead)
+		munmap(area, lead);
+	munmap(aligned + map_size, HPAGE_SIZE - lead);
+
+	aligned = mmap(aligned, map_size, PROT_READ,
+		       MAP_PRIVATE | MAP_FIXED, fd, 0);
+	if (aligned == MAP_FAILED)
+		die("mmap");
+
+	if (madvise(aligned, map_size,
+		    no_huge ? MADV_NOHUGEPAGE : MADV_HUGEPAGE))
+		fprintf(stderr, "madvise failed, "
+			"no transparent hugepage support?\n");
+
+	return aligned;
+}
+
+int bench_mem_tlb(int argc, const char **argv,
+		  const char *prefix __used)
+{
+	struct timeval start, stop, diff;
+	unsigned long lines, seed = 1;
+	u64 misses = 0, ns;
+	long long huge;
+	volatile char *area;
+	char *map;
+	size_t off;
+	int fd, dtlb_fd, i;
+	unsigned int sum = 0;
+
+	argc = parse_options(argc, argv, options,
+			     bench_mem_tlb_usage, 0);
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (file_name) {
+		struct stat st;
+
+		if (stat(file_name, &st) < 0)
+			die("stat");
+		map_size = st.st_size;
+	} else {
+		s64 sz = perf_atoll((char *)size_str);
+
+		if (sz <= 0) {
+			fprintf(stderr, "Invalid size:%s\n", size_str);
+			return 1;
+		}
+		map_size = sz;
+	}
+	map_size &= ~(HPAGE_SIZE - 1);
+	if (!map_size) {
+		fprintf(stderr, "Need at least a huge page worth of file\n");
+		return 1;
+	}
+
+	fd = open_file();
+	map = map_file(fd);
+	area = map;
+
+	/* fault the whole mapping in before measuring */
+	huge = read_vmstat("thp_file_mapped");
+	for (off = 0; off < map_size; off += page_size)
+		sum += area[off];
+	if (huge >= 0)
+		huge = read_vmstat("thp_file_mapped") - huge;
+
+	dtlb_fd = sys_perf_event_open(&dtlb_attr, 0, -1, -1, 0);
+	if (dtlb_fd < 0 && bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# dTLB-load-misses not supported, "
+		       "reporting the access time only\n");
+
+	lines = map_size / CACHELINE_SIZE;
+	if (dtlb_fd >= 0)
+		ioctl(dtlb_fd, PERF_EVENT_IOC_ENABLE, 0);
+	gettimeofday(&start, NULL);
+	ns = lat_clock_ns();
+
+	for (i = 0; i < nr_loops; i++) {
+		/* xorshift, cheap next to the TLB miss it causes */
+		seed ^= seed << 13;
+		seed ^= seed >> 7;
+		seed ^= seed << 17;
+		sum += area[(seed % lines) * CACHELINE_SIZE];
+	}
+
+	ns = lat_clock_ns() - ns;
+	gettimeofday(&stop, NULL);
+	if (dtlb_fd >= 0) {
+		ioctl(dtlb_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(dtlb_fd, &misses, sizeof(misses)) != sizeof(misses))
+			misses = 0;
+		close(dtlb_fd);
+	}
+	timersub(&stop, &start, &diff);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %zuMB of %s mapped with %s, %d random reads "
+		       "(checksum %x)\n\n", map_size >> 20,
+		       file_name ?: "a temporary file",
+		       no_huge ? "MADV_NOHUGEPAGE" : "MADV_HUGEPAGE",
+		       nr_loops, sum);
+
+	/* otherwise the numbers are for small pages, whatever was asked */
+	if (!no_huge && bench_format == BENCH_FORMAT_DEFAULT) {
+		if (huge < 0)
+			printf("# no thp_file_mapped in /proc/vmstat, "
+			       "the mapping is probably not huge\n\n");
+		else if ((size_t)huge < map_size / HPAGE_SIZE)
+			printf("# only %lld of %zu huge pages were mapped\n\n",
+			       huge, map_size / HPAGE_SIZE);
+	}
+
+	bench_print_ops(&diff, nr_loops, "reads", NULL);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14.2f nsecs/read\n",
+		       nr_loops ? (double)ns / nr_loops : 0.0);
+		if (dtlb_fd >= 0) {
+			printf(" %14llu dTLB-load-misses\n",
+			       (unsigned long long)misses);
+			printf(" %14.3f dTLB-load-misses/read\n",
+			       nr_loops ? (double)misses / nr_loops : 0.0);
+		}
+		break;
+	case BENCH_FORMAT_SIMPLE:
+		printf("%.2f\n", nr_loops ? (double)ns / nr_loops : 0.0);
+		break;
+	default:
+		break;
+	}
+
+	munmap(map, map_size);
+	close(fd);
+	return 0;
+}
@@ -13,6 +13,8 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  futex ... futex hash and wakeup paths
+ *  epoll ... epoll wakeup and fd management
  *
  */
 
@@ -52,6 +54,50 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "memset",
+	  "Simple memory set in various ways",
+	  bench_mem_memset },
+	{ "pagefault",
+	  "Anonymous page faults from many threads",
+	  bench_mem_pagefault },
+	{ "mmap",
+	  "mmap()/munmap() from many threads",
+	  bench_mem_mmap },
+	{ "replay",
+	  "Page reclaim under replayed app switches",
+	  bench_mem_replay },
+	{ "tlb",
+	  "TLB reach of read-only file mappings",
+	  bench_mem_tlb },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite futex_suites[] = {
+	{ "wake",
+	  "Uncontended FUTEX_WAKE calls",
+	  bench_futex_wake },
+	{ "wait",
+	  "FUTEX_WAIT/FUTEX_WAKE round trips between thread pairs",
+	  bench_futex_wait },
+	{ "requeue",
+	  "FUTEX_CMP_REQUEUE of a crowd of waiters",
+	  bench_futex_requeue },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite epoll_suites[] = {
+	{ "wait",
+	  "epoll_wait() wakeups on eventfds",
+	  bench_epoll_wait },
+	{ "ctl",
+	  "epoll_ctl() add/mod/del with many fds",
+	  bench_epoll_ctl },
 	suite_all,
 	{ NULL,
 	  NULL,
@@ -71,6 +117,12 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "futex",
+	  "futex hash and wakeup paths",
+	  futex_suites },
+	{ "epoll",
+	  "epoll wakeup and fd management",
+	  epoll_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },
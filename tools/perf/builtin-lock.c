@@ -12,6 +12,7 @@
 
 #include "util/debug.h"
 #include "util/session.h"
+#include "util/parse-events.h"
 
 #include <sys/types.h>
 #include <sys/prctl.h>
@@ -353,6 +354,14 @@ struct trace_release_event {
 	const char		*name;
 };
 
+/* from CONFIG_LOCK_CONTENTION_STAT, which works without lockdep */
+struct trace_contention_event {
+	void			*addr;
+	u64			ip;
+	int			type;
+	u64			wait_ns;
+};
+
 struct trace_lock_handler {
 	void (*acquire_event)(struct trace_acquire_event *,
 			      struct event *,
@@ -377,6 +386,12 @@ struct trace_lock_handler {
 			      int cpu,
 			      u64 timestamp,
 			      struct thread *thread);
+
+	void (*contention_event)(struct trace_contention_event *,
+				 struct event *,
+				 int cpu,
+				 u64 timestamp,
+				 struct thread *thread);
 };
 
 static struct lock_seq_stat *get_seq(struct thread_stat *ts, void *addr)
@@ -633,6 +648,68 @@ end:
 	return;
 }
 
+/* keep in sync with enum LOCK_CONTENTION_* in include/linux/lockdep.h */
+static const char *contention_types[] = {
+	"spin", "rwlock", "mutex", "rwsem",
+};
+
+/*
+ * Without lockdep there are no lock classes to name a lock after, so
+ * the statistics are per call site, named after the kernel function.
+ */
+static const char *contention_site_name(struct trace_contention_event *ev,
+					char *buf, size_t size)
+{
+	struct machine *machine = perf_session__find_host_machine(session);
+	struct symbol *sym = NULL;
+	struct map *map = NULL;
+
+	if (machine)
+		sym = machine__find_kernel_function(machine, ev->ip, &map, NULL);
+	if (sym)
+		snprintf(buf, size, "%s+%#" PRIx64, sym->name,
+			 map->map_ip(map, ev->ip) - sym->start);
+	else if (ev->type >= 0 &&
+		 ev->type < (int)ARRAY_SIZE(contention_types))
+		snprintf(buf, size, "%s@%#" PRIx64,
+			 contention_types[ev->type], ev->ip);
+	else
+		snprintf(buf, size, "%#" PRIx64, ev->ip);
+
+	return buf;
+}
+
+static void
+report_lock_contention_event(struct trace_contention_event *contention_event,
+			     struct event *__event __used,
+			     int cpu __used,
+			     u64 timestamp __used,
+			     struct thread *thread __used)
+{
+	void *key = (void *)(unsigned long)contention_event->ip;
+	u64 wait = contention_event->wait_ns;
+	struct list_head *entry = lockhashentry(key);
+	struct lock_stat *ls;
+	char name[128];
+
+	/* resolve the name only for sites not seen yet */
+	list_for_each_entry(ls, entry, hash_entry) {
+		if (ls->addr == key)
+			goto found;
+	}
+	ls = lock_stat_findnew(key, contention_site_name(contention_event,
+							 name, sizeof(name)));
+found:
+	/* only contended acquisitions are recorded */
+	ls->nr_acquired++;
+	ls->nr_contended++;
+	ls->wait_time_total += wait;
+	if (ls->wait_time_max < wait)
+		ls->wait_time_max = wait;
+	if (ls->wait_time_min > wait)
+		ls->wait_time_min = wait;
+}
+
 /* lock oriented handlers */
 /* TODO: handlers for CPU oriented, thread oriented */
 static struct trace_lock_handler report_lock_ops  = {
@@ -640,6 +717,7 @@ static struct trace_lock_handler report_lock_ops  = {
 	.acquired_event		= report_lock_acquired_event,
 	.contended_event	= report_lock_contended_event,
 	.release_event		= report_lock_release_event,
+	.contention_event	= report_lock_contention_event,
 };
 
 static struct trace_lock_handler *trace_handler;
@@ -717,6 +795,26 @@ process_lock_release_event(void *data,
 		trace_handler->release_event(&release_event, event, cpu, timestamp, thread);
 }
 
+static void
+process_lock_contention_event(void *data,
+			      struct event *event __used,
+			      int cpu __used,
+			      u64 timestamp __used,
+			      struct thread *thread __used)
+{
+	struct trace_contention_event contention_event;
+	u64 tmp;		/* this is required for casting... */
+
+	tmp = raw_field_value(event, "lock_addr", data);
+	memcpy(&contention_event.addr, &tmp, sizeof(void *));
+	contention_event.ip = raw_field_value(event, "ip", data);
+	contention_event.type = (int)raw_field_value(event, "type", data);
+	contention_event.wait_ns = raw_field_value(event, "wait_ns", data);
+
+	if (trace_handler->contention_event)
+		trace_handler->contention_event(&contention_event, event, cpu, timestamp, thread);
+}
+
 static void
 process_raw_event(void *data, int cpu, u64 timestamp, struct thread *thread)
 {
@@ -734,6 +832,8 @@ process_raw_event(void *data, int cpu, u64 timestamp, struct thread *thread)
 		process_lock_contended_event(data, event, cpu, timestamp, thread);
 	if (!strcmp(event->name, "lock_release"))
 		process_lock_release_event(data, event, cpu, timestamp, thread);
+	if (!strcmp(event->name, "lock_contention"))
+		process_lock_contention_event(data, event, cpu, timestamp, thread);
 }
 
 static void print_bad_events(int bad, int total)
@@ -866,6 +966,7 @@ static int process_sample_event(union perf_event *event,
 static struct perf_event_ops eops = {
 	.sample			= process_sample_event,
 	.comm			= perf_event__process_comm,
+	.mmap			= perf_event__process_mmap,
 	.ordered_samples	= true,
 };
 
@@ -948,19 +1049,41 @@ static const char *record_args[] = {
 	"-e", "lock:lock_release",
 };
 
+/* for kernels with CONFIG_LOCK_CONTENTION_STAT instead of lockdep */
+static const char *contention_record_args[] = {
+	"record",
+	"-R",
+	"-f",
+	"-m", "1024",
+	"-c", "1",
+	"-e", "lock:lock_contention",
+};
+
 static int __cmd_record(int argc, const char **argv)
 {
-	unsigned int rec_argc, i, j;
-	const char **rec_argv;
+	unsigned int rec_argc, nr_args, i, j;
+	const char **rec_argv, **args;
+
+	if (is_valid_tracepoint("lock:lock_acquire")) {
+		args = record_args;
+		nr_args = ARRAY_SIZE(record_args);
+	} else if (is_valid_tracepoint("lock:lock_contention")) {
+		args = contention_record_args;
+		nr_args = ARRAY_SIZE(contention_record_args);
+	} else {
+		pr_err("lock events not found: the kernel needs CONFIG_LOCKDEP "
+		       "or CONFIG_LOCK_CONTENTION_STAT\n");
+		return -1;
+	}
 
-	rec_argc = ARRAY_SIZE(record_args) + argc - 1;
+	rec_argc = nr_args + argc - 1;
 	rec_argv = calloc(rec_argc + 1, sizeof(char *));
 
 	if (rec_argv == NULL)
 		return -ENOMEM;
 
-	for (i = 0; i < ARRAY_SIZE(record_args); i++)
-		rec_argv[i] = strdup(record_args[i]);
+	for (i = 0; i < nr_args; i++)
+		rec_argv[i] = strdup(args[i]);
 
 	for (j = 1; j < (unsigned int)argc; j++, i++)
 		rec_argv[i] = argv[j];
@@ -12,6 +12,7 @@
 #include "util/trace-event.h"
 
 #include "util/debug.h"
+#include "util/sched-offcpu.h"
 
 #include <sys/prctl.h>
 
@@ -1355,6 +1356,9 @@ static void sort_lat(void)
 
 static struct trace_sched_handler *trace_handler;
 
+/* the sample being processed, for handlers that want its callchain */
+static struct perf_sample *curr_sample;
+
 static void
 process_sched_wakeup_event(void *data, struct perf_session *session,
 			   struct event *event,
@@ -1623,6 +1627,7 @@ static int process_sample_event(union perf_event *event,
 	if (profile_cpu != -1 && profile_cpu != (int)sample->cpu)
 		return 0;
 
+	curr_sample = sample;
 	process_raw_event(event, session, sample->raw_data, sample->cpu,
 			  sample->time, thread);
 
@@ -1743,6 +1748,65 @@ static void __cmd_map(void)
 	print_bad_events();
 }
 
+static struct ip_callchain *offcpu_callchain(struct perf_session *session)
+{
+	if (!(session->sample_type & PERF_SAMPLE_CALLCHAIN))
+		return NULL;
+	return curr_sample->callchain;
+}
+
+static void
+offcpu_switch_event(struct trace_switch_event *switch_event,
+		    struct perf_session *session,
+		    struct event *event __used,
+		    int cpu __used,
+		    u64 timestamp,
+		    struct thread *thread __used)
+{
+	offcpu__switch(session, offcpu_callchain(session),
+		       switch_event->prev_pid, switch_event->prev_state,
+		       switch_event->next_pid, timestamp);
+}
+
+static void
+offcpu_wakeup_event(struct trace_wakeup_event *wakeup_event,
+		    struct perf_session *session,
+		    struct event *event __used,
+		    int cpu __used,
+		    u64 timestamp,
+		    struct thread *thread __used)
+{
+	/* a failed wakeup found the task already running */
+	if (!wakeup_event->success)
+		return;
+
+	offcpu__wakeup(session, offcpu_callchain(session),
+		       wakeup_event->common_pid, wakeup_event->pid,
+		       timestamp);
+}
+
+static struct trace_sched_handler offcpu_ops  = {
+	.wakeup_event		= offcpu_wakeup_event,
+	.switch_event		= offcpu_switch_event,
+	.runtime_event		= NULL,
+	.fork_event		= NULL,
+};
+
+static void __cmd_offcpu(void)
+{
+	struct perf_session *session;
+
+	setup_pager();
+	read_events(false, &session);
+
+	offcpu__fprintf(session, stdout);
+
+	print_bad_events();
+	printf("\n");
+
+	perf_session__delete(session);
+}
+
 static void __cmd_replay(void)
 {
 	unsigned long i;
@@ -1777,7 +1841,7 @@ static void __cmd_replay(void)
 
 
 static const char * const sched_usage[] = {
-	"perf sched [<options>] {record|latency|map|replay|script}",
+	"perf sched [<options>] {record|latency|map|replay|offcpu|script}",
 	NULL
 };
 
@@ -1823,6 +1887,25 @@ static const struct option replay_options[] = {
 	OPT_END()
 };
 
+static const char *offcpu_sort = "comm,sym";
+
+static const char * const offcpu_usage[] = {
+	"perf sched offcpu [<options>]",
+	NULL
+};
+
+static const struct option offcpu_options[] = {
+	OPT_STRING('s', "sort", &offcpu_sort, "key[,key2...]",
+		   "sort by key(s): pid, comm, dso, symbol, parent"),
+	OPT_INTEGER('d', "chain-depth", &offcpu_chain_depth,
+		    "number of wakers to follow in wakeup chains"),
+	OPT_INCR('v', "verbose", &verbose,
+		    "be more verbose (show symbol address, etc)"),
+	OPT_BOOLEAN('D', "dump-raw-trace", &dump_trace,
+		    "dump raw trace in ASCII"),
+	OPT_END()
+};
+
 static void setup_sorting(void)
 {
 	char *tmp, *tok, *str = strdup(sort_order);
@@ -1909,6 +1992,18 @@ int cmd_sched(int argc, const char **argv, const char *prefix __used)
 		trace_handler = &map_ops;
 		setup_sorting();
 		__cmd_map();
+	} else if (!strncmp(argv[0], "off", 3)) {
+		trace_handler = &offcpu_ops;
+		if (argc > 1) {
+			argc = parse_options(argc, argv, offcpu_options, offcpu_usage, 0);
+			if (argc)
+				usage_with_options(offcpu_usage, offcpu_options);
+		}
+		if (offcpu_chain_depth < 0 || offcpu_chain_depth > OFFCPU_MAX_DEPTH)
+			usage_with_options(offcpu_usage, offcpu_options);
+		if (offcpu__init(offcpu_sort) < 0)
+			usage_with_options(offcpu_usage, offcpu_options);
+		__cmd_offcpu();
 	} else if (!strncmp(argv[0], "rep", 3)) {
 		trace_handler = &replay_ops;
 		if (argc) {
@@ -2,10 +2,15 @@
 #ifndef PERF_DWARF2_H
 #define PERF_DWARF2_H
 
-/* dwarf2.h ... dummy header file for including arch/x86/lib/memcpy_64.S */
+/*
+ * dwarf2.h ... dummy header file for including arch/x86/lib/memcpy_64.S
+ * and arch/x86/lib/memset_64.S
+ */
 
 #define CFI_STARTPROC
 #define CFI_ENDPROC
+#define CFI_REMEMBER_STATE
+#define CFI_RESTORE_STATE
 
 #endif	/* PERF_DWARF2_H */
 
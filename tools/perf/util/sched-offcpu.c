@@ -0,0 +1,432 @@
+/*
+ * Off-CPU and wakeup chain analysis for 'perf sched offcpu'.
+ *
+ * A task switched out in a sleeping state is blocked, and the callchain
+ * of that sched_switch is its blocking stack.  The sched_wakeup that makes
+ * it runnable again carries the waker's callchain.  When the task is
+ * switched back in, the time it spent off the CPU is charged to two sets
+ * of hist entries: the blocked task with its blocking stack, and the
+ * waker with the stack that woke it.  Following the waker of each waker
+ * gives the wakeup chains that explain longer waits.
+ */
+#include "util.h"
+#include "debug.h"
+#include "hist.h"
+#include "sort.h"
+#include "symbol.h"
+#include "thread.h"
+#include "session.h"
+#include "callchain.h"
+#include "sched-offcpu.h"
+
+#include <linux/rbtree.h>
+
+int offcpu_chain_depth = 3;
+
+#define OFFCPU_MAX_CHAINS	20
+#define OFFCPU_CHAIN_LEN	256
+
+struct offcpu_task {
+	struct rb_node		node;
+	pid_t			pid;
+	/* set while the task is blocked */
+	u64			block_ts;
+	struct ip_callchain	*block_chain;
+	/* the first wakeup that ends the block */
+	pid_t			waker;
+	struct ip_callchain	*waker_chain;
+	/* who ended the previous block, to follow wakeup chains */
+	pid_t			last_waker;
+};
+
+struct offcpu_chain {
+	struct rb_node		node;
+	char			*desc;
+	u64			time;
+	u64			max;
+	u64			nr;
+};
+
+static struct rb_root		offcpu_tasks;
+static struct rb_root		offcpu_chains;
+static struct hists		blocked_hists;
+static struct hists		waker_hists;
+static u64			total_offcpu;
+static u64			nr_blocks;
+static u64			nr_unwoken;
+
+/*
+ * Scheduler and wakeup internals at the top of every stack; the first
+ * frame below them says where a task blocked or what woke it.
+ */
+static const char *sched_internals[] = {
+	"schedule", "__schedule", "io_schedule", "preempt_schedule",
+	"try_to_wake_up", "wake_up_", "__wake_up", "ttwu_",
+	"default_wake_function", "autoremove_wake_function",
+};
+
+static bool sched_internal(struct symbol *sym)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(sched_internals); i++)
+		if (!strncmp(sym->name, sched_internals[i],
+			     strlen(sched_internals[i])))
+			return true;
+	return false;
+}
+
+static struct offcpu_task *offcpu_task__findnew(pid_t pid, bool create)
+{
+	struct rb_node **p = &offcpu_tasks.rb_node;
+	struct rb_node *parent = NULL;
+	struct offcpu_task *t;
+
+	while (*p) {
+		parent = *p;
+		t = rb_entry(parent, struct offcpu_task, node);
+
+		if (pid == t->pid)
+			return t;
+		if (pid < t->pid)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	if (!create)
+		return NULL;
+
+	t = zalloc(sizeof(*t));
+	if (t == NULL)
+		die("No memory");
+	t->pid = pid;
+	t->waker = -1;
+	t->last_waker = -1;
+	rb_link_node(&t->node, parent, p);
+	rb_insert_color(&t->node, &offcpu_tasks);
+
+	return t;
+}
+
+static struct ip_callchain *callchain__dup(struct ip_callchain *chain)
+{
+	size_t size;
+	void *copy;
+
+	if (chain == NULL)
+		return NULL;
+
+	size = (chain->nr + 1) * sizeof(u64);
+	copy = malloc(size);
+	if (copy == NULL)
+		die("No memory");
+
+	return memcpy(copy, chain, size);
+}
+
+static void offcpu_task__clear(struct offcpu_task *t)
+{
+	free(t->block_chain);
+	free(t->waker_chain);
+	t->block_chain = t->waker_chain = NULL;
+	t->block_ts = 0;
+	t->waker = -1;
+}
+
+static int offcpu__add_entry(struct hists *hists, struct perf_session *session,
+			     struct thread *thread, struct ip_callchain *chain,
+			     u64 period)
+{
+	struct callchain_cursor *cursor = &session->callchain_cursor;
+	struct addr_location al = {
+		.thread	= thread,
+		.level	= '.',
+	};
+	struct callchain_cursor_node *node;
+	struct symbol *parent = NULL;
+	struct hist_entry *he;
+
+	callchain_cursor_reset(cursor);
+	if (chain && perf_session__resolve_callchain(session, thread,
+						     chain, &parent))
+		return -1;
+
+	/* key the entry on the first frame outside the scheduler */
+	callchain_cursor_commit(cursor);
+	while ((node = callchain_cursor_current(cursor)) != NULL) {
+		if (node->sym && !sched_internal(node->sym)) {
+			al.map = node->map;
+			al.sym = node->sym;
+			al.addr = node->ip;
+			if (node->map && node->map->dso->kernel)
+				al.level = 'k';
+			break;
+		}
+		callchain_cursor_advance(cursor);
+	}
+
+	he = __hists__add_entry(hists, &al, parent, period);
+	if (he == NULL)
+		return -ENOMEM;
+
+	if (symbol_conf.use_callchain &&
+	    callchain_append(he->callchain, cursor, period))
+		return -ENOMEM;
+
+	hists->stats.total_period += period;
+	hists__inc_nr_events(hists, PERF_RECORD_SAMPLE);
+
+	return 0;
+}
+
+static void offcpu__add_chain(const char *desc, u64 delta)
+{
+	struct rb_node **p = &offcpu_chains.rb_node;
+	struct rb_node *parent = NULL;
+	struct offcpu_chain *c;
+	int cmp;
+
+	while (*p) {
+		parent = *p;
+		c = rb_entry(parent, struct offcpu_chain, node);
+
+		cmp = strcmp(desc, c->desc);
+		if (!cmp)
+			goto found;
+		if (cmp < 0)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+
+	c = zalloc(sizeof(*c));
+	if (c == NULL || (c->desc = strdup(desc)) == NULL)
+		die("No memory");
+	rb_link_node(&c->node, parent, p);
+	rb_insert_color(&c->node, &offcpu_chains);
+found:
+	c->time += delta;
+	c->nr++;
+	if (delta > c->max)
+		c->max = delta;
+}
+
+static const char *offcpu__comm(struct perf_session *session, pid_t pid)
+{
+	struct thread *thread = perf_session__findnew(session, pid);
+
+	return thread ? thread->comm : "<unknown>";
+}
+
+/* "blocked <- waker <- waker's waker ..." */
+static void offcpu__account_chain(struct perf_session *session,
+				  struct offcpu_task *t, u64 delta)
+{
+	pid_t seen[OFFCPU_MAX_DEPTH + 1];
+	char desc[OFFCPU_CHAIN_LEN];
+	struct offcpu_task *w;
+	pid_t pid = t->waker;
+	int depth, i;
+	size_t len;
+
+	len = scnprintf(desc, sizeof(desc), "%s",
+			offcpu__comm(session, t->pid));
+	seen[0] = t->pid;
+
+	for (depth = 0; depth < offcpu_chain_depth && pid >= 0; depth++) {
+		/* ping-pong partners wake each other, stop at the loop */
+		for (i = 0; i <= depth; i++)
+			if (seen[i] == pid)
+				goto out;
+		seen[depth + 1] = pid;
+
+		len += scnprintf(desc + len, sizeof(desc) - len, " <- %s",
+				 pid ? offcpu__comm(session, pid) : "[irq/idle]");
+		w = offcpu_task__findnew(pid, false);
+		if (!pid || w == NULL)
+			break;
+		pid = w->last_waker;
+	}
+out:
+
+	offcpu__add_chain(desc, delta);
+}
+
+static void offcpu__account(struct perf_session *session,
+			    struct offcpu_task *t, u64 delta)
+{
+	struct thread *thread;
+
+	nr_blocks++;
+	total_offcpu += delta;
+
+	thread = perf_session__findnew(session, t->pid);
+	if (thread == NULL ||
+	    offcpu__add_entry(&blocked_hists, session, thread,
+			      t->block_chain, delta))
+		pr_debug("problem adding off-cpu entry for %d\n", t->pid);
+
+	if (t->waker < 0) {
+		nr_unwoken++;
+		return;
+	}
+
+	thread = perf_session__findnew(session, t->waker);
+	if (thread == NULL ||
+	    offcpu__add_entry(&waker_hists, session, thread,
+			      t->waker_chain, delta))
+		pr_debug("problem adding waker entry for %d\n", t->waker);
+
+	offcpu__account_chain(session, t, delta);
+	t->last_waker = t->waker;
+}
+
+void offcpu__switch(struct perf_session *session, struct ip_callchain *chain,
+		    pid_t prev_pid, u64 prev_state, pid_t next_pid, u64 ts)
+{
+	struct offcpu_task *t;
+
+	/* preempted tasks are still runnable, only sleeps count */
+	if (prev_pid && prev_state) {
+		t = offcpu_task__findnew(prev_pid, true);
+		offcpu_task__clear(t);
+		t->block_ts = ts;
+		t->block_chain = callchain__dup(chain);
+	}
+
+	if (!next_pid)
+		return;
+
+	t = offcpu_task__findnew(next_pid, false);
+	if (t == NULL || !t->block_ts)
+		return;
+
+	if (ts > t->block_ts)
+		offcpu__account(session, t, ts - t->block_ts);
+	offcpu_task__clear(t);
+}
+
+void offcpu__wakeup(struct perf_session *session __used,
+		    struct ip_callchain *chain, pid_t waker_pid,
+		    pid_t wakee_pid, u64 ts __used)
+{
+	struct offcpu_task *t = offcpu_task__findnew(wakee_pid, false);
+
+	/* only the wakeup that ends a block we saw start is interesting */
+	if (t == NULL || !t->block_ts || t->waker >= 0)
+		return;
+
+	t->waker = waker_pid;
+	t->waker_chain = callchain__dup(chain);
+}
+
+int offcpu__init(const char *sort_keys)
+{
+	char *tmp, *tok, *str = strdup(sort_keys);
+
+	if (str == NULL)
+		return -ENOMEM;
+
+	sort_order = sort_keys;
+	for (tok = strtok_r(str, ", ", &tmp);
+			tok; tok = strtok_r(NULL, ", ", &tmp)) {
+		if (sort_dimension__add(tok) < 0) {
+			error("Unknown --sort key: `%s'", tok);
+			free(str);
+			return -EINVAL;
+		}
+	}
+	free(str);
+
+	symbol_conf.use_callchain = true;
+	symbol_conf.show_nr_samples = true;
+	if (callchain_register_param(&callchain_param) < 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int chain_cmp(const void *a, const void *b)
+{
+	const struct offcpu_chain *l = *(const struct offcpu_chain **)a;
+	const struct offcpu_chain *r = *(const struct offcpu_chain **)b;
+
+	if (l->time == r->time)
+		return 0;
+	return l->time < r->time ? 1 : -1;
+}
+
+static size_t offcpu__fprintf_chains(FILE *fp)
+{
+	struct offcpu_chain **sorted;
+	struct rb_node *nd;
+	size_t ret = 0, nr = 0, i;
+
+	for (nd = rb_first(&offcpu_chains); nd; nd = rb_next(nd))
+		nr++;
+	if (!nr)
+		return 0;
+
+	sorted = calloc(nr, sizeof(*sorted));
+	if (sorted == NULL)
+		return 0;
+
+	nr = 0;
+	for (nd = rb_first(&offcpu_chains); nd; nd = rb_next(nd))
+		sorted[nr++] = rb_entry(nd, struct offcpu_chain, node);
+	qsort(sorted, nr, sizeof(*sorted), chain_cmp);
+
+	ret += fprintf(fp, "#\n# Wakeup chains (blocked <- waker <- ...), "
+		       "top %d by off-CPU time\n#\n", OFFCPU_MAX_CHAINS);
+	ret += fprintf(fp, "# %12s %10s %12s  %s\n", "Total ms", "Blocks",
+		       "Max ms", "Chain");
+	for (i = 0; i < nr && i < OFFCPU_MAX_CHAINS; i++)
+		ret += fprintf(fp, "  %12.3f %10" PRIu64 " %12.3f  %s\n",
+			       sorted[i]->time / 1e6, sorted[i]->nr,
+			       sorted[i]->max / 1e6, sorted[i]->desc);
+
+	free(sorted);
+	return ret;
+}
+
+static size_t offcpu__fprintf_hists(struct hists *hists, const char *title,
+				    FILE *fp)
+{
+	size_t ret;
+
+	hists__collapse_resort(hists);
+	hists__output_resort(hists);
+
+	ret = fprintf(fp, "#\n# %s\n#\n", title);
+	ret += hists__fprintf(hists, NULL, false, fp);
+	ret += fprintf(fp, "\n");
+
+	return ret;
+}
+
+size_t offcpu__fprintf(struct perf_session *session, FILE *fp)
+{
+	size_t ret = 0;
+
+	if (!nr_blocks) {
+		fprintf(fp, "No blocked tasks found.\n");
+		return 0;
+	}
+
+	if (!(session->sample_type & PERF_SAMPLE_CALLCHAIN))
+		ret += fprintf(fp, "# No callchains recorded, use "
+			       "'perf sched record -g' to see stacks.\n");
+
+	ret += fprintf(fp, "# %" PRIu64 " blocks, %.3f ms off-CPU, "
+		       "%" PRIu64 " without a recorded wakeup\n",
+		       nr_blocks, total_offcpu / 1e6, nr_unwoken);
+
+	ret += offcpu__fprintf_hists(&blocked_hists,
+			"Off-CPU time by blocked task and blocking stack", fp);
+	ret += offcpu__fprintf_hists(&waker_hists,
+			"Off-CPU time by waker and waking stack", fp);
+	ret += offcpu__fprintf_chains(fp);
+
+	return ret;
+}
@@ -0,0 +1,21 @@
+#ifndef __PERF_SCHED_OFFCPU_H
+#define __PERF_SCHED_OFFCPU_H
+
+#include <linux/types.h>
+#include <stdio.h>
+
+struct perf_session;
+struct ip_callchain;
+
+#define OFFCPU_MAX_DEPTH	16
+
+extern int offcpu_chain_depth;
+
+int offcpu__init(const char *sort_keys);
+void offcpu__switch(struct perf_session *session, struct ip_callchain *chain,
+		    pid_t prev_pid, u64 prev_state, pid_t next_pid, u64 ts);
+void offcpu__wakeup(struct perf_session *session, struct ip_callchain *chain,
+		    pid_t waker_pid, pid_t wakee_pid, u64 ts);
+size_t offcpu__fprintf(struct perf_session *session, FILE *fp);
+
+#endif	/* __PERF_SCHED_OFFCPU_H */
@@ -42,6 +42,9 @@ struct slabinfo {
 	unsigned long deactivate_remote_frees, order_fallback;
 	unsigned long cmpxchg_double_cpu_fail, cmpxchg_double_fail;
 	unsigned long alloc_node_mismatch, deactivate_bypass;
+	unsigned long cpu_partial_alloc, cpu_partial_free, cpu_partial_drain;
+	unsigned long alloc_list_lock, free_list_lock;
+	int cpu_partial;
 	int numa[MAX_NODES];
 	int numa_partial[MAX_NODES];
 } slabinfo[MAX_SLABS];
@@ -420,6 +423,7 @@ static void slab_stats(struct slabinfo *s)
 	unsigned long total_alloc;
 	unsigned long total_free;
 	unsigned long total;
+	unsigned long alloc_slowpath;
 
 	if (!s->alloc_slab)
 		return;
@@ -487,6 +491,27 @@ static void slab_stats(struct slabinfo *s)
 			s->alloc_node_mismatch, (s->alloc_node_mismatch * 100) / total);
 	}
 
+	alloc_slowpath = total_alloc - s->alloc_fastpath;
+	if (alloc_slowpath || s->free_slowpath) {
+		printf("\nSlowpath (cpu_partial=%d)  Alloc     Free %%Al %%Fr\n",
+			s->cpu_partial);
+		printf("--------------------------------------------------\n");
+		printf("Cpu partial list     %8lu %8lu %3lu %3lu\n",
+			s->cpu_partial_alloc, s->cpu_partial_free,
+			alloc_slowpath ?
+				s->cpu_partial_alloc * 100 / alloc_slowpath : 0,
+			s->free_slowpath ?
+				s->cpu_partial_free * 100 / s->free_slowpath : 0);
+		printf("Node list_lock       %8lu %8lu %3lu %3lu\n",
+			s->alloc_list_lock, s->free_list_lock,
+			alloc_slowpath ?
+				s->alloc_list_lock * 100 / alloc_slowpath : 0,
+			s->free_slowpath ?
+				s->free_list_lock * 100 / s->free_slowpath : 0);
+		if (s->cpu_partial_drain)
+			printf("Cpu partial drains   %8lu\n", s->cpu_partial_drain);
+	}
+
 	if (s->cmpxchg_double_fail || s->cmpxchg_double_cpu_fail)
 		printf("\nCmpxchg_double Looping\n------------------------\n");
 		printf("Locked Cmpxchg Double redos   %lu\nUnlocked Cmpxchg Double redos %lu\n",
@@ -1211,6 +1236,12 @@ static void read_slab_dir(void)
 			slab->cmpxchg_double_fail = get_obj("cmpxchg_double_fail");
 			slab->alloc_node_mismatch = get_obj("alloc_node_mismatch");
 			slab->deactivate_bypass = get_obj("deactivate_bypass");
+			slab->cpu_partial = get_obj("cpu_partial");
+			slab->cpu_partial_alloc = get_obj("cpu_partial_alloc");
+			slab->cpu_partial_free = get_obj("cpu_partial_free");
+			slab->cpu_partial_drain = get_obj("cpu_partial_drain");
+			slab->alloc_list_lock = get_obj("alloc_list_lock");
+			slab->free_list_lock = get_obj("free_list_lock");
 			chdir("..");
 			if (slab->name[0] == ':')
 				alias_targets++;
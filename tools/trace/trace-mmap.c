@@ -0,0 +1,140 @@
+/*
+ * trace-mmap.c: consume the ftrace ring buffer of one CPU through mmap
+ *
+ * Maps per_cpu/cpuN/trace_pipe_raw, swaps in reader pages with
+ * TRACE_MMAP_IOCTL_GET_READER and prints the events in place, without
+ * copying the pages out of the kernel.
+ *
+ * Released under the GPL v2.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "trace-reader.h"
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: trace-mmap [-d tracing_dir] [-c cpu] [-n pages] [-q]\n"
+		"  -d  tracing directory (default /sys/kernel/debug/tracing)\n"
+		"  -c  cpu to read (default 0)\n"
+		"  -n  stop after this many pages (default: run forever)\n"
+		"  -q  only count events and report the read rate\n");
+	exit(1);
+}
+
+static void print_record(struct tr_cpu *c, struct tr_record *rec)
+{
+	struct tr_event *ev = rec->event;
+	int i;
+
+	printf("[%03d] %llu.%06llu: ", c->cpu, rec->ts / 1000000000ULL,
+	       (rec->ts / 1000ULL) % 1000000ULL);
+	if (!ev) {
+		printf("unknown event (%d bytes)\n", rec->size);
+		return;
+	}
+
+	printf("%s:", ev->name);
+	for (i = 0; i < ev->nr_fields; i++) {
+		struct tr_field *f = &ev->fields[i];
+
+		if (!strncmp(f->name, "common_", 7))
+			continue;
+		/* strings and arrays are shown by size only */
+		if (f->size > 8 || strchr(f->type, '['))
+			printf(" %s=<%d>", f->name, f->size);
+		else
+			printf(" %s=%llu", f->name, tr_read_field(rec, f));
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long events = 0, missed = 0;
+	struct timeval start, end;
+	const char *dir = NULL;
+	struct tr_handle *h;
+	struct tr_record rec;
+	struct tr_cpu *c;
+	long max_pages = -1;
+	long pages = 0;
+	int quiet = 0;
+	int cpu = 0;
+	double secs;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:c:n:q")) != -1) {
+		switch (opt) {
+		case 'd':
+			dir = optarg;
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'n':
+			max_pages = atol(optarg);
+			break;
+		case 'q':
+			quiet = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	h = tr_open(dir);
+	if (!h) {
+		perror("tracing directory");
+		return 1;
+	}
+	if (tr_load_events(h) < 0) {
+		perror("events");
+		return 1;
+	}
+
+	c = tr_cpu_open(h, cpu);
+	if (!c) {
+		perror("trace_pipe_raw");
+		return 1;
+	}
+
+	gettimeofday(&start, NULL);
+	while (max_pages < 0 || pages < max_pages) {
+		int ret = tr_cpu_swap(c);
+
+		if (ret < 0) {
+			perror("swap reader page");
+			break;
+		}
+		if (!ret) {
+			usleep(100000);
+			continue;
+		}
+
+		pages++;
+		if (c->missed)
+			missed++;
+		while (tr_cpu_next(c, &rec)) {
+			events++;
+			if (!quiet)
+				print_record(c, &rec);
+		}
+	}
+	gettimeofday(&end, NULL);
+
+	secs = (end.tv_sec - start.tv_sec) +
+	       (end.tv_usec - start.tv_usec) / 1000000.0;
+	fprintf(stderr, "cpu %d: %llu events in %ld pages (%llu with lost "
+		"events), %.0f events/sec\n", cpu, events, pages, missed,
+		secs > 0 ? events / secs : 0.0);
+
+	tr_cpu_close(c);
+	tr_close(h);
+
+	return 0;
+}
@@ -0,0 +1,444 @@
+/*
+ * trace-reader.c: parse ftrace ring buffer pages in place
+ *
+ * Released under the GPL v2.
+ */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "../../include/linux/trace_mmap.h"
+#include "trace-reader.h"
+
+/* see include/linux/ring_buffer.h */
+struct rb_event {
+	unsigned int	type_len:5, time_delta:27;
+	unsigned int	array[];
+};
+
+#define RB_TYPE_DATA_MAX	28
+#define RB_TYPE_PADDING		29
+#define RB_TYPE_TIME_EXTEND	30
+#define RB_TYPE_TIME_STAMP	31
+
+#define RB_EVNT_HDR_SIZE	4
+#define RB_LEN_TIME_EXTEND	8
+#define RB_LEN_TIME_STAMP	16
+
+#define RB_COMMIT_MASK		0xfffff
+#define RB_MISSED_EVENTS	(1U << 31)
+
+static int page_size;
+
+static char *tr_path(struct tr_handle *h, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static char *tr_path(struct tr_handle *h, const char *fmt, ...)
+{
+	static char path[4096];
+	va_list ap;
+	int len;
+
+	len = snprintf(path, sizeof(path), "%s/", h->dir);
+	va_start(ap, fmt);
+	vsnprintf(path + len, sizeof(path) - len, fmt, ap);
+	va_end(ap);
+
+	return path;
+}
+
+/*
+ * Parse one "\tfield:<type> <name>;\toffset:N;\tsize:N;\tsigned:N;" line.
+ * Returns 0 on success.
+ */
+static int parse_field(char *line, struct tr_field *f)
+{
+	char *decl, *end, *name, *p;
+
+	decl = strstr(line, "field:");
+	if (!decl)
+		return -1;
+	decl += strlen("field:");
+	end = strchr(decl, ';');
+	if (!end)
+		return -1;
+	*end = '\0';
+
+	/* the name is the last word of the declaration, minus any [N] */
+	p = strchr(decl, '[');
+	if (p)
+		*p = '\0';
+	while (*decl == ' ')
+		decl++;
+	name = strrchr(decl, ' ');
+	if (!name)
+		return -1;
+	*name++ = '\0';
+
+	snprintf(f->name, sizeof(f->name), "%s", name);
+	snprintf(f->type, sizeof(f->type), "%s", decl);
+
+	p = end + 1;
+	if (sscanf(p, " offset:%d; size:%d; signed:%d;",
+		   &f->offset, &f->size, &f->is_signed) < 2)
+		return -1;
+
+	return 0;
+}
+
+static int parse_header_page(struct tr_handle *h)
+{
+	struct tr_field f;
+	char line[512];
+	FILE *fp;
+
+	fp = fopen(tr_path(h, "events/header_page"), "r");
+	if (!fp)
+		return -1;
+
+	h->commit_offset = 8;
+	h->commit_size = sizeof(long);
+	h->data_offset = 8 + sizeof(long);
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (parse_field(line, &f))
+			continue;
+		if (!strcmp(f.name, "commit")) {
+			h->commit_offset = f.offset;
+			h->commit_size = f.size;
+		} else if (!strcmp(f.name, "data"))
+			h->data_offset = f.offset;
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+struct tr_handle *tr_open(const char *tracing_dir)
+{
+	struct tr_handle *h;
+
+	if (!page_size)
+		page_size = getpagesize();
+
+	h = calloc(1, sizeof(*h));
+	if (!h)
+		return NULL;
+
+	h->dir = strdup(tracing_dir ? : "/sys/kernel/debug/tracing");
+	if (!h->dir || parse_header_page(h)) {
+		tr_close(h);
+		return NULL;
+	}
+
+	return h;
+}
+
+void tr_close(struct tr_handle *h)
+{
+	int i;
+
+	for (i = 0; i < h->nr_events; i++) {
+		if (h->events[i]) {
+			free(h->events[i]->fields);
+			free(h->events[i]);
+		}
+	}
+	free(h->events);
+	free(h->dir);
+	free(h);
+}
+
+static int add_event(struct tr_handle *h, struct tr_event *ev)
+{
+	if (ev->id >= h->nr_events) {
+		struct tr_event **events;
+		int nr = ev->id + 64;
+
+		events = realloc(h->events, nr * sizeof(*events));
+		if (!events)
+			return -1;
+		memset(events + h->nr_events, 0,
+		       (nr - h->nr_events) * sizeof(*events));
+		h->events = events;
+		h->nr_events = nr;
+	}
+	h->events[ev->id] = ev;
+
+	return 0;
+}
+
+static struct tr_event *load_event(struct tr_handle *h, const char *system,
+				   const char *name)
+{
+	struct tr_event *ev;
+	struct tr_field f;
+	char line[512];
+	FILE *fp;
+
+	fp = fopen(tr_path(h, "events/%s/%s/format", system, name), "r");
+	if (!fp)
+		return NULL;
+
+	ev = calloc(1, sizeof(*ev));
+	if (!ev)
+		goto out;
+	ev->id = -1;
+	snprintf(ev->system, sizeof(ev->system), "%s", system);
+	snprintf(ev->name, sizeof(ev->name), "%s", name);
+
+	while (fgets(line, sizeof(line), fp)) {
+		struct tr_field *fields;
+
+		if (sscanf(line, "ID: %d", &ev->id) == 1)
+			continue;
+		if (!strncmp(line, "print fmt:", 10))
+			break;
+		if (parse_field(line, &f))
+			continue;
+
+		fields = realloc(ev->fields, (ev->nr_fields + 1) * sizeof(f));
+		if (!fields)
+			break;
+		ev->fields = fields;
+		ev->fields[ev->nr_fields++] = f;
+	}
+
+	if (ev->id < 0) {
+		free(ev->fields);
+		free(ev);
+		ev = NULL;
+	}
+ out:
+	fclose(fp);
+	return ev;
+}
+
+int tr_load_events(struct tr_handle *h)
+{
+	struct dirent *sys, *evd;
+	DIR *sdir, *edir;
+	int count = 0;
+
+	sdir = opendir(tr_path(h, "events"));
+	if (!sdir)
+		return -1;
+
+	while ((sys = readdir(sdir))) {
+		if (sys->d_name[0] == '.')
+			continue;
+
+		edir = opendir(tr_path(h, "events/%s", sys->d_name));
+		if (!edir)
+			continue;
+
+		while ((evd = readdir(edir))) {
+			struct tr_event *ev;
+
+			if (evd->d_name[0] == '.')
+				continue;
+			ev = load_event(h, sys->d_name, evd->d_name);
+			if (!ev)
+				continue;
+			if (add_event(h, ev)) {
+				free(ev->fields);
+				free(ev);
+				continue;
+			}
+			count++;
+		}
+		closedir(edir);
+	}
+	closedir(sdir);
+
+	return count;
+}
+
+struct tr_event *tr_find_event(struct tr_handle *h, int id)
+{
+	if (id < 0 || id >= h->nr_events)
+		return NULL;
+	return h->events[id];
+}
+
+struct tr_event *tr_find_event_by_name(struct tr_handle *h,
+				       const char *system, const char *name)
+{
+	int i;
+
+	for (i = 0; i < h->nr_events; i++) {
+		struct tr_event *ev = h->events[i];
+
+		if (ev && !strcmp(ev->name, name) &&
+		    (!system || !strcmp(ev->system, system)))
+			return ev;
+	}
+	return NULL;
+}
+
+struct tr_field *tr_find_field(struct tr_event *event, const char *name)
+{
+	int i;
+
+	for (i = 0; i < event->nr_fields; i++)
+		if (!strcmp(event->fields[i].name, name))
+			return &event->fields[i];
+	return NULL;
+}
+
+static unsigned long long read_int(void *ptr, int size, int is_signed)
+{
+	switch (size) {
+	case 1:
+		return is_signed ? (long long)*(signed char *)ptr :
+			*(unsigned char *)ptr;
+	case 2:
+		return is_signed ? (long long)*(short *)ptr :
+			*(unsigned short *)ptr;
+	case 4:
+		return is_signed ? (long long)*(int *)ptr :
+			*(unsigned int *)ptr;
+	case 8:
+		return *(unsigned long long *)ptr;
+	}
+	return 0;
+}
+
+unsigned long long tr_read_field(struct tr_record *rec,
+				 struct tr_field *field)
+{
+	if (field->offset + field->size > rec->size)
+		return 0;
+	return read_int(rec->data + field->offset, field->size,
+			field->is_signed);
+}
+
+struct tr_cpu *tr_cpu_open(struct tr_handle *h, int cpu)
+{
+	struct tr_cpu *c;
+
+	c = calloc(1, sizeof(*c));
+	if (!c)
+		return NULL;
+
+	c->handle = h;
+	c->cpu = cpu;
+	c->fd = open(tr_path(h, "per_cpu/cpu%d/trace_pipe_raw", cpu),
+		     O_RDONLY);
+	if (c->fd < 0)
+		goto out_free;
+
+	c->page = mmap(NULL, page_size, PROT_READ, MAP_SHARED, c->fd, 0);
+	if (c->page == MAP_FAILED)
+		goto out_close;
+
+	return c;
+
+ out_close:
+	close(c->fd);
+ out_free:
+	free(c);
+	return NULL;
+}
+
+void tr_cpu_close(struct tr_cpu *c)
+{
+	munmap(c->page, page_size);
+	close(c->fd);
+	free(c);
+}
+
+/*
+ * Hand the mapped page back and map the next one.
+ * Returns 1 if a new page is mapped, 0 if there was nothing to read
+ * and -1 on error.
+ */
+int tr_cpu_swap(struct tr_cpu *c)
+{
+	struct tr_handle *h = c->handle;
+	unsigned int commit;
+
+	if (ioctl(c->fd, TRACE_MMAP_IOCTL_GET_READER) < 0) {
+		c->commit = c->pos = 0;
+		return errno == EAGAIN ? 0 : -1;
+	}
+
+	c->ts = *(unsigned long long *)c->page;
+	commit = read_int(c->page + h->commit_offset, h->commit_size, 0);
+	c->missed = !!(commit & RB_MISSED_EVENTS);
+	c->commit = commit & RB_COMMIT_MASK;
+	if (c->commit > (unsigned int)(page_size - h->data_offset))
+		c->commit = page_size - h->data_offset;
+	c->pos = 0;
+
+	return 1;
+}
+
+/*
+ * Return the next data record of the mapped page in @rec: 1 if one was
+ * found, 0 once the page is used up.
+ */
+int tr_cpu_next(struct tr_cpu *c, struct tr_record *rec)
+{
+	void *data = c->page + c->handle->data_offset;
+
+	while (c->pos + RB_EVNT_HDR_SIZE <= c->commit) {
+		struct rb_event *event = data + c->pos;
+		unsigned int len;
+
+		switch (event->type_len) {
+		case RB_TYPE_PADDING:
+			/* a null padding event fills the rest of the page */
+			if (!event->time_delta) {
+				c->pos = c->commit;
+				return 0;
+			}
+			/* discarded event, its delta does not count */
+			c->pos += event->array[0] + RB_EVNT_HDR_SIZE;
+			continue;
+		case RB_TYPE_TIME_EXTEND:
+			c->ts += ((unsigned long long)event->array[0] << 27) +
+				 event->time_delta;
+			c->pos += RB_LEN_TIME_EXTEND;
+			continue;
+		case RB_TYPE_TIME_STAMP:
+			c->pos += RB_LEN_TIME_STAMP;
+			continue;
+		case 0:
+			len = event->array[0];
+			rec->data = &event->array[1];
+			rec->size = len - sizeof(event->array[0]);
+			len += RB_EVNT_HDR_SIZE;
+			break;
+		default:
+			len = event->type_len * 4;
+			rec->data = &event->array[0];
+			rec->size = len;
+			len += RB_EVNT_HDR_SIZE;
+			break;
+		}
+
+		if (!len || c->pos + len > c->commit) {
+			c->pos = c->commit;
+			return 0;
+		}
+
+		c->ts += event->time_delta;
+		c->pos += len;
+
+		rec->ts = c->ts;
+		/* every trace event starts with its unsigned short type */
+		rec->event = tr_find_event(c->handle,
+					   *(unsigned short *)rec->data);
+		return 1;
+	}
+
+	return 0;
+}
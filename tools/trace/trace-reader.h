@@ -0,0 +1,73 @@
+#ifndef __TRACE_READER_H
+#define __TRACE_READER_H
+
+/*
+ * Minimal reader for the ftrace ring buffer pages exported through
+ * per_cpu/cpuN/trace_pipe_raw. Pages are consumed in place through the
+ * read-only mapping of the file; event layouts come from the format files
+ * under events/.
+ */
+
+#define TR_NAME_MAX	64
+
+struct tr_field {
+	char		name[TR_NAME_MAX];
+	char		type[TR_NAME_MAX];
+	int		offset;
+	int		size;
+	int		is_signed;
+};
+
+struct tr_event {
+	int		id;
+	char		system[TR_NAME_MAX];
+	char		name[TR_NAME_MAX];
+	int		nr_fields;
+	struct tr_field	*fields;
+};
+
+struct tr_handle {
+	char		*dir;
+	/* events indexed by id */
+	struct tr_event	**events;
+	int		nr_events;
+	/* page header layout, from events/header_page */
+	int		commit_offset;
+	int		commit_size;
+	int		data_offset;
+};
+
+struct tr_record {
+	unsigned long long	ts;
+	struct tr_event		*event;
+	void			*data;
+	int			size;
+};
+
+struct tr_cpu {
+	struct tr_handle	*handle;
+	int			cpu;
+	int			fd;
+	void			*page;
+	unsigned long long	ts;
+	unsigned int		commit;
+	unsigned int		pos;
+	int			missed;
+};
+
+struct tr_handle *tr_open(const char *tracing_dir);
+void tr_close(struct tr_handle *h);
+int tr_load_events(struct tr_handle *h);
+struct tr_event *tr_find_event(struct tr_handle *h, int id);
+struct tr_event *tr_find_event_by_name(struct tr_handle *h,
+				       const char *system, const char *name);
+struct tr_field *tr_find_field(struct tr_event *event, const char *name);
+unsigned long long tr_read_field(struct tr_record *rec,
+				 struct tr_field *field);
+
+struct tr_cpu *tr_cpu_open(struct tr_handle *h, int cpu);
+void tr_cpu_close(struct tr_cpu *c);
+int tr_cpu_swap(struct tr_cpu *c);
+int tr_cpu_next(struct tr_cpu *c, struct tr_record *rec);
+
+#endif /* __TRACE_READER_H */